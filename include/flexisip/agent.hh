@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <ifaddrs.h>
 #include <memory>
 #include <sstream>
@@ -54,6 +55,7 @@ namespace flexisip {
 
 class Module;
 class DomainRegistrationManager;
+class OverloadControl;
 
 /**
  * The agent class represents a SIP agent.
@@ -193,8 +195,15 @@ public:
 	void incrReplyStat(int status);
 	bool doOnConfigStateChanged(const ConfigValue& conf, ConfigState state) override;
 	void logEvent(const std::shared_ptr<SipEvent>& ev);
+	/**
+	 * Write an event log which isn't attached to any SipEvent.
+	 */
+	void writeEventLog(const std::shared_ptr<const EventLog>& evlog);
 	std::shared_ptr<Module> findModule(const std::string& moduleName) const;
 	std::shared_ptr<Module> findModuleByFunction(const std::string& moduleFunction) const;
+	const std::list<std::shared_ptr<Module>>& getModules() const {
+		return mModules;
+	}
 	nth_engine_t* getHttpEngine() {
 		return mHttpEngine;
 	}
@@ -239,6 +248,7 @@ private:
 	void initializePreferredRoute();
 	void loadModules();
 	void startMdns();
+	void dumpLatencyStats() const;
 
 	static int messageCallback(nta_agent_magic_t* context, nta_agent_t* agent, msg_t* msg, sip_t* sip);
 	static void printEventTailSeparator();
@@ -269,6 +279,9 @@ private:
 	std::string mPassphrase;
 	tport_t* mInternalTport = nullptr;
 	bool mTerminating = false;
+	std::chrono::seconds mLatencyDumpInterval{0};
+	std::chrono::steady_clock::time_point mLastLatencyDump{};
+	std::unique_ptr<OverloadControl> mOverloadControl;
 #if ENABLE_MDNS
 	std::vector<belle_sip_mdns_register_t*> mMdnsRegisterList;
 #endif
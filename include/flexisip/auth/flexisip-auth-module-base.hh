@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -52,6 +53,16 @@ public:
 
 	NonceStore &nonceStore() {return mNonceStore;}
 
+	/**
+	 * Issue nonces which need no storage to be validated, instead of storing every issued nonce in the NonceStore.
+	 * See StatelessNonceStore.
+	 */
+	void enableStatelessNonces();
+	/**
+	 * @return The store of stateless nonces, or nullptr if they are not enabled.
+	 */
+	StatelessNonceStore *statelessNonceStore() {return mStatelessNonceStore.get();}
+
 protected:
 	void onCheck(AuthStatus &as, msg_auth_t *credentials, auth_challenger_t const *ach) override;
 	void onChallenge(AuthStatus &as, auth_challenger_t const *ach) override;
@@ -70,7 +81,14 @@ protected:
 	void notify(FlexisipAuthStatus &as);
 	void onError(FlexisipAuthStatus &as);
 
+	/**
+	 * Information about the client, to which stateless nonces are bound.
+	 */
+	static std::string getClientInfo(const AuthStatus &as);
+
 	NonceStore mNonceStore;
+	std::unique_ptr<StatelessNonceStore> mStatelessNonceStore;
+	int mNonceExpires = 3600;
 	bool mQOPAuth = false;
 };
 
@@ -18,10 +18,13 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <ctime>
 #include <map>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include <sofia-sip/msg_types.h>
 
@@ -50,4 +53,61 @@ private:
 	int mNonceExpires = 3600;
 };
 
+/**
+ * Nonces which need no storage to be validated.
+ * A nonce is made of its issuing time followed by a HMAC-SHA256, truncated to 128 bits, of this time and of the client
+ * information given on generation (realm and user, typically). Hence it can only be used by the client it has been
+ * issued to, and its validity period can be checked without looking it up.
+ * Only the last nonce count of the nonces actually used by clients is kept in memory, to detect replays. The counts are
+ * split into shards, each with its own lock, and grouped by issuing time, so that expired counts are dropped by
+ * buckets instead of being scanned one by one.
+ * The HMAC key is generated randomly on construction.
+ */
+class StatelessNonceStore {
+public:
+	enum class Validity { Valid, Stale, Invalid };
+
+	explicit StatelessNonceStore(int nonceExpires);
+
+	std::string generate(const std::string &clientInfo, std::time_t now) const;
+	/**
+	 * Check that the nonce has been issued by this store to the given client, and is not expired.
+	 * @param[out] issued The issuing time of the nonce, when it is not invalid.
+	 */
+	Validity validate(const std::string &nonce, const std::string &clientInfo, std::time_t now,
+					  std::time_t &issued) const;
+
+	/**
+	 * Record the nonce count used with a valid nonce.
+	 * @return False if the nonce count is not greater than the last one used with this nonce, which means that the
+	 * request is replayed.
+	 */
+	bool updateNc(const std::string &nonce, std::time_t issued, uint32_t nc);
+	void cleanExpired(std::time_t now);
+
+	size_t getTrackedNonceCount();
+	/**
+	 * Approximate number of bytes used to track the nonce counts.
+	 */
+	size_t getMemoryUsage();
+
+private:
+	static constexpr size_t sShardCount = 16;
+	static constexpr size_t sMacSize = 16;
+	static constexpr size_t sTimeSize = 8;
+
+	struct Shard {
+		std::mutex mutex;
+		// Last nonce count of each nonce, by the start time of the bucket they were issued in.
+		std::map<std::time_t, std::unordered_map<uint64_t, uint32_t>> buckets;
+	};
+
+	std::array<uint8_t, sMacSize> computeMac(const uint8_t *time, const std::string &clientInfo) const;
+
+	std::array<uint8_t, 32> mKey{};
+	std::array<Shard, sShardCount> mShards{};
+	std::time_t mNonceExpires;
+	std::time_t mBucketDuration;
+};
+
 }
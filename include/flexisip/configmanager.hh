@@ -393,6 +393,9 @@ class StatCounter64 : public GenericEntry {
 	inline void incr() {
 		mValue++;
 	}
+	inline void add(uint64_t val) {
+		mValue += val;
+	}
 
   private:
 	uint64_t mValue;
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <list>
 #include <map>
@@ -82,6 +84,13 @@ public:
 		return mState == TERMINATED;
 	}
 
+	/**
+	 * Number of events currently suspended, waiting for an asynchronous operation.
+	 */
+	static unsigned getSuspendedCount() {
+		return sSuspendedCount.load(std::memory_order_relaxed);
+	}
+
 	inline const std::shared_ptr<IncomingAgent>& getIncomingAgent() {
 		return mIncomingAgent;
 	}
@@ -127,12 +136,16 @@ protected:
 	std::shared_ptr<OutgoingAgent> mOutgoingAgent;
 	std::shared_ptr<EventLog> mEventLog;
 	Agent* mAgent;
+	std::chrono::steady_clock::time_point mSuspendedAt{}; // Set by the Agent for the module latency statistics.
 
 	enum State {
 		STARTED,
 		SUSPENDED,
 		TERMINATED,
 	} mState;
+	void setState(State state);
+	/* Record the time spent suspended in the latency statistics of the current module, if suspended. */
+	void recordSuspension();
 	static std::string stateStr(State s) {
 		switch (s) {
 			case STARTED:
@@ -144,6 +157,9 @@ protected:
 		}
 		return "invalid";
 	}
+
+private:
+	static std::atomic_uint sSuspendedCount;
 };
 
 class RequestSipEvent : public SipEvent {
@@ -200,10 +200,14 @@ private:
 class CallQualityStatisticsLog : public EventLog {
 public:
 	CallQualityStatisticsLog(const sip_t* sip);
+	CallQualityStatisticsLog(const sip_t* sip, const std::string& report);
 
 	const std::string& getReport() const {
 		return mReport;
 	}
+	void setReport(const std::string& report) {
+		mReport = report;
+	}
 
 	void write(EventLogWriter& writer) const override;
 
@@ -25,16 +25,409 @@
 #include "flexisip/logmanager.hh"
 
 #include <cstring>
+#include <cctype>
+#include <cstdint>
 #include <sstream>
 #include <algorithm>
 #include <regex>
+#include <vector>
 
 
 using namespace std;
 
 namespace flexisip{
 
+/*
+ * Flat form of a BooleanExpression, produced by ExpressionCompiler.
+ * The expression is turned into a sequence of instructions updating a single boolean register, && and || being
+ * implemented with conditional jumps so that the evaluation is short-circuited as in the interpreted tree.
+ * Operands are either constants or variables read through their VariableAccessor. Each variable is read at most once
+ * per evaluation, when first needed, and its value is a reference into _valuesT: the evaluation does not allocate
+ * memory, except in the std::regex engine.
+ */
+template <typename _valuesT>
+class CompiledBooleanExpression : public BooleanExpression<_valuesT> {
+public:
+	using Expr = BooleanExpression<_valuesT>;
+	static constexpr size_t sMaxVariables = 16; // Limited by the size of VariableCache::resolved.
+
+	CompiledBooleanExpression(const shared_ptr<Expr> &source) : mSource(source) {
+	}
+	virtual bool eval(const _valuesT &args) override;
+
+	static bool contains(const StringRef &str, const StringRef &pattern) {
+		if (pattern.empty()) return true;
+		const char *begin = str.data ? str.data : "";
+		const char *end = begin + str.size;
+		return search(begin, end, pattern.data, pattern.data + pattern.size) != end;
+	}
+	/* Whether value is one of the words of the space separated list. */
+	static bool in(const StringRef &value, const StringRef &list) {
+		size_t pos = 0;
+		while (pos < list.size) {
+			while (pos < list.size && list.data[pos] == ' ') ++pos;
+			size_t end = pos;
+			while (end < list.size && list.data[end] != ' ') ++end;
+			if (end > pos && StringRef(list.data + pos, end - pos) == value) return true;
+			pos = end;
+		}
+		return false;
+	}
+	static bool numeric(const StringRef &str) {
+		for (size_t i = 0; i < str.size; ++i) {
+			if (!isdigit(str.data[i])) return false;
+		}
+		return true;
+	}
+	static bool regexMatch(const regex &re, const StringRef &str) {
+		const char *begin = str.data ? str.data : "";
+		return regex_match(begin, begin + str.size, re);
+	}
+
+private:
+	friend class ExpressionCompiler<_valuesT>;
+
+	enum class OpCode : uint8_t {
+		Const,
+		Equals,
+		NotEquals,
+		Contains,
+		In,
+		InConstantList,
+		Regex,
+		Defined,
+		Numeric,
+		NamedOperator,
+		Not,
+		JumpIfFalse,
+		JumpIfTrue
+	};
+	struct Operand {
+		bool variable = false;
+		uint16_t index = 0; // Index of the variable slot or of the constant.
+	};
+	struct Instruction {
+		OpCode op;
+		Operand left;
+		Operand right;
+		size_t arg; // Value of Const, target of jumps, or index of the regex, constant list or named operator.
+	};
+	/*
+	 * Values of the variables already read during the current evaluation.
+	 * Only the resolved mask is initialized, the other arrays are filled on demand.
+	 */
+	struct VariableCache {
+		const char *data[sMaxVariables];
+		size_t sizes[sMaxVariables];
+		ScratchBuffer buffers[sMaxVariables];
+		uint16_t resolved = 0;
+	};
+
+	StringRef get(const Operand &operand, const _valuesT &args, VariableCache &cache) const {
+		if (!operand.variable) return StringRef(mConstants[operand.index]);
+		const uint16_t mask = uint16_t(1u << operand.index);
+		if ((cache.resolved & mask) == 0) {
+			StringRef value = mVariables[operand.index](args, cache.buffers[operand.index]);
+			cache.data[operand.index] = value.data;
+			cache.sizes[operand.index] = value.size;
+			cache.resolved |= mask;
+		}
+		return StringRef(cache.data[operand.index], cache.sizes[operand.index]);
+	}
+
+	shared_ptr<Expr> mSource; // Keeps the named operators alive.
+	vector<Instruction> mCode;
+	vector<string> mConstants;
+	vector<vector<string>> mConstantLists;
+	vector<VariableAccessor<_valuesT>> mVariables;
+	vector<regex> mRegexes;
+	vector<NamedOperator<_valuesT> *> mNamedOperators;
+};
 
+template <typename _valuesT>
+bool CompiledBooleanExpression<_valuesT>::eval(const _valuesT &args) {
+	VariableCache cache;
+	bool value = false;
+	size_t pc = 0;
+	const size_t end = mCode.size();
+	while (pc < end) {
+		const Instruction &instruction = mCode[pc++];
+		switch (instruction.op) {
+			case OpCode::Const:
+				value = instruction.arg != 0;
+				break;
+			case OpCode::Equals:
+				value = get(instruction.left, args, cache) == get(instruction.right, args, cache);
+				break;
+			case OpCode::NotEquals:
+				value = get(instruction.left, args, cache) != get(instruction.right, args, cache);
+				break;
+			case OpCode::Contains:
+				value = contains(get(instruction.left, args, cache), get(instruction.right, args, cache));
+				break;
+			case OpCode::In:
+				value = in(get(instruction.left, args, cache), get(instruction.right, args, cache));
+				break;
+			case OpCode::InConstantList: {
+				const StringRef varValue = get(instruction.left, args, cache);
+				const auto &list = mConstantLists[instruction.arg];
+				value = any_of(list.cbegin(), list.cend(), [&varValue](const string &item) { return varValue == item; });
+			} break;
+			case OpCode::Regex:
+				value = regexMatch(mRegexes[instruction.arg], get(instruction.left, args, cache));
+				break;
+			case OpCode::Defined:
+				value = !get(instruction.left, args, cache).empty();
+				break;
+			case OpCode::Numeric:
+				value = numeric(get(instruction.left, args, cache));
+				break;
+			case OpCode::NamedOperator:
+				value = mNamedOperators[instruction.arg]->eval(args);
+				break;
+			case OpCode::Not:
+				value = !value;
+				break;
+			case OpCode::JumpIfFalse:
+				if (!value) pc = instruction.arg;
+				break;
+			case OpCode::JumpIfTrue:
+				if (value) pc = instruction.arg;
+				break;
+		}
+	}
+	return value;
+}
+
+/*
+ * Turns a tree of BooleanExpression into a CompiledBooleanExpression. The tree nodes emit their own code through the
+ * emit*() methods, which fold the operations whose operands are all constants.
+ */
+template <typename _valuesT>
+class ExpressionCompiler {
+public:
+	using Expr = BooleanExpression<_valuesT>;
+	using Var = Variable<_valuesT>;
+	using Compiled = CompiledBooleanExpression<_valuesT>;
+
+	ExpressionCompiler(const map<string, VariableAccessor<_valuesT>> &accessors) : mAccessors(accessors) {
+	}
+
+	/*
+	 * Returns the compiled form of the expression, a ConstantBooleanExpression if its value does not depend on
+	 * _valuesT, or nullptr if it cannot be compiled.
+	 */
+	shared_ptr<Expr> compile(const shared_ptr<Expr> &expr);
+
+	CompilationResult emitAnd(const shared_ptr<Expr> &exp1, const shared_ptr<Expr> &exp2) {
+		return emitLogical(Compiled::OpCode::JumpIfFalse, CompilationResult::False, exp1, exp2);
+	}
+	CompilationResult emitOr(const shared_ptr<Expr> &exp1, const shared_ptr<Expr> &exp2) {
+		return emitLogical(Compiled::OpCode::JumpIfTrue, CompilationResult::True, exp1, exp2);
+	}
+	CompilationResult emitNot(const shared_ptr<Expr> &exp);
+	CompilationResult emitEquals(const shared_ptr<Var> &var1, const shared_ptr<Var> &var2) {
+		return emitBinary(Compiled::OpCode::Equals, var1, var2);
+	}
+	CompilationResult emitUnEquals(const shared_ptr<Var> &var1, const shared_ptr<Var> &var2) {
+		return emitBinary(Compiled::OpCode::NotEquals, var1, var2);
+	}
+	CompilationResult emitContains(const shared_ptr<Var> &var1, const shared_ptr<Var> &var2) {
+		return emitBinary(Compiled::OpCode::Contains, var1, var2);
+	}
+	CompilationResult emitIn(const shared_ptr<Var> &var1, const shared_ptr<Var> &var2) {
+		return emitBinary(Compiled::OpCode::In, var1, var2);
+	}
+	CompilationResult emitDefined(const shared_ptr<Var> &var) {
+		return emitUnary(Compiled::OpCode::Defined, var);
+	}
+	CompilationResult emitNumeric(const shared_ptr<Var> &var) {
+		return emitUnary(Compiled::OpCode::Numeric, var);
+	}
+	CompilationResult emitRegex(const shared_ptr<Var> &var, const regex &re);
+	CompilationResult emitNamedOperator(NamedOperator<_valuesT> &op);
+
+private:
+	using OpCode = typename Compiled::OpCode;
+	using Operand = typename Compiled::Operand;
+
+	static CompilationResult fromBool(bool value) {
+		return value ? CompilationResult::True : CompilationResult::False;
+	}
+	void emit(OpCode op, const Operand &left = Operand{}, const Operand &right = Operand{}, size_t arg = 0) {
+		mProgram->mCode.push_back({op, left, right, arg});
+	}
+	bool resolve(const shared_ptr<Var> &var, Operand &operand);
+	StringRef constant(const Operand &operand) const {
+		return StringRef(mProgram->mConstants[operand.index]);
+	}
+	CompilationResult emitLogical(OpCode jump, CompilationResult shortCircuit, const shared_ptr<Expr> &exp1,
+	                              const shared_ptr<Expr> &exp2);
+	CompilationResult emitBinary(OpCode op, const shared_ptr<Var> &var1, const shared_ptr<Var> &var2);
+	CompilationResult emitUnary(OpCode op, const shared_ptr<Var> &var);
+
+	const map<string, VariableAccessor<_valuesT>> &mAccessors;
+	shared_ptr<Compiled> mProgram;
+};
+
+template <typename _valuesT>
+class ConstantBooleanExpression;
+
+template <typename _valuesT>
+shared_ptr<BooleanExpression<_valuesT>> ExpressionCompiler<_valuesT>::compile(const shared_ptr<Expr> &expr) {
+	if (!expr) return nullptr;
+	mProgram = make_shared<Compiled>(expr);
+	auto result = expr->compile(*this);
+	auto program = move(mProgram);
+	switch (result) {
+		case CompilationResult::Unsupported:
+			return nullptr;
+		case CompilationResult::Dynamic:
+			return program;
+		default:
+			return make_shared<ConstantBooleanExpression<_valuesT>>(result == CompilationResult::True);
+	}
+}
+
+template <typename _valuesT>
+bool ExpressionCompiler<_valuesT>::resolve(const shared_ptr<Var> &var, Operand &operand) {
+	if (!var) return false;
+	auto cons = dynamic_pointer_cast<Constant<_valuesT>>(var);
+	if (cons) {
+		operand.variable = false;
+		operand.index = uint16_t(mProgram->mConstants.size());
+		mProgram->mConstants.push_back(cons->get());
+		return true;
+	}
+	auto accessorIt = mAccessors.find(var->getName());
+	if (accessorIt == mAccessors.end() || accessorIt->second == nullptr) return false;
+	auto &variables = mProgram->mVariables;
+	auto slot = find(variables.begin(), variables.end(), accessorIt->second);
+	if (slot == variables.end()) {
+		if (variables.size() >= Compiled::sMaxVariables) return false;
+		slot = variables.insert(variables.end(), accessorIt->second);
+	}
+	operand.variable = true;
+	operand.index = uint16_t(slot - variables.begin());
+	return true;
+}
+
+template <typename _valuesT>
+CompilationResult ExpressionCompiler<_valuesT>::emitLogical(OpCode jump, CompilationResult shortCircuit,
+                                                            const shared_ptr<Expr> &exp1,
+                                                            const shared_ptr<Expr> &exp2) {
+	if (!exp1 || !exp2) return CompilationResult::Unsupported;
+	auto &code = mProgram->mCode;
+	const size_t start = code.size();
+	auto result1 = exp1->compile(*this);
+	if (result1 == CompilationResult::Unsupported || result1 == shortCircuit) return result1;
+	if (result1 != CompilationResult::Dynamic) return exp2->compile(*this); /* (true && exp2) is exp2 */
+
+	const size_t jumpPos = code.size();
+	emit(jump);
+	auto result2 = exp2->compile(*this);
+	if (result2 == CompilationResult::Unsupported) return result2;
+	if (result2 == shortCircuit) {
+		/* (exp1 && false) is false, expressions have no side effect. */
+		code.resize(start);
+		return result2;
+	}
+	if (result2 != CompilationResult::Dynamic) {
+		/* (exp1 && true) is exp1 */
+		code.resize(jumpPos);
+		return CompilationResult::Dynamic;
+	}
+	code[jumpPos].arg = code.size();
+	return CompilationResult::Dynamic;
+}
+
+template <typename _valuesT>
+CompilationResult ExpressionCompiler<_valuesT>::emitNot(const shared_ptr<Expr> &exp) {
+	if (!exp) return CompilationResult::Unsupported;
+	auto result = exp->compile(*this);
+	switch (result) {
+		case CompilationResult::True:
+			return CompilationResult::False;
+		case CompilationResult::False:
+			return CompilationResult::True;
+		case CompilationResult::Dynamic:
+			emit(OpCode::Not);
+			break;
+		default:
+			break;
+	}
+	return result;
+}
+
+template <typename _valuesT>
+CompilationResult ExpressionCompiler<_valuesT>::emitBinary(OpCode op, const shared_ptr<Var> &var1,
+                                                           const shared_ptr<Var> &var2) {
+	Operand left, right;
+	if (!resolve(var1, left) || !resolve(var2, right)) return CompilationResult::Unsupported;
+	if (!left.variable && !right.variable) {
+		switch (op) {
+			case OpCode::Equals:
+				return fromBool(constant(left) == constant(right));
+			case OpCode::NotEquals:
+				return fromBool(constant(left) != constant(right));
+			case OpCode::Contains:
+				return fromBool(Compiled::contains(constant(left), constant(right)));
+			default:
+				return fromBool(Compiled::in(constant(left), constant(right)));
+		}
+	}
+	if (op == OpCode::In && !right.variable) {
+		/* The list is split once and for all. */
+		const StringRef list = constant(right);
+		vector<string> items;
+		size_t pos = 0;
+		while (pos < list.size) {
+			while (pos < list.size && list.data[pos] == ' ') ++pos;
+			size_t end = pos;
+			while (end < list.size && list.data[end] != ' ') ++end;
+			if (end > pos) items.emplace_back(list.data + pos, end - pos);
+			pos = end;
+		}
+		mProgram->mConstantLists.push_back(move(items));
+		emit(OpCode::InConstantList, left, right, mProgram->mConstantLists.size() - 1);
+		return CompilationResult::Dynamic;
+	}
+	emit(op, left, right);
+	return CompilationResult::Dynamic;
+}
+
+template <typename _valuesT>
+CompilationResult ExpressionCompiler<_valuesT>::emitUnary(OpCode op, const shared_ptr<Var> &var) {
+	Operand operand;
+	if (!resolve(var, operand)) return CompilationResult::Unsupported;
+	if (!operand.variable) {
+		return fromBool(op == OpCode::Defined ? !constant(operand).empty() : Compiled::numeric(constant(operand)));
+	}
+	emit(op, operand);
+	return CompilationResult::Dynamic;
+}
+
+template <typename _valuesT>
+CompilationResult ExpressionCompiler<_valuesT>::emitRegex(const shared_ptr<Var> &var, const regex &re) {
+	Operand operand;
+	if (!resolve(var, operand)) return CompilationResult::Unsupported;
+	if (!operand.variable) return fromBool(Compiled::regexMatch(re, constant(operand)));
+	mProgram->mRegexes.push_back(re);
+	emit(OpCode::Regex, operand, Operand{}, mProgram->mRegexes.size() - 1);
+	return CompilationResult::Dynamic;
+}
+
+template <typename _valuesT>
+CompilationResult ExpressionCompiler<_valuesT>::emitNamedOperator(NamedOperator<_valuesT> &op) {
+	mProgram->mNamedOperators.push_back(&op);
+	emit(OpCode::NamedOperator, Operand{}, Operand{}, mProgram->mNamedOperators.size() - 1);
+	return CompilationResult::Dynamic;
+}
+
+template <typename _valuesT>
+CompilationResult NamedOperator<_valuesT>::compile(ExpressionCompiler<_valuesT> &compiler) {
+	return compiler.emitNamedOperator(*this);
+}
 
 template <typename _valuesT>
 class ConstantBooleanExpression : public BooleanExpression<_valuesT> {
@@ -43,6 +436,9 @@ class ConstantBooleanExpression : public BooleanExpression<_valuesT> {
 	virtual bool eval(const _valuesT &args) override{
 		return mRet;
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override{
+		return mRet ? CompilationResult::True : CompilationResult::False;
+	}
 	bool mRet;
 };
 
@@ -56,6 +452,9 @@ private:
 	virtual bool eval(const _valuesT &args) override{
 		return mExp1->eval(args) && mExp2->eval(args);
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override{
+		return compiler.emitAnd(mExp1, mExp2);
+	}
 };
 
 template <typename _valuesT>
@@ -67,6 +466,9 @@ class LogicalOr : public BooleanExpression<_valuesT> {
 	virtual bool eval(const _valuesT &args) override{
 		return mExp1->eval(args) || mExp2->eval(args);
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override{
+		return compiler.emitOr(mExp1, mExp2);
+	}
   private:
 	shared_ptr<Expr> mExp1, mExp2;
 };
@@ -80,6 +482,9 @@ class LogicalNot : public BooleanExpression<_valuesT> {
 	virtual bool eval(const _valuesT &args) override{
 		return !mExp->eval(args);
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override{
+		return compiler.emitNot(mExp);
+	}
 
   private:
 	shared_ptr<Expr> mExp;
@@ -94,6 +499,9 @@ class EqualsOp : public BooleanExpression<_valuesT> {
 	virtual bool eval(const _valuesT &args) override{
 		return mVar1->get(args) == mVar2->get(args);
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override{
+		return compiler.emitEquals(mVar1, mVar2);
+	}
   private:
 	shared_ptr<Var> mVar1, mVar2;
 };
@@ -107,6 +515,9 @@ class UnEqualsOp : public BooleanExpression<_valuesT> {
 	virtual bool eval(const _valuesT &args) override{
 		return mVar1->get(args) != mVar2->get(args);
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override{
+		return compiler.emitUnEquals(mVar1, mVar2);
+	}
   private:
 	shared_ptr<Var> mVar1, mVar2;
 };
@@ -131,6 +542,9 @@ public:
 		}
 		return res;
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override{
+		return compiler.emitNumeric(mVar);
+	}
 private:
 	shared_ptr<Var> mVar;
 };
@@ -148,6 +562,9 @@ public:
 	virtual bool eval(const _valuesT &args) {
 		return mVar->defined(args);
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override{
+		return compiler.emitDefined(mVar);
+	}
 private:
 	shared_ptr<Var> mVar;
 };
@@ -167,6 +584,10 @@ template <typename _valuesT> class RegexpOp : public BooleanExpression<_valuesT>
 		return false;
 	}
 
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT>& compiler) override {
+		return compiler.emitRegex(mInput, mRegex);
+	}
+
   private:
 	shared_ptr<Var> mInput;
 	std::regex mRegex;
@@ -183,6 +604,9 @@ public:
 		string var2 = mVar2->get(args);
 		return var1.find(var2) != string::npos;
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override{
+		return compiler.emitContains(mVar1, mVar2);
+	}
 private:
 	shared_ptr<Var> mVar1, mVar2;
 };
@@ -209,6 +633,9 @@ public:
 		}
 		return res;
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override{
+		return compiler.emitIn(mVar1, mVar2);
+	}
 private:
 	shared_ptr<Var> mVar1, mVar2;
 };
@@ -266,7 +693,7 @@ std::shared_ptr<ExpressionElement> BooleanExpressionBuilder<_valuesT>::buildElem
 		auto varIt = mRules.variables.find(word);
 		auto opIt = mRules.operators.find(word);
 		if (varIt != mRules.variables.end()){
-			return make_shared<Variable<_valuesT>>((*varIt).second);
+			return make_shared<Variable<_valuesT>>(word, (*varIt).second);
 		}else if (opIt != mRules.operators.end()){
 			return make_shared<NamedOperator<_valuesT>>((*opIt).second);
 		}else{
@@ -328,12 +755,34 @@ void BooleanExpressionBuilder<_valuesT>::checkRulesOverlap(){
 }
 
 template< typename _valuesT>
-BooleanExpressionBuilder<_valuesT>::BooleanExpressionBuilder(const ExpressionRules<_valuesT> &rules) : mRules(rules){
+ExpressionRules<_valuesT> BooleanExpressionBuilder<_valuesT>::addAccessorVariables(const ExpressionRules<_valuesT> &rules){
+	ExpressionRules<_valuesT> ret = rules;
+	for (const auto &p : rules.accessors){
+		if (ret.variables.find(p.first) != ret.variables.end()) continue;
+		auto accessor = p.second;
+		ret.variables[p.first] = [accessor](const _valuesT &args)->string {
+			ScratchBuffer buffer;
+			StringRef value = accessor(args, buffer);
+			return value.data ? string(value.data, value.size) : string();
+		};
+	}
+	return ret;
+}
+
+template< typename _valuesT>
+BooleanExpressionBuilder<_valuesT>::BooleanExpressionBuilder(const ExpressionRules<_valuesT> &rules) : mRules(addAccessorVariables(rules)){
 	checkRulesOverlap();
 }
 
 template< typename _valuesT>
 std::shared_ptr<BooleanExpression<_valuesT>> BooleanExpressionBuilder<_valuesT>::parse(const std::string &expression){
+	auto expr = parseInterpreted(expression);
+	auto compiled = ExpressionCompiler<_valuesT>(mRules.accessors).compile(expr);
+	return compiled ? compiled : expr;
+}
+
+template< typename _valuesT>
+std::shared_ptr<BooleanExpression<_valuesT>> BooleanExpressionBuilder<_valuesT>::parseInterpreted(const std::string &expression){
 	if (expression.empty())
 		return make_shared<ConstantBooleanExpression<_valuesT>>(true); /* By arbitrary decision, we evaluate void to true.*/
 	size_t pos = 0;
@@ -19,6 +19,8 @@
 #pragma once
 
 
+#include <array>
+#include <cstring>
 #include <string>
 #include <memory>
 #include <map>
@@ -33,6 +35,53 @@ class ExpressionElement{
 public:
 	virtual ~ExpressionElement() = default;
 };
+
+/*
+ * Non-owning reference to a string stored in the evaluated _valuesT, used by the compiled expressions in order to
+ * read the variables without copying them.
+ */
+struct StringRef {
+	StringRef() = default;
+	StringRef(const char *str) : data(str), size(str ? std::strlen(str) : 0) {
+	}
+	StringRef(const char *str, size_t len) : data(str), size(len) {
+	}
+	StringRef(const std::string &str) : data(str.data()), size(str.size()) {
+	}
+	bool empty() const {
+		return size == 0;
+	}
+	bool operator==(const StringRef &other) const {
+		return size == other.size && (size == 0 || std::memcmp(data, other.data, size) == 0);
+	}
+	bool operator!=(const StringRef &other) const {
+		return !(*this == other);
+	}
+
+	const char *data = nullptr;
+	size_t size = 0;
+};
+
+/*
+ * Storage provided to the accessors of variables which are not available as text in _valuesT (numbers for instance).
+ */
+using ScratchBuffer = std::array<char, 24>;
+
+/*
+ * Allocation-free equivalent of the function of a variable: it returns a reference to the value of the variable,
+ * either stored in _valuesT or formatted into the provided ScratchBuffer.
+ */
+template <typename _valuesT>
+using VariableAccessor = StringRef (*)(const _valuesT &, ScratchBuffer &);
+
+template <typename _valuesT>
+class ExpressionCompiler;
+
+/*
+ * Outcome of the compilation of an expression: its value if it could be determined at compilation time, Dynamic when
+ * code was emitted to evaluate it at run-time, Unsupported if it cannot be compiled.
+ */
+enum class CompilationResult { False, True, Dynamic, Unsupported };
 	
 /* 
  * Variable represents a text field which is evaluated at run-time using the _valuesT argument.
@@ -42,7 +91,12 @@ class Variable : public ExpressionElement{
 public:
 	Variable(const std::function< std::string (const _valuesT &)> &func) : mFunc(func){
 	}
+	Variable(const std::string &name, const std::function< std::string (const _valuesT &)> &func) : mFunc(func), mName(name){
+	}
 	~Variable() = default;
+	const std::string &getName() const{
+		return mName;
+	}
 	virtual std::string get(const _valuesT &args){
 		return mFunc(args);
 	}
@@ -77,6 +131,7 @@ public:
 	}
 private:
 	std::function< std::string (const _valuesT &)> mFunc;
+	std::string mName;
 protected:
 	Variable() = default;
 };
@@ -111,6 +166,13 @@ class BooleanExpression {
  public:
 	virtual ~BooleanExpression() = default;
 	virtual bool eval(const _valuesT &args) = 0;
+	/*
+	 * Emits the code evaluating this expression into the compiler.
+	 * Expressions that do not know how to compile themselves are evaluated by the interpreter.
+	 */
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler){
+		return CompilationResult::Unsupported;
+	}
 protected:
 	BooleanExpression() = default;
 };
@@ -128,6 +190,7 @@ public:
 	virtual bool eval(const _valuesT &args) override{
 		return mFunc(args);
 	}
+	virtual CompilationResult compile(ExpressionCompiler<_valuesT> &compiler) override;
 private:
 	std::function< bool (const _valuesT &)> mFunc;
 };
@@ -137,6 +200,9 @@ private:
  * The variables map provides mapping between a variable name and function to be called to get the
  * variable's value in the _valuesT argument.
  * The operators map provides the mapping between operator names and the function that evaluates them.
+ * The optional accessors map provides, for the variables, the allocation-free accessors used by compiled expressions.
+ * Expressions using a variable without accessor are not compiled. Conversely, the variables that only have an
+ * accessor are evaluated by the interpreter through a copy of the value it returns.
  */
 
 template <typename _valuesT>
@@ -144,12 +210,15 @@ struct ExpressionRules{
 public:
 	std::map<std::string, std::function< std::string (const _valuesT &)>> variables; // the map of variables with their function to evaluate
 	std::map<std::string, std::function< bool (const _valuesT &)>> operators; // the named operators, with their function to evaluate.
+	std::map<std::string, VariableAccessor<_valuesT>> accessors; // the variables that can be read by compiled expressions.
 };
 
 /*
  * The BooleanExpressionBuilder creates BooleanExpression by parsing an input string.
  * The BooleanExpression is constructed according to the rules provided in the constructor,
  * which gave the map of allowed variables and named operators.
+ * parse() compiles the expression into a flat program (see CompiledBooleanExpression) whenever possible, and otherwise
+ * returns the interpreted tree of expressions, as parseInterpreted() does.
  */
 template <typename _valuesT>
 class BooleanExpressionBuilder{
@@ -159,7 +228,9 @@ public:
 	using Expr = BooleanExpression<_valuesT>;
 	BooleanExpressionBuilder(const ExpressionRules<_valuesT> &rules);
 	std::shared_ptr<BooleanExpression<_valuesT>> parse(const std::string &expression);
+	std::shared_ptr<BooleanExpression<_valuesT>> parseInterpreted(const std::string &expression);
 private:
+	static ExpressionRules<_valuesT> addAccessorVariables(const ExpressionRules<_valuesT> &rules);
 	void checkRulesOverlap();
 	size_t findFirstNonWord(const std::string &expr, size_t offset);
 	size_t findMatchingClosingParenthesis(const std::string &expr, size_t offset);
@@ -29,6 +29,8 @@ public:
 	StatCounter64 *mCountSyncRetrieve = nullptr;
 	StatCounter64 *mCountPassFound = nullptr;
 	StatCounter64 *mCountPassNotFound = nullptr;
+	StatCounter64 *mCountTrackedNonces = nullptr;
+	StatCounter64 *mCountNonceMemory = nullptr;
 
 	Authentication(Agent *ag);
 	~Authentication() override;
@@ -41,6 +41,8 @@ class ModuleInfo;
 
 class SharedLibrary;
 
+class ModuleLatencyStats;
+
 enum class ModuleClass {
 	Experimental,
 	Production
@@ -63,7 +65,7 @@ class Module : protected ConfigValueListener {
 
 public:
 	Module(Agent *agent);
-	virtual ~Module() = default;
+	virtual ~Module();
 
 	Agent *getAgent() const {return mAgent;}
 	nta_agent_t *getSofiaAgent() const;
@@ -87,6 +89,9 @@ public:
 	ModuleInfoBase *getInfo() const {return mInfo;}
 	void setInfo(ModuleInfoBase *moduleInfo);
 
+	/* Null if Flexisip has been built without module latency statistics. */
+	ModuleLatencyStats *getLatencyStats() const {return mLatencyStats.get();}
+
 protected:
 	virtual void onDeclare(GenericStruct *root) {}
 	virtual void onLoad(const GenericStruct *root) {}
@@ -110,6 +115,7 @@ protected:
 	ModuleInfoBase *mInfo = nullptr;
 	GenericStruct *mModuleConfig = nullptr;
 	std::unique_ptr<EntryFilter> mFilter;
+	std::unique_ptr<ModuleLatencyStats> mLatencyStats;
 };
 
 // -----------------------------------------------------------------------------
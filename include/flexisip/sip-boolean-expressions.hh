@@ -31,6 +31,7 @@ class SipBooleanExpressionBuilder : public BooleanExpressionBuilder<sip_t> {
 public:
 	static SipBooleanExpressionBuilder &get();
 	std::shared_ptr<SipBooleanExpression> parse(const std::string &expression);
+	std::shared_ptr<SipBooleanExpression> parseInterpreted(const std::string &expression);
 
 private:
 	SipBooleanExpressionBuilder();
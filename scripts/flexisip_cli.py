@@ -29,6 +29,8 @@ def parse_args():
 		'REGISTRAR_CLEAR': {'help': 'Remove an address-of-record from the registrar database.'},
 		'REGISTRAR_DUMP': {'help': 'Dump list of registered address-of-records for this proxy instance only (not all the cluster !)'},
 		'SIP_BRIDGE': {'help': 'Send commands to the external SIP provider bridge. (If active)'},
+		'MEDIA_RELAY_STATS': {'help': 'Show packet loss, jitter and bitrate of the calls currently relayed by the MediaRelay module.'},
+		'MODULE_LATENCY': {'help': 'Show the latency histograms of the modules: processing time per request method, of responses, and time spent by suspended events.'},
 	}
 
 	kargs = {
@@ -57,6 +59,12 @@ def parse_args():
 	commands['REGISTRAR_DELETE']['parser'].add_argument('uri', help='AOR sip uri.')
 	commands['REGISTRAR_DELETE']['parser'].add_argument('uuid', help='+sip.instance value identifying the binding.')
 	commands['SIP_BRIDGE']['parser'].add_argument('subcommand', help='The command to send to the bridge. Valid commands: INFO')
+	commands['MEDIA_RELAY_STATS']['parser'].add_argument('callid', nargs='?', default=None,
+		help='Call-ID of the call to show. All the relayed calls are shown if no Call-ID is given.'
+	)
+	commands['MODULE_LATENCY']['parser'].add_argument('module', nargs='?', default=None,
+		help='Name of the module to show, e.g. Router. All the enabled modules are shown if no module is given.'
+	)
 
 	return parser.parse_args()
 
@@ -98,6 +106,10 @@ def formatMessage(args):
 		messageArgs.append(args.uuid)
 	elif args.command == 'SIP_BRIDGE':
 		messageArgs.append(args.subcommand)
+	elif args.command == 'MEDIA_RELAY_STATS' and args.callid is not None:
+		messageArgs.append(args.callid)
+	elif args.command == 'MODULE_LATENCY' and args.module is not None:
+		messageArgs.append(args.module)
 	return ' '.join(messageArgs)
 
 
@@ -37,6 +37,8 @@
 
 #include "domain-registrations.hh"
 #include "etchosts.hh"
+#include "module-latency-stats.hh"
+#include "overload-control.hh"
 #include "plugin/plugin-loader.hh"
 #include "utils/uri-utils.hh"
 
@@ -51,6 +53,8 @@ static StatCounter64* createCounter(GenericStruct* global, string keyprefix, str
 	return global->createStat(keyprefix + value, helpprefix + value + ".");
 }
 void Agent::onDeclare(GenericStruct* root) {
+	mOverloadControl = make_unique<OverloadControl>(root->get<GenericStruct>("overload-control"));
+
 	GenericStruct* global = root->get<GenericStruct>("global");
 	string key = "count-incoming-request-";
 	string help = "Number of incoming requests with method name ";
@@ -654,6 +658,9 @@ void Agent::loadConfig(GenericManager* cm, bool strict) {
 		LOGD("%s", alias.c_str());
 	}
 
+	mLatencyDumpInterval = chrono::seconds{cm->getGlobal()->get<ConfigInt>("module-latency-dump-interval")->read()};
+	mOverloadControl->load(mRoot);
+
 	RegistrarDb::initialize(this);
 
 	initializePreferredRoute();
@@ -895,6 +902,10 @@ void Agent::logEvent(const shared_ptr<SipEvent>& ev) {
 	}
 }
 
+void Agent::writeEventLog(const shared_ptr<const EventLog>& evlog) {
+	if (mLogWriter && evlog->isCompleted()) mLogWriter->write(evlog);
+}
+
 shared_ptr<Module> Agent::findModule(const string& moduleName) const {
 	auto it = find_if(mModules.cbegin(), mModules.cend(),
 	                  [&moduleName](const auto& m) { return m->getModuleName() == moduleName; });
@@ -911,7 +922,15 @@ template <typename SipEventT, typename ModuleIter>
 void Agent::doSendEvent(std::shared_ptr<SipEventT> ev, const ModuleIter& begin, const ModuleIter& end) {
 	for (auto it = begin; it != end; ++it) {
 		ev->mCurrModule = *it;
+#ifdef MODULE_LATENCY_STATS
+		const auto processingStart = chrono::steady_clock::now();
 		(*it)->process(ev);
+		const auto processingEnd = chrono::steady_clock::now();
+		(*it)->getLatencyStats()->recordProcessing(*ev, processingEnd - processingStart);
+		if (ev->isSuspended()) ev->mSuspendedAt = processingEnd;
+#else
+		(*it)->process(ev);
+#endif
 		if (ev->isTerminated() || ev->isSuspended()) break;
 	}
 	if (!ev->isTerminated() && !ev->isSuspended()) {
@@ -1030,6 +1049,7 @@ void Agent::injectRequestEvent(shared_ptr<RequestSipEvent> ev) {
 	auto currModule = ev->mCurrModule.lock(); // Used to be a basic pointer
 	SLOGD << "Inject request SIP event [" << ev << "] after " << currModule->getModuleName() << ":\n"
 	      << *ev->getMsgSip();
+	ev->recordSuspension();
 	ev->restartProcessing();
 	auto it = find(mModules.cbegin(), mModules.cend(), currModule);
 	doSendEvent(ev, ++it, mModules.cend());
@@ -1041,6 +1061,7 @@ void Agent::injectResponseEvent(shared_ptr<ResponseSipEvent> ev) {
 	auto currModule = ev->mCurrModule.lock(); // Used to be a basic pointer
 	SLOGD << "Injecting response SIP event [" << ev << "] after " << currModule->getModuleName() << ":\n"
 	      << *ev->getMsgSip();
+	ev->recordSuspension();
 	ev->restartProcessing();
 	auto it = find(mModules.cbegin(), mModules.cend(), currModule);
 	doSendEvent(ev, ++it, mModules.cend());
@@ -1069,7 +1090,8 @@ int Agent::onIncomingMessage(msg_t* msg, const sip_t* sip) {
 	auto ms = make_shared<MsgSip>(msg);
 	if (sip->sip_request) {
 		auto ev = make_shared<RequestSipEvent>(shared_from_this(), ms, getIncomingTport(msg, this));
-		sendRequestEvent(ev);
+		// Under overload, new requests are rejected before entering the module chain.
+		if (mOverloadControl->admit(*ev)) sendRequestEvent(ev);
 	} else {
 		auto ev = make_shared<ResponseSipEvent>(shared_from_this(), ms);
 		sendResponseEvent(ev);
@@ -1104,11 +1126,29 @@ void Agent::idle() {
 	for (const auto& module : mModules) {
 		module->idle();
 	}
+	if (mLatencyDumpInterval.count() > 0) {
+		const auto now = chrono::steady_clock::now();
+		if (now - mLastLatencyDump >= mLatencyDumpInterval) {
+			mLastLatencyDump = now;
+			dumpLatencyStats();
+		}
+	}
 	if (GenericManager::get()->mNeedRestart) {
 		exit(RESTART_EXIT_CODE);
 	}
 }
 
+void Agent::dumpLatencyStats() const {
+	for (const auto& module : mModules) {
+		const auto* stats = module->getLatencyStats();
+		if (stats == nullptr || !module->isEnabled()) continue;
+		ostringstream os;
+		stats->dump(os);
+		const auto text = os.str();
+		if (!text.empty()) LOGI("Latency of module %s:%s", module->getModuleName().c_str(), text.c_str());
+	}
+}
+
 const string& Agent::getUniqueId() const {
 	return mUniqueId;
 }
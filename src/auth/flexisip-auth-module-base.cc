@@ -20,6 +20,7 @@
 #include <sofia-sip/msg_header.h>
 
 #include "flexisip/auth/flexisip-auth-module-base.hh"
+#include "flexisip/common.hh"
 #include "flexisip/logmanager.hh"
 #include "flexisip/module.hh"
 
@@ -41,10 +42,26 @@ AuthModule(root,
 		   AUTHTAG_QOP(qopAuth ? "auth" : nullptr),
 		   TAG_END()
 ),
-	mQOPAuth(qopAuth) {
+	mNonceExpires(nonceExpire), mQOPAuth(qopAuth) {
 	mNonceStore.setNonceExpires(nonceExpire);
 }
 
+void FlexisipAuthModuleBase::enableStatelessNonces() {
+	mStatelessNonceStore.reset(new StatelessNonceStore(mNonceExpires));
+}
+
+std::string FlexisipAuthModuleBase::getClientInfo(const AuthStatus &as) {
+	const auto *uri = as.userUri();
+	string info = as.realm() ? as.realm() : "";
+	info += ':';
+	if (uri) {
+		if (uri->url_user) info += uri->url_user;
+		info += '@';
+		if (uri->url_host) info += uri->url_host;
+	}
+	return info;
+}
+
 void FlexisipAuthModuleBase::onCheck(AuthStatus &as, msg_auth_t *au, auth_challenger_t const *ach) {
 	auto &authStatus = dynamic_cast<FlexisipAuthStatus &>(as);
 
@@ -100,6 +117,12 @@ void FlexisipAuthModuleBase::onChallenge(AuthStatus &as, auth_challenger_t const
 	msg_header_t *response = as.response();
 	as.response(nullptr);
 
+	if (mStatelessNonceStore && response) {
+		// Replace the nonce generated by SofiaSip before the challenge is duplicated for each algorithm.
+		auto nonce = mStatelessNonceStore->generate(getClientInfo(as), getCurrentTime());
+		msg_header_replace_param(as.home(), response->sh_common, su_sprintf(as.home(), "nonce=\"%s\"", nonce.c_str()));
+	}
+
 	msg_header_t *lastChallenge = nullptr;
 	for (const std::string &algo : flexisipAs.usedAlgo()) {
 		msg_header_t *challenge;
@@ -124,7 +147,7 @@ void FlexisipAuthModuleBase::onChallenge(AuthStatus &as, auth_challenger_t const
 		SLOGE << "AuthStatus[" << &as << "]: no available algorithm while challenge making";
 		as.status(500);
 		as.phrase("Internal error");
-	} else {
+	} else if (!mStatelessNonceStore) {
 		mNonceStore.insert(as.response()->sh_auth);
 	}
 }
@@ -117,6 +117,26 @@ void FlexisipAuthModule::makeChallenge(AuthStatus &as, const auth_challenger_t &
 	FlexisipAuthModuleBase::onChallenge(as, &ach);
 }
 
+bool FlexisipAuthModule::validateStatelessNonce(FlexisipAuthStatus &as, const auth_response_t &ar) {
+	if (as.nonceIssued() != 0) return true; // Already validated nonce.
+	time_t issued = 0;
+	switch (mStatelessNonceStore->validate(ar.ar_nonce, getClientInfo(as), getCurrentTime(), issued)) {
+		case StatelessNonceStore::Validity::Valid:
+			as.nonceIssued(issued);
+			return true;
+		case StatelessNonceStore::Validity::Stale:
+			// The request is genuine, only its nonce is too old: it is challenged again, without blacklisting.
+			LOGD("AuthStatus[%p]: stale nonce %s", &as, ar.ar_nonce);
+			as.stale(true);
+			as.nonceIssued(issued);
+			return true;
+		case StatelessNonceStore::Validity::Invalid:
+			LOGD("AuthStatus[%p]: invalid nonce %s", &as, ar.ar_nonce);
+			return false;
+	}
+	return false;
+}
+
 #define PA "Authorization missing "
 
 /** Verify digest authentication */
@@ -157,12 +177,21 @@ void FlexisipAuthModule::checkAuthHeader(FlexisipAuthStatus &as, msg_auth_t *au,
 		return;
 	}
 
-	msg_time_t now = msg_now();
-	if (as.nonceIssued() == 0 /* Already validated nonce */ && auth_validate_digest_nonce(mAm, as.getPtr(), ar, now) < 0) {
-		as.blacklist(mAm->am_blacklist);
-		challenge(as, ach);;
-		notify(as);
-		return;
+	if (mStatelessNonceStore) {
+		if (!validateStatelessNonce(as, *ar)) {
+			as.blacklist(mAm->am_blacklist);
+			challenge(as, ach);
+			notify(as);
+			return;
+		}
+	} else {
+		msg_time_t now = msg_now();
+		if (as.nonceIssued() == 0 /* Already validated nonce */ && auth_validate_digest_nonce(mAm, as.getPtr(), ar, now) < 0) {
+			as.blacklist(mAm->am_blacklist);
+			challenge(as, ach);;
+			notify(as);
+			return;
+		}
 	}
 
 	if (as.stale()) {
@@ -171,7 +200,16 @@ void FlexisipAuthModule::checkAuthHeader(FlexisipAuthStatus &as, msg_auth_t *au,
 		return;
 	}
 
-	if (mQOPAuth) {
+	if (mQOPAuth && mStatelessNonceStore) {
+		auto nc = strtoul(ar->ar_nc, NULL, 16);
+		if (!mStatelessNonceStore->updateNc(ar->ar_nonce, as.nonceIssued(), uint32_t(nc))) {
+			LOGW("Bad nonce count %lu for %s", nc, ar->ar_nonce);
+			as.blacklist(mAm->am_blacklist);
+			challenge(as, ach);
+			notify(as);
+			return;
+		}
+	} else if (mQOPAuth) {
 		int pnc = mNonceStore.getNc(ar->ar_nonce);
 		int nnc = (int)strtoul(ar->ar_nc, NULL, 16);
 		if (pnc == -1 || pnc >= nnc) {
@@ -68,6 +68,7 @@ private:
 
 	void onChallenge(AuthStatus &as, auth_challenger_t const *ach) override;
 	void makeChallenge(AuthStatus& as, const auth_challenger_t &ach);
+	bool validateStatelessNonce(FlexisipAuthStatus &as, const auth_response_t &ar);
 
 	void checkAuthHeader(FlexisipAuthStatus &as, msg_auth_t *credentials, auth_challenger_t const *ach) override;
 
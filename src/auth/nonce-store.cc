@@ -16,6 +16,9 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <random>
+
+#include <bctoolbox/crypto.h>
 #include <sofia-sip/msg_header.h>
 
 #include "flexisip/auth/nonce-store.hh"
@@ -96,3 +99,121 @@ void NonceStore::cleanExpired() {
 }
 
 // ====================================================================================================================
+//  StatelessNonceStore class
+// ====================================================================================================================
+
+constexpr size_t StatelessNonceStore::sShardCount;
+constexpr size_t StatelessNonceStore::sMacSize;
+constexpr size_t StatelessNonceStore::sTimeSize;
+
+StatelessNonceStore::StatelessNonceStore(int nonceExpires)
+	: mNonceExpires(nonceExpires), mBucketDuration(max<time_t>(nonceExpires / 8, 1)) {
+	random_device rd{};
+	for (auto &byte : mKey) byte = uint8_t(rd());
+}
+
+array<uint8_t, StatelessNonceStore::sMacSize> StatelessNonceStore::computeMac(const uint8_t *time,
+																			  const string &clientInfo) const {
+	string input(reinterpret_cast<const char *>(time), sTimeSize);
+	input += clientInfo;
+	array<uint8_t, sMacSize> mac;
+	bctbx_hmacSha256(mKey.data(), mKey.size(), reinterpret_cast<const uint8_t *>(input.data()), input.size(),
+					 uint8_t(mac.size()), mac.data());
+	return mac;
+}
+
+string StatelessNonceStore::generate(const string &clientInfo, time_t now) const {
+	uint8_t time[sTimeSize];
+	for (size_t i = 0; i < sTimeSize; ++i) time[i] = uint8_t(uint64_t(now) >> (8 * (sTimeSize - 1 - i)));
+	const auto mac = computeMac(time, clientInfo);
+
+	static const char hexDigits[] = "0123456789abcdef";
+	string nonce;
+	nonce.reserve(2 * (sTimeSize + sMacSize));
+	for (auto byte : time) nonce.append({hexDigits[byte >> 4], hexDigits[byte & 0xf]});
+	for (auto byte : mac) nonce.append({hexDigits[byte >> 4], hexDigits[byte & 0xf]});
+	return nonce;
+}
+
+StatelessNonceStore::Validity StatelessNonceStore::validate(const string &nonce, const string &clientInfo, time_t now,
+															time_t &issued) const {
+	uint8_t bytes[sTimeSize + sMacSize];
+	if (nonce.size() != 2 * sizeof(bytes)) return Validity::Invalid;
+	for (size_t i = 0; i < sizeof(bytes); ++i) {
+		auto hexValue = [](char c) {
+			if (c >= '0' && c <= '9') return c - '0';
+			if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+			return -1;
+		};
+		const auto high = hexValue(nonce[2 * i]), low = hexValue(nonce[2 * i + 1]);
+		if (high < 0 || low < 0) return Validity::Invalid;
+		bytes[i] = uint8_t(high << 4 | low);
+	}
+
+	const auto mac = computeMac(bytes, clientInfo);
+	uint8_t diff = 0; // Constant time comparison.
+	for (size_t i = 0; i < sMacSize; ++i) diff |= mac[i] ^ bytes[sTimeSize + i];
+	if (diff != 0) return Validity::Invalid;
+
+	uint64_t time = 0;
+	for (size_t i = 0; i < sTimeSize; ++i) time = time << 8 | bytes[i];
+	issued = time_t(time);
+	return (issued > now || issued + mNonceExpires < now) ? Validity::Stale : Validity::Valid;
+}
+
+bool StatelessNonceStore::updateNc(const string &nonce, time_t issued, uint32_t nc) {
+	if (nc == 0 || nonce.size() < 2 * (sTimeSize + sizeof(uint64_t))) return false;
+	// The beginning of the MAC identifies the nonce well enough.
+	const auto id = stoull(nonce.substr(2 * sTimeSize, 2 * sizeof(uint64_t)), nullptr, 16);
+	auto &shard = mShards[id % sShardCount];
+	unique_lock<mutex> lck(shard.mutex);
+	auto &counts = shard.buckets[issued - issued % mBucketDuration];
+	auto it = counts.find(id);
+	if (it == counts.end()) {
+		counts.emplace(id, nc);
+		return true;
+	}
+	if (it->second >= nc) return false;
+	it->second = nc;
+	return true;
+}
+
+void StatelessNonceStore::cleanExpired(time_t now) {
+	size_t count = 0;
+	for (auto &shard : mShards) {
+		unique_lock<mutex> lck(shard.mutex);
+		auto &buckets = shard.buckets;
+		// Buckets are sorted by time: stop at the first one containing nonces which may still be valid.
+		for (auto it = buckets.begin(); it != buckets.end() && it->first + mBucketDuration + mNonceExpires < now;) {
+			count += it->second.size();
+			it = buckets.erase(it);
+		}
+	}
+	if (count) LOGD("Cleaned %zu expired nonce counts", count);
+}
+
+size_t StatelessNonceStore::getTrackedNonceCount() {
+	size_t count = 0;
+	for (auto &shard : mShards) {
+		unique_lock<mutex> lck(shard.mutex);
+		for (const auto &bucket : shard.buckets) count += bucket.second.size();
+	}
+	return count;
+}
+
+size_t StatelessNonceStore::getMemoryUsage() {
+	using Counts = unordered_map<uint64_t, uint32_t>;
+	// Each element is a node holding the value and a pointer to the next node.
+	constexpr size_t nodeSize = sizeof(Counts::value_type) + sizeof(void *);
+	size_t usage = sizeof(*this);
+	for (auto &shard : mShards) {
+		unique_lock<mutex> lck(shard.mutex);
+		for (const auto &bucket : shard.buckets) {
+			usage += sizeof(bucket) + 4 * sizeof(void *); // Node of the map of buckets.
+			usage += bucket.second.size() * nodeSize + bucket.second.bucket_count() * sizeof(void *);
+		}
+	}
+	return usage;
+}
+
+// ====================================================================================================================
@@ -26,6 +26,7 @@
 #include "utils/thread/auto-thread-pool.hh"
 
 #include "authdb.hh"
+#include "overload-control.hh"
 
 using namespace soci;
 
@@ -80,6 +81,24 @@ void SociAuthDB::declareConfig(GenericStruct* mc) {
 	     "\tselect password, 'MD5' from accounts where login = :id and domain = :domain",
 	     "select password, 'MD5' from accounts where login = :id and domain = :domain"},
 
+	    {String, "soci-password-batch-request",
+	     "Soci SQL request used to obtain the passwords of several users at once. When set, the password lookups "
+	     "are grouped into batches, each fetched by a single request, instead of running 'soci-password-request' "
+	     "once per lookup. This saves many round trips to the database when a lot of users register at the same "
+	     "time, after a restart for instance.\n"
+	     "The ':credentials' keyword is replaced by the list of the (user, authorization realm) tuples to look for, "
+	     "e.g. (:id0, :domain0), (:id1, :domain1). The authorization username isn't available.\n"
+	     "The request MUST return a four-columns table: the two columns of 'soci-password-request', followed by "
+	     "the user and the domain each password belongs to. Users and domains are matched case-insensitively.\n"
+	     "\n"
+	     "Example: select password, algorithm, login, domain from accounts where (login, domain) in (:credentials)",
+	     ""},
+
+	    {Integer, "soci-password-batch-max-size", "Maximum number of password lookups per batch request.", "50"},
+
+	    {Integer, "soci-password-batch-max-delay",
+	     "Maximum time in milliseconds a password lookup waits for other lookups to join its batch.", "5"},
+
 	    {Integer, "soci-max-queue-size",
 	     "Amount of queries that will be allowed to be queued before bailing password requests.\n"
 	     "This value should be chosen accordingly with 'soci-poolsize', so that you have a coherent behavior.\n"
@@ -110,8 +129,8 @@ void SociAuthDB::declareConfig(GenericStruct* mc) {
 	     "WARNING: This parameter is used by the presence server only.\n"
 	     "Same as 'soci-user-with-phone-request' but allows to fetch several users by a unique SQL request.\n"
 	     "The string MUST contains the ':phones' keyword which will be replaced by the list of phone numbers to "
-	     "look for. Each element of the list is seperated by a comma character and is protected by simple quotes "
-	     "(e.g. '0336xxxxxxxx','0337yyyyyyyy','034zzzzzzzzz').\n"
+	     "look for. Each element of the list is a parameter bound to a phone number, and they are separated by a "
+	     "comma character (e.g. :phone0, :phone1, :phone2).\n"
 	     "If you use phone number linked accounts you'll need to select login, domain, phone in your request for "
 	     "flexisip to work.\n"
 	     "Example: select login, domain, phone from accounts where phone in (:phones)",
@@ -145,6 +164,7 @@ SociAuthDB::SociAuthDB() {
 	connection_string = ma->get<ConfigString>("soci-connection-string")->read();
 	backend = ma->get<ConfigString>("soci-backend")->read();
 	get_password_request = ma->get<ConfigString>("soci-password-request")->read();
+	get_password_batch_request = ma->get<ConfigString>("soci-password-batch-request")->read();
 	auto max_queue_size = (unsigned int)ma->get<ConfigInt>("soci-max-queue-size")->read();
 
 	get_user_with_phone_request = ps->get<ConfigString>("soci-user-with-phone-request")->read();
@@ -154,6 +174,31 @@ SociAuthDB::SociAuthDB() {
 	conn_pool.reset(new connection_pool(poolSize));
 	thread_pool = make_unique<AutoThreadPool>(poolSize, max_queue_size);
 
+	mCountBatchRequests = ma->get<StatCounter64>("count-password-batch-requests");
+	if (!get_password_batch_request.empty()) {
+		if (get_password_batch_request.find(":credentials") == string::npos) {
+			LOGF("[SOCI] 'soci-password-batch-request' must contain the ':credentials' keyword");
+		}
+		auto maxSize = ma->get<ConfigInt>("soci-password-batch-max-size")->read();
+		auto maxDelay = ma->get<ConfigInt>("soci-password-batch-max-delay")->read();
+		mPasswordBatcher = make_unique<Batcher<PasswordLookup>>(
+		    maxSize > 0 ? maxSize : 1, milliseconds{maxDelay},
+		    [this](vector<PasswordLookup>&& lookups) { runPasswordBatch(move(lookups)); });
+	}
+
+	mResolvedPhones.setCapacity(max(ps->get<ConfigInt>("phone-alias-cache-size")->read(), 0));
+	mPhoneCacheExpire = ps->get<ConfigInt>("phone-alias-cache-expire")->read();
+	mPhoneCacheNegativeExpire = ps->get<ConfigInt>("phone-alias-cache-negative-expire")->read();
+	mCountPhoneBatchRequests = ps->get<StatCounter64>("count-phone-alias-batch-requests");
+	mCountCoalescedPhoneLookups = ps->get<StatCounter64>("count-phone-alias-coalesced-lookups");
+	if (!get_users_with_phones_request.empty()) {
+		auto maxSize = ps->get<ConfigInt>("phone-alias-batch-max-size")->read();
+		auto maxDelay = ps->get<ConfigInt>("phone-alias-batch-max-delay")->read();
+		mPhoneBatcher = make_unique<Batcher<PhoneLookup>>(
+		    maxSize > 0 ? maxSize : 1, milliseconds{maxDelay},
+		    [this](vector<PhoneLookup>&& lookups) { runPhoneBatch(move(lookups)); });
+	}
+
 	LOGD("[SOCI] Authentication provider for backend %s created. Pooled for %zu connections", backend.c_str(),
 	     poolSize);
 	connectDatabase();
@@ -185,157 +230,268 @@ void SociAuthDB::closeOpenedSessions() {
 	_connected = false;
 }
 
-void SociAuthDB::getPasswordWithPool(const string& id,
-                                     const string& domain,
-                                     const string& authid,
-                                     AuthDbListener* listener) {
+// Password and algorithm columns of the rows returned by the password requests.
+using PasswordRows = vector<pair<string, string>>;
+
+static void addPasswordRow(PasswordRows& rows, const row& r) {
+	/* If size == 1 then we only have the password so we assume MD5 */
+	rows.emplace_back(r.get<string>(0), r.size() > 1 ? r.get<string>(1) : "MD5");
+}
+
+static AuthDbBackend::PwList makePasswordList(const PasswordRows& rows, const string& user, const string& domain) {
+	AuthDbBackend::PwList passwd{};
+	for (const auto& r : rows) {
+		const auto& algo = r.second;
+		if (algo == "CLRTXT") {
+			const auto& password = r.first;
+			auto input = user + ":" + domain + ":" + password;
+			passwd.clear();
+			passwd.emplace_back(password, algo);
+			passwd.emplace_back(Md5{}.compute<string>(input), "MD5");
+			passwd.emplace_back(Sha256{}.compute<string>(input), "SHA-256");
+			break;
+		} else {
+			passwd.emplace_back(StringUtils::toLower(r.first), algo);
+		}
+	}
+	return passwd;
+}
+
+void SociAuthDB::getPasswordWithPool(const string& id, const string& domain, const string& authid) {
 	vector<passwd_algo_t> passwd{};
 	auto unescapedIdStr = urlUnescape(id);
 
 	SociHelper sociHelper{*conn_pool};
 
 	try {
+		PasswordRows rows{};
 		sociHelper.execute([&](session& sql) {
 			rowset<row> results = (sql.prepare << get_password_request, use(unescapedIdStr, "id"),
 			                       use(domain, "domain"), use(authid, "authid"));
 			for (const auto& r : results) {
-				/* If size == 1 then we only have the password so we assume MD5 */
-				auto algo = r.size() > 1 ? r.get<string>(1) : "MD5";
-				if (algo == "CLRTXT") {
-					const auto& password = r.get<string>(0);
-					auto input = unescapedIdStr + ":" + domain + ":" + password;
-					passwd.clear();
-					passwd.emplace_back(password, algo);
-					passwd.emplace_back(Md5{}.compute<string>(input), "MD5");
-					passwd.emplace_back(Sha256{}.compute<string>(input), "SHA-256");
-					break;
-				} else {
-					auto hash = StringUtils::toLower(r.get<string>(0));
-					passwd.emplace_back(move(hash), algo);
-				}
+				addPasswordRow(rows, r);
 			}
 		});
+		passwd = makePasswordList(rows, unescapedIdStr, domain);
 
-		if (!passwd.empty()) cachePassword(createPasswordKey(id, authid), domain, passwd, mCacheExpire);
-		if (listener) {
-			listener->onResult(passwd.empty() ? PASSWORD_NOT_FOUND : PASSWORD_FOUND, passwd);
-		}
+		const auto key = createPasswordKey(id, authid);
+		if (!passwd.empty()) cachePassword(key, domain, passwd, mCacheExpire);
+		else cacheUnknownUser(key, domain);
+		notifyPasswordListeners(getCacheKey(key, domain), passwd.empty() ? PASSWORD_NOT_FOUND : PASSWORD_FOUND,
+		                        passwd);
 	} catch (SociHelper::DatabaseException& e) {
-		if (listener) listener->onResult(AUTH_ERROR, passwd);
+		notifyPasswordListeners(getCacheKey(createPasswordKey(id, authid), domain), AUTH_ERROR, passwd);
 	}
 }
 
-void SociAuthDB::getUserWithPhoneWithPool(const string& phone, const string& domain, AuthDbListener* listener) {
-	string user;
-
-	try {
-		SociHelper sociHelper(*conn_pool);
+string SociAuthDB::makeBatchPasswordRequest(const string& request, size_t count) {
+	ostringstream credentials{};
+	for (size_t i = 0; i < count; ++i) {
+		if (i != 0) credentials << ", ";
+		credentials << "(:id" << i << ", :domain" << i << ")";
+	}
+	static const string keyword = ":credentials";
+	const auto list = credentials.str();
+	string batchRequest = request;
+	for (auto index = batchRequest.find(keyword); index != string::npos;
+	     index = batchRequest.find(keyword, index + list.size())) {
+		batchRequest.replace(index, keyword.size(), list);
+	}
+	return batchRequest;
+}
 
-		if (get_user_with_phone_request != "") {
-			sociHelper.execute(
-			    [&](session& sql) { sql << get_user_with_phone_request, into(user), use(phone, "phone"); });
-		} else {
-			string s = get_users_with_phones_request;
-			int index = s.find(":phones");
-			while (index > -1) {
-				s = s.replace(index, 7, phone);
-				index = s.find(":phones");
-			}
-			sociHelper.execute([&](session& sql) {
-				rowset<row> ret = (sql.prepare << s);
-				for (rowset<row>::const_iterator it = ret.begin(); it != ret.end(); ++it) {
-					row const& row = *it;
-					user = row.get<string>(0);
-				}
-			});
-		}
-		if (!user.empty()) {
-			cacheUserWithPhone(phone, domain, user);
+void SociAuthDB::runPasswordBatch(vector<PasswordLookup>&& lookups) {
+	auto batch = make_shared<vector<PasswordLookup>>(move(lookups));
+	bool success = thread_pool->run([this, batch] { getPasswordsWithPool(*batch); });
+	if (!success) {
+		SLOGE << "[SOCI] Auth queue is full, cannot fullfil a batch of " << batch->size() << " password requests";
+		for (const auto& lookup : *batch) {
+			notifyPasswordListeners(getCacheKey(createPasswordKey(lookup.id, lookup.authid), lookup.domain),
+			                        AUTH_ERROR, PwList());
 		}
-		if (listener) {
-			listener->onResult(user.empty() ? PASSWORD_NOT_FOUND : PASSWORD_FOUND, user);
+	}
+}
+
+void SociAuthDB::getPasswordsWithPool(const vector<PasswordLookup>& lookups) {
+	auto credentialKey = [](const string& user, const string& domain) {
+		return StringUtils::toLower(domain) + '\n' + StringUtils::toLower(user);
+	};
+	// Lookups of the same user with different authids are answered by the same rows.
+	vector<string> unescapedIds{};
+	unordered_map<string, PasswordRows> rowsByCredentials{};
+	values params{};
+	size_t count = 0;
+	for (const auto& lookup : lookups) {
+		unescapedIds.push_back(urlUnescape(lookup.id));
+		if (!rowsByCredentials.emplace(credentialKey(unescapedIds.back(), lookup.domain), PasswordRows{}).second) {
+			continue;
 		}
+		params.set("id" + to_string(count), unescapedIds.back());
+		params.set("domain" + to_string(count), lookup.domain);
+		++count;
+	}
+	const auto request = makeBatchPasswordRequest(get_password_batch_request, count);
+
+	SociHelper sociHelper{*conn_pool};
+	try {
+		sociHelper.execute([&](session& sql) {
+			rowset<row> results = (sql.prepare << request, use(params));
+			for (const auto& r : results) {
+				auto it = rowsByCredentials.find(credentialKey(r.get<string>(2), r.get<string>(3)));
+				if (it != rowsByCredentials.end()) addPasswordRow(it->second, r);
+			}
+		});
+		mCountBatchRequests->incr();
 	} catch (SociHelper::DatabaseException& e) {
-		if (listener) listener->onResult(PASSWORD_NOT_FOUND, user);
+		for (const auto& lookup : lookups) {
+			notifyPasswordListeners(getCacheKey(createPasswordKey(lookup.id, lookup.authid), lookup.domain),
+			                        AUTH_ERROR, PwList());
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < lookups.size(); ++i) {
+		const auto& lookup = lookups[i];
+		const auto& rows = rowsByCredentials[credentialKey(unescapedIds[i], lookup.domain)];
+		auto passwd = makePasswordList(rows, unescapedIds[i], lookup.domain);
+		const auto key = createPasswordKey(lookup.id, lookup.authid);
+		if (!passwd.empty()) cachePassword(key, lookup.domain, passwd, mCacheExpire);
+		else cacheUnknownUser(key, lookup.domain);
+		notifyPasswordListeners(getCacheKey(key, lookup.domain), passwd.empty() ? PASSWORD_NOT_FOUND : PASSWORD_FOUND,
+		                        passwd);
 	}
 }
 
-void SociAuthDB::getUsersWithPhonesWithPool(list<tuple<string, string, AuthDbListener*>>& creds) {
-	set<pair<string, string>> presences;
-	ostringstream in;
-	list<string> phones;
-	list<string> domains;
-	bool first = true;
-
-	for (const auto& cred : creds) {
-		const auto& phone = std::get<0>(cred);
-		phones.push_back(phone);
-		domains.push_back(std::get<1>(cred));
-		if (first) {
-			first = false;
-			in << "'" << phone << "'";
-		} else {
-			in << ",'" << phone << "'";
-		}
+void SociAuthDB::notifyPasswordListeners(const string& requestKey, AuthDbResult result, const PwList& passwd) {
+	vector<AuthDbListener*> listeners{};
+	{
+		lock_guard<mutex> lock(mPendingPasswordRequestsMutex);
+		auto it = mPendingPasswordRequests.find(requestKey);
+		if (it == mPendingPasswordRequests.end()) return;
+		listeners = move(it->second);
+		mPendingPasswordRequests.erase(it);
+	}
+	for (auto* listener : listeners) {
+		listener->onResult(result, passwd);
 	}
+}
 
-	string s = get_users_with_phones_request;
-	int index = s.find(":phones");
-	while (index > -1) {
-		s = s.replace(index, 7, in.str());
-		index = s.find(":phones");
+string SociAuthDB::makeUsersWithPhonesRequest(const string& request, size_t count) {
+	// The phone numbers come from the request URIs of the subscriptions: they are bound, never written in the request.
+	ostringstream phones{};
+	for (size_t i = 0; i < count; ++i) {
+		if (i != 0) phones << ", ";
+		phones << ":phone" << i;
+	}
+	static const string keyword = ":phones";
+	const auto list = phones.str();
+	string phonesRequest = request;
+	for (auto index = phonesRequest.find(keyword); index != string::npos;
+	     index = phonesRequest.find(keyword, index + list.size())) {
+		phonesRequest.replace(index, keyword.size(), list);
 	}
+	return phonesRequest;
+}
 
+void SociAuthDB::getUserWithPhoneWithPool(const string& phone, const string& domain) {
+	string user;
 	try {
 		SociHelper sociHelper(*conn_pool);
-		sociHelper.execute([&](session& sql) {
-			rowset<row> ret = (sql.prepare << s);
+		sociHelper.execute([&](session& sql) { sql << get_user_with_phone_request, into(user), use(phone, "phone"); });
+	} catch (SociHelper::DatabaseException& e) {
+		notifyPhoneListeners(getCacheKey(phone, domain), AUTH_ERROR, "");
+		return;
+	}
+	if (!user.empty()) cacheResolvedPhone(phone, domain, user, mPhoneCacheExpire);
+	else cacheUnknownPhone(phone, domain, mPhoneCacheNegativeExpire);
+	notifyPhoneListeners(getCacheKey(phone, domain), user.empty() ? PASSWORD_NOT_FOUND : PASSWORD_FOUND,
+	                     user.empty() ? phone : user);
+}
 
-			for (rowset<row>::const_iterator it = ret.begin(); it != ret.end(); ++it) {
-				row const& row = *it;
-				string user = row.get<string>(0);
-				string domain = row.get<string>(1);
-				string phone = (row.size() > 2) ? row.get<string>(2) : "";
+void SociAuthDB::runPhoneBatch(vector<PhoneLookup>&& lookups) {
+	auto batch = make_shared<vector<PhoneLookup>>(move(lookups));
+	bool success = thread_pool->run([this, batch] { getUsersWithPhonesWithPool(*batch); });
+	if (!success) {
+		SLOGE << "[SOCI] Auth queue is full, cannot fullfil a batch of " << batch->size() << " phone alias requests";
+		for (const auto& lookup : *batch) {
+			notifyPhoneListeners(getCacheKey(lookup.phone, lookup.domain), AUTH_ERROR, "");
+		}
+	}
+}
 
-				bool domain_match = false;
-				if (check_domain_in_presence_results) {
-					domain_match = find(domains.begin(), domains.end(), domain) != domains.end();
-				}
+void SociAuthDB::getUsersWithPhonesWithPool(const vector<PhoneLookup>& lookups) {
+	// The same phone number may be looked up in several domains.
+	unordered_map<string, vector<const PhoneLookup*>> lookupsByPhone{};
+	vector<string> phones{};
+	for (const auto& lookup : lookups) {
+		auto& samePhone = lookupsByPhone[lookup.phone];
+		if (samePhone.empty()) phones.push_back(lookup.phone);
+		samePhone.push_back(&lookup);
+	}
+	values params{};
+	for (size_t i = 0; i < phones.size(); ++i) {
+		params.set("phone" + to_string(i), phones[i]);
+	}
+	const auto request = makeUsersWithPhonesRequest(get_users_with_phones_request, phones.size());
 
-				if (!check_domain_in_presence_results || domain_match) {
-					if (!phone.empty()) {
-						cacheUserWithPhone(phone, domain, user);
-						presences.insert(make_pair(user, phone));
-					} else {
-						presences.insert(make_pair(user, user));
-					}
+	// Users found, by request key.
+	unordered_map<string, string> users{};
+	try {
+		SociHelper sociHelper(*conn_pool);
+		sociHelper.execute([&](session& sql) {
+			users.clear();
+			rowset<row> results = (sql.prepare << request, use(params));
+			for (const auto& r : results) {
+				const auto user = r.get<string>(0);
+				const auto domain = r.get<string>(1);
+				// Without phone, the row is the one of a user looked up by its own name.
+				auto phone = (r.size() > 2) ? r.get<string>(2) : "";
+				if (phone.empty()) phone = user;
+
+				auto it = lookupsByPhone.find(phone);
+				if (it == lookupsByPhone.end()) continue;
+				for (const auto* lookup : it->second) {
+					if (check_domain_in_presence_results && lookup->domain != domain) continue;
+					users.emplace(getCacheKey(lookup->phone, lookup->domain), user);
 				}
 			}
 		});
-		notifyAllListeners(creds, presences);
+		mCountPhoneBatchRequests->incr();
 	} catch (SociHelper::DatabaseException& e) {
-		SLOGE << "[SOCI] MySQL request causing the error was : " << s;
-		presences.clear();
-		notifyAllListeners(creds, presences);
+		SLOGE << "[SOCI] MySQL request causing the error was : " << request;
+		for (const auto& lookup : lookups) {
+			notifyPhoneListeners(getCacheKey(lookup.phone, lookup.domain), AUTH_ERROR, "");
+		}
+		return;
 	}
-}
 
-void SociAuthDB::notifyAllListeners(std::list<std::tuple<std::string, std::string, AuthDbListener*>>& creds,
-                                    const std::set<std::pair<std::string, std::string>>& presences) {
-	for (const auto& cred : creds) {
-		const string& phone = std::get<0>(cred);
-		AuthDbListener* listener = std::get<2>(cred);
-		auto presence = find_if(presences.cbegin(), presences.cend(),
-		                        [&phone](const pair<string, string>& p) { return p.second == phone; });
-		if (presence != presences.cend()) {
-			// 				mDInfo[presence->first] = mDInfo[phone];
-			if (listener) listener->onResult(PASSWORD_FOUND, presence->first);
+	for (const auto& lookup : lookups) {
+		const auto requestKey = getCacheKey(lookup.phone, lookup.domain);
+		auto it = users.find(requestKey);
+		if (it != users.end()) {
+			cacheResolvedPhone(lookup.phone, lookup.domain, it->second, mPhoneCacheExpire);
+			notifyPhoneListeners(requestKey, PASSWORD_FOUND, it->second);
 		} else {
-			if (listener) listener->onResult(PASSWORD_NOT_FOUND, phone);
+			cacheUnknownPhone(lookup.phone, lookup.domain, mPhoneCacheNegativeExpire);
+			notifyPhoneListeners(requestKey, PASSWORD_NOT_FOUND, lookup.phone);
 		}
 	}
 }
 
+void SociAuthDB::notifyPhoneListeners(const string& requestKey, AuthDbResult result, const string& user) {
+	vector<AuthDbListener*> listeners{};
+	{
+		lock_guard<mutex> lock(mPendingPhoneRequestsMutex);
+		auto it = mPendingPhoneRequests.find(requestKey);
+		if (it == mPendingPhoneRequests.end()) return;
+		listeners = move(it->second);
+		mPendingPhoneRequests.erase(it);
+	}
+	for (auto* listener : listeners) {
+		listener->onResult(result, user);
+	}
+}
+
 #ifdef __clang__
 #pragma mark - Inherited virtuals
 #endif
@@ -351,15 +507,37 @@ void SociAuthDB::getPasswordFromBackend(const string& id,
 		return;
 	}
 
-	// create a thread to grab a pool connection and use it to retrieve the auth information
-	auto func = bind(&SociAuthDB::getPasswordWithPool, this, id, domain, authid, listener);
+	// If the same credentials are already being fetched, wait for the result of the running request instead of
+	// sending another one to the database.
+	const auto requestKey = getCacheKey(createPasswordKey(id, authid), domain);
+	{
+		lock_guard<mutex> lock(mPendingPasswordRequestsMutex);
+		auto it = mPendingPasswordRequests.find(requestKey);
+		if (it != mPendingPasswordRequests.end()) {
+			if (listener) it->second.push_back(listener);
+			mCountCoalescedLookups->incr();
+			return;
+		}
+		auto& listeners = mPendingPasswordRequests[requestKey];
+		if (listener) listeners.push_back(listener);
+	}
+
+	if (mPasswordBatcher) {
+		mPasswordBatcher->add(PasswordLookup{id, domain, authid, make_shared<BackendRequestGuard>()});
+		return;
+	}
+
+	// create a thread to grab a pool connection and use it to retrieve the auth information.
+	// The guard counts the request as pending for the overload control until the task is done.
+	auto func = [task = bind(&SociAuthDB::getPasswordWithPool, this, id, domain, authid),
+	             guard = make_shared<BackendRequestGuard>()]() mutable { task(); };
 
 	bool success = thread_pool->run(func);
 	if (!success) {
 		// Enqueue() can fail when the queue is full, so we have to act on that
 		SLOGE << "[SOCI] Auth queue is full, cannot fullfil password request for " << id << " / " << domain << " / "
 		      << authid;
-		if (listener) listener->onResult(AUTH_ERROR, PwList());
+		notifyPasswordListeners(requestKey, AUTH_ERROR, PwList());
 	}
 }
 
@@ -370,37 +548,34 @@ void SociAuthDB::getUserWithPhoneFromBackend(const string& phone, const string&
 		return;
 	}
 
-	// create a thread to grab a pool connection and use it to retrieve the auth information
-	auto func = bind(&SociAuthDB::getUserWithPhoneWithPool, this, phone, domain, listener);
-
-	bool success = thread_pool->run(func);
-	if (success == FALSE) {
-		// Enqueue() can fail when the queue is full, so we have to act on that
-		SLOGE << "[SOCI] Auth queue is full, cannot fullfil user request for " << phone;
-		if (listener) listener->onResult(AUTH_ERROR, "");
+	// Subscriptions to lists sharing phone numbers look them up at the same time: wait for the result of the
+	// running request instead of sending another one to the database.
+	const auto requestKey = getCacheKey(phone, domain);
+	{
+		lock_guard<mutex> lock(mPendingPhoneRequestsMutex);
+		auto it = mPendingPhoneRequests.find(requestKey);
+		if (it != mPendingPhoneRequests.end()) {
+			if (listener) it->second.push_back(listener);
+			mCountCoalescedPhoneLookups->incr();
+			return;
+		}
+		auto& listeners = mPendingPhoneRequests[requestKey];
+		if (listener) listeners.push_back(listener);
 	}
-}
 
-void SociAuthDB::getUsersWithPhonesFromBackend(list<tuple<string, string, AuthDbListener*>>& creds) {
-	if (!_connected) connectDatabase();
-	if (!_connected) {
-		for (const auto& cred : creds) {
-			AuthDbListener* listener = std::get<2>(cred);
-			if (listener) listener->onResult(AUTH_ERROR, "");
-		}
+	if (mPhoneBatcher) {
+		mPhoneBatcher->add(PhoneLookup{phone, domain, make_shared<BackendRequestGuard>()});
 		return;
 	}
 
 	// create a thread to grab a pool connection and use it to retrieve the auth information
-	auto func = bind(&SociAuthDB::getUsersWithPhonesWithPool, this, creds);
+	auto func = [task = bind(&SociAuthDB::getUserWithPhoneWithPool, this, phone, domain),
+	             guard = make_shared<BackendRequestGuard>()]() mutable { task(); };
 
 	bool success = thread_pool->run(func);
 	if (success == FALSE) {
 		// Enqueue() can fail when the queue is full, so we have to act on that
-		SLOGE << "[SOCI] Auth queue is full, cannot fullfil user request for " << &creds;
-		for (const auto& cred : creds) {
-			AuthDbListener* listener = std::get<2>(cred);
-			if (listener) listener->onResult(AUTH_ERROR, "");
-		}
+		SLOGE << "[SOCI] Auth queue is full, cannot fullfil user request for " << phone;
+		notifyPhoneListeners(requestKey, AUTH_ERROR, "");
 	}
 }
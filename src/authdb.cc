@@ -73,11 +73,24 @@ AuthDbBackend &AuthDbBackend::get() {
 	return *sUnique;
 }
 
+void AuthDbBackend::resetAuthDB() {
+	SLOGW << "Reseting AuthDbBackend static pointer, you MUST be in a test.";
+	sUnique = nullptr;
+}
+
 AuthDbBackend::AuthDbBackend() {
 	GenericStruct *cr = GenericManager::get()->getRoot();
 	GenericStruct *ma = cr->get<GenericStruct>("module::Authentication");
 	list<string> domains = ma->get<ConfigStringList>("auth-domains")->read();
 	mCacheExpire = ma->get<ConfigInt>("cache-expire")->read();
+	mCacheNegativeExpire = ma->get<ConfigInt>("cache-negative-expire")->read();
+	mCachedPasswords.setRefreshAheadPercent(ma->get<ConfigInt>("cache-refresh-ahead")->read());
+
+	mCountCacheHits = ma->get<StatCounter64>("count-password-cache-hits");
+	mCountCacheNegativeHits = ma->get<StatCounter64>("count-password-cache-negative-hits");
+	mCountCacheMisses = ma->get<StatCounter64>("count-password-cache-misses");
+	mCountCacheRefreshes = ma->get<StatCounter64>("count-password-cache-refreshes");
+	mCountCoalescedLookups = ma->get<StatCounter64>("count-password-coalesced-lookups");
 }
 
 AuthDbBackend::~AuthDbBackend() {
@@ -107,44 +120,38 @@ string AuthDbBackend::createPasswordKey(const string &user, const string &auth_u
 	return key.str();
 }
 
-AuthDbBackend::CacheResult AuthDbBackend::getCachedPassword(const string &key, const string &domain, vector<passwd_algo_t> &pass) {
-	time_t now = getCurrentTime();
-	auto &passwords = mCachedPasswords[domain];
-	unique_lock<mutex> lck(mCachedPasswordMutex);
-	auto it = passwords.find(key);
-	if (it != passwords.end()) {
-		pass = it->second.pass;
-		if (now < it->second.expire_date) {
+AuthDbBackend::CacheResult AuthDbBackend::getCachedPassword(const string &key, const string &domain, vector<passwd_algo_t> &pass, bool *refresh) {
+	switch (mCachedPasswords.get(getCacheKey(key, domain), getCurrentTime(), pass, refresh)) {
+		case ExpiringCache<vector<passwd_algo_t>>::Status::Hit:
 			return VALID_PASS_FOUND;
-		} else {
-			passwords.erase(it);
+		case ExpiringCache<vector<passwd_algo_t>>::Status::NegativeHit:
+			return UNKNOWN_USER_FOUND;
+		case ExpiringCache<vector<passwd_algo_t>>::Status::Expired:
 			return EXPIRED_PASS_FOUND;
-		}
+		case ExpiringCache<vector<passwd_algo_t>>::Status::Miss:
+			break;
 	}
 	return NO_PASS_FOUND;
 }
 
 void AuthDbBackend::clearCache() {
 	mCachedPasswords.clear();
+	mResolvedPhones.clear();
 }
 
 bool AuthDbBackend::cachePassword(const string &key, const string &domain, const vector<passwd_algo_t> &pass, int expires) {
 	if (pass.empty()) throw invalid_argument("empty password list");
-	time_t now = getCurrentTime();
-	map<string, CachedPassword> &passwords = mCachedPasswords[domain];
-	unique_lock<mutex> lck(mCachedPasswordMutex);
-	map<string, CachedPassword>::iterator it = passwords.find(key);
 	if (expires == -1)
 		expires = mCacheExpire;
-	if (it != passwords.end()) {
-		it->second.pass = pass;
-		it->second.expire_date = now + expires;
-	} else {
-		passwords.insert(make_pair(key, CachedPassword(pass, now + expires)));
-	}
+	mCachedPasswords.put(getCacheKey(key, domain), pass, getCurrentTime(), expires);
 	return true;
 }
 
+void AuthDbBackend::cacheUnknownUser(const string &key, const string &domain) {
+	if (mCacheNegativeExpire <= 0) return;
+	mCachedPasswords.putNegative(getCacheKey(key, domain), getCurrentTime(), mCacheNegativeExpire);
+}
+
 bool AuthDbBackend::cacheUserWithPhone(const string &phone, const string &domain, const string &user) {
 	unique_lock<mutex> lck(mCachedUserWithPhoneMutex);
 
@@ -159,20 +166,41 @@ bool AuthDbBackend::cacheUserWithPhone(const string &phone, const string &domain
 	return true;
 }
 
+void AuthDbBackend::cacheResolvedPhone(const string &phone, const string &domain, const string &user, int expires) {
+	mResolvedPhones.put(getCacheKey(phone, domain), user, getCurrentTime(), expires);
+}
+
+void AuthDbBackend::cacheUnknownPhone(const string &phone, const string &domain, int expires) {
+	if (expires <= 0) return;
+	mResolvedPhones.putNegative(getCacheKey(phone, domain), getCurrentTime(), expires);
+}
+
 void AuthDbBackend::getPassword(const std::string &user, const std::string &domain, const std::string &auth_username, AuthDbListener *listener) {
 	// Check for usable cached password
 	string key = createPasswordKey(user, auth_username);
 	vector<passwd_algo_t> pass;
-	switch (getCachedPassword(key, domain, pass)) {
+	bool refresh = false;
+	switch (getCachedPassword(key, domain, pass, &refresh)) {
 		case VALID_PASS_FOUND:
+			mCountCacheHits->incr();
 			if (listener) listener->onResult(AuthDbResult::PASSWORD_FOUND, pass);
+			if (refresh) {
+				// The password will expire soon: fetch it again in the background, so that the next requests don't
+				// all wait for the backend at the time it expires.
+				mCountCacheRefreshes->incr();
+				getPasswordFromBackend(user, domain, auth_username, nullptr);
+			}
+			return;
+		case UNKNOWN_USER_FOUND:
+			mCountCacheNegativeHits->incr();
+			if (listener) listener->onResult(AuthDbResult::PASSWORD_NOT_FOUND, pass);
 			return;
 		case EXPIRED_PASS_FOUND:
 			// Might check here if connection is failing
 			// If it is the case use fallback password and
 			// return AuthDbResult::PASSWORD_FOUND;
-			break;
 		case NO_PASS_FOUND:
+			mCountCacheMisses->incr();
 			break;
 	}
 
@@ -228,6 +256,15 @@ AuthDbBackend::CacheResult AuthDbBackend::getCachedUserWithPhone(const string &p
 		user.assign(it->second);
 		return VALID_PASS_FOUND;
 	}
+	lck.unlock();
+	switch (mResolvedPhones.get(getCacheKey(phone, domain), getCurrentTime(), user)) {
+		case LruCache<string>::Status::Hit:
+			return VALID_PASS_FOUND;
+		case LruCache<string>::Status::NegativeHit:
+			return UNKNOWN_USER_FOUND;
+		case LruCache<string>::Status::Miss:
+			break;
+	}
 	return NO_PASS_FOUND;
 }
 
@@ -238,6 +275,9 @@ void AuthDbBackend::getUserWithPhone(const string & phone, const string & domain
 		case VALID_PASS_FOUND:
 			if (listener) listener->onResult(AuthDbResult::PASSWORD_FOUND, user);
 			return;
+		case UNKNOWN_USER_FOUND:
+			if (listener) listener->onResult(AuthDbResult::PASSWORD_NOT_FOUND, phone);
+			return;
 		case EXPIRED_PASS_FOUND:
 		case NO_PASS_FOUND:
 			break;
@@ -259,6 +299,9 @@ void AuthDbBackend::getUsersWithPhone(list<tuple<string,string,AuthDbListener*>>
 			case VALID_PASS_FOUND:
 				if (cred_listener) cred_listener->onResult(AuthDbResult::PASSWORD_FOUND, user);
 				break;
+			case UNKNOWN_USER_FOUND:
+				if (cred_listener) cred_listener->onResult(AuthDbResult::PASSWORD_NOT_FOUND, phone);
+				break;
 			case EXPIRED_PASS_FOUND:
 			case NO_PASS_FOUND:
 				needed_creds.push_back(cred);
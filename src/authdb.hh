@@ -30,6 +30,7 @@
 #include <map>
 #include <set>
 #include <thread>
+#include <unordered_map>
 
 #include "sofia-sip/auth_module.h"
 #include "sofia-sip/auth_plugin.h"
@@ -37,6 +38,9 @@
 #include "belr/grammarbuilder.h"
 #include "belr/parser.h"
 
+#include "utils/expiring-cache.hh"
+#include "utils/lru-cache.hh"
+
 namespace flexisip {
 
 enum AuthDbResult { PENDING, PASSWORD_FOUND, PASSWORD_NOT_FOUND, AUTH_ERROR };
@@ -86,11 +90,13 @@ public:
 	                           const std::string& phone_alias = "");
 
 	static AuthDbBackend& get();
+	/* Destroy the backend, so that the next call to get() creates one matching the current configuration */
+	static void resetAuthDB();
 	/* called by module_auth so that backends can declare their configuration to the ConfigurationManager */
 	static void declareConfig(GenericStruct* mc);
 
 protected:
-	enum CacheResult { VALID_PASS_FOUND, EXPIRED_PASS_FOUND, NO_PASS_FOUND };
+	enum CacheResult { VALID_PASS_FOUND, EXPIRED_PASS_FOUND, NO_PASS_FOUND, UNKNOWN_USER_FOUND };
 
 	AuthDbBackend();
 
@@ -106,8 +112,26 @@ protected:
 	                   const std::string& domain,
 	                   const std::vector<passwd_algo_t>& pass,
 	                   int expires);
+	/**
+	 * Remember for [cache-negative-expire] seconds that the user doesn't exist, so that repeated attempts with unknown
+	 * usernames don't reach the backend.
+	 */
+	void cacheUnknownUser(const std::string& key, const std::string& domain);
 	bool cacheUserWithPhone(const std::string& phone, const std::string& domain, const std::string& user);
-	CacheResult getCachedPassword(const std::string& key, const std::string& domain, std::vector<passwd_algo_t>& pass);
+	/**
+	 * Remember the user found by the backend for a phone alias, or that there is none, in a cache of bounded size,
+	 * unlike the aliases of the accounts known locally.
+	 */
+	void cacheResolvedPhone(const std::string& phone, const std::string& domain, const std::string& user, int expires);
+	void cacheUnknownPhone(const std::string& phone, const std::string& domain, int expires);
+	/**
+	 * @param[out] refresh If not null, set to true when the password has to be fetched again from the backend because
+	 * it will expire soon.
+	 */
+	CacheResult getCachedPassword(const std::string& key,
+	                              const std::string& domain,
+	                              std::vector<passwd_algo_t>& pass,
+	                              bool* refresh = nullptr);
 	CacheResult getCachedUserWithPhone(const std::string& phone, const std::string& domain, std::string& user);
 	void createCachedAccount(const std::string& user,
 	                         const std::string& domain,
@@ -118,16 +142,21 @@ protected:
 	void clearCache();
 
 	static std::string urlUnescape(const std::string& str);
+	static std::string getCacheKey(const std::string& key, const std::string& domain) {
+		return domain + '\n' + key;
+	}
 
 	int mCacheExpire;
+	int mCacheNegativeExpire;
+	StatCounter64* mCountCacheHits = nullptr;
+	StatCounter64* mCountCacheNegativeHits = nullptr;
+	StatCounter64* mCountCacheMisses = nullptr;
+	StatCounter64* mCountCacheRefreshes = nullptr;
+	StatCounter64* mCountCoalescedLookups = nullptr;
+	// Users of the phone aliases resolved by the backend. Disabled (no capacity) unless the backend sets it up.
+	LruCache<std::string> mResolvedPhones{};
 
 private:
-	struct CachedPassword {
-		std::vector<passwd_algo_t> pass;
-		time_t expire_date;
-		CachedPassword(const std::vector<passwd_algo_t>& ipass, time_t idate) : pass(ipass), expire_date(idate) {
-		}
-	};
 
 	struct ListenerToFunctionWrapper : public AuthDbListener {
 	public:
@@ -144,8 +173,7 @@ private:
 
 	static std::unique_ptr<AuthDbBackend> sUnique;
 
-	std::map<std::string, std::map<std::string, CachedPassword>> mCachedPasswords;
-	std::mutex mCachedPasswordMutex;
+	ExpiringCache<std::vector<passwd_algo_t>> mCachedPasswords;
 	std::mutex mCachedUserWithPhoneMutex;
 	std::map<std::string, std::string> mPhone2User;
 };
@@ -272,37 +300,59 @@ public:
 #if ENABLE_SOCI
 
 #include "soci/soci.h"
+#include "utils/batcher.hh"
 #include "utils/thread/thread-pool.hh"
 
 namespace flexisip {
 
+class BackendRequestGuard;
+
 class SociAuthDB : public AuthDbBackend {
 public:
 	void getUserWithPhoneFromBackend(const std::string&, const std::string&, AuthDbListener* listener) override;
-	void
-	getUsersWithPhonesFromBackend(std::list<std::tuple<std::string, std::string, AuthDbListener*>>& creds) override;
 	void getPasswordFromBackend(const std::string& id,
 	                            const std::string& domain,
 	                            const std::string& authid,
 	                            AuthDbListener* listener) override;
 
 	static void declareConfig(GenericStruct* mc);
+	/**
+	 * Replace the ':credentials' keyword of the batch password request by the list of 'count' (:idN, :domainN)
+	 * tuples.
+	 */
+	static std::string makeBatchPasswordRequest(const std::string& request, std::size_t count);
+	/**
+	 * Replace the ':phones' keyword of the users with phones request by the list of 'count' :phoneN parameters.
+	 */
+	static std::string makeUsersWithPhonesRequest(const std::string& request, std::size_t count);
 
 private:
+	struct PasswordLookup {
+		std::string id;
+		std::string domain;
+		std::string authid;
+		// Keeps the lookup counted as pending by the overload control while it waits for its batch.
+		std::shared_ptr<BackendRequestGuard> guard;
+	};
+	struct PhoneLookup {
+		std::string phone;
+		std::string domain;
+		std::shared_ptr<BackendRequestGuard> guard;
+	};
+
 	SociAuthDB();
 
 	void connectDatabase();
 	void closeOpenedSessions();
 
-	void getUserWithPhoneWithPool(const std::string& phone, const std::string& domain, AuthDbListener* listener);
-	void getUsersWithPhonesWithPool(std::list<std::tuple<std::string, std::string, AuthDbListener*>>& creds);
-	void getPasswordWithPool(const std::string& id,
-	                         const std::string& domain,
-	                         const std::string& authid,
-	                         AuthDbListener* listener);
-
-	void notifyAllListeners(std::list<std::tuple<std::string, std::string, AuthDbListener*>>& creds,
-	                        const std::set<std::pair<std::string, std::string>>& presences);
+	void getUserWithPhoneWithPool(const std::string& phone, const std::string& domain);
+	void notifyPhoneListeners(const std::string& requestKey, AuthDbResult result, const std::string& user);
+	void runPhoneBatch(std::vector<PhoneLookup>&& lookups);
+	void getUsersWithPhonesWithPool(const std::vector<PhoneLookup>& lookups);
+	void getPasswordWithPool(const std::string& id, const std::string& domain, const std::string& authid);
+	void notifyPasswordListeners(const std::string& requestKey, AuthDbResult result, const PwList& passwd);
+	void runPasswordBatch(std::vector<PasswordLookup>&& lookups);
+	void getPasswordsWithPool(const std::vector<PasswordLookup>& lookups);
 
 	std::size_t poolSize;
 	std::unique_ptr<soci::connection_pool> conn_pool;
@@ -310,11 +360,27 @@ private:
 	std::string connection_string;
 	std::string backend;
 	std::string get_password_request;
+	std::string get_password_batch_request;
 	std::string get_user_with_phone_request;
 	std::string get_users_with_phones_request;
 	std::string get_password_algo_request;
 	bool check_domain_in_presence_results = false;
 	bool _connected = false;
+	// Listeners waiting for the result of each password request being run, so that concurrent lookups of the same
+	// credentials only run the request once.
+	std::unordered_map<std::string, std::vector<AuthDbListener*>> mPendingPasswordRequests;
+	std::mutex mPendingPasswordRequestsMutex;
+	StatCounter64* mCountBatchRequests = nullptr;
+	// Same for the phone alias lookups, of all the subscriptions of the presence server.
+	std::unordered_map<std::string, std::vector<AuthDbListener*>> mPendingPhoneRequests;
+	std::mutex mPendingPhoneRequestsMutex;
+	int mPhoneCacheExpire = 0;
+	int mPhoneCacheNegativeExpire = 0;
+	StatCounter64* mCountPhoneBatchRequests = nullptr;
+	StatCounter64* mCountCoalescedPhoneLookups = nullptr;
+	// Declared last, so that they flush the lookups they still hold while the pools are alive.
+	std::unique_ptr<Batcher<PasswordLookup>> mPasswordBatcher;
+	std::unique_ptr<Batcher<PhoneLookup>> mPhoneBatcher;
 
 	friend AuthDbBackend;
 };
@@ -18,6 +18,7 @@
 
 #include "callcontext-mediarelay.hh"
 #include <memory>
+#include <sstream>
 #include <string>
 #include "mediarelay.hh"
 #include "h264iframefilter.hh"
@@ -29,6 +30,7 @@ using namespace flexisip;
 RelayedCall::RelayedCall(const shared_ptr<MediaRelayServer> &server, sip_t *sip) :
 					CallContextBase(sip), mServer(server), mBandwidthThres(0) {
 	LOGD("New RelayedCall %p", this);
+	if (sip->sip_call_id) mCallId = sip->sip_call_id->i_id;
 	mDropTelephoneEvents=false;
 	mIsEstablished=false;
 	mHasSendRecvBack=false;
@@ -114,7 +116,7 @@ void RelayedCall::initChannels ( const std::shared_ptr< SdpModifier >& m, const
 				 * In that case, we provide him with a relay address that is the public address of the proxy,
 				 * but with the same address family as the address in the c= line of the SDP*/
 			}
-			s = mServer->createSession(tag, rt);
+			s = mServer->createSession(tag, rt, mCallId);
 			mSessions[i] = s;
 		}
 		shared_ptr<RelayChannel> chan = s->getChannel("",trid);
@@ -271,6 +273,11 @@ time_t RelayedCall::getLastActivity() {
 }
 
 void RelayedCall::terminate(){
+	if (mTerminationCallback) {
+		auto callback = std::move(mTerminationCallback);
+		mTerminationCallback = nullptr;
+		callback(*this);
+	}
 	int i;
 	for (i = 0; i < sMaxSessions; ++i) {
 		shared_ptr<RelaySession> s = mSessions[i];
@@ -281,6 +288,19 @@ void RelayedCall::terminate(){
 	}
 }
 
+string RelayedCall::getQualityReport() {
+	ostringstream report;
+	report << "Call-ID: " << mCallId << "\n";
+	for (int i = 0; i < sMaxSessions; ++i) {
+		shared_ptr<RelaySession> s = mSessions[i];
+		if (!s) continue;
+		auto stats = s->getQualityStatistics();
+		report << "Stream " << i << " caller: " << stats.front << "\n";
+		if (stats.hasBack) report << "Stream " << i << " callee: " << stats.back << "\n";
+	}
+	return report.str();
+}
+
 RelayedCall::~RelayedCall() {
 	LOGD("Destroy RelayedCall %p", this);
 	terminate();
@@ -311,11 +331,26 @@ static bool isLastProxy(Agent *ag, sip_t *sip){
 	return false;
 }
 
+/* Returns the filter of type T already applied to the channel and matching the predicate, so that its state is kept. */
+template <typename T, typename Predicate>
+static shared_ptr<MediaFilter> findFilter(const MediaFilterChain::FilterList &filters, Predicate predicate) {
+	for (const auto &filter : filters) {
+		auto typed = dynamic_pointer_cast<T>(filter);
+		if (typed && predicate(*typed)) return filter;
+	}
+	return nullptr;
+}
+
 void RelayedCall::configureRelayChannel(shared_ptr<RelayChannel> ms, sip_t *sip, sdp_session_t *session, int mline_nr){
 	sdp_media_t *mline;
 	int i;
 	for(i=0,mline=session->sdp_media;i<mline_nr;mline=mline->m_next,++i){
 	}
+	/* The filters are only replaced when the SDP defines some, so that an answer doesn't remove the ones enabled by
+	 * the offer. Filters defined again (re-INVITE) are kept with their state. */
+	const auto currentFilters = ms->getFilters();
+	MediaFilterChain::FilterList filters;
+	if (mline->m_rtpmaps) ms->getStatistics().setClockRate((int)mline->m_rtpmaps->rm_rate);
 	if (mBandwidthThres>0){
 		if (mline->m_type==sdp_media_video){
 			if (mline->m_rtpmaps && strcmp(mline->m_rtpmaps->rm_encoding,"H264")==0){
@@ -328,7 +363,9 @@ void RelayedCall::configureRelayChannel(shared_ptr<RelayChannel> ms, sip_t *sip,
 					}else enabled=true;
 					if (enabled) {
 						LOGI("Enabling H264 filtering for channel %p",ms.get());
-						ms->setFilter(make_shared<H264IFrameFilter>(mDecim));
+						auto filter =
+							findFilter<H264IFrameFilter>(*currentFilters, [](const H264IFrameFilter &) { return true; });
+						filters.push_back(filter ? filter : make_shared<H264IFrameFilter>(mDecim));
 					}
 				}
 			}
@@ -343,12 +380,17 @@ void RelayedCall::configureRelayChannel(shared_ptr<RelayChannel> ms, sip_t *sip,
 				for (rtpmap=mline->m_rtpmaps;rtpmap!=NULL;rtpmap=rtpmap->rm_next){
 					if (strcasecmp(rtpmap->rm_encoding,"telephone-event")==0){
 						LOGI("Enabling telephone-event filtering on payload type %i",rtpmap->rm_pt);
-						ms->setFilter(make_shared<TelephoneEventFilter>((int)rtpmap->rm_pt));
+						int pt = (int)rtpmap->rm_pt;
+						auto filter = findFilter<TelephoneEventFilter>(*currentFilters, [pt](const TelephoneEventFilter &f) {
+							return f.getPayloadType() == pt;
+						});
+						filters.push_back(filter ? filter : make_shared<TelephoneEventFilter>(pt));
 					}
 				}
 			}
 		}
 	}
 #endif
+	if (!filters.empty()) ms->setFilters(move(filters));
 }
 
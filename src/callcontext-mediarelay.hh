@@ -19,6 +19,7 @@
 #pragma once
 
 #include "callstore.hh"
+#include <functional>
 #include <memory>
 #include <string>
 #include "mediarelay.hh"
@@ -62,6 +63,11 @@ public:
 	bool checkMediaValid();
 	virtual time_t getLastActivity();
 	void terminate();
+	/* Set the function called once when the call terminates, whatever the reason (BYE, CANCEL, error response,
+	 * inactivity), before its relay sessions are released. */
+	void setTerminationCallback(std::function<void(RelayedCall &call)> &&callback) {
+		mTerminationCallback = std::move(callback);
+	}
 
 	virtual ~RelayedCall();
 
@@ -74,10 +80,28 @@ public:
 	const std::shared_ptr<MediaRelayServer> & getServer()const{
 		return mServer;
 	}
+	/* Text report of the quality statistics of every relayed stream of the call. */
+	std::string getQualityReport();
+	/* Parsed SDP of the offer, shared by the branches of a forked INVITE. */
+	SdpParseCache &getOfferSdpCache() {
+		return mOfferSdpCache;
+	}
+	/* Parsed SDP of the last answer, reused when several responses carry the same body (183 then 200 Ok). */
+	SdpParseCache &getAnswerSdpCache() {
+		return mAnswerSdpCache;
+	}
+	/* Release the parsed SDPs once the INVITE transaction is complete, as no more branch nor answer will use them. */
+	void clearSdpCaches() {
+		mOfferSdpCache.clear();
+		mAnswerSdpCache.clear();
+	}
 private:
 	void setupSpecificRelayTransport(RelayTransport *rt, const char *destHost);
 	std::shared_ptr<RelaySession> mSessions[sMaxSessions];
 	const std::shared_ptr<MediaRelayServer> & mServer;
+	std::string mCallId;
+	SdpParseCache mOfferSdpCache;
+	SdpParseCache mAnswerSdpCache;
 	int mBandwidthThres;
 	int mDecim;
 	int mEarlyMediaRelayCount;
@@ -86,6 +110,7 @@ private:
 	bool mHasSendRecvBack;
 	bool mIsEstablished;
 	bool mForcePublicAddressEnabled = false;
+	std::function<void(RelayedCall &call)> mTerminationCallback;
 };
 
 }
\ No newline at end of file
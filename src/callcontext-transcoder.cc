@@ -387,6 +387,17 @@ void TranscodedCall::unjoin() {
 	mTicker = NULL;
 }
 
+void TranscodedCall::moveTo(MSTicker *t) {
+	if (mTicker == NULL || mTicker == t)
+		return;
+	LOGD("Moving graphs from ticker %p to ticker %p", mTicker, t);
+	ms_ticker_detach(mTicker, mFrontSide->getRecvPoint().filter);
+	ms_ticker_detach(mTicker, mBackSide->getRecvPoint().filter);
+	ms_ticker_attach(t, mFrontSide->getRecvPoint().filter);
+	ms_ticker_attach(t, mBackSide->getRecvPoint().filter);
+	mTicker = t;
+}
+
 bool TranscodedCall::isJoined() const {
 	return mTicker != NULL;
 }
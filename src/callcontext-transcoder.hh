@@ -82,6 +82,11 @@ class TranscodedCall : public CallContextBase {
 	void prepare(const CallContextParams &params);
 	void join(MSTicker *ticker);
 	void unjoin();
+	/* Move the running graphs to another ticker. */
+	void moveTo(MSTicker *ticker);
+	MSTicker *getTicker() const {
+		return mTicker;
+	}
 	bool isJoined() const;
 	void redraw(CallSide *receiver);
 	void setInitialOffer(std::list<PayloadType *> &payloads);
@@ -27,9 +27,11 @@
 #include <poll.h>
 
 #include "cli.hh"
+#include "module-latency-stats.hh"
 #include "recordserializer.hh"
 #include <flexisip/common.hh>
 #include <flexisip/logmanager.hh>
+#include <flexisip/module.hh>
 #include <flexisip/registrardb.hh>
 
 #include "cJSON.h"
@@ -356,7 +358,12 @@ void *CommandLineInterface::threadfunc(void *arg) {
 }
 
 
-ProxyCommandLineInterface::ProxyCommandLineInterface(const std::shared_ptr<Agent> &agent) : CommandLineInterface("proxy"), mAgent(agent) {}
+ProxyCommandLineInterface::ProxyCommandLineInterface(const std::shared_ptr<Agent> &agent) : CommandLineInterface("proxy"), mAgent(agent) {
+	// Modules may provide their own commands.
+	for (const auto &module : mAgent->getModules()) {
+		if (auto handler = dynamic_pointer_cast<CliHandler>(module)) registerHandler(*handler);
+	}
+}
 
 void ProxyCommandLineInterface::handleRegistrarGet(unsigned int socket, const std::vector<std::string> &args) {
 	if (args.size() < 1) {
@@ -515,6 +522,27 @@ void ProxyCommandLineInterface::handleRegistrarDump(unsigned int socket, const s
 	cJSON_Delete(root);
 }
 
+/*
+ * The latency histograms are written by the main thread and read here through relaxed atomics.
+ */
+void ProxyCommandLineInterface::handleModuleLatency(unsigned int socket, const std::vector<std::string> &args) {
+	cJSON *root = cJSON_CreateObject();
+	for (const auto &module : mAgent->getModules()) {
+		const auto *stats = module->getLatencyStats();
+		if (stats == nullptr) {
+			cJSON_Delete(root);
+			answer(socket, "Error: Flexisip has been built without module latency statistics");
+			return;
+		}
+		if (!module->isEnabled() || (!args.empty() && module->getModuleName() != args[0])) continue;
+		cJSON_AddItemToObject(root, module->getModuleName().c_str(), stats->toJson());
+	}
+	char *jsonOutput = cJSON_Print(root);
+	answer(socket, jsonOutput);
+	free(jsonOutput);
+	cJSON_Delete(root);
+}
+
 void ProxyCommandLineInterface::parseAndAnswer(unsigned int socket, const std::string &command, const std::vector<std::string> &args) {
 	if (command == "REGISTRAR_CLEAR"){
 		handleRegistrarClear(socket, args);
@@ -524,6 +552,8 @@ void ProxyCommandLineInterface::parseAndAnswer(unsigned int socket, const std::s
 		handleRegistrarGet(socket, args);
 	}else if (command == "REGISTRAR_DUMP"){
 		handleRegistrarDump(socket, args);
+	}else if (command == "MODULE_LATENCY"){
+		handleModuleLatency(socket, args);
 	}else{
 		CommandLineInterface::parseAndAnswer(socket, command, args);
 	}
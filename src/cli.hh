@@ -95,6 +95,7 @@ private:
 	void handleRegistrarDelete(unsigned int socket, const std::vector<std::string> &args);
 	void handleRegistrarGet(unsigned int socket, const std::vector<std::string> &args);
 	void handleRegistrarDump(unsigned int socket, const std::vector<std::string> &args);
+	void handleModuleLatency(unsigned int socket, const std::vector<std::string> &args);
 	void parseAndAnswer(unsigned int socket, const std::string &command, const std::vector<std::string> &args) override;
 
 	std::shared_ptr<Agent> mAgent;
@@ -17,6 +17,7 @@
  */
 
 #include "conference-server.hh"
+#include "registrar-subscription-hub.hh"
 #include "registration-events/utils.hh"
 
 #include "registration-subscription.hh"
@@ -90,18 +91,15 @@ void OwnRegistrationSubscription::start(){
 	if (mParticipantAor.empty()) return;
 
 	mActive = true;
-	/*First organise the fetch of the contacts belonging to this AOR, so that we can notify immediately*/
-	RegistrarDb::get()->fetch(mParticipantAor, RegistrationSubscriptionFetchListener::shared_from_this(), true);
-
-	/*Secondly subscribe for changes in the registration info of this participant*/
-	RegistrarDb::get()->subscribe(mParticipantAor, RegistrationSubscriptionListener::shared_from_this());
+	/* Subscribe for changes in the registration info of this participant. The subscription is shared with the other
+	 * chatrooms and servers interested in this participant, and the current contacts are notified at once if known. */
+	RegistrarSubscriptionHub::get().subscribe(mParticipantAor, RegistrationSubscriptionListener::shared_from_this());
 }
 
 void OwnRegistrationSubscription::stop(){
 	if (!mActive) return;
 	mActive = false;
-	string key = Record::defineKeyFromUrl(mParticipantAor.get());
-	RegistrarDb::get()->unsubscribe(key, RegistrationSubscriptionListener::shared_from_this());
+	RegistrarSubscriptionHub::get().unsubscribe(mParticipantAor, RegistrationSubscriptionListener::shared_from_this());
 }
 
 shared_ptr<Address> OwnRegistrationSubscription::getPubGruu(const shared_ptr<Record> &r, const shared_ptr<ExtendedContact> &ec){
@@ -134,10 +132,6 @@ void OwnRegistrationSubscription::processRecord(const shared_ptr<Record> &r){
 	notify(compatibleParticipantDevices);
 }
 
-void OwnRegistrationSubscription::onRecordFound (const shared_ptr<Record> &r) {
-	processRecord(r);
-}
-
 void OwnRegistrationSubscription::onContactRegistered(const shared_ptr<Record> &r, const string &uid) {
 	if (!mActive) return;
 	processRecord(r);
@@ -65,11 +65,6 @@ class RegistrationSubscription : public virtual_enable_shared_from_this<Registra
 		int getMaskFromSpecs (const std::string &specs);
 };
 
-class RegistrationSubscriptionFetchListener : public virtual_enable_shared_from_this<RegistrationSubscriptionFetchListener>, public ContactUpdateListener{
-	public:
-		virtual ~RegistrationSubscriptionFetchListener() = default;
-};
-
 class RegistrationSubscriptionListener : public virtual_enable_shared_from_this<RegistrationSubscriptionListener>, public ContactRegisteredListener{
 	public:
 		virtual ~RegistrationSubscriptionListener() = default;
@@ -79,7 +74,7 @@ class RegistrationSubscriptionListener : public virtual_enable_shared_from_this<
  * Implementation of a registration subscription based on flexisip's RegistrarDb.
  */
 class OwnRegistrationSubscription
-	: public RegistrationSubscription, protected RegistrationSubscriptionFetchListener, protected RegistrationSubscriptionListener
+	: public RegistrationSubscription, protected RegistrationSubscriptionListener
 {
 	public:
 		OwnRegistrationSubscription(
@@ -93,12 +88,7 @@ class OwnRegistrationSubscription
 	private:
 		std::shared_ptr<linphone::Address> getPubGruu(const std::shared_ptr<Record> &r, const std::shared_ptr<ExtendedContact> &ec);
 		void processRecord(const std::shared_ptr<Record> &r);
-		/*ContactUpdateListener virtual functions to override*/
-		virtual void onRecordFound (const std::shared_ptr<Record> &r) override;
-		virtual void onError () override {};
-		virtual void onInvalid () override {};
-		virtual void onContactUpdated (const std::shared_ptr<ExtendedContact> &ec) override {}
-		/*ContactRegisteredListener overrides*/
+		/*ContactRegisteredListener overrides, also called with an empty uid for the current record*/
 		virtual void onContactRegistered(const std::shared_ptr<Record> &r, const std::string &uid) override;
 
 		SipUri mParticipantAor;
@@ -846,6 +846,12 @@ GenericManager::GenericManager()
 			"Possible values are 'proxy', 'presence', 'conference', 'regevent' separated by whitespaces.", "proxy" },
 		{Boolean, "auto-respawn", "Automatically respawn flexisip in case of abnormal termination (crashes). This has an effect if "
 			"Flexisip has been launched with '--daemon' option only", "true"},
+		{Integer, "module-latency-dump-interval", "Interval, in seconds, between two dumps in the logs of the latency "
+			"statistics of each module: time spent processing requests per SIP method and responses, and time "
+			"spent by events waiting for an asynchronous operation. The statistics are also available through the "
+			"MODULE_LATENCY command of the CLI and the 'count-*-latency-*' counters of each module. "
+			"0 disables the periodic dump. This requires Flexisip to be built with ENABLE_MODULE_LATENCY_STATS, "
+			"which is off by default.", "0"},
 		{String, "plugins-dir", "Path to the directory where plugins can be found.", DEFAULT_PLUGINS_DIR},
 		{StringList, "plugins", "Plugins to load. Look at <prefix>/lib/flexisip/plugins to know the list of installed plugin. The name of a plugin can "
 			"be derivated from the according library name by striping out the extension part and the leading 'lib' prefix.\n"
@@ -1016,6 +1022,25 @@ GenericManager::GenericManager()
 		{Integer, "mdns-ttl", "Time To Live of any mDNS query that will ask for this Flexisip instance", "3600"},
 		config_item_end};
 
+	static ConfigItemDescriptor overload_control_conf[] = {
+		{Boolean, "enabled", "Enable the overload control. When the proxy is overloaded, part of the new out-of-dialog "
+			"requests are rejected with a '503 Service Unavailable' and a Retry-After header before entering the module "
+			"chain. The percentage of rejected requests grows with the load. In-dialog requests, ACK and CANCEL are "
+			"never rejected, and REGISTER refreshes are only rejected when more than half of the new requests are. "
+			"Clients supporting RFC 7339 are also told the percentage of requests to drop in the Via header of the "
+			"503 response.", "false"},
+		{Integer, "max-main-loop-lag", "Lag, in milliseconds, of the main loop above which the proxy is considered "
+			"overloaded. The lag is measured with a timer firing every 100ms. 0 disables this criterion.", "200"},
+		{Integer, "max-suspended-events", "Number of SIP events waiting for an asynchronous operation (registrar "
+			"database, authentication backend...) above which the proxy is considered overloaded. 0 disables this "
+			"criterion.", "5000"},
+		{Integer, "max-backend-requests", "Number of pending requests to the backends (Redis registrar database, "
+			"SQL authentication backend) above which the proxy is considered overloaded. 0 disables this criterion.",
+			"2000"},
+		{Integer, "retry-after", "Value, in seconds, of the Retry-After header of the 503 responses. It is also used as "
+			"the validity of the overload control information given to RFC 7339 clients.", "5"},
+		config_item_end};
+
 	auto uNotifObjs = make_unique<GenericStruct>("notif", "Templates for notifications.", 1);
 	uNotifObjs->setExportable(false);
 	auto notifObjs = mConfigRoot.addChild(move(uNotifObjs));
@@ -1064,6 +1089,16 @@ GenericManager::GenericManager()
 	auto mdns = mConfigRoot.addChild(move(uMdns));
 	mdns->addChildrenValues(mdns_conf);
 	mdns->setReadOnly(true);
+
+	auto uOverloadControl = make_unique<GenericStruct>(
+	    "overload-control",
+	    "Admission control of the new requests according to the load of the proxy: lag of the main loop, number of "
+	    "suspended SIP events and of pending requests to the backends. The current values are available through the "
+	    "statistics of this section.",
+	    6); // Holds statistics: its oid must not collide with the ones of the modules (see ModuleInfoBase::ModuleOid).
+	auto overloadControl = mConfigRoot.addChild(move(uOverloadControl));
+	overloadControl->addChildrenValues(overload_control_conf);
+	overloadControl->setReadOnly(true);
 }
 
 bool GenericManager::doIsValidNextConfig(const ConfigValue &cv) {
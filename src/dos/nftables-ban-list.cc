@@ -0,0 +1,97 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+#include "nftables-ban-list.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+
+static const string sIpv4Set = "banned-ipv4";
+static const string sIpv6Set = "banned-ipv6";
+
+NftablesBanList::NftablesBanList(const string& table) : mTable(table) {
+}
+
+bool NftablesBanList::isValidTableName(const string& table) {
+	return !table.empty() && all_of(table.cbegin(), table.cend(), [](unsigned char c) {
+		return isalnum(c) || c == '_' || c == '-';
+	});
+}
+
+string NftablesBanList::getSetupCommands() const {
+	const auto table = "inet " + mTable;
+	ostringstream cmds;
+	// Adding the table first, so that deleting it cannot fail.
+	cmds << "add table " << table << "; delete table " << table << "; add table " << table << "; ";
+	cmds << "add set " << table << " " << sIpv4Set
+	     << " { type ipv4_addr . inet_proto . inet_service; flags timeout; }; ";
+	cmds << "add set " << table << " " << sIpv6Set
+	     << " { type ipv6_addr . inet_proto . inet_service; flags timeout; }; ";
+	// Priority lower than the one of the usual filter chains, so that banned packets are rejected first.
+	cmds << "add chain " << table << " input { type filter hook input priority -10; policy accept; }; ";
+	cmds << "add rule " << table << " input ip saddr . meta l4proto . th sport @" << sIpv4Set << " reject; ";
+	cmds << "add rule " << table << " input ip6 saddr . meta l4proto . th sport @" << sIpv6Set << " reject";
+	return cmds.str();
+}
+
+string NftablesBanList::getCleanupCommands() const {
+	return "delete table inet " + mTable;
+}
+
+void NftablesBanList::add(const string& ip, const string& port, const string& protocol, seconds duration) {
+	static const string ipv4MappedPrefix = "::ffff:";
+	const bool ipv4Mapped = ip.compare(0, ipv4MappedPrefix.size(), ipv4MappedPrefix) == 0 &&
+	                        ip.find('.') != string::npos;
+	const bool ipv6 = !ipv4Mapped && ip.find(':') != string::npos;
+	Ban ban{(ipv4Mapped ? ip.substr(ipv4MappedPrefix.size()) : ip) + " . " + protocol + " . " + port, duration};
+
+	lock_guard<mutex> lock(mMutex);
+	(ipv6 ? mPendingIpv6Bans : mPendingIpv4Bans).push_back(move(ban));
+}
+
+string NftablesBanList::takePendingCommands() {
+	vector<Ban> ipv4Bans, ipv6Bans;
+	{
+		lock_guard<mutex> lock(mMutex);
+		ipv4Bans.swap(mPendingIpv4Bans);
+		ipv6Bans.swap(mPendingIpv6Bans);
+	}
+
+	ostringstream cmds;
+	auto addElements = [&](const string& set, const vector<Ban>& bans) {
+		if (bans.empty()) return;
+		if (cmds.tellp() > 0) cmds << "; ";
+		cmds << "add element inet " << mTable << " " << set << " { ";
+		for (auto it = bans.cbegin(); it != bans.cend(); ++it) {
+			if (it != bans.cbegin()) cmds << ", ";
+			cmds << it->element << " timeout " << it->duration.count() << "s";
+		}
+		cmds << " }";
+	};
+	addElements(sIpv4Set, ipv4Bans);
+	addElements(sIpv6Set, ipv6Bans);
+	return cmds.str();
+}
+
+} // namespace flexisip
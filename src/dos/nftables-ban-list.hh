@@ -0,0 +1,78 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace flexisip {
+
+/**
+ * Banned addresses stored in nftables.
+ * Flexisip owns an nftables table of the inet family, with one set per IP family. The elements of the sets are
+ * 'address . protocol . port' tuples carrying their own timeout, so that the kernel removes them when the ban expires.
+ * Whatever the number of banned addresses, the table only contains two rules, and the lookups are done by the kernel
+ * in constant time.
+ * Bans are queued by add(), from the main thread, then flushed as a single nft transaction by the thread running the
+ * commands returned by takePendingCommands().
+ */
+class NftablesBanList {
+public:
+	explicit NftablesBanList(const std::string& table);
+
+	/**
+	 * The table name is passed to nft through a shell: only letters, digits, '_' and '-' are accepted.
+	 */
+	static bool isValidTableName(const std::string& table);
+
+	/**
+	 * nft commands (re)creating the table, the sets and the rules rejecting the packets of the banned addresses.
+	 * Any table left by a previous run is removed.
+	 */
+	std::string getSetupCommands() const;
+	/**
+	 * nft commands removing the table.
+	 */
+	std::string getCleanupCommands() const;
+
+	/**
+	 * Queue the ban of the given address. IPv4-mapped IPv6 addresses are banned as IPv4 addresses.
+	 */
+	void add(const std::string& ip, const std::string& port, const std::string& protocol,
+	         std::chrono::seconds duration);
+	/**
+	 * nft commands adding all the queued bans to the sets, or an empty string if no ban is queued.
+	 */
+	std::string takePendingCommands();
+
+private:
+	struct Ban {
+		std::string element;
+		std::chrono::seconds duration;
+	};
+
+	std::string mTable;
+	std::mutex mMutex{};
+	std::vector<Ban> mPendingIpv4Bans{};
+	std::vector<Ban> mPendingIpv6Bans{};
+};
+
+} // namespace flexisip
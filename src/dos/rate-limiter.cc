@@ -0,0 +1,147 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "rate-limiter.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+
+RateLimiter::Key::Key(const sockaddr* addr) {
+	if (addr->sa_family == AF_INET) {
+		const auto* in = reinterpret_cast<const sockaddr_in*>(addr);
+		ip[10] = ip[11] = 0xff;
+		memcpy(&ip[12], &in->sin_addr, 4);
+		port = ntohs(in->sin_port);
+	} else if (addr->sa_family == AF_INET6) {
+		const auto* in6 = reinterpret_cast<const sockaddr_in6*>(addr);
+		memcpy(ip.data(), &in6->sin6_addr, ip.size());
+		port = ntohs(in6->sin6_port);
+	}
+}
+
+RateLimiter::RateLimiter(double rate, double burst, size_t maxEntries)
+    : mMaxEntries(max<size_t>(maxEntries, 1)), mTokensPerMs(rate / 1000.0), mBurst(float(max(burst, 1.0))),
+      mEpoch(steady_clock::now()) {
+	// Keep the load factor under 50% so that the probe sequences remain short.
+	size_t capacity = 16;
+	while (capacity < 2 * mMaxEntries) capacity *= 2;
+	mSlots.resize(capacity);
+	mMask = capacity - 1;
+	random_device rd{};
+	mSeed = (uint64_t(rd()) << 32) | rd();
+}
+
+size_t RateLimiter::getHomeIndex(const Key& key) const {
+	uint64_t high, low;
+	memcpy(&high, key.ip.data(), sizeof(high));
+	memcpy(&low, key.ip.data() + sizeof(high), sizeof(low));
+	uint64_t h = (mSeed ^ high) * 0x9e3779b97f4a7c15ULL;
+	h = (h ^ (h >> 32) ^ low) * 0xff51afd7ed558ccdULL;
+	h = (h ^ (h >> 29) ^ key.port) * 0xc4ceb9fe1a85ec53ULL;
+	return size_t(h ^ (h >> 32)) & mMask;
+}
+
+size_t RateLimiter::find(const Key& key) const {
+	auto index = getHomeIndex(key);
+	while (mSlots[index].used && !(mSlots[index].key == key)) index = (index + 1) & mMask;
+	return index;
+}
+
+uint32_t RateLimiter::toMs(steady_clock::time_point time) const {
+	return uint32_t(duration_cast<milliseconds>(time - mEpoch).count());
+}
+
+void RateLimiter::refill(Slot& slot, uint32_t nowMs) const {
+	// Unsigned arithmetic, so that the wrapping of the timestamps is harmless.
+	const uint32_t elapsedMs = nowMs - slot.lastUpdateMs;
+	slot.tokens = float(min<double>(mBurst, slot.tokens + elapsedMs * mTokensPerMs));
+	slot.lastUpdateMs = nowMs;
+}
+
+bool RateLimiter::consume(const Key& key, steady_clock::time_point now) {
+	const auto nowMs = toMs(now);
+	auto& slot = mSlots[find(key)];
+	if (!slot.used) {
+		if (mSize >= mMaxEntries) {
+			++mOverflowCount;
+			return true;
+		}
+		slot.key = key;
+		slot.used = true;
+		slot.tokens = mBurst - 1.0f;
+		slot.lastUpdateMs = nowMs;
+		++mSize;
+		return true;
+	}
+	refill(slot, nowMs);
+	if (slot.tokens < 1.0f) return false;
+	slot.tokens -= 1.0f;
+	return true;
+}
+
+void RateLimiter::reset(const Key& key) {
+	auto index = find(key);
+	if (mSlots[index].used) erase(index);
+}
+
+size_t RateLimiter::expire(steady_clock::time_point now, size_t maxVisitedSlots) {
+	const auto nowMs = toMs(now);
+	size_t removed = 0;
+	for (size_t visited = 0; visited < maxVisitedSlots && mSize > 0; ++visited) {
+		auto& slot = mSlots[mExpiryCursor];
+		if (slot.used) {
+			refill(slot, nowMs);
+			if (slot.tokens >= mBurst) {
+				// Another bucket may be shifted into this slot: visit it again.
+				erase(mExpiryCursor);
+				++removed;
+				continue;
+			}
+		}
+		mExpiryCursor = (mExpiryCursor + 1) & mMask;
+	}
+	return removed;
+}
+
+void RateLimiter::erase(size_t index) {
+	// Backward shift deletion: move back the following entries of the cluster which would not be reachable anymore
+	// from their home slot once this slot is empty.
+	auto hole = index;
+	for (auto next = (hole + 1) & mMask; mSlots[next].used; next = (next + 1) & mMask) {
+		const auto home = getHomeIndex(mSlots[next].key);
+		// The entry can fill the hole if its home is not cyclically in ]hole, next].
+		const bool homeInRange = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+		if (!homeInRange) {
+			mSlots[hole] = mSlots[next];
+			hole = next;
+		}
+	}
+	mSlots[hole].used = false;
+	--mSize;
+}
+
+} // namespace flexisip
@@ -0,0 +1,124 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <sys/socket.h>
+
+namespace flexisip {
+
+/**
+ * Token bucket rate limiter of the packets received from each remote address.
+ * Each address owns a bucket of 'burst' tokens, refilled at 'rate' tokens per second. A packet takes a token, and is
+ * over the limit when the bucket is empty.
+ * Buckets are stored in a fixed-size open addressing table (linear probing, backward shift deletion), so that the
+ * memory used is bounded and no allocation happens while processing packets. A bucket which has been refilled
+ * completely carries no information anymore: such buckets are removed by expire(), which only visits a bounded
+ * number of slots at each call.
+ * This class is not thread-safe.
+ */
+class RateLimiter {
+public:
+	/**
+	 * Binary remote address: IPv6 address (IPv4 addresses are stored as IPv4-mapped IPv6 addresses) and port.
+	 */
+	struct Key {
+		Key() = default;
+		explicit Key(const sockaddr* addr);
+
+		bool operator==(const Key& other) const {
+			return port == other.port && ip == other.ip;
+		}
+
+		std::array<uint8_t, 16> ip{};
+		uint16_t port = 0;
+	};
+
+	/**
+	 * @param rate number of packets per second allowed for each address.
+	 * @param burst maximum number of packets accepted at once from an address, that is the size of the buckets.
+	 * @param maxEntries maximum number of addresses tracked at the same time.
+	 */
+	RateLimiter(double rate, double burst, size_t maxEntries);
+
+	/**
+	 * Take a token from the bucket of the given address.
+	 * @return false if the address exceeds the rate limit. Packets from new addresses are always accepted, without
+	 * being tracked, when the table is full.
+	 */
+	bool consume(const Key& key, std::chrono::steady_clock::time_point now);
+	/**
+	 * Refill the bucket of the given address, typically once the address has been banned.
+	 */
+	void reset(const Key& key);
+	/**
+	 * Remove the buckets which have been refilled completely, visiting at most maxVisitedSlots slots from where the
+	 * previous call stopped.
+	 * @return the number of removed buckets.
+	 */
+	size_t expire(std::chrono::steady_clock::time_point now, size_t maxVisitedSlots);
+
+	size_t size() const {
+		return mSize;
+	}
+	size_t getCapacity() const {
+		return mSlots.size();
+	}
+	size_t getMaxEntries() const {
+		return mMaxEntries;
+	}
+	/**
+	 * Number of packets accepted without being tracked because the table was full.
+	 */
+	uint64_t getOverflowCount() const {
+		return mOverflowCount;
+	}
+
+private:
+	struct Slot {
+		Key key{};
+		bool used = false;
+		float tokens = 0.0f;
+		uint32_t lastUpdateMs = 0; // Relative to mEpoch, wraps after 49 days.
+	};
+
+	size_t getHomeIndex(const Key& key) const;
+	// Index of the slot holding the key, or of the empty slot where it should be inserted.
+	size_t find(const Key& key) const;
+	uint32_t toMs(std::chrono::steady_clock::time_point time) const;
+	void refill(Slot& slot, uint32_t nowMs) const;
+	void erase(size_t index);
+
+	std::vector<Slot> mSlots;
+	size_t mMask;
+	size_t mSize = 0;
+	size_t mMaxEntries;
+	size_t mExpiryCursor = 0;
+	uint64_t mOverflowCount = 0;
+	uint64_t mSeed; // Hash seed, so that the probe sequences cannot be predicted from outside.
+	double mTokensPerMs;
+	float mBurst;
+	std::chrono::steady_clock::time_point mEpoch;
+};
+
+} // namespace flexisip
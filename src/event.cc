@@ -25,11 +25,14 @@
 #include "flexisip/transaction.hh"
 
 #include "flexisip/event.hh"
+#include "module-latency-stats.hh"
 
 using namespace std;
 
 namespace flexisip {
 
+atomic_uint SipEvent::sSuspendedCount{0};
+
 SipEvent::SipEvent(const shared_ptr<IncomingAgent>& inAgent, const shared_ptr<MsgSip>& msgSip)
     : mCurrModule{}, mMsgSip(msgSip), mState(STARTED) {
 	LOGD("New SipEvent %p - msg %p", this, msgSip->getMsg());
@@ -60,13 +63,26 @@ SipEvent::SipEvent(const shared_ptr<OutgoingAgent>& outAgent, const shared_ptr<M
 SipEvent::SipEvent(const SipEvent& sipEvent)
     : enable_shared_from_this<SipEvent>(), mCurrModule(sipEvent.mCurrModule), mIncomingAgent(sipEvent.mIncomingAgent),
       mOutgoingAgent(sipEvent.mOutgoingAgent), mAgent(sipEvent.mAgent), mState(sipEvent.mState) {
+	if (mState == SUSPENDED) sSuspendedCount.fetch_add(1, memory_order_relaxed);
 	LOGD("New SipEvent %p with state %s", this, stateStr(mState).c_str());
-	// make a copy of the msgsip when the SipEvent is copy-constructed
-	mMsgSip = make_shared<MsgSip>(*sipEvent.mMsgSip);
+	// Make a copy of the msgsip when the SipEvent is copy-constructed. This happens for each fork branch, so that the
+	// copy shares the strings and the body of the original message instead of duplicating them.
+	mMsgSip = MsgSip::makeShallowCopy(*sipEvent.mMsgSip);
 }
 
 SipEvent::~SipEvent() {
 	LOGD("Destroy SipEvent %p", this);
+	if (mState == SUSPENDED) {
+		// Dropped by the module which suspended it.
+		recordSuspension();
+		sSuspendedCount.fetch_sub(1, memory_order_relaxed);
+	}
+}
+
+void SipEvent::setState(State state) {
+	if (mState == SUSPENDED) sSuspendedCount.fetch_sub(1, memory_order_relaxed);
+	if (state == SUSPENDED) sSuspendedCount.fetch_add(1, memory_order_relaxed);
+	mState = state;
 }
 
 void SipEvent::flushLog() {
@@ -86,7 +102,8 @@ void SipEvent::setEventLog(const std::shared_ptr<EventLog>& log) {
 void SipEvent::terminateProcessing() {
 	LOGD("Terminate SipEvent %p", this);
 	if (mState == STARTED || mState == SUSPENDED) {
-		mState = TERMINATED;
+		if (mState == SUSPENDED) recordSuspension();
+		setState(TERMINATED);
 		flushLog();
 		mIncomingAgent.reset();
 		mOutgoingAgent.reset();
@@ -97,10 +114,20 @@ void SipEvent::terminateProcessing() {
 	}
 }
 
+void SipEvent::recordSuspension() {
+#ifdef MODULE_LATENCY_STATS
+	if (mSuspendedAt == chrono::steady_clock::time_point{}) return;
+	if (auto module = mCurrModule.lock()) {
+		module->getLatencyStats()->recordSuspension(chrono::steady_clock::now() - mSuspendedAt);
+	}
+	mSuspendedAt = {};
+#endif
+}
+
 void SipEvent::suspendProcessing() {
 	LOGD("Suspend SipEvent %p", this);
 	if (mState == STARTED) {
-		mState = SUSPENDED;
+		setState(SUSPENDED);
 	} else {
 		LOGA("Can't suspendProcessing: wrong state %s", stateStr(mState).c_str());
 	}
@@ -109,7 +136,7 @@ void SipEvent::suspendProcessing() {
 void SipEvent::restartProcessing() {
 	LOGD("Restart SipEvent %p", this);
 	if (mState == SUSPENDED) {
-		mState = STARTED;
+		setState(STARTED);
 	} else {
 		LOGA("Can't restartProcessing: wrong state %s", stateStr(mState).c_str());
 	}
@@ -142,7 +169,7 @@ std::shared_ptr<RequestSipEvent> RequestSipEvent::makeRestored(std::shared_ptr<I
                                                                const std::weak_ptr<Module>& currModule) {
 	auto shared = make_shared<RequestSipEvent>(incomingAgent, msgSip);
 	shared->mCurrModule = currModule;
-	shared->mState = SUSPENDED;
+	shared->setState(SUSPENDED);
 
 	return shared;
 }
@@ -143,6 +143,10 @@ CallQualityStatisticsLog::CallQualityStatisticsLog(const sip_t* sip)
     : EventLog(sip), mReport{sip->sip_payload && sip->sip_payload->pl_data ? sip->sip_payload->pl_data : nullptr} {
 }
 
+CallQualityStatisticsLog::CallQualityStatisticsLog(const sip_t* sip, const std::string& report)
+    : EventLog(sip), mReport{report} {
+}
+
 void CallQualityStatisticsLog::write(EventLogWriter& writer) const {
 	writer.writeCallQualityStatisticsLog(*this);
 }
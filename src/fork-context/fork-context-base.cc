@@ -36,7 +36,7 @@ ForkContextBase::ForkContextBase(Agent* agent,
                                  const weak_ptr<StatPair>& counter,
                                  bool isRestored)
     : mListener(listener), mStatCounter(counter), mCurrentPriority(-1), mAgent(agent),
-      mEvent(make_shared<RequestSipEvent>(event)), // Is this deep copy really necessary ?
+      mEvent(make_shared<RequestSipEvent>(event)), // Shares the strings and body of the original message.
       mCfg(cfg), mLateTimer(agent->getRoot()), mFinishTimer(agent->getRoot()), mNextBranchesTimer(agent->getRoot()) {
 	if (auto sharedCounter = mStatCounter.lock()) {
 		sharedCounter->incrStart();
@@ -16,7 +16,7 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include "utils/thread/auto-thread-pool.hh"
+#include "utils/thread/work-stealing-thread-pool.hh"
 
 #include "flexisip/fork-context/fork-message-context-db-proxy.hh"
 
@@ -98,8 +98,13 @@ ForkMessageContextDbProxy::~ForkMessageContextDbProxy() {
 	if (!mForkUuidInDb.empty() && mIsFinished) {
 		// Destructor is called because the ForkContext is finished, removing info from database
 		LOGD("ForkMessageContextDbProxy[%p] was present in DB, cleaning UUID[%s]", this, mForkUuidInDb.c_str());
-		AutoThreadPool::getGlobalThreadPool()->run(
-		    [uuid = mForkUuidInDb]() { ForkMessageContextSociRepository::getInstance()->deleteByUuid(uuid); });
+		// Nobody waits for the removal, let the other database accesses go first.
+		auto queued = WorkStealingThreadPool::getGlobalThreadPool()->run(
+		    [uuid = mForkUuidInDb]() { ForkMessageContextSociRepository::getInstance()->deleteByUuid(uuid); },
+		    WorkStealingThreadPool::Priority::Low);
+		if (!queued) {
+			SLOGE << errorLogPrefix() << "Thread pool is full, UUID[" << mForkUuidInDb << "] is kept in DB.";
+		}
 	}
 }
 
@@ -143,7 +148,7 @@ void ForkMessageContextDbProxy::onForkContextFinished(const shared_ptr<ForkConte
 
 void ForkMessageContextDbProxy::runSavingThread() {
 	const auto& dbFork = mForkMessage->getDbObject();
-	AutoThreadPool::getGlobalThreadPool()->run(
+	auto queued = WorkStealingThreadPool::getGlobalThreadPool()->run(
 	    [thiz = shared_from_this(), dbFork, dbForkVersion = mCurrentVersion.load()]() {
 		    lock_guard<mutex> lock(thiz->mDbAccessMutex);
 		    if (dbForkVersion == thiz->mCurrentVersion && thiz->mLastSavedVersion < dbForkVersion &&
@@ -157,6 +162,9 @@ void ForkMessageContextDbProxy::runSavingThread() {
 			        });
 		    }
 	    });
+	if (!queued) {
+		SLOGE << errorLogPrefix() << "Thread pool is full, ForkMessage will remain in memory.";
+	}
 }
 
 void ForkMessageContextDbProxy::onResponse(const shared_ptr<BranchInfo>& br,
@@ -185,7 +193,9 @@ ForkMessageContextDbProxy::onNewRegister(const SipUri& dest, const string& uid,
 
 	// If the ForkMessage is only in database create a thread to access database and then recursively call this method.
 	if (getState() == State::IN_DATABASE) {
-		AutoThreadPool::getGlobalThreadPool()->run([thiz = shared_from_this(), dest, uid, dispatchFunc]() {
+		// A device is waiting for the message: the restoration goes before the other database accesses.
+		auto& threadPool = WorkStealingThreadPool::getGlobalThreadPool();
+		auto queued = threadPool->run([thiz = shared_from_this(), dest, uid, dispatchFunc]() {
 			lock_guard<mutex> lock(thiz->mDbAccessMutex);
 			if (thiz->getState() == State::IN_DATABASE && !thiz->mDbFork) {
 				try {
@@ -201,7 +211,11 @@ ForkMessageContextDbProxy::onNewRegister(const SipUri& dest, const string& uid,
 					    shared->onNewRegister(dest, uid, dispatchFunc);
 				    }
 			    });
-		});
+		}, WorkStealingThreadPool::Priority::High);
+		if (!queued) {
+			SLOGE << errorLogPrefix() << "Thread pool is full, ForkMessage not retrieved from DB for device [" << uid
+			      << "].";
+		}
 
 		// Always return a fake empty branch here in case you were called by delayedOnNewRegister.
 		return BranchInfo::make();
@@ -18,6 +18,7 @@
 
 #include <stdint.h>
 #include <bctoolbox/defs.h>
+#include <flexisip/logmanager.hh>
 #include "h264iframefilter.hh"
 
 #define TYPE_IDR 5
@@ -35,14 +36,15 @@ using namespace flexisip;
 H264IFrameFilter::H264IFrameFilter(int skipcount) : mSkipCount(skipcount), mLastIframeTimestamp(0), mIframeCount(0) {
 }
 
-bool H264IFrameFilter::onOutgoingTransfer(uint8_t *data, size_t size, const sockaddr *addr, socklen_t addrlen) {
+bool H264IFrameFilter::onOutgoingTransfer(const RtpHeaderInfo &header, uint8_t *data, size_t size,
+										  const sockaddr *addr, socklen_t addrlen) {
 	const uint8_t *p = data;
 	bool ret = false;
 	bool isIFrame = false;
-	if (size < 16)
+	if (!header.valid || size < header.payloadOffset + 4)
 		return true; // not a RTP h264 packet probably
-	uint32_t ts = ntohl(((uint32_t *)p)[1]);
-	p += 12;
+	uint32_t ts = header.timestamp;
+	p += header.payloadOffset;
 	uint8_t ptype = nal_header_get_type(p);
 	switch (ptype) {
 		case TYPE_IDR:
@@ -87,6 +89,7 @@ bool H264IFrameFilter::onOutgoingTransfer(uint8_t *data, size_t size, const sock
 	return ret;
 }
 
-bool H264IFrameFilter::onIncomingTransfer(uint8_t *data, size_t size, const sockaddr *addr, socklen_t addrlen) {
+bool H264IFrameFilter::onIncomingTransfer(const RtpHeaderInfo &header, uint8_t *data, size_t size,
+										  const sockaddr *addr, socklen_t addrlen) {
 	return true;
 }
@@ -18,7 +18,7 @@
 
 #pragma once
 
-#include "mediarelay.hh"
+#include "media-filter.hh"
 
 namespace flexisip {
 
@@ -26,9 +26,11 @@ class H264IFrameFilter : public MediaFilter {
   public:
 	H264IFrameFilter(int skipcount);
 	/// Should return false if the incoming packet must not be transfered.
-	bool onIncomingTransfer(uint8_t *data, size_t size, const sockaddr *addr, socklen_t addrlen);
+	bool onIncomingTransfer(const RtpHeaderInfo &header, uint8_t *data, size_t size, const sockaddr *addr,
+							socklen_t addrlen) override;
 	/// Should return false if the packet output must not be sent.
-	bool onOutgoingTransfer(uint8_t *data, size_t size, const sockaddr *addr, socklen_t addrlen);
+	bool onOutgoingTransfer(const RtpHeaderInfo &header, uint8_t *data, size_t size, const sockaddr *addr,
+							socklen_t addrlen) override;
 
   private:
 	int mSkipCount;
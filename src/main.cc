@@ -85,6 +85,7 @@
 #include "b2bua/b2bua-server.hh"
 #endif // ENABLE_B2BUA
 #ifdef ENABLE_PRESENCE
+#include "presence/list-subscription/resource-list-cache.hh"
 #include "presence/presence-longterm.hh"
 #include "presence/presence-server.hh"
 #endif
@@ -1000,6 +1001,9 @@ int main(int argc, char* argv[]) {
 		}
 
 		presence_cli = unique_ptr<CommandLineInterface>(new CommandLineInterface("presence"));
+		if (const auto& resourceListCache = presenceServer->getResourceListCache()) {
+			presence_cli->registerHandler(*resourceListCache);
+		}
 		presence_cli->start();
 #endif
 	}
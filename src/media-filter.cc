@@ -0,0 +1,108 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+
+#include <arpa/inet.h>
+
+#include "media-filter.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+namespace {
+
+/*
+ * Branch-free extraction of the fixed header fields. The first 12 bytes are loaded as three 32 bits words,
+ * so that the compiler can keep everything in registers.
+ * 'valid' is computed as a mask and applied at the end instead of returning early.
+ */
+inline void parseFixedHeader(const uint8_t* data, size_t size, RtpHeaderInfo& h) {
+	uint32_t words[3] = {0, 0, 0};
+	const bool longEnough = size >= RtpHeaderInfo::sMinSize;
+	memcpy(words, data, longEnough ? sizeof(words) : 0);
+	const uint32_t w0 = ntohl(words[0]);
+
+	h.valid = longEnough && (w0 >> 30) == 2;
+	h.marker = (w0 >> 23) & 0x1;
+	h.payloadType = (w0 >> 16) & 0x7f;
+	h.seqNumber = w0 & 0xffff;
+	h.timestamp = ntohl(words[1]);
+	h.ssrc = ntohl(words[2]);
+	// Fixed header + CSRC list.
+	h.payloadOffset = RtpHeaderInfo::sMinSize + ((w0 >> 24) & 0xf) * 4;
+}
+
+/* The header extension is rare, it is handled out of the fixed header parsing. */
+inline void skipHeaderExtension(const uint8_t* data, size_t size, RtpHeaderInfo& h) {
+	if (!h.valid || (data[0] & 0x10) == 0) return;
+	if (size < h.payloadOffset + 4) {
+		h.valid = false;
+		return;
+	}
+	uint16_t extLength;
+	memcpy(&extLength, data + h.payloadOffset + 2, sizeof(extLength));
+	h.payloadOffset += 4 + ntohs(extLength) * 4;
+}
+
+} // namespace
+
+RtpHeaderInfo RtpHeaderInfo::parse(const uint8_t* data, size_t size) {
+	RtpHeaderInfo h;
+	parseFixedHeader(data, size, h);
+	skipHeaderExtension(data, size, h);
+	if (h.valid && size < h.payloadOffset) h.valid = false;
+	return h;
+}
+
+void MediaFilterChain::add(const shared_ptr<MediaFilter>& filter) {
+	auto filters = make_shared<FilterList>(*getFilters());
+	filters->push_back(filter);
+	atomic_store(&mFilters, shared_ptr<const FilterList>{move(filters)});
+}
+
+void MediaFilterChain::set(FilterList filters) {
+	atomic_store(&mFilters, shared_ptr<const FilterList>{make_shared<FilterList>(move(filters))});
+}
+
+void MediaFilterChain::clear() {
+	atomic_store(&mFilters, make_shared<const FilterList>());
+}
+
+bool MediaFilterChain::onIncomingTransfer(uint8_t* data, size_t size, const sockaddr* addr, socklen_t addrlen) {
+	const auto filters = getFilters();
+	if (filters->empty()) return true;
+	const auto header = RtpHeaderInfo::parse(data, size);
+	for (const auto& filter : *filters) {
+		if (!filter->onIncomingTransfer(header, data, size, addr, addrlen)) return false;
+	}
+	return true;
+}
+
+bool MediaFilterChain::onOutgoingTransfer(uint8_t* data, size_t size, const sockaddr* addr, socklen_t addrlen) {
+	const auto filters = getFilters();
+	if (filters->empty()) return true;
+	const auto header = RtpHeaderInfo::parse(data, size);
+	for (const auto& filter : *filters) {
+		if (!filter->onOutgoingTransfer(header, data, size, addr, addrlen)) return false;
+	}
+	return true;
+}
+
+} // namespace flexisip
@@ -0,0 +1,102 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <sys/socket.h>
+
+namespace flexisip {
+
+/**
+ * Fixed part of a RTP header (RFC 3550), parsed once per packet and shared
+ * by all the filters of a MediaFilterChain.
+ */
+struct RtpHeaderInfo {
+	static constexpr size_t sMinSize = 12;
+
+	uint32_t timestamp = 0;
+	uint32_t ssrc = 0;
+	uint16_t seqNumber = 0;
+	uint8_t payloadType = 0;
+	bool marker = false;
+	// False if the packet is too short or is not a RTP version 2 packet.
+	bool valid = false;
+	// Offset of the payload, CSRC list and header extension skipped.
+	size_t payloadOffset = 0;
+
+	static RtpHeaderInfo parse(const uint8_t* data, size_t size);
+};
+
+class MediaFilter {
+public:
+	virtual ~MediaFilter() = default;
+
+	/// Should return false if the incoming packet must not be transfered.
+	virtual bool onIncomingTransfer(const RtpHeaderInfo& header,
+	                                uint8_t* data,
+	                                size_t size,
+	                                const sockaddr* addr,
+	                                socklen_t addrlen) = 0;
+	/// Should return false if the packet output must not be sent.
+	virtual bool onOutgoingTransfer(const RtpHeaderInfo& header,
+	                                uint8_t* data,
+	                                size_t size,
+	                                const sockaddr* addr,
+	                                socklen_t addrlen) = 0;
+};
+
+/**
+ * Ordered list of MediaFilters applied to a RelayChannel.
+ * The RTP header is parsed once, then each filter is given the parsed header. A packet is dropped as soon as one
+ * filter rejects it.
+ * Filters are added from the main thread while packets are filtered from the relay thread: the list is replaced as
+ * a whole (copy-on-write) so that the relay thread never sees it while it is modified.
+ */
+class MediaFilterChain {
+public:
+	using FilterList = std::vector<std::shared_ptr<MediaFilter>>;
+
+	void add(const std::shared_ptr<MediaFilter>& filter);
+	/* Replace all the filters at once. */
+	void set(FilterList filters);
+	void clear();
+	bool empty() const {
+		return getFilters()->empty();
+	}
+	size_t size() const {
+		return getFilters()->size();
+	}
+
+	bool onIncomingTransfer(uint8_t* data, size_t size, const sockaddr* addr, socklen_t addrlen);
+	bool onOutgoingTransfer(uint8_t* data, size_t size, const sockaddr* addr, socklen_t addrlen);
+
+	std::shared_ptr<const FilterList> getFilters() const {
+		return std::atomic_load(&mFilters);
+	}
+
+private:
+	std::shared_ptr<const FilterList> mFilters = std::make_shared<const FilterList>();
+};
+
+} // namespace flexisip
@@ -69,6 +69,7 @@ RelayChannel::RelayChannel(RelaySession *relaySession, const RelayTransport &rt,
 	initializeRtpSession(relaySession);
 	mSockAddrSize[0] = mSockAddrSize[1] = 0;
 	mPreventLoop = preventLoops;
+	mStatisticsEnabled = relaySession->getRelayServer()->statisticsEnabled();
 	mHasMultipleTargets = false;
 	mDestAddrChanged = false;
 	mRecvErrorCount[0] = mRecvErrorCount[1] = 0;
@@ -192,6 +193,10 @@ int RelayChannel::recv(int i, uint8_t *buf, size_t buflen, time_t curTime) {
 	if (err > 0) {
 		mPacketsReceived[i]++;
 		mRecvErrorCount[i] = 0;
+		if (mStatisticsEnabled) {
+			if (i == 0) mStatistics.onRtpPacket(buf, err, RtpStreamStatistics::Clock::now());
+			else mStatistics.onRtcpPacket(buf, err);
+		}
 		if (addrsize != mSockAddrSize[i] || memcmp(&ss, &mSockAddr[i], addrsize) != 0){
 			if (curTime - mSockAddrLastUseTime[i] > sDestinationSwitchTimeout){
 				char ipPort[128] = {0};
@@ -217,8 +222,7 @@ int RelayChannel::recv(int i, uint8_t *buf, size_t buflen, time_t curTime) {
 			/*LOGD("ignored packet");*/
 			return 0;
 		}
-		if (mFilter &&
-			mFilter->onIncomingTransfer(buf, buflen, (struct sockaddr *)&mSockAddr[i], mSockAddrSize[i]) == false) {
+		if (mFilters.onIncomingTransfer(buf, err, (struct sockaddr *)&mSockAddr[i], mSockAddrSize[i]) == false) {
 			return 0;
 		}
 	} else if (err == -1) {
@@ -235,7 +239,7 @@ int RelayChannel::send(int i, uint8_t *buf, size_t buflen) {
 	int err = 0;
 	/*if destination address is working mSockAddrSize>0*/
 	if (mRemotePort[i] > 0 && mSockAddrSize[i] > 0 && mDir != Inactive && mRecvErrorCount[i] < sMaxRecvErrors && mIsOpen) {
-		if (!mFilter || mFilter->onOutgoingTransfer(buf, buflen, (struct sockaddr *)&mSockAddr[i], mSockAddrSize[i])) {
+		if (mFilters.onOutgoingTransfer(buf, buflen, (struct sockaddr *)&mSockAddr[i], mSockAddrSize[i])) {
 			int localPort = (i == 0) ? mRelayTransport.mRtpPort : mRelayTransport.mRtcpPort;
 			err = sendto(mSockets[i], buf, buflen, 0, (struct sockaddr *)&mSockAddr[i], mSockAddrSize[i]);
 			mPacketsSent[i]++;
@@ -253,13 +257,13 @@ int RelayChannel::send(int i, uint8_t *buf, size_t buflen) {
 	return err;
 }
 
-void RelayChannel::setFilter(shared_ptr<MediaFilter> filter) {
-	mFilter = filter;
+void RelayChannel::setFilters(MediaFilterChain::FilterList filters) {
+	mFilters.set(move(filters));
 }
 
 RelaySession::RelaySession(MediaRelayServer *server, const string &frontId,
-						   const RelayTransport & rt)
-	: mServer(server), mFrontId(frontId) {
+						   const RelayTransport & rt, const string &callId)
+	: mServer(server), mFrontId(frontId), mCallId(callId) {
 	mLastActivityTime = getCurrentTime();
 	mUsed = true;
 	mFront = make_shared<RelayChannel>(this, rt, mServer->loopPreventionEnabled());
@@ -421,6 +425,18 @@ void RelaySession::unuse() {
 	}
 }
 
+RelaySession::QualityStatistics RelaySession::getQualityStatistics() {
+	QualityStatistics stats;
+	mMutex.lock();
+	if (mFront) stats.front = mFront->getStatistics().getSnapshot();
+	if (mBack) {
+		stats.back = mBack->getStatistics().getSnapshot();
+		stats.hasBack = true;
+	}
+	mMutex.unlock();
+	return stats;
+}
+
 bool RelaySession::checkChannels() {
 	mMutex.lock();
 	for (auto itb = mBacks.begin(); itb != mBacks.end(); ++itb) {
@@ -511,8 +527,9 @@ MediaRelayServer::~MediaRelayServer() {
 	close(mCtlPipe[1]);
 }
 
-shared_ptr<RelaySession> MediaRelayServer::createSession(const std::string &frontId, const RelayTransport &frontRelayTransport) {
-	shared_ptr<RelaySession> s = make_shared<RelaySession>(this, frontId, frontRelayTransport);
+shared_ptr<RelaySession> MediaRelayServer::createSession(const std::string &frontId, const RelayTransport &frontRelayTransport,
+														 const std::string &callId) {
+	shared_ptr<RelaySession> s = make_shared<RelaySession>(this, frontId, frontRelayTransport, callId);
 	mMutex.lock();
 	mSessions.push_back(s);
 	mSessionsCount++;
@@ -526,6 +543,13 @@ shared_ptr<RelaySession> MediaRelayServer::createSession(const std::string &fron
 	return s;
 }
 
+list<shared_ptr<RelaySession>> MediaRelayServer::getSessions() {
+	mMutex.lock();
+	auto sessions = mSessions;
+	mMutex.unlock();
+	return sessions;
+}
+
 void MediaRelayServer::update() {
 	/*write to the control pipe to wakeup the server thread */
 	if (write(mCtlPipe[1], "e", 1) == -1)
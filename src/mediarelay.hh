@@ -21,7 +21,10 @@
 #include <flexisip/module.hh>
 #include <flexisip/agent.hh>
 #include "callstore.hh"
+#include "cli.hh"
 #include "sdp-modifier.hh"
+#include "media-filter.hh"
+#include "rtp-statistics.hh"
 #include <ortp/rtpsession.h>
 
 namespace flexisip {
@@ -29,7 +32,7 @@ namespace flexisip {
 class RelayedCall;
 class MediaRelayServer;
 
-class MediaRelay : public Module, protected ModuleToolbox {
+class MediaRelay : public Module, protected ModuleToolbox, public CliHandler {
 	friend class MediaRelayServer;
 	friend class RelayedCall;
 
@@ -41,6 +44,7 @@ class MediaRelay : public Module, protected ModuleToolbox {
 	virtual void onRequest(std::shared_ptr<RequestSipEvent> &ev);
 	virtual void onResponse(std::shared_ptr<ResponseSipEvent> &ev);
 	virtual void onIdle();
+	std::string handleCommand(const std::string &command, const std::vector<std::string> &args) override;
 
   protected:
 	virtual void onDeclare(GenericStruct *mc);
@@ -63,6 +67,7 @@ class MediaRelay : public Module, protected ModuleToolbox {
 
 	StatCounter64 *mCountCalls;
 	StatCounter64 *mCountCallsFinished;
+	StatCounter64 *mCountSdpParseCacheHits;
 	int mH264Decim;
 	int mMaxCalls;
 	int mMinPort, mMaxPort;
@@ -74,6 +79,7 @@ class MediaRelay : public Module, protected ModuleToolbox {
 	bool mPreventLoop;
 	bool mForceRelayForNonIceTargets;
 	bool mUsePublicIpForSdpMasquerading = false;
+	bool mCallQualityStatistics = true;
 	static ModuleInfo<MediaRelay> sInfo;
 };
 
@@ -106,7 +112,10 @@ class MediaRelayServer {
   public:
 	MediaRelayServer(MediaRelay *module);
 	~MediaRelayServer();
-	std::shared_ptr<RelaySession> createSession(const std::string &frontId, const RelayTransport &frontRelayTransport);
+	std::shared_ptr<RelaySession> createSession(const std::string &frontId, const RelayTransport &frontRelayTransport,
+												const std::string &callId = "");
+	/* Returns a copy of the list of sessions currently relayed by this server. */
+	std::list<std::shared_ptr<RelaySession>> getSessions();
 	void update();
 	Agent *getAgent();
 	RtpSession *createRtpSession(const std::string &bindIp);
@@ -114,6 +123,9 @@ class MediaRelayServer {
 	bool loopPreventionEnabled() const {
 		return mModule->mPreventLoop;
 	}
+	bool statisticsEnabled() const {
+		return mModule->mCallQualityStatistics;
+	}
 
   private:
 	void start();
@@ -142,8 +154,15 @@ class RelayChannel;
 **/
 class RelaySession : public std::enable_shared_from_this<RelaySession> {
   public:
+	/* Quality statistics of the streams received from each party. */
+	struct QualityStatistics {
+		RtpStreamStatistics::Snapshot front;
+		RtpStreamStatistics::Snapshot back;
+		bool hasBack = false;
+	};
+
 	RelaySession(MediaRelayServer *server, const std::string &frontId,
-				 const RelayTransport &frontRelayIps);
+				 const RelayTransport &frontRelayIps, const std::string &callId = "");
 	~RelaySession();
 
 	void fillPollFd(PollFd *pfd);
@@ -176,6 +195,10 @@ class RelaySession : public std::enable_shared_from_this<RelaySession> {
 	MediaRelayServer *getRelayServer() {
 		return mServer;
 	}
+	const std::string &getCallId() const {
+		return mCallId;
+	}
+	QualityStatistics getQualityStatistics();
 	bool checkChannels();
 
   private:
@@ -184,23 +207,13 @@ class RelaySession : public std::enable_shared_from_this<RelaySession> {
 	MediaRelayServer *mServer;
 	time_t mLastActivityTime;
 	std::string mFrontId;
+	const std::string mCallId;
 	std::shared_ptr<RelayChannel> mFront;
 	std::map<std::string, std::shared_ptr<RelayChannel>> mBacks;
 	std::shared_ptr<RelayChannel> mBack;
 	bool_t mUsed;
 };
 
-class MediaFilter {
-  public:
-	virtual ~MediaFilter() {};
-
-	/// Should return false if the incoming packet must not be transfered.
-	virtual bool onIncomingTransfer(uint8_t *data, size_t size, const sockaddr *addr, socklen_t addrlen) = 0;
-	/// Should return false if the packet output must not be sent.
-	virtual bool onOutgoingTransfer(uint8_t *data, size_t size, const sockaddr *addr, socklen_t addrlen) = 0;
-};
-
-
 class RelayChannel : public SdpMasqueradeContext{
   public:
 	enum Dir { SendOnly, SendRecv, Inactive };
@@ -225,13 +238,21 @@ class RelayChannel : public SdpMasqueradeContext{
 	int send(int i, uint8_t *buf, size_t size);
 	void fillPollFd(PollFd *pfd);
 	bool checkPollFd(const PollFd *pfd, int i);
-	void setFilter(std::shared_ptr<MediaFilter> filter);
+	/* The chain of filters applied to the packets of this channel. */
+	std::shared_ptr<const MediaFilterChain::FilterList> getFilters() const {
+		return mFilters.getFilters();
+	}
+	void setFilters(MediaFilterChain::FilterList filters);
 	uint64_t getReceivedPackets(int componentIndex) const {
 		return mPacketsReceived[componentIndex];
 	}
 	uint64_t getSentPackets(int componentIndex) const {
 		return mPacketsSent[componentIndex];
 	}
+	/* Quality statistics of the stream received from the remote party of this channel. */
+	RtpStreamStatistics &getStatistics() {
+		return mStatistics;
+	}
 	void setMultipleTargets(bool val){
 		mHasMultipleTargets = val;
 	}
@@ -253,12 +274,14 @@ class RelayChannel : public SdpMasqueradeContext{
 	struct sockaddr_storage mSockAddr[2]; /*the destination address in use*/
 	socklen_t mSockAddrSize[2];
 	time_t mSockAddrLastUseTime[2] = { 0 };
-	std::shared_ptr<MediaFilter> mFilter;
+	MediaFilterChain mFilters;
+	RtpStreamStatistics mStatistics;
 	int mPfdIndex;
 	int mRecvErrorCount[2];
 	uint64_t mPacketsReceived[2];
 	uint64_t mPacketsSent[2];
 	bool mPreventLoop;
+	bool mStatisticsEnabled;
 	bool mHasMultipleTargets;
 	bool mDestAddrChanged;
 	bool mIsOpen; /* Initially false, it is set to true when the remote address is set. It controls whether tranfer can occur. */
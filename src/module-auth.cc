@@ -68,6 +68,17 @@ void Authentication::onDeclare(GenericStruct *mc) {
 			"file"
 		},
 		{Integer, "cache-expire", "Duration of the validity of the credentials added to the cache in seconds.", "1800"},
+		{Integer, "cache-negative-expire", "Duration in seconds during which an unknown user is remembered as such, "
+			"so that the requests of clients using a wrong username don't all hit the database. 0 disables the caching "
+			"of unknown users.\n"
+			"The accounts created directly in the database are only seen once this duration has elapsed: a user who "
+			"tried to register before the creation of their account is rejected until then. A few seconds are enough "
+			"to absorb bursts of requests, longer durations save more database requests at the cost of this delay. "
+			"The accounts provisioned through Flexisip itself (password file, monitor) replace the unknown user at "
+			"once.", "5"},
+		{Integer, "cache-refresh-ahead", "Percentage of the validity duration of the cached credentials, at its end, "
+			"during which the first use of the credentials triggers their fetching in the background, so that they are "
+			"refreshed before expiring. 0 disables the refresh-ahead.", "20"},
 
 		// deprecated parameters
 		{StringList, "trusted-client-certificates", "List of whitespace separated username or username@domain CN "
@@ -111,6 +122,18 @@ void Authentication::onDeclare(GenericStruct *mc) {
 	mCountSyncRetrieve = mc->createStat("count-sync-retrieve", "Number of synchronous retrieves.");
 	mCountPassFound = mc->createStat("count-password-found", "Number of passwords found.");
 	mCountPassNotFound = mc->createStat("count-password-not-found", "Number of passwords not found.");
+	mc->createStat("count-password-cache-hits", "Number of credentials found in the cache.");
+	mc->createStat("count-password-cache-negative-hits", "Number of users found in the cache as unknown.");
+	mc->createStat("count-password-cache-misses", "Number of credentials not found in the cache, or expired.");
+	mc->createStat("count-password-cache-refreshes", "Number of credentials refreshed ahead of their expiration.");
+	mc->createStat("count-password-coalesced-lookups",
+		"Number of credential lookups joining the identical backend request already running.");
+	mc->createStat("count-password-batch-requests",
+		"Number of requests fetching a batch of credentials, when 'soci-password-batch-request' is set.");
+	mCountTrackedNonces = mc->createStat("count-tracked-nonces",
+		"Number of nonces whose nonce count is tracked, when stateless nonces are enabled.");
+	mCountNonceMemory = mc->createStat("count-nonce-memory-bytes",
+		"Approximate memory used to track the nonce counts, in bytes, when stateless nonces are enabled.");
 }
 
 void Authentication::onLoad(const GenericStruct *mc) {
@@ -255,11 +278,20 @@ void Authentication::onResponse(shared_ptr<ResponseSipEvent> &ev) {
 
 
 void Authentication::onIdle() {
+	size_t trackedNonces = 0, nonceMemory = 0;
 	for (auto &it : mAuthModules) {
 		AuthModule *am = it.second.get();
 		FlexisipAuthModule *fam = dynamic_cast<FlexisipAuthModule *>(am);
-		fam->nonceStore().cleanExpired();
+		if (auto *statelessNonceStore = fam->statelessNonceStore()) {
+			statelessNonceStore->cleanExpired(getCurrentTime());
+			trackedNonces += statelessNonceStore->getTrackedNonceCount();
+			nonceMemory += statelessNonceStore->getMemoryUsage();
+		} else {
+			fam->nonceStore().cleanExpired();
+		}
 	}
+	mCountTrackedNonces->set(trackedNonces);
+	mCountNonceMemory->set(nonceMemory);
 }
 
 bool Authentication::doOnConfigStateChanged(const ConfigValue &conf, ConfigState state) {
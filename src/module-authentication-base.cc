@@ -89,6 +89,15 @@ void ModuleAuthenticationBase::onDeclare(GenericStruct *mc) {
 		"Expiration time before generating a new nonce.\n"
 		"Unit: second",
 		"3600"
+	}, {
+		Boolean,
+		"stateless-nonces",
+		"Issue nonces signed with a HMAC, which embed their issuing time and the identity of the client they are "
+		"issued to. Such nonces are checked without being stored, and only the nonce counts of the nonces used by "
+		"clients are kept in memory, which makes the memory used by the module independent of the number of "
+		"challenges sent.\n"
+		"Nonces cannot be shared between several proxy instances, with or without this setting.",
+		"false"
 	}, {
 		String,
 		"realm",
@@ -140,8 +149,11 @@ void ModuleAuthenticationBase::onLoad(const GenericStruct *mc) {
 	auto disableQOPAuth = mc->get<ConfigBoolean>("disable-qop-auth")->read();
 	auto nonceExpires = mc->get<ConfigInt>("nonce-expires")->read();
 
+	auto statelessNonces = mc->get<ConfigBoolean>("stateless-nonces")->read();
+
 	for (const string &domain : authDomains) {
 		unique_ptr<FlexisipAuthModuleBase> am(createAuthModule(domain, nonceExpires, !disableQOPAuth));
+		if (statelessNonces) am->enableStatelessNonces();
 		mAuthModules[domain] = move(am);
 	}
 
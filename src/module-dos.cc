@@ -16,8 +16,9 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <atomic>
+#include <chrono>
 #include <set>
-#include <unordered_map>
 
 #include <sofia-sip/msg_addr.h>
 #include <sofia-sip/tport.h>
@@ -25,17 +26,15 @@
 #include "flexisip/agent.hh"
 #include "flexisip/logmanager.hh"
 #include "flexisip/module.hh"
+
+#include "dos/nftables-ban-list.hh"
+#include "dos/rate-limiter.hh"
 #include "utils/thread/basic-thread-pool.hh"
 
 using namespace std;
+using namespace std::chrono;
 using namespace flexisip;
 
-typedef struct DosContext {
-	uint64_t recv_msg_count_since_last_check;
-	double last_check_recv_msg_check_time;
-	double packet_count_rate;
-} DosContext;
-
 class DoSProtection;
 
 typedef struct BanContext {
@@ -55,18 +54,25 @@ private:
 	int mBanTime;
 	bool mIptablesVersionChecked;
 	bool mIptablesSupportsWait;
+	bool mNftablesAvailable = false;
+	bool mUseNftables = false;
 	set<BinaryIp> mWhiteList;
-	unordered_map<string, DosContext> mDosContexts;
-	unordered_map<string, DosContext>::iterator mDOSHashtableIterator;
+	unique_ptr<RateLimiter> mRateLimiter;
+	unique_ptr<NftablesBanList> mNftablesBanList;
+	atomic_bool mNftablesFlushScheduled{false};
 	unique_ptr<ThreadPool> mThreadPool;
 	string mFlexisipChain;
+	StatCounter64* mCountBannedAddresses = nullptr;
+	StatCounter64* mCountUntrackedPackets = nullptr;
 
-	int runIptables(const string& arguments, bool ipv6 = false, bool dumpErrors = true) {
+	// Number of slots of the rate limiter table visited at each call of onIdle().
+	static constexpr size_t sExpiredSlotsPerIdle = 16384;
+
+	int runCommand(const string& commandLine, bool dumpErrors = true) {
 		ostringstream command;
 		char output[512] = {0};
 
-		command << (ipv6 ? "/sbin/ip6tables" : "/sbin/iptables");
-		command << " " << arguments;
+		command << commandLine;
 		command << " 2>&1";
 		FILE* f = popen(command.str().c_str(), "r");
 		if (f == nullptr) {
@@ -86,6 +92,15 @@ private:
 		return ret;
 	}
 
+	int runIptables(const string& arguments, bool ipv6 = false, bool dumpErrors = true) {
+		return runCommand(string(ipv6 ? "/sbin/ip6tables" : "/sbin/iptables") + " " + arguments, dumpErrors);
+	}
+
+	// All the commands are given as a single argument, so that nft applies them in a single transaction.
+	int runNft(const string& commands, bool dumpErrors = true) {
+		return runCommand("/usr/sbin/nft '" + commands + "'", dumpErrors);
+	}
+
 	void onDeclare(GenericStruct* module_config) {
 		ConfigItemDescriptor configs[] = {
 		    {Integer, "time-period", "Number of milliseconds to consider to compute the packet rate", "3000"},
@@ -93,8 +108,23 @@ private:
 		     "Maximum packet rate in packets/seconds,  averaged over [time-period] "
 		     "millisecond(s) to consider it as a DoS attack.",
 		     "20"},
-		    {Integer, "ban-time", "Number of minutes to ban the ip/port using iptables", "2"},
+		    {Integer, "ban-time", "Number of minutes to ban the ip/port using the firewall", "2"},
+		    {String, "firewall",
+		     "Firewall used to ban the ip/ports exceeding the packet rate limit:\n"
+		     " - 'nftables': the banned ip/ports are added, with a timeout, to a set of the [nftables-table] table.\n"
+		     " - 'iptables': one rule per banned ip/port is added to the [iptables-chain] chain.\n"
+		     " - 'auto': nftables is used if the nft command is available, iptables otherwise.\n"
+		     "iptables is used as a fallback when nftables cannot be set up.",
+		     "auto"},
+		    {String, "nftables-table",
+		     "Name of the nftables table, of the inet family, flexisip will create to store the banned IPs. Only "
+		     "letters, digits, '_' and '-' are allowed.",
+		     "flexisip"},
 		    {String, "iptables-chain", "Name of the chain flexisip will create to store the banned IPs", "FLEXISIP"},
+		    {Integer, "max-tracked-addresses",
+		     "Maximum number of UDP ip/ports whose packet rate is tracked at the same time. Packets from new ip/ports "
+		     "are not rate limited while this limit is reached.",
+		     "65536"},
 		    {StringList, "white-list",
 		     "List of IP addresses or hostnames for which no DoS protection is made."
 		     " This is typically for trusted servers from which we can receive high traffic. "
@@ -106,6 +136,11 @@ private:
 		    config_item_end};
 		module_config->get<ConfigBoolean>("enabled")->setDefault("true");
 		module_config->addChildrenValues(configs);
+
+		mCountBannedAddresses = module_config->createStat("count-banned-addresses", "Number of banned ip/ports.");
+		mCountUntrackedPackets = module_config->createStat(
+		    "count-untracked-packets",
+		    "Number of UDP packets not rate limited because [max-tracked-addresses] ip/ports were already tracked.");
 	}
 
 	void onLoad(const GenericStruct* mc) {
@@ -113,7 +148,10 @@ private:
 		mPacketRateLimit = mc->get<ConfigInt>("packet-rate-limit")->read();
 		mBanTime = mc->get<ConfigInt>("ban-time")->read();
 		mFlexisipChain = mc->get<ConfigString>("iptables-chain")->read();
-		mDOSHashtableIterator = mDosContexts.begin();
+		// A packet rate averaged over [time-period] is a bucket refilled at this rate, able to hold one period of
+		// packets.
+		mRateLimiter = make_unique<RateLimiter>(mPacketRateLimit, double(mPacketRateLimit) * mTimePeriod / 1000.0,
+		                                        mc->get<ConfigInt>("max-tracked-addresses")->read());
 
 		GenericStruct* cluster = GenericManager::get()->getRoot()->get<GenericStruct>("cluster");
 		list<string> whiteList = cluster->get<ConfigStringList>("nodes")->read();
@@ -134,10 +172,30 @@ private:
 			tport_set_params(tport, TPTAG_DOS(mTimePeriod), TAG_END());
 		}
 		if (getuid() != 0) {
-			LOGE("Flexisip not started with root privileges! iptables commands for DoS protection won't work.");
+			LOGE("Flexisip not started with root privileges! Firewall commands for DoS protection won't work.");
 			return;
 		}
 
+		const auto firewall = mc->get<ConfigString>("firewall")->read();
+		mUseNftables = false;
+		if (firewall == "nftables" || (firewall == "auto" && mNftablesAvailable)) {
+			const auto table = mc->get<ConfigString>("nftables-table")->read();
+			if (!NftablesBanList::isValidTableName(table)) {
+				LOGE("DoSProtection: invalid nftables table name '%s', only letters, digits, '_' and '-' are allowed. "
+				     "Falling back to iptables.",
+				     table.c_str());
+			} else {
+				mNftablesBanList = make_unique<NftablesBanList>(table);
+				if (runNft(mNftablesBanList->getSetupCommands()) == 0) {
+					mUseNftables = true;
+					return;
+				}
+				LOGE("DoSProtection: cannot set up nftables, falling back to iptables.");
+			}
+		} else if (firewall != "iptables" && firewall != "auto") {
+			LOGE("DoSProtection: unknown firewall '%s', using iptables.", firewall.c_str());
+		}
+
 		// Let's remove the Flexisip's chain in case the previous run crashed
 		char iptables_cmd[512];
 
@@ -181,6 +239,10 @@ private:
 	}
 
 	void onUnload() {
+		if (mUseNftables) {
+			runNft(mNftablesBanList->getCleanupCommands());
+			return;
+		}
 		// Let's remove the Flexisip's chain
 		char iptables_cmd[512];
 		// First we have to empty the chain
@@ -219,6 +281,7 @@ private:
 				if (runIptables("-V > /dev/null", true) != 0) {
 					LOGEN("ip6tables command is not installed. DoS protection is inactive for IPv6.");
 				}
+				mNftablesAvailable = runCommand("/usr/sbin/nft --version > /dev/null", false) == 0;
 			}
 			return true;
 #endif
@@ -226,35 +289,8 @@ private:
 	}
 
 	void onIdle() {
-		struct timeval now;
-		double started_time_in_millis, time_elapsed;
-
-		gettimeofday(&now, NULL);
-		started_time_in_millis = now.tv_sec * 1000 + (now.tv_usec / 1000);
-
-		if (mDOSHashtableIterator == mDosContexts.end()) {
-			mDOSHashtableIterator = mDosContexts.begin();
-		}
-		for (; mDOSHashtableIterator != mDosContexts.end();) {
-			double now_in_millis;
-			DosContext dos = mDOSHashtableIterator->second;
-
-			gettimeofday(&now, NULL);
-			now_in_millis = now.tv_sec * 1000 + (now.tv_usec / 1000);
-			time_elapsed = now_in_millis - dos.last_check_recv_msg_check_time;
-
-			if (time_elapsed >= 3600 * 1000) { // If no message received in the past hour
-				mDOSHashtableIterator = mDosContexts.erase(mDOSHashtableIterator);
-			} else {
-				++mDOSHashtableIterator;
-			}
-
-			if (now_in_millis - started_time_in_millis >= 100) { // Do not use more than 100ms to clean the hashtable
-				LOGW("Started to clean dos hashtable %fms ago, let's stop for now a continue later",
-				     now_in_millis - started_time_in_millis);
-				break;
-			}
-		}
+		mRateLimiter->expire(steady_clock::now(), sExpiredSlotsPerIdle);
+		mCountUntrackedPackets->set(mRateLimiter->getOverflowCount());
 	}
 
 	bool isIpWhiteListed(const char* ip) {
@@ -310,6 +346,27 @@ private:
 		su_timer_set_interval(ctx->timer, invokeLambdaFromSofiaTimerCallback, ctx, mBanTime * 60 * 1000);
 	}
 
+	void flushNftablesBans() {
+		mNftablesFlushScheduled = false;
+		// All the bans queued since the last flush are added at once.
+		auto commands = mNftablesBanList->takePendingCommands();
+		if (!commands.empty()) runNft(commands);
+	}
+
+	void ban(const char* ip, const char* port, const string& protocol) {
+		mCountBannedAddresses->incr();
+		if (mUseNftables) {
+			mNftablesBanList->add(ip, port, protocol, minutes{mBanTime});
+			if (!mNftablesFlushScheduled.exchange(true) && !mThreadPool->run([this] { flushNftablesBans(); })) {
+				mNftablesFlushScheduled = false; // The queue is full, the ban will be flushed with the next one.
+			}
+			return;
+		}
+		string ipStr = ip, portStr = port;
+		mThreadPool->run([this, ipStr, portStr, protocol] { banIP(ipStr.c_str(), portStr.c_str(), protocol.c_str()); });
+		createBanContextAndPostInFuture(ip, port, protocol);
+	}
+
 	void onRequest(shared_ptr<RequestSipEvent>& ev) {
 		shared_ptr<tport_t> inTport = ev->getIncomingTport();
 		tport_t* tport = inTport.get();
@@ -332,42 +389,20 @@ private:
 			msg_get_address(msgSip->getMsg(), su, &len);
 			addr = &(su[0].su_sa);
 
+			const RateLimiter::Key key{addr};
+			if (mRateLimiter->consume(key, steady_clock::now())) return;
+			// Refill the bucket to not ban the ip/port twice by mistake.
+			mRateLimiter->reset(key);
+
 			if ((err = getnameinfo(addr, len, ip, sizeof(ip), port, sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV)) ==
 			    0) {
-				string id = string(ip) + ":" + string(port);
-				struct timeval now;
-				DosContext& dosContext = mDosContexts[id];
-				double now_in_millis, time_elapsed;
-
-				dosContext.recv_msg_count_since_last_check++;
-				gettimeofday(&now, NULL);
-				now_in_millis = now.tv_sec * 1000 + (now.tv_usec / 1000);
-				if (dosContext.last_check_recv_msg_check_time == 0) {
-					dosContext.last_check_recv_msg_check_time = now_in_millis;
-				}
-
-				time_elapsed = now_in_millis - dosContext.last_check_recv_msg_check_time;
-				if (time_elapsed < 0) {
-					dosContext.packet_count_rate = 0;
-					dosContext.recv_msg_count_since_last_check = 0;
-					dosContext.last_check_recv_msg_check_time = now_in_millis;
-				} else if (time_elapsed >= mTimePeriod) {
-					dosContext.packet_count_rate = dosContext.recv_msg_count_since_last_check / time_elapsed * 1000;
-					dosContext.recv_msg_count_since_last_check = 0;
-					dosContext.last_check_recv_msg_check_time = now_in_millis;
-				}
-
-				if (dosContext.packet_count_rate >= mPacketRateLimit) {
-					LOGW("Packet count rate (%f) >= limit (%i), blocking ip/port %s/%s on protocol udp for %i minutes",
-					     dosContext.packet_count_rate, mPacketRateLimit, ip, port, mBanTime);
-					if (!isIpWhiteListed(ip)) {
-						mThreadPool->run([&, ip, port] { banIP(ip, port, "udp"); });
-						createBanContextAndPostInFuture(ip, port, "udp");
-						ev->terminateProcessing(); // the event is discarded
-					} else {
-						LOGW("IP %s should be banned but wasn't because in white list", ip);
-					}
-					dosContext.packet_count_rate = 0; // Reset it to not add the iptables rule twice by mistake
+				LOGW("Packet count rate > limit (%i) over %ims, blocking ip/port %s/%s on protocol udp for %i minutes",
+				     mPacketRateLimit, mTimePeriod, ip, port, mBanTime);
+				if (!isIpWhiteListed(ip)) {
+					ban(ip, port, "udp");
+					ev->terminateProcessing(); // the event is discarded
+				} else {
+					LOGW("IP %s should be banned but wasn't because in white list", ip);
 				}
 			} else {
 				LOGW("getnameinfo() failed: %s", gai_strerror(err));
@@ -385,13 +420,12 @@ private:
 					LOGW("Packet count rate (%lu) >= limit (%i), blocking ip/port %s/%s on protocol tcp for %i minutes",
 					     packet_count_rate, mPacketRateLimit, ip, port, mBanTime);
 					if (!isIpWhiteListed(ip)) {
-						mThreadPool->run([&, ip, port] { banIP(ip, port, "tcp"); });
-						createBanContextAndPostInFuture(ip, port, "tcp");
+						ban(ip, port, "tcp");
 						ev->terminateProcessing(); // the event is discarded
 					} else {
 						LOGW("IP %s should be banned but wasn't because in white list", ip);
 					}
-					tport_reset_packet_count_rate(tport); // Reset it to not add the iptables rule twice by mistake
+					tport_reset_packet_count_rate(tport); // Reset it to not ban the ip/port twice by mistake
 				} else {
 					LOGW("getnameinfo() failed: %s", gai_strerror(err));
 				}
@@ -416,6 +450,7 @@ public:
 ModuleInfo<DoSProtection>
     DoSProtection::sInfo("DoSProtection",
                          "This module bans user when they are sending too much packets within a given timeframe. "
-                         "To see the list of currently banned IPs/ports, use iptables -L. ",
+                         "To see the list of currently banned IPs/ports, use 'nft list table inet flexisip' or "
+                         "'iptables -L', depending on the firewall in use. ",
                          {""},
                          ModuleInfoBase::ModuleOid::DoSProtection);
@@ -0,0 +1,146 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "flexisip/event.hh"
+
+#include "module-latency-stats.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+
+constexpr array<milliseconds, 4> ModuleLatencyStats::sStatThresholds;
+
+size_t LatencyHistogram::getBucket(uint64_t durationUs) {
+	if (durationUs == 0) return 0;
+	// Index of the most significant bit, plus one.
+	size_t bucket = 64 - __builtin_clzll(durationUs);
+	return bucket < sBucketCount ? bucket : sBucketCount - 1;
+}
+
+void LatencyHistogram::record(nanoseconds duration) {
+	const uint64_t us = duration.count() > 0 ? duration_cast<microseconds>(duration).count() : 0;
+	increase(mBuckets[getBucket(us)], 1);
+	increase(mCount, 1);
+	increase(mSumUs, us);
+	if (us > mMaxUs.load(memory_order_relaxed)) mMaxUs.store(us, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getPercentileUs(double percentile) const {
+	const auto count = getCount();
+	if (count == 0) return 0;
+	const auto rank = uint64_t(percentile * double(count) / 100.0);
+	uint64_t cumulated = 0;
+	for (size_t i = 0; i < sBucketCount; ++i) {
+		cumulated += mBuckets[i].load(memory_order_relaxed);
+		if (cumulated > rank) return getBucketUpperBoundUs(i);
+	}
+	return getBucketUpperBoundUs(sBucketCount - 1);
+}
+
+cJSON* LatencyHistogram::toJson() const {
+	cJSON* item = cJSON_CreateObject();
+	cJSON_AddNumberToObject(item, "count", double(getCount()));
+	cJSON_AddNumberToObject(item, "mean-us", double(getMeanUs()));
+	cJSON_AddNumberToObject(item, "p50-us", double(getPercentileUs(50)));
+	cJSON_AddNumberToObject(item, "p90-us", double(getPercentileUs(90)));
+	cJSON_AddNumberToObject(item, "p99-us", double(getPercentileUs(99)));
+	cJSON_AddNumberToObject(item, "max-us", double(getMaxUs()));
+	// Non-empty buckets only, keyed by their upper bound.
+	cJSON* buckets = cJSON_CreateObject();
+	for (size_t i = 0; i < sBucketCount; ++i) {
+		auto value = mBuckets[i].load(memory_order_relaxed);
+		if (value == 0) continue;
+		cJSON_AddNumberToObject(buckets, ("<" + to_string(getBucketUpperBoundUs(i))).c_str(), double(value));
+	}
+	cJSON_AddItemToObject(item, "buckets", buckets);
+	return item;
+}
+
+static ostream& operator<<(ostream& os, const LatencyHistogram& h) {
+	return os << "count=" << h.getCount() << " mean=" << h.getMeanUs() << "us p50<" << h.getPercentileUs(50)
+	          << "us p90<" << h.getPercentileUs(90) << "us p99<" << h.getPercentileUs(99) << "us max=" << h.getMaxUs()
+	          << "us";
+}
+
+ModuleLatencyStats::Counters::Counters(GenericStruct* moduleConfig, const string& kind, const string& help) {
+	const string prefix = "count-" + kind + "-latency-";
+	for (size_t i = 0; i < sStatThresholds.size(); ++i) {
+		const auto threshold = to_string(sStatThresholds[i].count()) + "ms";
+		buckets[i] = moduleConfig->createStat(prefix + "under-" + threshold, help + " taking less than " + threshold + ".");
+	}
+	const auto last = to_string(sStatThresholds.back().count()) + "ms";
+	buckets.back() = moduleConfig->createStat(prefix + "over-" + last, help + " taking more than " + last + ".");
+	totalUs = moduleConfig->createStat(prefix + "total-us", "Cumulated time, in microseconds, of the " + help + ".");
+}
+
+void ModuleLatencyStats::Counters::record(nanoseconds duration) {
+	size_t i = 0;
+	while (i < sStatThresholds.size() && duration >= sStatThresholds[i]) ++i;
+	buckets[i]->incr();
+	totalUs->add(duration_cast<microseconds>(duration).count());
+}
+
+ModuleLatencyStats::ModuleLatencyStats(GenericStruct* moduleConfig)
+    : mRequestCounters{moduleConfig, "request", "Number of requests processed by the module"},
+      mResponseCounters{moduleConfig, "response", "Number of responses processed by the module"},
+      mSuspensionCounters{moduleConfig, "suspension",
+                          "Number of events suspended by the module, waiting for an asynchronous operation,"} {
+}
+
+void ModuleLatencyStats::recordProcessing(const RequestSipEvent& ev, nanoseconds duration) {
+	const auto* request = ev.getSip()->sip_request;
+	mRequests[getMethodIndex(request ? request->rq_method : sip_method_unknown)].record(duration);
+	mRequestCounters.record(duration);
+}
+
+void ModuleLatencyStats::recordProcessing(const ResponseSipEvent&, nanoseconds duration) {
+	mResponses.record(duration);
+	mResponseCounters.record(duration);
+}
+
+void ModuleLatencyStats::recordSuspension(nanoseconds duration) {
+	mSuspensions.record(duration);
+	mSuspensionCounters.record(duration);
+}
+
+cJSON* ModuleLatencyStats::toJson() const {
+	cJSON* item = cJSON_CreateObject();
+	cJSON* requests = cJSON_CreateObject();
+	for (size_t i = 0; i < sMethodCount; ++i) {
+		if (mRequests[i].getCount() == 0) continue;
+		cJSON_AddItemToObject(requests, i == sip_method_unknown ? "other" : sip_method_names[i],
+		                      mRequests[i].toJson());
+	}
+	cJSON_AddItemToObject(item, "requests", requests);
+	cJSON_AddItemToObject(item, "responses", mResponses.toJson());
+	cJSON_AddItemToObject(item, "suspensions", mSuspensions.toJson());
+	return item;
+}
+
+void ModuleLatencyStats::dump(ostream& os) const {
+	for (size_t i = 0; i < sMethodCount; ++i) {
+		if (mRequests[i].getCount() == 0) continue;
+		os << "\n\t" << (i == sip_method_unknown ? "other" : sip_method_names[i]) << " requests: " << mRequests[i];
+	}
+	if (mResponses.getCount()) os << "\n\tresponses: " << mResponses;
+	if (mSuspensions.getCount()) os << "\n\tsuspensions: " << mSuspensions;
+}
+
+} // namespace flexisip
@@ -0,0 +1,141 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include <sofia-sip/sip.h>
+
+#include "flexisip/configmanager.hh"
+
+#include "cJSON.h"
+
+namespace flexisip {
+
+class RequestSipEvent;
+class ResponseSipEvent;
+
+/**
+ * Latency histogram with logarithmic buckets: the first bucket counts the durations under 1us, bucket i the durations
+ * in [2^(i-1), 2^i[ us, and the last one all the longer durations.
+ * It is written by the main thread only. Values are published through relaxed atomics so that they can be read from the
+ * CLI thread without locking.
+ */
+class LatencyHistogram {
+public:
+	static constexpr size_t sBucketCount = 26; // The last bucket starts at 2^24us, about 16s.
+
+	void record(std::chrono::nanoseconds duration);
+
+	uint64_t getCount() const {
+		return mCount.load(std::memory_order_relaxed);
+	}
+	uint64_t getSumUs() const {
+		return mSumUs.load(std::memory_order_relaxed);
+	}
+	uint64_t getMaxUs() const {
+		return mMaxUs.load(std::memory_order_relaxed);
+	}
+	uint64_t getMeanUs() const {
+		auto count = getCount();
+		return count ? getSumUs() / count : 0;
+	}
+	/**
+	 * Upper bound, in microseconds, of the bucket containing the given percentile (between 0 and 100).
+	 */
+	uint64_t getPercentileUs(double percentile) const;
+
+	static uint64_t getBucketUpperBoundUs(size_t bucket) {
+		return uint64_t(1) << bucket;
+	}
+	static size_t getBucket(uint64_t durationUs);
+
+	cJSON* toJson() const;
+
+private:
+	static void increase(std::atomic_uint64_t& value, uint64_t delta) {
+		// Single writer: no need for an atomic read-modify-write.
+		value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+	}
+
+	std::array<std::atomic_uint64_t, sBucketCount> mBuckets{};
+	std::atomic_uint64_t mCount{0};
+	std::atomic_uint64_t mSumUs{0};
+	std::atomic_uint64_t mMaxUs{0};
+};
+
+/**
+ * Latency statistics of a module: time spent in processRequest() for each SIP method, time spent in
+ * processResponse(), and time the events suspended by the module wait before being injected back into the module chain
+ * (asynchronous database or backend requests for instance).
+ * Coarse-grained buckets are also exported as StatCounter64, hence through SNMP.
+ */
+class ModuleLatencyStats {
+public:
+	explicit ModuleLatencyStats(GenericStruct* moduleConfig);
+
+	void recordProcessing(const RequestSipEvent& ev, std::chrono::nanoseconds duration);
+	void recordProcessing(const ResponseSipEvent& ev, std::chrono::nanoseconds duration);
+	void recordSuspension(std::chrono::nanoseconds duration);
+
+	const LatencyHistogram& getRequestHistogram(sip_method_t method) const {
+		return mRequests[getMethodIndex(method)];
+	}
+	const LatencyHistogram& getResponseHistogram() const {
+		return mResponses;
+	}
+	const LatencyHistogram& getSuspensionHistogram() const {
+		return mSuspensions;
+	}
+
+	cJSON* toJson() const;
+	void dump(std::ostream& os) const;
+
+private:
+	// Requests with unknown methods are counted with sip_method_unknown.
+	static constexpr size_t sMethodCount = sip_method_publish + 1;
+	static constexpr std::array<std::chrono::milliseconds, 4> sStatThresholds{
+	    std::chrono::milliseconds{1}, std::chrono::milliseconds{10}, std::chrono::milliseconds{100},
+	    std::chrono::milliseconds{1000}};
+
+	struct Counters {
+		Counters(GenericStruct* moduleConfig, const std::string& kind, const std::string& help);
+		void record(std::chrono::nanoseconds duration);
+
+		std::array<StatCounter64*, sStatThresholds.size() + 1> buckets{};
+		StatCounter64* totalUs = nullptr;
+	};
+
+	static size_t getMethodIndex(sip_method_t method) {
+		return (method > 0 && size_t(method) < sMethodCount) ? size_t(method) : size_t(sip_method_unknown);
+	}
+
+	std::array<LatencyHistogram, sMethodCount> mRequests{};
+	LatencyHistogram mResponses{};
+	LatencyHistogram mSuspensions{};
+	Counters mRequestCounters;
+	Counters mResponseCounters;
+	Counters mSuspensionCounters;
+};
+
+} // namespace flexisip
@@ -22,6 +22,7 @@
 #include <flexisip/fork-context/fork-context-base.hh>
 #include <flexisip/transaction.hh>
 
+#include "cJSON.h"
 #include "callcontext-mediarelay.hh"
 #include "h264iframefilter.hh"
 #include "mediarelay.hh"
@@ -101,6 +102,13 @@ void MediaRelay::onDeclare(GenericStruct * mc) {
 			"Force the media relay to use the public address of Flexisip to relay calls. It not enabled, Flexisip "
 			"will deduce a suitable IP address by basing on data from SIP messages, which could fail in tricky "
 			"situations e.g. when Flexisip is behind a TCP proxy.", "false" },
+		{ Boolean, "call-quality-statistics",
+			"Compute packet loss, jitter and bitrate of each relayed stream. The statistics of a call are written "
+			"in the event logs as a call quality statistics log when the call ends, and the statistics of running calls "
+			"can be obtained with the MEDIA_RELAY_STATS command of the CLI.\n"
+			"The call quality statistics logs of the relayed calls come in addition to the ones built from the "
+			"reports PUBLISHed by the clients: enable it only if the consumers of the event logs can tell them "
+			"apart.", "false" },
 #ifdef MEDIARELAY_SPECIFIC_FEATURES_ENABLED
 		/*very specific features, useless for most people*/
 		{ Integer, "h264-filtering-bandwidth",
@@ -119,6 +127,9 @@ void MediaRelay::onDeclare(GenericStruct * mc) {
 	auto p=mc->createStatPair("count-calls", "Number of relayed calls.");
 	mCountCalls=p.first;
 	mCountCallsFinished=p.second;
+	mCountSdpParseCacheHits = mc->createStat("count-sdp-parse-cache-hits",
+		"Number of SDP bodies that did not need to be parsed again, because they were identical to the one of "
+		"another branch of the same forked INVITE, or of a previous response.");
 }
 
 void MediaRelay::createServers(){
@@ -157,6 +168,7 @@ void MediaRelay::onLoad(const GenericStruct * modconf) {
 	mForceRelayForNonIceTargets = modconf->get<ConfigBoolean>("force-relay-for-non-ice-targets")->read();
 	mUsePublicIpForSdpMasquerading = modconf->get<ConfigBoolean>("force-public-ip-for-sdp-masquerading")->read();
 	mInactivityPeriod = modconf->get<ConfigInt>("inactivity-period")->read();
+	mCallQualityStatistics = modconf->get<ConfigBoolean>("call-quality-statistics")->read();
 	createServers();
 }
 
@@ -182,7 +194,9 @@ bool MediaRelay::processNewInvite(const shared_ptr<RelayedCall> &c, const shared
 		return false;
 	}
 	c->updateActivity();
-	shared_ptr<SdpModifier> m = SdpModifier::createFromSipMsg(ev->getMsgSip()->getHome(), sip, mSdpMangledParam);
+	bool cacheHit = false;
+	shared_ptr<SdpModifier> m = c->getOfferSdpCache().createModifier(ev->getMsgSip()->getHome(), sip, mSdpMangledParam, &cacheHit);
+	if (cacheHit) mCountSdpParseCacheHits->incr();
 	if (m == NULL) {
 		LOGW("Invalid SDP");
 		return false;
@@ -295,7 +309,19 @@ void MediaRelay::onRequest(shared_ptr<RequestSipEvent> &ev) {
 		if (processNewInvite(c, ot, ev)) {
 			//be in the record-route
 			addRecordRouteIncoming(getAgent(),ev);
-			if (newContext) mCalls->store(c);
+			if (newContext) {
+				mCalls->store(c);
+				if (mCallQualityStatistics) {
+					/* The statistics are written however the call ends: BYE, CANCEL, error response or inactivity. */
+					auto log = make_shared<CallQualityStatisticsLog>(sip, "");
+					auto agent = getAgent();
+					c->setTerminationCallback([log, agent](RelayedCall &call) {
+						log->setReport(call.getQualityReport());
+						log->setCompleted();
+						agent->writeEventLog(log);
+					});
+				}
+			}
 			ot->setProperty(getModuleName(), c);
 		}
 	}else if (sip->sip_request->rq_method == sip_method_bye) {
@@ -329,7 +355,9 @@ void MediaRelay::processResponseWithSDP(const shared_ptr<RelayedCall> &c, const
 		c->setEstablished(transaction->getBranchId());
 	}else isEarlyMedia=true;
 
-	shared_ptr<SdpModifier> m = SdpModifier::createFromSipMsg(msgSip->getHome(), sip, mSdpMangledParam);
+	bool cacheHit = false;
+	shared_ptr<SdpModifier> m = c->getAnswerSdpCache().createModifier(msgSip->getHome(), sip, mSdpMangledParam, &cacheHit);
+	if (cacheHit) mCountSdpParseCacheHits->incr();
 	if (m == NULL) {
 		LOGW("Invalid SDP");
 		return;
@@ -385,6 +413,7 @@ void MediaRelay::onResponse(shared_ptr<ResponseSipEvent> &ev) {
 		//This is a response sent to the incoming transaction.
 		LOGD("call context %p",c.get());
 		if (sip->sip_cseq && isInviteOrUpdate(sip->sip_cseq->cs_method)){
+			if (sip->sip_status->st_status >= 200) c->clearSdpCaches();
 			//Check for failure code, in which case the call context can be destroyed immediately.
 			if ( sip->sip_status->st_status >= 300){
 				if (!c->isDialogEstablished()){
@@ -424,6 +453,48 @@ void MediaRelay::onResponse(shared_ptr<ResponseSipEvent> &ev) {
 	}
 }
 
+static cJSON *snapshotToJson(const RtpStreamStatistics::Snapshot &s) {
+	cJSON *item = cJSON_CreateObject();
+	cJSON_AddNumberToObject(item, "packets", (double)s.packets);
+	cJSON_AddNumberToObject(item, "bytes", (double)s.bytes);
+	cJSON_AddNumberToObject(item, "lost", (double)s.lost);
+	cJSON_AddNumberToObject(item, "loss-rate", s.getLossRate());
+	cJSON_AddNumberToObject(item, "jitter-ms", s.jitterMs);
+	cJSON_AddNumberToObject(item, "bitrate-kbps", s.bitrateKbps);
+	cJSON_AddNumberToObject(item, "rtcp-packets", (double)s.rtcpPackets);
+	cJSON_AddNumberToObject(item, "remote-fraction-lost", s.remoteFractionLost);
+	cJSON_AddNumberToObject(item, "remote-jitter-ms", s.remoteJitterMs);
+	return item;
+}
+
+/*
+ * Called from the CLI thread: only the relay servers' session lists (protected by their mutex) and the statistics
+ * counters (atomics) are accessed, never the CallStore.
+ */
+string MediaRelay::handleCommand(const string &command, const vector<string> &args) {
+	if (command != "MEDIA_RELAY_STATS") return "";
+	if (!mCallQualityStatistics) return "Error: call quality statistics are disabled (see module::MediaRelay/call-quality-statistics)";
+
+	cJSON *root = cJSON_CreateArray();
+	for (const auto &server : mServers) {
+		for (const auto &session : server->getSessions()) {
+			if (!session->isUsed()) continue;
+			if (!args.empty() && session->getCallId() != args[0]) continue;
+			auto stats = session->getQualityStatistics();
+			cJSON *item = cJSON_CreateObject();
+			cJSON_AddStringToObject(item, "call-id", session->getCallId().c_str());
+			cJSON_AddItemToObject(item, "caller", snapshotToJson(stats.front));
+			if (stats.hasBack) cJSON_AddItemToObject(item, "callee", snapshotToJson(stats.back));
+			cJSON_AddItemToArray(root, item);
+		}
+	}
+	char *jsonOutput = cJSON_Print(root);
+	string output{jsonOutput};
+	free(jsonOutput);
+	cJSON_Delete(root);
+	return output;
+}
+
 void MediaRelay::onIdle() {
 	mCalls->dump();
 	mCalls->removeAndDeleteInactives(mInactivityPeriod);
@@ -16,11 +16,15 @@
  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <map>
+
 #include <flexisip/agent.hh>
 #include <flexisip/logmanager.hh>
 #include <flexisip/module.hh>
 #include <flexisip/utils/sip-uri.hh>
 
+#include "utils/consistent-hash-ring.hh"
+
 using namespace std;
 using namespace flexisip;
 
@@ -28,6 +32,8 @@ class ModulePresence : public Module, ModuleToolbox {
 private:
 	static ModuleInfo<ModulePresence> sInfo;
 	SipUri mDestRoute;
+	ConsistentHashRing mClusterRing{};
+	map<string, SipUri> mClusterRoutes{};
 	su_home_t mHome;
 	shared_ptr<SipBooleanExpression> mOnlyListSubscription;
 
@@ -46,6 +52,12 @@ private:
 				"the ones that have the same domain.",
 				"false"
 			},
+			{StringList, "presence-server-cluster",
+				"SIP URIs of the nodes of a cluster of presence servers. When set, each request is sent to the node "
+				"owning the presentity or list of its request URI, chosen by consistent hashing, instead of "
+				"'presence-server'. The presence servers must be given the same URIs in their 'cluster-nodes' parameter.",
+				""
+			},
 			config_item_end
 		};
 		module_config->get<ConfigBoolean>("enabled")->setDefault("false");
@@ -81,8 +93,20 @@ private:
 			LOGF("Invalid SIP URI (%s) in 'presence-server' parameter of 'Presence' module: %s", destRouteStr.c_str(), e.what());
 		}
 
+		mClusterRing = ConsistentHashRing{};
+		mClusterRoutes.clear();
+		for (const auto &node : mc->get<ConfigStringList>("presence-server-cluster")->read()) {
+			try {
+				mClusterRoutes.emplace(node, SipUri(node));
+				mClusterRing.addNode(node);
+			} catch (const invalid_argument &e) {
+				LOGF("Invalid SIP URI (%s) in 'presence-server-cluster' parameter of 'Presence' module: %s", node.c_str(), e.what());
+			}
+		}
+
 		mOnlyListSubscription = mc->get<ConfigBooleanExpression>("only-list-subscription")->read();
-		SLOGI << getModuleName() << ": presence server is [" << mDestRoute.str() << "]";
+		if (mClusterRing.empty()) SLOGI << getModuleName() << ": presence server is [" << mDestRoute.str() << "]";
+		else SLOGI << getModuleName() << ": presence servers are a cluster of " << mClusterRing.getNodes().size() << " nodes";
 		SLOGI << getModuleName() << ": Non list subscription are " << (mOnlyListSubscription ? "not" : "")
 			<< " redirected by presence server";
 	}
@@ -90,10 +114,22 @@ private:
 	void onUnload() {
 	}
 
+	const SipUri &getDestRoute(const sip_t *sip) const {
+		if (mClusterRing.empty()) return mDestRoute;
+		const url_t *url = sip->sip_request->rq_url;
+		// Same key as the presence servers use to find the owner of a presentity, which is built from the user part
+		// once unescaped by belle-sip.
+		string key = url->url_user ? url->url_user : "";
+		key.resize(url_unescape_to(&key[0], key.c_str(), key.size()));
+		key += "@" + string(url->url_host ? url->url_host : "");
+		return mClusterRoutes.at(mClusterRing.getOwner(key));
+	}
+
 	void route(shared_ptr<RequestSipEvent> &ev) {
-		SLOGI << getModuleName() << " routing to [" << mDestRoute.str() << "]";
+		const auto &destRoute = getDestRoute(ev->getSip());
+		SLOGI << getModuleName() << " routing to [" << destRoute.str() << "]";
 		cleanAndPrependRoute(this->getAgent(), ev->getMsgSip()->getMsg(), ev->getSip(),
-							 sip_route_create(ev->getMsgSip()->getHome(), mDestRoute.get(), nullptr));
+							 sip_route_create(ev->getMsgSip()->getHome(), destRoute.get(), nullptr));
 	}
 	bool isMessageAPresenceMessage(shared_ptr<RequestSipEvent> &ev) {
 		sip_t *sip = ev->getSip();
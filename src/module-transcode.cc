@@ -18,6 +18,13 @@
 
 #include "module-transcode.hh"
 
+#ifdef ENABLE_TRANSCODER
+#include <cstring>
+
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 using namespace std;
 using namespace flexisip;
 
@@ -72,17 +79,162 @@ void Transcoder::onDeclare(GenericStruct *mc) {
 		 "If true, retransmissions of INVITEs will be blocked. The purpose of this option is to limit bandwidth usage "
 		 "and server load on reliable networks.",
 		 "false"},
+		{Integer, "ticker-count",
+		 "Number of media processing threads (tickers) running the transcoding graphs. A value of 0 creates one ticker "
+		 "per CPU.",
+		 "0"},
+		{Boolean, "ticker-cpu-pinning", "Bind each ticker thread to a single CPU.", "false"},
+		{Integer, "ticker-rebalance-threshold",
+		 "Average load (in percent) of a ticker above which transcoded calls are moved to the least loaded ticker. "
+		 "A value of 0 disables the rebalancing.",
+		 "0"},
 		config_item_end};
 	mc->addChildrenValues(items);
 
 	auto p = mc->createStatPair("count-calls", "Number of transcoded calls.");
 #ifdef ENABLE_TRANSCODER
 	mCalls.setCallStatCounters(p.first, p.second);
+	mCountTickersSeenLate = mc->createStat(
+		"count-tickers-seen-late",
+		"Number of times a transcoding ticker was seen late. The tickers are checked periodically, and a ticker late "
+		"several times between two checks is only counted once.");
+	mCountRebalancedCalls =
+		mc->createStat("count-rebalanced-calls", "Number of transcoded calls moved from a ticker to another.");
+	mMaxTickerLateMs = mc->createStat(
+		"max-ticker-late-ms", "Highest lateness (in milliseconds) of the late ticks seen in the transcoding tickers.");
+	mMaxTickerLoad =
+		mc->createStat("max-ticker-load", "Average load (in percent) of the most loaded transcoding ticker.");
 #endif
 	(void)p;
 }
 
 #ifdef ENABLE_TRANSCODER
+TickerManager::~TickerManager() {
+	for (auto &info : mTickers) {
+		ms_ticker_destroy(info.ticker);
+	}
+}
+
+void TickerManager::configure(unsigned int tickerCount, bool cpuPinning) {
+	if (mStarted) {
+		LOGE("TickerManager: cannot be configured once started.");
+		return;
+	}
+	mTickerCount = tickerCount;
+	mCpuPinning = cpuPinning;
+}
+
+void TickerManager::start() {
+	int cpuCount = ModuleToolbox::getCpuCount();
+	unsigned int count = mTickerCount > 0 ? mTickerCount : cpuCount;
+	for (unsigned int i = 0; i < count; ++i) {
+		TickerInfo info;
+		info.ticker = ms_ticker_new();
+		string name = "Transcoder ticker " + to_string(i);
+		ms_ticker_set_name(info.ticker, name.c_str());
+		if (mCpuPinning) pinToCpu(info.ticker, i % cpuCount);
+		mTickers.push_back(info);
+	}
+	mStarted = true;
+}
+
+void TickerManager::pinToCpu(MSTicker *ticker, int cpu) {
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+	CPU_SET(cpu, &cpuset);
+	int err = pthread_setaffinity_np(ticker->thread, sizeof(cpuset), &cpuset);
+	if (err != 0) {
+		LOGW("TickerManager: cannot bind ticker %p to CPU %i: %s", ticker, cpu, strerror(err));
+	} else {
+		LOGI("TickerManager: ticker %p bound to CPU %i", ticker, cpu);
+	}
+}
+
+float TickerManager::getLoad(MSTicker *ticker) const {
+	return mLoadGetter(ticker);
+}
+
+MSTicker *TickerManager::getLeastLoaded() {
+	if (!mStarted) start();
+	auto it = min_element(mTickers.cbegin(), mTickers.cend(), [this](const TickerInfo &a, const TickerInfo &b) {
+		return getLoad(a.ticker) < getLoad(b.ticker);
+	});
+	return it->ticker;
+}
+
+MSTicker *TickerManager::getMostLoaded() {
+	if (!mStarted) start();
+	auto it = max_element(mTickers.cbegin(), mTickers.cend(), [this](const TickerInfo &a, const TickerInfo &b) {
+		return getLoad(a.ticker) < getLoad(b.ticker);
+	});
+	return it->ticker;
+}
+
+MSTicker *TickerManager::chooseOne() {
+	return getLeastLoaded();
+}
+
+unsigned int TickerManager::updateLateTickers() {
+	unsigned int lateTickers = 0;
+	for (auto &info : mTickers) {
+		MSTickerLateEvent lateEvent;
+		ms_ticker_get_last_late_tick(info.ticker, &lateEvent);
+		if (lateEvent.lateMs > 0 && lateEvent.time != info.lastLateTime) {
+			info.lastLateTime = lateEvent.time;
+			info.maxLateMs = max<int64_t>(info.maxLateMs, lateEvent.lateMs);
+			info.timesSeenLate++;
+			lateTickers++;
+		}
+	}
+	return lateTickers;
+}
+
+int64_t TickerManager::getMaxLateMs() const {
+	int64_t maxLateMs = 0;
+	for (const auto &info : mTickers) {
+		maxLateMs = max(maxLateMs, info.maxLateMs);
+	}
+	return maxLateMs;
+}
+
+shared_ptr<TranscodedCall> TickerManager::rebalance(const list<shared_ptr<CallContextBase>> &calls, int threshold) {
+	if (threshold <= 0)
+		return nullptr;
+	MSTicker *busiest = getMostLoaded();
+	MSTicker *idlest = getLeastLoaded();
+	float busiestLoad = getLoad(busiest);
+	float idlestLoad = getLoad(idlest);
+	if (busiest == idlest || busiestLoad < threshold)
+		return nullptr;
+
+	int callCount = 0;
+	shared_ptr<TranscodedCall> candidate;
+	for (const auto &ctx : calls) {
+		auto c = dynamic_pointer_cast<TranscodedCall>(ctx);
+		if (c && c->getTicker() == busiest) {
+			callCount++;
+			if (!candidate) candidate = c;
+		}
+	}
+	if (!candidate || callCount < 2)
+		return nullptr;
+	/* Assume that calls share the load evenly: do not move if it would only swap the imbalance. */
+	float callLoad = busiestLoad / callCount;
+	if (idlestLoad + callLoad >= busiestLoad)
+		return nullptr;
+	LOGI("Ticker %p is overloaded (%.1f%%), moving call %p to ticker %p (%.1f%%)", busiest, busiestLoad,
+		 candidate.get(), idlest, idlestLoad);
+	candidate->moveTo(idlest);
+	return candidate;
+}
+
+void TickerManager::dump() const {
+	for (const auto &info : mTickers) {
+		LOGD("Ticker %p: average load %.1f%%, seen late %llu times (max %lli ms late)", info.ticker,
+			 getLoad(info.ticker), (unsigned long long)info.timesSeenLate, (long long)info.maxLateMs);
+	}
+}
+
 static list<PayloadType *> makeSupportedAudioPayloadList() {
 	/* in mediastreamer2, we use normal_bitrate as an IP bitrate, not codec bitrate*/
 	payload_type_silk_nb.normal_bitrate = 29000;
@@ -188,11 +340,25 @@ void Transcoder::onLoad(const GenericStruct *mc) {
 	mRemoveBandwidthsLimits = mc->get<ConfigBoolean>("remove-bw-limits")->read();
 	list<PayloadType *> l = makeSupportedAudioPayloadList();
 	mSupportedAudioPayloads = orderList(mc->get<ConfigStringList>("audio-codecs")->read(), l);
+	mTickerManager.configure(max(0, mc->get<ConfigInt>("ticker-count")->read()),
+							 mc->get<ConfigBoolean>("ticker-cpu-pinning")->read());
+	mRebalanceThreshold = mc->get<ConfigInt>("ticker-rebalance-threshold")->read();
 }
 
 void Transcoder::onIdle() {
 	mCalls.dump();
 	mCalls.removeAndDeleteInactives(180);
+	if (mCalls.size() > 0) {
+		unsigned int lateTickers = mTickerManager.updateLateTickers();
+		for (unsigned int i = 0; i < lateTickers; ++i)
+			mCountTickersSeenLate->incr();
+		mMaxTickerLateMs->set(mTickerManager.getMaxLateMs());
+		mMaxTickerLoad->set(static_cast<uint64_t>(mTickerManager.getLoad(mTickerManager.getMostLoaded())));
+		mTickerManager.dump();
+		/* A single call is moved at a time, so that the loads are re-evaluated before moving another one. */
+		if (mTickerManager.rebalance(mCalls.getList(), mRebalanceThreshold))
+			mCountRebalancedCalls->incr();
+	}
 }
 
 bool Transcoder::canDoRateControl(sip_t *sip) {
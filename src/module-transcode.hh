@@ -37,31 +37,66 @@
 namespace flexisip {
 
 #ifdef ENABLE_TRANSCODER
+/**
+ * Pool of MSTickers running the transcoding graphs.
+ * Graphs are assigned to the least loaded ticker, and can be moved from an overloaded ticker to a less loaded one
+ * while the call is running.
+ */
 class TickerManager {
 public:
-	TickerManager() : mLastTickerIndex(0), mStarted(false) {
-	}
-	MSTicker *chooseOne() {
-		if (!mStarted) {
-			int cpucount = ModuleToolbox::getCpuCount();
-			mLastTickerIndex = 0;
-			for (int i = 0; i < cpucount; ++i) {
-				mTickers.push_back(ms_ticker_new());
-			}
-			mStarted = true;
-		}
-		if (mLastTickerIndex >= mTickers.size())
-			mLastTickerIndex = 0;
-		return mTickers[mLastTickerIndex++];
-	}
-	~TickerManager() {
-		for_each(mTickers.begin(), mTickers.end(), std::ptr_fun(ms_ticker_destroy));
+	using LoadGetter = std::function<float(MSTicker *)>;
+
+	TickerManager() = default;
+	TickerManager(const TickerManager &) = delete;
+	~TickerManager();
+
+	/**
+	 * Must be called before the first call to chooseOne().
+	 * @param tickerCount number of tickers to create, or 0 to create one ticker per CPU.
+	 * @param cpuPinning whether each ticker thread is bound to a single CPU.
+	 */
+	void configure(unsigned int tickerCount, bool cpuPinning);
+	/* Return the ticker with the lowest average load. */
+	MSTicker *chooseOne();
+	MSTicker *getLeastLoaded();
+	MSTicker *getMostLoaded();
+	float getLoad(MSTicker *ticker) const;
+	/* Replace the measure of the load of the tickers, which is their average load by default. */
+	void setLoadGetter(const LoadGetter &loadGetter) {
+		mLoadGetter = loadGetter;
 	}
+	/**
+	 * Move one call from the most loaded ticker to the least loaded one, if the first one is above the threshold (in
+	 * percent) and the move actually reduces the imbalance.
+	 * @return the moved call, or nullptr.
+	 */
+	std::shared_ptr<TranscodedCall> rebalance(const std::list<std::shared_ptr<CallContextBase>> &calls, int threshold);
+	/**
+	 * Look for the tickers that were late since the last call. The tickers only keep their last late tick, so a ticker
+	 * late several times between two calls is only seen once.
+	 * @return the number of tickers seen late.
+	 */
+	unsigned int updateLateTickers();
+	/* The highest lateness, in milliseconds, of the late ticks seen by updateLateTickers(). */
+	int64_t getMaxLateMs() const;
+	void dump() const;
 
 private:
-	std::vector<MSTicker *> mTickers;
-	unsigned int mLastTickerIndex;
-	bool mStarted;
+	struct TickerInfo {
+		MSTicker *ticker = nullptr;
+		uint64_t timesSeenLate = 0;
+		uint64_t lastLateTime = 0;
+		int64_t maxLateMs = 0;
+	};
+
+	void start();
+	void pinToCpu(MSTicker *ticker, int cpu);
+
+	std::vector<TickerInfo> mTickers;
+	LoadGetter mLoadGetter = ms_ticker_get_average_load;
+	unsigned int mTickerCount = 0;
+	bool mCpuPinning = false;
+	bool mStarted = false;
 };
 #endif
 
@@ -96,6 +131,11 @@ private:
 	MSFactory *mFactory;
 	CallContextParams mCallParams;
 	bool mRemoveBandwidthsLimits;
+	int mRebalanceThreshold;
+	StatCounter64 *mCountTickersSeenLate;
+	StatCounter64 *mCountRebalancedCalls;
+	StatCounter64 *mMaxTickerLateMs;
+	StatCounter64 *mMaxTickerLoad;
 #endif
 	static ModuleInfo<Transcoder> sInfo;
 };
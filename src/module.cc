@@ -29,6 +29,7 @@
 #include <sofia-sip/nta.h>
 
 #include "domain-registrations.hh"
+#include "module-latency-stats.hh"
 #include "utils/signaling-exception.hh"
 
 using namespace std;
@@ -40,6 +41,8 @@ using namespace flexisip;
 
 Module::Module(Agent *ag) : mAgent(ag), mFilter(new ConfigEntryFilter()) {}
 
+Module::~Module() = default;
+
 bool Module::isEnabled() const {
 	return mFilter->isEnabled();
 }
@@ -87,6 +90,9 @@ void Module::declare(GenericStruct* root) {
 		mModuleConfig->get<ConfigBoolean>("enabled")->setDefault("false");
 	}
 	onDeclare(mModuleConfig);
+#ifdef MODULE_LATENCY_STATS
+	mLatencyStats = make_unique<ModuleLatencyStats>(mModuleConfig);
+#endif
 }
 
 void Module::checkConfig() {
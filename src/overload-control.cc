@@ -0,0 +1,162 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdio>
+
+#include <sofia-sip/msg_header.h>
+#include <sofia-sip/sip_tag.h>
+
+#include "flexisip/event.hh"
+#include "flexisip/logmanager.hh"
+
+#include "overload-control.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+
+atomic_uint BackendRequestGuard::sPendingRequests{0};
+
+constexpr milliseconds OverloadControl::sCheckInterval;
+
+OverloadControl::OverloadControl(GenericStruct* config) : mConfig(config) {
+	mCountRejected = config->createStat("count-rejected-requests", "Number of requests rejected because of overload.");
+	mCountRejectedRegisterRefresh = config->createStat(
+	    "count-rejected-register-refreshes", "Number of REGISTER refreshes rejected because of severe overload.");
+	mCountReduction =
+	    config->createStat("count-reduction-percentage", "Current percentage of new requests rejected.");
+	mCountMainLoopLag =
+	    config->createStat("count-main-loop-lag-ms", "Current lag of the main loop, in milliseconds.");
+	mCountSuspendedEvents = config->createStat(
+	    "count-suspended-events", "Current number of SIP events waiting for an asynchronous operation.");
+	mCountBackendRequests = config->createStat(
+	    "count-backend-requests", "Current number of requests sent to the backends and not answered yet.");
+}
+
+void OverloadControl::load(const shared_ptr<sofiasip::SuRoot>& root) {
+	mTimer.reset();
+	mReduction = 0;
+	if (!mConfig->get<ConfigBoolean>("enabled")->read()) return;
+
+	mMaxLagMs = mConfig->get<ConfigInt>("max-main-loop-lag")->read();
+	mMaxSuspendedEvents = mConfig->get<ConfigInt>("max-suspended-events")->read();
+	mMaxBackendRequests = mConfig->get<ConfigInt>("max-backend-requests")->read();
+	mRetryAfter = mConfig->get<ConfigInt>("retry-after")->read();
+	SLOGI << "Overload control enabled: max-main-loop-lag=" << mMaxLagMs
+	      << "ms max-suspended-events=" << mMaxSuspendedEvents << " max-backend-requests=" << mMaxBackendRequests;
+
+	mLastCheck = {};
+	mSmoothedLagMs = 0.0;
+	mTimer = make_unique<sofiasip::Timer>(root, sCheckInterval);
+	mTimer->setForEver([this]() { onTimer(); });
+}
+
+void OverloadControl::onTimer() {
+	const auto now = steady_clock::now();
+	if (mLastCheck != steady_clock::time_point{}) {
+		// The timer is late by the time the main loop spent in other tasks. Smooth it to ignore isolated spikes.
+		const auto lag = duration_cast<milliseconds>(now - mLastCheck) - sCheckInterval;
+		mSmoothedLagMs += (double(max(lag.count(), decltype(lag.count()){0})) - mSmoothedLagMs) / 4.0;
+	}
+	mLastCheck = now;
+	update(milliseconds{long(mSmoothedLagMs)}, SipEvent::getSuspendedCount(), BackendRequestGuard::getPendingRequests());
+}
+
+void OverloadControl::update(milliseconds mainLoopLag, unsigned suspendedEvents, unsigned backendRequests) {
+	const auto reduction = max({computeReduction(mainLoopLag.count(), mMaxLagMs),
+	                            computeReduction(suspendedEvents, mMaxSuspendedEvents),
+	                            computeReduction(backendRequests, mMaxBackendRequests)});
+	if (reduction != mReduction) {
+		if (mReduction == 0) {
+			SLOGW << "Overload detected: main loop lag=" << mainLoopLag.count()
+			      << "ms suspended events=" << suspendedEvents << " backend requests=" << backendRequests
+			      << ", rejecting " << reduction << "% of new requests";
+		} else if (reduction == 0) {
+			SLOGI << "End of overload";
+		}
+		mReduction = reduction;
+		mSequence = formatSequence(duration_cast<milliseconds>(system_clock::now().time_since_epoch()));
+	}
+	mCountReduction->set(mReduction);
+	mCountMainLoopLag->set(mainLoopLag.count());
+	mCountSuspendedEvents->set(suspendedEvents);
+	mCountBackendRequests->set(backendRequests);
+}
+
+string OverloadControl::formatSequence(milliseconds timestamp) {
+	char sequence[32];
+	snprintf(sequence, sizeof(sequence), "%lld.%03lld", (long long)(timestamp.count() / 1000),
+	         (long long)(timestamp.count() % 1000));
+	return sequence;
+}
+
+unsigned OverloadControl::computeReduction(double value, double threshold) {
+	if (threshold <= 0.0 || value <= threshold) return 0;
+	const auto reduction = unsigned(100.0 * (1.0 - threshold / value) + 0.5);
+	return min(max(reduction, 1u), 100u);
+}
+
+OverloadControl::Priority OverloadControl::getPriority(const sip_t& sip) {
+	const auto* request = sip.sip_request;
+	if (request == nullptr || request->rq_method == sip_method_ack || request->rq_method == sip_method_cancel) {
+		return Priority::Exempt;
+	}
+	// Rejecting in-dialog requests would break established calls and subscriptions.
+	if (sip.sip_to && sip.sip_to->a_tag) return Priority::Exempt;
+	if (request->rq_method == sip_method_register &&
+	    (sip.sip_authorization || sip.sip_proxy_authorization || (sip.sip_cseq && sip.sip_cseq->cs_seq > 1))) {
+		return Priority::High;
+	}
+	return Priority::Normal;
+}
+
+bool OverloadControl::admit(RequestSipEvent& ev) {
+	if (mReduction == 0) return true;
+	const auto priority = getPriority(*ev.getSip());
+	if (priority == Priority::Exempt) return true;
+
+	auto reduction = mReduction;
+	auto& credit = mRejectionCredits[priority == Priority::High ? 0 : 1];
+	if (priority == Priority::High) reduction = mReduction > 50 ? (mReduction - 50) * 2 : 0;
+	credit += reduction;
+	if (credit < 100) return true;
+	credit -= 100;
+
+	++*mCountRejected;
+	if (priority == Priority::High) ++*mCountRejectedRegisterRefresh;
+	reject(ev);
+	return false;
+}
+
+void OverloadControl::reject(RequestSipEvent& ev) {
+	auto* home = ev.getHome();
+	auto* via = reinterpret_cast<msg_common_t*>(ev.getSip()->sip_via);
+	if (via && msg_header_find_param(via, "oc")) {
+		// The client supports RFC 7339: the Via of the response, copied from the request, tells it the percentage of
+		// requests to drop and for how long.
+		msg_header_replace_param(home, via, su_sprintf(home, "oc=%u", mReduction));
+		msg_header_replace_param(home, via, "oc-algo=\"loss\"");
+		msg_header_replace_param(home, via, su_sprintf(home, "oc-validity=%u", mRetryAfter * 1000));
+		msg_header_replace_param(home, via, su_sprintf(home, "oc-seq=%s", mSequence.c_str()));
+	}
+	ev.reply(503, "Service Unavailable", SIPTAG_RETRY_AFTER_STR(to_string(mRetryAfter).c_str()), TAG_END());
+}
+
+} // namespace flexisip
@@ -0,0 +1,135 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <sofia-sip/sip.h>
+
+#include "flexisip/configmanager.hh"
+#include "flexisip/sofia-wrapper/su-root.hh"
+#include "flexisip/sofia-wrapper/timer.hh"
+
+namespace flexisip {
+
+class RequestSipEvent;
+
+/**
+ * Counts a request sent to a backend (Redis, authentication database...) for as long as it is not answered.
+ * Backends keep an instance alive during each of their asynchronous requests.
+ */
+class BackendRequestGuard {
+public:
+	BackendRequestGuard() {
+		sPendingRequests.fetch_add(1, std::memory_order_relaxed);
+	}
+	~BackendRequestGuard() {
+		sPendingRequests.fetch_sub(1, std::memory_order_relaxed);
+	}
+	BackendRequestGuard(const BackendRequestGuard&) = delete;
+	BackendRequestGuard& operator=(const BackendRequestGuard&) = delete;
+
+	static unsigned getPendingRequests() {
+		return sPendingRequests.load(std::memory_order_relaxed);
+	}
+
+private:
+	static std::atomic_uint sPendingRequests;
+};
+
+/**
+ * Overload control of the proxy.
+ * The load of the proxy is measured periodically through three metrics:
+ *  - the lag of the main loop, that is how late a periodic timer fires,
+ *  - the number of SIP events suspended by the modules while waiting for an asynchronous operation,
+ *  - the number of requests sent to the backends and not answered yet.
+ * When a metric exceeds its threshold, a reduction percentage is computed from the most overloaded one. This
+ * percentage of the new out-of-dialog requests is rejected with a 503 carrying a Retry-After header, before entering
+ * the module chain. Clients supporting SIP overload control (RFC 7339) are also given the reduction percentage in the
+ * Via header of the 503, as specified by the 'loss' algorithm.
+ * In-dialog requests, ACK and CANCEL are never rejected. REGISTER refreshes are only rejected when the proxy is
+ * severely overloaded, that is when the reduction exceeds 50%.
+ */
+class OverloadControl {
+public:
+	enum class Priority { Exempt, High, Normal };
+
+	explicit OverloadControl(GenericStruct* config);
+
+	void load(const std::shared_ptr<sofiasip::SuRoot>& root);
+
+	/**
+	 * Decide whether a new incoming request can enter the module chain. If not, the request is answered with a 503
+	 * and false is returned.
+	 */
+	bool admit(RequestSipEvent& ev);
+
+	/**
+	 * Update the reduction percentage from the current value of the metrics.
+	 */
+	void update(std::chrono::milliseconds mainLoopLag, unsigned suspendedEvents, unsigned backendRequests);
+
+	unsigned getReduction() const {
+		return mReduction;
+	}
+
+	/**
+	 * Percentage of the requests to reject when a metric has the given value, which is 0 under the threshold and
+	 * tends to 100 as the value grows. A null threshold disables the metric.
+	 */
+	static unsigned computeReduction(double value, double threshold);
+	/**
+	 * RFC 7339 oc-seq value of a timestamp: seconds since the epoch, with the milliseconds as a 3 digits fraction.
+	 */
+	static std::string formatSequence(std::chrono::milliseconds timestamp);
+	static Priority getPriority(const sip_t& sip);
+
+private:
+	static constexpr std::chrono::milliseconds sCheckInterval{100};
+
+	void onTimer();
+	void reject(RequestSipEvent& ev);
+
+	GenericStruct* mConfig;
+	std::unique_ptr<sofiasip::Timer> mTimer{};
+	std::chrono::steady_clock::time_point mLastCheck{};
+	double mSmoothedLagMs = 0.0;
+	unsigned mMaxLagMs = 0;
+	unsigned mMaxSuspendedEvents = 0;
+	unsigned mMaxBackendRequests = 0;
+	unsigned mRetryAfter = 0;
+	unsigned mReduction = 0;
+	std::string mSequence{}; // RFC 7339 oc-seq: timestamp of the last change of the reduction.
+	// Accumulated reduction percentages of the high and normal priority requests: a request is rejected each time
+	// 100 is reached.
+	std::array<unsigned, 2> mRejectionCredits{};
+
+	StatCounter64* mCountRejected = nullptr;
+	StatCounter64* mCountRejectedRegisterRefresh = nullptr;
+	StatCounter64* mCountReduction = nullptr;
+	StatCounter64* mCountMainLoopLag = nullptr;
+	StatCounter64* mCountSuspendedEvents = nullptr;
+	StatCounter64* mCountBackendRequests = nullptr;
+};
+
+} // namespace flexisip
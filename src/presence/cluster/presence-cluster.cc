@@ -0,0 +1,174 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+
+#include <belle-sip/belle-sip.h>
+
+#include "flexisip/configmanager.hh"
+#include "flexisip/logmanager.hh"
+
+#include "presence/presentity-presenceinformation.hh"
+
+#include "presence-cluster.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+
+PresenceCluster::PresenceCluster(const vector<string>& nodes,
+                                 const string& localNode,
+                                 unique_ptr<PresenceStore>&& store,
+                                 int stateExpires)
+    : mRing(nodes), mLocalNode(localNode), mStore(move(store)), mStateExpires(stateExpires) {
+	mStore->setListener(this);
+}
+
+PresenceCluster::~PresenceCluster() {
+	mStore->setListener(nullptr);
+}
+
+string PresenceCluster::getPresentityKey(const belle_sip_uri_t* presentity) {
+	const char* user = belle_sip_uri_get_user(presentity);
+	const char* host = belle_sip_uri_get_host(presentity);
+	return string(user ? user : "") + "@" + (host ? host : "");
+}
+
+bool PresenceCluster::isLocal(const belle_sip_uri_t* presentity) const {
+	return mRing.getOwner(getPresentityKey(presentity)) == mLocalNode;
+}
+
+void PresenceCluster::publish(const belle_sip_uri_t* presentity, const string& pidf, const string& extendedPidf) {
+	mStore->publish(getPresentityKey(presentity), encodeState(nextVersion(), pidf, extendedPidf), mStateExpires);
+	if (mStats.countPublishedStates) mStats.countPublishedStates->incr();
+}
+
+void PresenceCluster::remove(const belle_sip_uri_t* presentity) {
+	// The removal is versioned as well, so that it isn't overridden by an older state.
+	mStore->remove(getPresentityKey(presentity), encodeState(nextVersion(), "", ""));
+	if (mStats.countPublishedStates) mStats.countPublishedStates->incr();
+}
+
+void PresenceCluster::watch(const shared_ptr<PresentityPresenceInformation>& presentity) {
+	const auto key = getPresentityKey(presentity->getEntity());
+	auto& watchers = mWatched[key].presentities;
+	watchers.push_back(presentity);
+	if (watchers.size() == 1) mStore->watch(key);
+}
+
+void PresenceCluster::unwatch(const PresentityPresenceInformation& presentity) {
+	const auto key = getPresentityKey(presentity.getEntity());
+	auto it = mWatched.find(key);
+	if (it == mWatched.end()) return;
+	auto& watchers = it->second.presentities;
+	watchers.erase(remove_if(watchers.begin(), watchers.end(),
+	                         [&presentity](const weak_ptr<PresentityPresenceInformation>& watcher) {
+		                         auto locked = watcher.lock();
+		                         return !locked || locked.get() == &presentity;
+	                         }),
+	               watchers.end());
+	if (watchers.empty()) {
+		mWatched.erase(it);
+		mStore->unwatch(key);
+	}
+}
+
+/*
+ * The version of a state is the time of its publication in microseconds, so that it keeps increasing when the
+ * ownership of the presentity moves to another node, and is increased when the clock doesn't move.
+ */
+uint64_t PresenceCluster::nextVersion() {
+	const uint64_t now = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+	mLastVersion = max(mLastVersion + 1, now);
+	return mLastVersion;
+}
+
+/*
+ * The state is made of the version and of the length of the PIDF document in decimal, separated by a space and
+ * followed by a line feed, then of the PIDF document and of the extended PIDF document.
+ */
+string PresenceCluster::encodeState(uint64_t version, const string& pidf, const string& extendedPidf) {
+	auto state = to_string(version) + ' ' + to_string(pidf.size());
+	state.reserve(state.size() + 1 + pidf.size() + extendedPidf.size());
+	state += '\n';
+	state += pidf;
+	state += extendedPidf;
+	return state;
+}
+
+static bool parseDecimal(const string& str, size_t begin, size_t end, uint64_t& value) {
+	if (begin == end || end - begin > 20) return false;
+	value = 0;
+	for (auto i = begin; i < end; i++) {
+		if (str[i] < '0' || str[i] > '9') return false;
+		value = value * 10 + (str[i] - '0');
+	}
+	return true;
+}
+
+bool PresenceCluster::decodeState(const string& state, uint64_t& version, string& pidf, string& extendedPidf) {
+	const auto separator = state.find('\n');
+	if (separator == string::npos) return false;
+	const auto space = state.find(' ');
+	if (space == string::npos || space > separator) return false;
+	uint64_t pidfSize = 0;
+	if (!parseDecimal(state, 0, space, version) || !parseDecimal(state, space + 1, separator, pidfSize)) return false;
+	if (pidfSize > state.size() - separator - 1) return false;
+	pidf = state.substr(separator + 1, pidfSize);
+	extendedPidf = state.substr(separator + 1 + pidfSize);
+	return true;
+}
+
+void PresenceCluster::onPresentityState(const string& presentity, const string& state) {
+	auto it = mWatched.find(presentity);
+	if (it == mWatched.end()) return;
+
+	shared_ptr<const string> pidf{}, extendedPidf{};
+	if (state.empty()) {
+		// Nothing stored: only meaningful before any state, a removal being sent as a state without documents.
+		if (it->second.version != 0) return;
+	} else {
+		uint64_t version = 0;
+		string basic{}, extended{};
+		if (!decodeState(state, version, basic, extended)) {
+			SLOGE << "PresenceCluster: invalid state received for presentity [" << presentity << "]";
+			return;
+		}
+		if (version <= it->second.version) {
+			SLOGD << "PresenceCluster: state " << version << " of presentity [" << presentity
+			      << "] dropped, state " << it->second.version << " already received";
+			return;
+		}
+		it->second.version = version;
+		if (!basic.empty()) {
+			pidf = make_shared<const string>(move(basic));
+			extendedPidf = make_shared<const string>(move(extended));
+		}
+	}
+	if (mStats.countReceivedStates) mStats.countReceivedStates->incr();
+
+	// Copied, as a listener may unwatch the presentity.
+	auto watchers = it->second.presentities;
+	for (const auto& watcher : watchers) {
+		if (auto info = watcher.lock()) info->setRemoteState(pidf, extendedPidf);
+	}
+}
+
+} // namespace flexisip
@@ -0,0 +1,104 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "presence-store.hh"
+#include "utils/consistent-hash-ring.hh"
+
+typedef struct _belle_sip_uri belle_sip_uri_t;
+
+namespace flexisip {
+
+class PresentityPresenceInformation;
+class StatCounter64;
+
+/**
+ * Sharing of the presentities between the nodes of a presence cluster.
+ * Each presentity is owned by a node, chosen by consistent hashing of its user and host, to which the proxies send
+ * its PUBLISH requests. The owner writes the PIDF documents of the presentity to the store on each change. The other
+ * nodes keep a read-only copy of the presentities their subscribers watch, updated by the store.
+ * Each state carries a version, increasing with the time of its publication, so that a copy is never replaced by an
+ * older state, e.g. when the state fetched on watch() is received after a newer one sent by the owner.
+ */
+class PresenceCluster : public PresenceStore::Listener {
+public:
+	/**
+	 * @param nodes All the nodes of the cluster, as given to the proxies.
+	 * @param localNode This node, among nodes.
+	 * @param stateExpires Lifetime in seconds of the states written to the store, in case the owner stops refreshing
+	 * them.
+	 */
+	PresenceCluster(const std::vector<std::string>& nodes,
+	                const std::string& localNode,
+	                std::unique_ptr<PresenceStore>&& store,
+	                int stateExpires);
+	~PresenceCluster() override;
+
+	// The key of a presentity in the cluster, "user@host", as computed by the proxies from the request URI.
+	static std::string getPresentityKey(const belle_sip_uri_t* presentity);
+
+	bool isLocal(const belle_sip_uri_t* presentity) const;
+
+	void publish(const belle_sip_uri_t* presentity, const std::string& pidf, const std::string& extendedPidf);
+	void remove(const belle_sip_uri_t* presentity);
+
+	/**
+	 * Keep the presentity, owned by another node, up to date with the state stored by its owner.
+	 */
+	void watch(const std::shared_ptr<PresentityPresenceInformation>& presentity);
+	void unwatch(const PresentityPresenceInformation& presentity);
+
+	static std::string encodeState(std::uint64_t version, const std::string& pidf, const std::string& extendedPidf);
+	static bool
+	decodeState(const std::string& state, std::uint64_t& version, std::string& pidf, std::string& extendedPidf);
+
+	void onPresentityState(const std::string& presentity, const std::string& state) override;
+
+	struct Stats {
+		StatCounter64* countPublishedStates = nullptr;
+		StatCounter64* countReceivedStates = nullptr;
+	};
+	void setStats(const Stats& stats) {
+		mStats = stats;
+	}
+
+private:
+	struct Watched {
+		std::vector<std::weak_ptr<PresentityPresenceInformation>> presentities{};
+		std::uint64_t version = 0; // Version of the last state received.
+	};
+
+	std::uint64_t nextVersion();
+
+	ConsistentHashRing mRing;
+	std::string mLocalNode;
+	std::unique_ptr<PresenceStore> mStore;
+	int mStateExpires;
+	std::unordered_map<std::string, Watched> mWatched{};
+	std::uint64_t mLastVersion = 0;
+	Stats mStats{};
+};
+
+} // namespace flexisip
@@ -0,0 +1,65 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+
+namespace flexisip {
+
+/**
+ * Storage of the state of the presentities shared by the nodes of a presence cluster, along with a channel telling the
+ * nodes about the changes of the presentities they watch.
+ * States are opaque strings for the store.
+ */
+class PresenceStore {
+public:
+	class Listener {
+	public:
+		virtual ~Listener() = default;
+		/**
+		 * Current state of a watched presentity, called once after watch() then on each change. States may be
+		 * received out of order.
+		 * @param state The stored state, empty if the presentity has none.
+		 */
+		virtual void onPresentityState(const std::string& presentity, const std::string& state) = 0;
+	};
+
+	virtual ~PresenceStore() = default;
+
+	void setListener(Listener* listener) {
+		mListener = listener;
+	}
+
+	/**
+	 * Store the state of a presentity for expires seconds and send it to the nodes watching the presentity.
+	 */
+	virtual void publish(const std::string& presentity, const std::string& state, int expires) = 0;
+	/**
+	 * Delete the stored state of a presentity and send the given final state to the nodes watching the presentity.
+	 */
+	virtual void remove(const std::string& presentity, const std::string& finalState) = 0;
+
+	virtual void watch(const std::string& presentity) = 0;
+	virtual void unwatch(const std::string& presentity) = 0;
+
+protected:
+	Listener* mListener = nullptr;
+};
+
+} // namespace flexisip
@@ -0,0 +1,186 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+
+#include "flexisip/logmanager.hh"
+
+#include "registrardb-redis-sofia-event.h"
+
+#include "redis-presence-store.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+RedisPresenceStore::RedisPresenceStore(const shared_ptr<sofiasip::SuRoot>& root,
+                                       const string& domain,
+                                       int port,
+                                       const string& password)
+    : mRoot(root), mDomain(domain), mPort(port), mPassword(password), mReconnectionTimer(root) {
+	connect();
+}
+
+RedisPresenceStore::~RedisPresenceStore() {
+	for (auto* context : {mContext, mSubscribeContext}) {
+		if (context == nullptr) continue;
+		context->data = nullptr;
+		redisAsyncDisconnect(context);
+	}
+}
+
+void RedisPresenceStore::connect() {
+	if (mContext == nullptr) mContext = createContext(false);
+	if (mSubscribeContext == nullptr) {
+		mSubscribeContext = createContext(true);
+		if (mSubscribeContext) watchAll();
+	}
+	if ((mContext == nullptr || mSubscribeContext == nullptr) && !mReconnectionTimer.isRunning()) {
+		mReconnectionTimer.set([this]() { connect(); }, sReconnectionDelayMs);
+	}
+}
+
+redisAsyncContext* RedisPresenceStore::createContext(bool subscribe) {
+	auto* context = redisAsyncConnect(mDomain.c_str(), mPort);
+	if (context->err) {
+		SLOGE << "RedisPresenceStore: connection error: " << context->errstr;
+		redisAsyncFree(context);
+		return nullptr;
+	}
+	context->data = this;
+#ifndef WITHOUT_HIREDIS_CONNECT_CALLBACK
+	redisAsyncSetConnectCallback(context, sOnConnect);
+#endif
+	redisAsyncSetDisconnectCallback(context, sOnDisconnect);
+	if (REDIS_OK != redisSofiaAttach(context, mRoot->getCPtr())) {
+		SLOGE << "RedisPresenceStore: cannot attach the " << (subscribe ? "subscribe " : "") << "context to the main loop";
+		context->data = nullptr;
+		redisAsyncDisconnect(context);
+		return nullptr;
+	}
+	if (!mPassword.empty()) redisAsyncCommand(context, nullptr, nullptr, "AUTH %s", mPassword.c_str());
+	return context;
+}
+
+void RedisPresenceStore::onContextLost(const redisAsyncContext* context, int status) {
+	if (context == mContext) mContext = nullptr;
+	else if (context == mSubscribeContext) mSubscribeContext = nullptr;
+	else return;
+	SLOGE << "RedisPresenceStore: connection lost" << (status != REDIS_OK ? string(": ") + context->errstr : "")
+	      << ", reconnecting in " << sReconnectionDelayMs << "ms";
+	if (!mReconnectionTimer.isRunning()) mReconnectionTimer.set([this]() { connect(); }, sReconnectionDelayMs);
+}
+
+void RedisPresenceStore::publish(const string& presentity, const string& state, int expires) {
+	if (mContext == nullptr) {
+		SLOGW << "RedisPresenceStore: not connected, state of [" << presentity << "] not published";
+		return;
+	}
+	const auto key = sKeyPrefix + presentity;
+	redisAsyncCommand(mContext, nullptr, nullptr, "SET %b %b EX %d", key.data(), key.size(), state.data(), state.size(),
+	                  expires);
+	redisAsyncCommand(mContext, nullptr, nullptr, "PUBLISH %b %b", key.data(), key.size(), state.data(),
+	                  state.size());
+}
+
+void RedisPresenceStore::remove(const string& presentity, const string& finalState) {
+	if (mContext == nullptr) {
+		SLOGW << "RedisPresenceStore: not connected, state of [" << presentity << "] not removed";
+		return;
+	}
+	const auto key = sKeyPrefix + presentity;
+	redisAsyncCommand(mContext, nullptr, nullptr, "DEL %b", key.data(), key.size());
+	redisAsyncCommand(mContext, nullptr, nullptr, "PUBLISH %b %b", key.data(), key.size(), finalState.data(),
+	                  finalState.size());
+}
+
+void RedisPresenceStore::watch(const string& presentity) {
+	if (!mWatched.insert(presentity).second) return;
+	if (mSubscribeContext == nullptr) return; // subscribed on reconnection
+	const auto key = sKeyPrefix + presentity;
+	redisAsyncCommand(mSubscribeContext, sOnMessage, nullptr, "SUBSCRIBE %b", key.data(), key.size());
+	fetch(presentity);
+}
+
+void RedisPresenceStore::unwatch(const string& presentity) {
+	if (mWatched.erase(presentity) == 0 || mSubscribeContext == nullptr) return;
+	const auto key = sKeyPrefix + presentity;
+	redisAsyncCommand(mSubscribeContext, nullptr, nullptr, "UNSUBSCRIBE %b", key.data(), key.size());
+}
+
+void RedisPresenceStore::watchAll() {
+	for (const auto& presentity : mWatched) {
+		const auto key = sKeyPrefix + presentity;
+		redisAsyncCommand(mSubscribeContext, sOnMessage, nullptr, "SUBSCRIBE %b", key.data(), key.size());
+		fetch(presentity);
+	}
+}
+
+void RedisPresenceStore::fetch(const string& presentity) {
+	// Without the main connection yet, the state is sent by the owner on its next change.
+	if (mContext == nullptr) return;
+	const auto key = sKeyPrefix + presentity;
+	redisAsyncCommand(mContext, sOnFetch, new string(presentity), "GET %b", key.data(), key.size());
+}
+
+/* Static functions that are used as callbacks to redisAsync API */
+
+#ifndef WITHOUT_HIREDIS_CONNECT_CALLBACK
+void RedisPresenceStore::sOnConnect(const redisAsyncContext* context, int status) {
+	auto* zis = static_cast<RedisPresenceStore*>(context->data);
+	if (zis == nullptr) return;
+	if (status != REDIS_OK) zis->onContextLost(context, status);
+	else SLOGD << "RedisPresenceStore: connected to [" << zis->mDomain << ":" << zis->mPort << "]";
+}
+#endif
+
+void RedisPresenceStore::sOnDisconnect(const redisAsyncContext* context, int status) {
+	auto* zis = static_cast<RedisPresenceStore*>(context->data);
+	if (zis) zis->onContextLost(context, status);
+}
+
+void RedisPresenceStore::sOnMessage(redisAsyncContext* context, void* r, void*) {
+	const auto* reply = static_cast<redisReply*>(r);
+	auto* zis = static_cast<RedisPresenceStore*>(context->data);
+	if (reply == nullptr || zis == nullptr || reply->type != REDIS_REPLY_ARRAY || reply->elements < 3) return;
+	if (strcasecmp(reply->element[0]->str, "message") != 0) return;
+
+	const string channel{reply->element[1]->str, reply->element[1]->len};
+	const auto prefixLength = strlen(sKeyPrefix);
+	if (channel.compare(0, prefixLength, sKeyPrefix) != 0 || zis->mListener == nullptr) return;
+	const auto presentity = channel.substr(prefixLength);
+	if (zis->mWatched.count(presentity) == 0) return; // message received before the UNSUBSCRIBE
+	zis->mListener->onPresentityState(presentity, string{reply->element[2]->str, reply->element[2]->len});
+}
+
+void RedisPresenceStore::sOnFetch(redisAsyncContext* context, void* r, void* data) {
+	unique_ptr<string> presentity{static_cast<string*>(data)};
+	const auto* reply = static_cast<redisReply*>(r);
+	auto* zis = static_cast<RedisPresenceStore*>(context->data);
+	if (reply == nullptr || zis == nullptr || zis->mListener == nullptr) return;
+	if (zis->mWatched.count(*presentity) == 0) return;
+	if (reply->type == REDIS_REPLY_STRING) {
+		zis->mListener->onPresentityState(*presentity, string{reply->str, reply->len});
+	} else if (reply->type == REDIS_REPLY_NIL) {
+		zis->mListener->onPresentityState(*presentity, "");
+	} else if (reply->type == REDIS_REPLY_ERROR) {
+		SLOGE << "RedisPresenceStore: cannot fetch the state of [" << *presentity << "]: " << reply->str;
+	}
+}
+
+} // namespace flexisip
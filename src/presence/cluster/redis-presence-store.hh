@@ -0,0 +1,79 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+#include "flexisip/sofia-wrapper/su-root.hh"
+#include "flexisip/sofia-wrapper/timer.hh"
+
+#include "presence-store.hh"
+
+typedef struct redisAsyncContext redisAsyncContext;
+
+namespace flexisip {
+
+/**
+ * Presence store kept in a Redis server. The state of a presentity is stored under the key
+ * "fs:presence:<presentity>" and published on the channel of the same name.
+ * The connections are driven by the Sofia-SIP main loop, and restored with the watched channels after a failure.
+ */
+class RedisPresenceStore : public PresenceStore {
+public:
+	RedisPresenceStore(const std::shared_ptr<sofiasip::SuRoot>& root,
+	                   const std::string& domain,
+	                   int port,
+	                   const std::string& password);
+	~RedisPresenceStore() override;
+
+	void publish(const std::string& presentity, const std::string& state, int expires) override;
+	void remove(const std::string& presentity, const std::string& finalState) override;
+	void watch(const std::string& presentity) override;
+	void unwatch(const std::string& presentity) override;
+
+private:
+	static constexpr const char* sKeyPrefix = "fs:presence:";
+	static constexpr unsigned sReconnectionDelayMs = 5000;
+
+	void connect();
+	redisAsyncContext* createContext(bool subscribe);
+	void onContextLost(const redisAsyncContext* context, int status);
+	void watchAll();
+	void fetch(const std::string& presentity);
+
+#ifndef WITHOUT_HIREDIS_CONNECT_CALLBACK
+	static void sOnConnect(const redisAsyncContext* context, int status);
+#endif
+	static void sOnDisconnect(const redisAsyncContext* context, int status);
+	static void sOnMessage(redisAsyncContext* context, void* reply, void* data);
+	static void sOnFetch(redisAsyncContext* context, void* reply, void* data);
+
+	std::shared_ptr<sofiasip::SuRoot> mRoot;
+	std::string mDomain;
+	int mPort;
+	std::string mPassword;
+	redisAsyncContext* mContext = nullptr;
+	redisAsyncContext* mSubscribeContext = nullptr;
+	std::unordered_set<std::string> mWatched{};
+	sofiasip::Timer mReconnectionTimer;
+};
+
+} // namespace flexisip
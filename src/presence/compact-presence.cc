@@ -0,0 +1,235 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <unordered_map>
+
+#include "xml/pidf-oma-pres.hh"
+
+#include "compact-presence.hh"
+#include "rpid-activities.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+namespace {
+
+using ServiceDescription = Xsd::Pidf::Tuple::ServiceDescriptionType;
+
+constexpr uint32_t sUnknownActivity = 1U << 24;
+
+/*
+ * Return the instance shared by all the tuples for the given service description. The presence server is
+ * single-threaded, so is the pool.
+ */
+shared_ptr<const ServiceDescription> intern(const ServiceDescription& service) {
+	static unordered_map<string, weak_ptr<const ServiceDescription>> pool{};
+	static size_t purgeThreshold = 64;
+
+	// Service descriptions with extensions are not shared.
+	if (!service.getAny().empty() || !service.getAnyAttribute().empty()) {
+		return make_shared<const ServiceDescription>(service);
+	}
+
+	string key = service.getServiceId() + '\n' + service.getVersion();
+	if (service.getDescription()) key += '\n' + *service.getDescription();
+
+	auto& entry = pool[key];
+	if (auto shared = entry.lock()) return shared;
+	auto shared = make_shared<const ServiceDescription>(service);
+	entry = shared;
+
+	if (pool.size() >= purgeThreshold) {
+		for (auto it = pool.begin(); it != pool.end();) {
+			if (it->second.expired()) it = pool.erase(it);
+			else ++it;
+		}
+		purgeThreshold = max<size_t>(64, pool.size() * 2);
+	}
+	return shared;
+}
+
+size_t getTupleHeapUsage(const Xsd::Pidf::Tuple& tuple) {
+	auto usage = getHeapUsage(tuple.getId());
+	if (tuple.getContact()) usage += sizeof(Xsd::Pidf::Contact) + getHeapUsage(*tuple.getContact());
+	for (const auto& note : tuple.getNote()) {
+		usage += sizeof(note) + getHeapUsage(note);
+	}
+	if (tuple.getTimestamp()) usage += sizeof(*tuple.getTimestamp());
+	usage += tuple.getServiceDescription().size() * sizeof(ServiceDescription);
+	return usage;
+}
+
+} // namespace
+
+size_t getHeapUsage(const string& str) {
+	// Short strings are stored in the object itself.
+	const auto* self = reinterpret_cast<const char*>(&str);
+	if (str.data() >= self && str.data() < self + sizeof(str)) return 0;
+	return str.capacity() + 1;
+}
+
+// CompactTuple
+
+CompactTuple::CompactTuple(unique_ptr<Xsd::Pidf::Tuple>&& tuple) : mId(tuple->getId()) {
+	if (!canPack(*tuple)) {
+		mFallback = move(tuple);
+		return;
+	}
+
+	const auto& basic = tuple->getStatus().getBasic();
+	if (basic) mBasic = (*basic == Xsd::Pidf::Basic::open) ? Basic::Open : Basic::Closed;
+
+	if (tuple->getContact()) {
+		const auto& contact = *tuple->getContact();
+		mHasContact = true;
+		mContact = contact;
+		if (contact.getPriority()) {
+			mHasPriority = true;
+			mPriority = static_cast<double>(*contact.getPriority());
+		}
+	}
+
+	mNotes.reserve(tuple->getNote().size());
+	for (const auto& note : tuple->getNote()) {
+		mNotes.push_back(Note{note, note.getLang() ? string(*note.getLang()) : string(), bool(note.getLang())});
+	}
+
+	if (tuple->getTimestamp()) {
+		const auto& timestamp = *tuple->getTimestamp();
+		mHasTimestamp = true;
+		mTimestamp.seconds = timestamp.seconds();
+		mTimestamp.year = timestamp.year();
+		mTimestamp.month = static_cast<uint8_t>(timestamp.month());
+		mTimestamp.day = static_cast<uint8_t>(timestamp.day());
+		mTimestamp.hours = static_cast<uint8_t>(timestamp.hours());
+		mTimestamp.minutes = static_cast<uint8_t>(timestamp.minutes());
+		mTimestamp.hasZone = timestamp.zone_present();
+		if (mTimestamp.hasZone) {
+			mTimestamp.zoneHours = static_cast<int8_t>(timestamp.zone_hours());
+			mTimestamp.zoneMinutes = static_cast<int8_t>(timestamp.zone_minutes());
+		}
+	}
+
+	mServiceDescriptions.reserve(tuple->getServiceDescription().size());
+	for (const auto& service : tuple->getServiceDescription()) {
+		mServiceDescriptions.push_back(intern(service));
+	}
+}
+
+bool CompactTuple::canPack(const Xsd::Pidf::Tuple& tuple) {
+	return tuple.getStatus().getAny().empty();
+}
+
+void CompactTuple::setContact(const string& contact) {
+	if (mFallback) {
+		Xsd::Pidf::Contact newContact{contact};
+		if (mFallback->getContact()) newContact.setPriority(mFallback->getContact()->getPriority());
+		mFallback->setContact(newContact);
+		return;
+	}
+	mHasContact = true;
+	mContact = contact;
+}
+
+unique_ptr<Xsd::Pidf::Tuple> CompactTuple::unpack() const {
+	if (mFallback) return make_unique<Xsd::Pidf::Tuple>(*mFallback);
+
+	Xsd::Pidf::Status status{};
+	if (mBasic != Basic::None) {
+		status.setBasic(Xsd::Pidf::Basic(mBasic == Basic::Open ? Xsd::Pidf::Basic::open : Xsd::Pidf::Basic::closed));
+	}
+	auto tuple = make_unique<Xsd::Pidf::Tuple>(status, mId);
+
+	if (mHasContact) {
+		Xsd::Pidf::Contact contact{mContact};
+		if (mHasPriority) contact.setPriority(Xsd::Pidf::Qvalue(mPriority));
+		tuple->setContact(contact);
+	}
+	for (const auto& note : mNotes) {
+		Xsd::Pidf::Note xsdNote{note.text};
+		if (note.hasLang) xsdNote.setLang(Xsd::Pidf::Note::LangType(note.lang));
+		tuple->getNote().push_back(xsdNote);
+	}
+	if (mHasTimestamp) {
+		const auto& t = mTimestamp;
+		tuple->setTimestamp(t.hasZone ? Xsd::XmlSchema::DateTime(t.year, t.month, t.day, t.hours, t.minutes, t.seconds,
+		                                                         t.zoneHours, t.zoneMinutes)
+		                              : Xsd::XmlSchema::DateTime(t.year, t.month, t.day, t.hours, t.minutes, t.seconds));
+	}
+	for (const auto& service : mServiceDescriptions) {
+		tuple->getServiceDescription().push_back(*service);
+	}
+	return tuple;
+}
+
+size_t CompactTuple::getMemoryUsage() const {
+	auto usage = sizeof(*this) + getHeapUsage(mId);
+	if (mFallback) return usage + sizeof(*mFallback) + getTupleHeapUsage(*mFallback);
+
+	usage += getHeapUsage(mContact);
+	usage += mNotes.capacity() * sizeof(Note);
+	for (const auto& note : mNotes) {
+		usage += getHeapUsage(note.text) + getHeapUsage(note.lang);
+	}
+	usage += mServiceDescriptions.capacity() * sizeof(mServiceDescriptions[0]);
+	return usage;
+}
+
+// CompactActivities
+
+CompactActivities::CompactActivities(const Xsd::Rpid::Activities& activities) {
+	if (!canPack(activities)) {
+		mFallback = make_unique<Xsd::Rpid::Activities>(activities);
+		return;
+	}
+	for (size_t i = 0; i < rpidEmptyActivities.size(); i++) {
+		if (!(activities.*(rpidEmptyActivities[i].get))().empty()) mActivities |= 1U << i;
+	}
+	if (activities.getUnknown()) mActivities |= sUnknownActivity;
+}
+
+bool CompactActivities::canPack(const Xsd::Rpid::Activities& activities) {
+	if (!activities.getNote().empty() || !activities.getOther().empty() || !activities.getAny().empty() ||
+	    !activities.getAnyAttribute().empty() || activities.getId() || activities.getFrom() || activities.getUntil()) {
+		return false;
+	}
+	// A bit can't tell how many times an activity is repeated.
+	for (const auto& activity : rpidEmptyActivities) {
+		if ((activities.*(activity.get))().size() > 1) return false;
+	}
+	return true;
+}
+
+Xsd::Rpid::Activities CompactActivities::unpack() const {
+	if (mFallback) return *mFallback;
+
+	Xsd::Rpid::Activities activities{};
+	for (size_t i = 0; i < rpidEmptyActivities.size(); i++) {
+		if (mActivities & (1U << i)) (activities.*(rpidEmptyActivities[i].getMutable))().push_back(Xsd::Rpid::Empty());
+	}
+	if (mActivities & sUnknownActivity) activities.setUnknown(Xsd::Rpid::Empty());
+	return activities;
+}
+
+size_t CompactActivities::getMemoryUsage() const {
+	// The activities held by the XSD object model are mostly empty sequences.
+	return sizeof(*this) + (mFallback ? sizeof(*mFallback) : 0);
+}
+
+} // namespace flexisip
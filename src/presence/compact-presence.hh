@@ -0,0 +1,123 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xml/pidf+xml.hh"
+#include "xml/rpid.hh"
+
+namespace flexisip {
+
+/**
+ * A PIDF tuple stored in a packed form, which is turned back into the XSD object model only to build the PIDF
+ * documents. Identical service descriptions are shared by all the tuples.
+ * Tuples holding extensions of the status, which only the DOM can store, are kept as XSD objects.
+ */
+class CompactTuple {
+public:
+	explicit CompactTuple(std::unique_ptr<Xsd::Pidf::Tuple>&& tuple);
+	CompactTuple(CompactTuple&&) = default;
+	CompactTuple& operator=(CompactTuple&&) = default;
+
+	static bool canPack(const Xsd::Pidf::Tuple& tuple);
+
+	const std::string& getId() const {
+		return mId;
+	}
+	bool isPacked() const {
+		return mFallback == nullptr;
+	}
+	void setContact(const std::string& contact);
+
+	std::unique_ptr<Xsd::Pidf::Tuple> unpack() const;
+
+	/**
+	 * Estimation of the heap and inline memory used by the tuple, shared service descriptions excluded.
+	 */
+	std::size_t getMemoryUsage() const;
+
+private:
+	enum class Basic : std::uint8_t { None, Open, Closed };
+
+	struct DateTime {
+		double seconds;
+		std::int32_t year;
+		std::uint8_t month;
+		std::uint8_t day;
+		std::uint8_t hours;
+		std::uint8_t minutes;
+		std::int8_t zoneHours;
+		std::int8_t zoneMinutes;
+		bool hasZone;
+	};
+
+	struct Note {
+		std::string text;
+		std::string lang;
+		bool hasLang;
+	};
+
+	std::string mId{};
+	std::string mContact{};
+	double mPriority = 0.;
+	DateTime mTimestamp{};
+	std::vector<Note> mNotes{};
+	std::vector<std::shared_ptr<const Xsd::Pidf::Tuple::ServiceDescriptionType>> mServiceDescriptions{};
+	Basic mBasic = Basic::None;
+	bool mHasContact = false;
+	bool mHasPriority = false;
+	bool mHasTimestamp = false;
+	std::unique_ptr<Xsd::Pidf::Tuple> mFallback{};
+};
+
+/**
+ * The RPID activities of a person. Activities made of empty elements only, as the ones published by Linphone, are
+ * stored as a bit field, other ones are kept as XSD objects.
+ */
+class CompactActivities {
+public:
+	explicit CompactActivities(const Xsd::Rpid::Activities& activities);
+	CompactActivities(CompactActivities&&) = default;
+	CompactActivities& operator=(CompactActivities&&) = default;
+
+	static bool canPack(const Xsd::Rpid::Activities& activities);
+
+	bool isPacked() const {
+		return mFallback == nullptr;
+	}
+	Xsd::Rpid::Activities unpack() const;
+	std::size_t getMemoryUsage() const;
+
+private:
+	// One bit per empty activity, in the order of rpidEmptyActivities, then one for <rpid:unknown/>.
+	std::uint32_t mActivities = 0;
+	std::unique_ptr<Xsd::Rpid::Activities> mFallback{};
+};
+
+/**
+ * Memory used on the heap by a string, beyond the object itself.
+ */
+std::size_t getHeapUsage(const std::string& str);
+
+} // namespace flexisip
@@ -18,6 +18,7 @@
 
 #include <chrono>
 #include <thread>
+#include <unordered_map>
 
 #include "belle-sip/message.h"
 
@@ -38,35 +39,75 @@ ExternalListSubscription::ExternalListSubscription(unsigned int expires,
                                                    function<void(shared_ptr<ListSubscription>)> listAvailable,
                                                    const string& sqlRequest,
                                                    soci::connection_pool* connPool,
-                                                   ThreadPool* threadPool)
-    : ListSubscription(expires, ist, aProv, maxPresenceInfoNotifiedAtATime, listAvailable), mConnPool(connPool) {
-	// create a thread to grab a pool connection and use it to retrieve the auth information
-	auto func = bind(&ExternalListSubscription::getUsersList, this, sqlRequest, ist);
+                                                   ThreadPool* threadPool,
+                                                   const shared_ptr<ResourceListCache>& listCache)
+    : ListSubscription(expires, ist, aProv, maxPresenceInfoNotifiedAtATime, listAvailable), mSqlRequest(sqlRequest),
+      mConnPool(connPool), mThreadPool(threadPool), mListCache(listCache) {
+	belle_sip_request_t* request = belle_sip_transaction_get_request(BELLE_SIP_TRANSACTION(ist));
+	belle_sip_header_to_t* toHeader =
+	    belle_sip_message_get_header_by_type(BELLE_SIP_MESSAGE(request), belle_sip_header_to_t);
+	belle_sip_header_from_t* fromHeader =
+	    belle_sip_message_get_header_by_type(BELLE_SIP_MESSAGE(request), belle_sip_header_from_t);
+	char* c_toUri = belle_sip_uri_to_string(belle_sip_header_address_get_uri(BELLE_SIP_HEADER_ADDRESS(toHeader)));
+	char* c_fromUri = belle_sip_uri_to_string(belle_sip_header_address_get_uri(BELLE_SIP_HEADER_ADDRESS(fromHeader)));
+	mFromUri = c_fromUri;
+	mToUri = c_toUri;
+	belle_sip_free(c_fromUri);
+	belle_sip_free(c_toUri);
 
-	bool success = threadPool->run(func);
-	if (!success) // Enqueue() can fail when the queue is full, so we have to act on that
+	fetchList([this, ist](const ResourceListCache::ListPtr& resources) {
+		if (resources) {
+			for (const auto& resource : *resources) {
+				if (auto listener = createListener(resource)) mListeners.push_back(listener);
+			}
+		}
+		finishCreation(ist);
+	});
+}
+
+void ExternalListSubscription::reloadList(function<void(ListenerList& added, ListenerList& removed)>&& onReloaded) {
+	auto self = static_pointer_cast<ExternalListSubscription>(shared_from_this());
+	auto onFetched = [self, onReloaded = move(onReloaded)](const ResourceListCache::ListPtr& resources) {
+		if (!resources) return;
+		// The list may be loaded by a thread of the pool, the listeners belong to the main loop.
+		belle_sip_main_loop_cpp_do_later(
+		    belle_sip_stack_get_main_loop(belle_sip_provider_get_sip_stack(self->mProv)),
+		    [self, resources, onReloaded]() {
+			    if (self->getState() == Subscription::State::terminated) return;
+			    ListenerList added{}, removed{};
+			    self->updateListeners(*resources, added, removed);
+			    if (!added.empty() || !removed.empty()) onReloaded(added, removed);
+		    },
+		    "deferred list update for external list subscription");
+	};
+	fetchList(move(onFetched));
+}
+
+void ExternalListSubscription::fetchList(ResourceListCache::Callback&& callback) {
+	const auto key = ResourceListCache::makeKey(mFromUri, mToUri);
+	if (!mListCache->get(key, move(callback))) return;
+
+	auto func = [listCache = mListCache, connPool = mConnPool, sqlRequest = mSqlRequest, fromUri = mFromUri,
+	             toUri = mToUri, key]() {
+		listCache->onLoaded(key, getUsersList(*connPool, sqlRequest, fromUri, toUri));
+	};
+	bool success = mThreadPool->run(func);
+	if (!success) { // Enqueue() can fail when the queue is full, so we have to act on that
 		SLOGE << "[SOCI] Auth queue is full, cannot fullfil user request for list subscription";
+		mListCache->onLoaded(key, nullptr);
+	}
 }
 
-void ExternalListSubscription::getUsersList(const string& sqlRequest, belle_sip_server_transaction_t* ist) {
+ResourceListCache::ListPtr ExternalListSubscription::getUsersList(soci::connection_pool& connPool,
+                                                                  const string& sqlRequest,
+                                                                  string fromUri,
+                                                                  string toUri) {
+	auto resources = make_shared<ResourceList>();
 	try {
-		SociHelper sociHelper(*mConnPool);
-
-		belle_sip_request_t* request = belle_sip_transaction_get_request(BELLE_SIP_TRANSACTION(ist));
-		belle_sip_header_to_t* toHeader =
-		    belle_sip_message_get_header_by_type(BELLE_SIP_MESSAGE(request), belle_sip_header_to_t);
-		belle_sip_header_from_t* fromHeader =
-		    belle_sip_message_get_header_by_type(BELLE_SIP_MESSAGE(request), belle_sip_header_from_t);
-		char* c_toUri = belle_sip_uri_to_string(belle_sip_header_address_get_uri(BELLE_SIP_HEADER_ADDRESS(toHeader)));
-		char* c_fromUri =
-		    belle_sip_uri_to_string(belle_sip_header_address_get_uri(BELLE_SIP_HEADER_ADDRESS(fromHeader)));
-
-		string fromUri(c_fromUri);
-		string toUri(c_toUri);
-		belle_sip_free(c_fromUri);
-		belle_sip_free(c_toUri);
+		SociHelper sociHelper(connPool);
 
 		sociHelper.execute([&](soci::session& sql) {
+			resources->clear(); // in case of retry
 			soci::rowset<soci::row> ret =
 			    (sql.prepare << sqlRequest, soci::use(fromUri, "from"), soci::use(toUri, "to"));
 			string addrStr;
@@ -75,23 +116,61 @@ void ExternalListSubscription::getUsersList(const string& sqlRequest, belle_sip_
 				unique_ptr<belle_sip_header_address_t, void (*)(void*)> addr(
 				    belle_sip_header_address_parse(addrStr.c_str()), belle_sip_object_unref);
 				if (addr == nullptr) {
-					ostringstream os;
-					os << "Cannot parse list entry [" << addrStr << "]";
+					SLOGE << "Cannot parse list entry [" << addrStr << "]";
 					continue;
 				}
 				const belle_sip_uri_t* uri = belle_sip_header_address_get_uri(addr.get());
 				if (!uri || !belle_sip_uri_get_host(uri) || !belle_sip_uri_get_user(uri)) {
-					ostringstream os;
-					os << "Cannot parse list entry [" << addrStr << "]";
+					SLOGE << "Cannot parse list entry [" << addrStr << "]";
 					continue;
 				}
 				const char* name = belle_sip_header_address_get_displayname(addr.get());
-				mListeners.push_back(make_shared<PresentityResourceListener>(*this, uri, name ? name : ""));
+				char* uriStr = belle_sip_uri_to_string(uri);
+				resources->push_back(ListedResource{uriStr, name ? name : ""});
+				belle_sip_free(uriStr);
 			}
 		});
 	} catch (SociHelper::DatabaseException& e) {
+		return nullptr;
+	}
+	return resources;
+}
+
+shared_ptr<PresentityResourceListener> ExternalListSubscription::createListener(const ListedResource& resource) {
+	unique_ptr<belle_sip_uri_t, void (*)(void*)> uri(belle_sip_uri_parse(resource.uri.c_str()),
+	                                                 belle_sip_object_unref);
+	if (uri == nullptr) return nullptr;
+	return make_shared<PresentityResourceListener>(*this, uri.get(), resource.name);
+}
+
+void ExternalListSubscription::updateListeners(const ResourceList& resources,
+                                               ListenerList& added,
+                                               ListenerList& removed) {
+	unordered_map<string, shared_ptr<PresentityPresenceInformationListener>> current{};
+	for (const auto& listener : mListeners) {
+		char* uri = belle_sip_uri_to_string(listener->getPresentityUri());
+		current.emplace(uri, listener);
+		belle_sip_free(uri);
+	}
+
+	ListenerList listeners{};
+	for (const auto& resource : resources) {
+		auto it = current.find(resource.uri);
+		if (it != current.end() && it->second->getName() == resource.name) {
+			listeners.push_back(it->second);
+			current.erase(it);
+			continue;
+		}
+		if (auto listener = createListener(resource)) {
+			listeners.push_back(listener);
+			added.push_back(listener);
+		}
+	}
+	for (auto& entry : current) {
+		forgetResource(entry.second->getPresentityUri());
+		removed.push_back(entry.second);
 	}
-	finishCreation(ist);
+	mListeners = move(listeners);
 }
 
 } // namespace flexisip
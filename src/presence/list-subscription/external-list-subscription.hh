@@ -22,6 +22,7 @@
 #include "soci/soci.h"
 
 #include "list-subscription.hh"
+#include "resource-list-cache.hh"
 #include "utils/thread/thread-pool.hh"
 
 typedef struct _belle_sip_uri belle_sip_uri_t;
@@ -41,12 +42,32 @@ public:
 	                         std::function<void(std::shared_ptr<ListSubscription>)> listAvailable,
 	                         const std::string& sqlRequest,
 	                         soci::connection_pool* connPool,
-	                         ThreadPool* threadPool);
+	                         ThreadPool* threadPool,
+	                         const std::shared_ptr<ResourceListCache>& listCache);
+
+	using ListenerList = std::list<std::shared_ptr<PresentityPresenceInformationListener>>;
+
+	/*
+	 * Fetch the list again, from the cache if it holds it, and replace the listeners of the resources which were
+	 * added to or removed from it. The callback is called from the main loop with these listeners, unless the
+	 * subscription has been terminated meanwhile.
+	 */
+	void reloadList(std::function<void(ListenerList& added, ListenerList& removed)>&& onReloaded);
 
 private:
-	void getUsersList(const std::string& sqlRequest, belle_sip_server_transaction_t* ist);
+	// Look the list up in the cache, and load it from the database on a thread of the pool on a miss.
+	void fetchList(ResourceListCache::Callback&& callback);
+	static ResourceListCache::ListPtr
+	getUsersList(soci::connection_pool& connPool, const std::string& sqlRequest, std::string fromUri, std::string toUri);
+	std::shared_ptr<PresentityResourceListener> createListener(const ListedResource& resource);
+	void updateListeners(const ResourceList& resources, ListenerList& added, ListenerList& removed);
 
+	std::string mSqlRequest;
+	std::string mFromUri;
+	std::string mToUri;
 	soci::connection_pool* mConnPool;
+	ThreadPool* mThreadPool;
+	std::shared_ptr<ResourceListCache> mListCache;
 };
 
 } // namespace flexisip
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 
 #include "belle-sip/belle-sip.h"
 #include "belle-sip/bodyhandler.h"
@@ -25,12 +26,18 @@
 
 #include "bellesip-signaling-exception.hh"
 #include "list-subscription.hh"
+#include "rlmi-writer.hh"
 #include <flexisip/logmanager.hh>
 
 using namespace std;
 
 namespace flexisip {
 
+// Size of the pidf documents of a NOTIFY sent to a subscriber over a datagram transport. Once it is reached, the other
+// resources are left to the following NOTIFYs, so that the requests stay close to the 1300 bytes above which RFC 3261
+// (section 18.1.1) requires a congestion controlled transport.
+static constexpr size_t sMaxDatagramNotifyBodySize = 1300;
+
 ListSubscription::ListSubscription(
 	unsigned int expires,
 	belle_sip_server_transaction_t *ist,
@@ -39,7 +46,17 @@ ListSubscription::ListSubscription(
 	function<void(shared_ptr<ListSubscription>)> listAvailable
 ) : Subscription("Presence", expires, belle_sip_transaction_get_dialog(BELLE_SIP_TRANSACTION(ist)), aProv),
 	mMaxPresenceInfoNotifiedAtATime(maxPresenceInfoNotifiedAtATime),
-	mListAvailable(listAvailable) {}
+	mListAvailable(listAvailable) {
+	// The top Via is the one of the last proxy. The bottom one gives the transport used by the subscriber.
+	belle_sip_request_t *request = belle_sip_transaction_get_request(BELLE_SIP_TRANSACTION(ist));
+	belle_sip_header_via_t *subscriberVia = nullptr;
+	for (auto *via = belle_sip_message_get_headers(BELLE_SIP_MESSAGE(request), BELLE_SIP_VIA); via; via = via->next) {
+		subscriberVia = BELLE_SIP_HEADER_VIA(via->data);
+	}
+	if (subscriberVia && strcasecmp(belle_sip_header_via_get_transport(subscriberVia), "UDP") == 0) {
+		mMaxNotifyBodySize = sMaxDatagramNotifyBodySize;
+	}
+}
 
 list<shared_ptr<PresentityPresenceInformationListener>> &ListSubscription::getListeners() {
 	return mListeners;
@@ -51,32 +68,46 @@ ListSubscription::~ListSubscription() {
 	SLOGD << "List subscription ["<< this <<"] deleted";
 };
 
-void ListSubscription::addInstanceToResource(Xsd::Rlmi::Resource &resource, list<belle_sip_body_handler_t *> &multipartList,
-											 PresentityPresenceInformation &presentityInformation, bool extended) {
-
+string ListSubscription::addInstance(const string &uri, list<belle_sip_body_handler_t *> &multipartList,
+									 PresentityPresenceInformation &presentityInformation, bool extended,
+									 size_t &bodySize) {
 	// we have a resource instance
 	// subscription state is always active until we implement ACL
-	Xsd::Rlmi::Instance instance("1", Xsd::Rlmi::State::active);
 	char cid_rand_part[8];
 	belle_sip_random_token(cid_rand_part, sizeof(cid_rand_part));
 	ostringstream cid;
 	cid << (const char *)cid_rand_part << "@" << belle_sip_uri_get_host(mName.get());
-	instance.setCid(cid.str());
-	string pidf = presentityInformation.getPidf(extended);
+	// the pidf is serialized once per version of the presentity, whatever the number of subscribers
+	auto pidf = presentityInformation.getPidf(extended);
 	belle_sip_memory_body_handler_t *bodyPart =
-		belle_sip_memory_body_handler_new_copy_from_buffer((void *)pidf.c_str(), pidf.length(), nullptr, nullptr);
+		belle_sip_memory_body_handler_new_copy_from_buffer((void *)pidf->c_str(), pidf->length(), nullptr, nullptr);
 	belle_sip_body_handler_add_header(BELLE_SIP_BODY_HANDLER(bodyPart),
 									  belle_sip_header_create("Content-Transfer-Encoding", "binary"));
-	ostringstream content_id;
-	content_id << "<" << cid.str() << ">";
 	belle_sip_body_handler_add_header(BELLE_SIP_BODY_HANDLER(bodyPart),
 									  belle_sip_header_create("Content-Id", cid.str().c_str()));
 	belle_sip_body_handler_add_header(
 		BELLE_SIP_BODY_HANDLER(bodyPart),
 		belle_sip_header_create("Content-Type", "application/pidf+xml;charset=\"UTF-8\""));
 	multipartList.push_back(BELLE_SIP_BODY_HANDLER(bodyPart));
-	resource.getInstance().push_back(instance);
+	bodySize += pidf->length();
+	mNotifiedStates[uri] =
+		NotifiedState{presentityInformation.shared_from_this(), presentityInformation.getVersion(), extended};
 	SLOGI << "Presence info added to list [" << mName.get() << " for entity [" << presentityInformation.getEntity() << "]";
+	return cid.str();
+}
+
+bool ListSubscription::hasChanged(const string &uri, PresentityPresenceInformation &presentityInformation,
+								  bool extended) const {
+	auto it = mNotifiedStates.find(uri);
+	if (it == mNotifiedStates.end()) return true;
+	const auto &notified = it->second;
+	return notified.presentity.lock().get() != &presentityInformation ||
+		   notified.version != presentityInformation.getVersion() || notified.extended != extended;
+}
+
+bool ListSubscription::isBatchFull(unsigned resourceCount, size_t bodySize) const {
+	return resourceCount >= mMaxPresenceInfoNotifiedAtATime ||
+		   (mMaxNotifyBodySize > 0 && bodySize >= mMaxNotifyBodySize);
 }
 
 void ListSubscription::notify(bool isFullState) {
@@ -102,47 +133,59 @@ void ListSubscription::notify(bool isFullState) {
 			 */
 			SLOGE << "First NOTIFY sent in subscription [" << mName.get() << "] MUST contain full state";
 		}
-		Xsd::Rlmi::List resourceList(string(uri), mVersion, isFullState);
+		RlmiWriter resourceList(string(uri), mVersion, isFullState);
 		belle_sip_free(uri);
 		list<belle_sip_body_handler_t *> multipartList;
+		unsigned instanceCount = 0;
+		size_t bodySize = 0;
+		bool unchangedSkipped = false;
 
 		if (isFullState) {
 			SLOGI << "Building full state rlmi for list name [" << mName.get() << "]";
 			for (shared_ptr<PresentityPresenceInformationListener> &resourceListener : mListeners) {
 				char *presentityUri = belle_sip_uri_to_string(resourceListener->getPresentityUri());
-				Xsd::Rlmi::Resource resource(presentityUri);
+				string resourceUri(presentityUri);
 				belle_sip_free(presentityUri);
-				if (!resourceListener->getName().empty())
-					resource.getName().push_back(resourceListener->getName());
+				string cid{};
 
 				PendingStateType::iterator it = mPendingStates.find(resourceListener->getPresentityUri());
-				if (it != mPendingStates.end() && it->second.first->isKnown() && resourceList.getResource().size() < mMaxPresenceInfoNotifiedAtATime) {
+				if (it != mPendingStates.end() && it->second.first->isKnown() && !isBatchFull(instanceCount, bodySize)) {
 					PresentityPresenceInformation &presentityInformation = *it->second.first;
-					addInstanceToResource(resource, multipartList, presentityInformation, resourceListener->extendedNotifyEnabled());
+					cid = addInstance(resourceUri, multipartList, presentityInformation,
+									  resourceListener->extendedNotifyEnabled(), bodySize);
+					instanceCount++;
 					mPendingStates.erase(it); //might be optimized
 				} else {
 					SLOGI << "No presence info yet for uri [" << resourceListener->getPresentityUri() << "]";
 				}
-				resourceList.getResource().push_back(resource);
+				resourceList.addResource(resourceUri, resourceListener->getName(), cid);
 			}
 		} else {
 			SLOGI << "Building partial state rlmi for list name [" << mName.get() << "]";
-			for (PendingStateType::iterator it =  mPendingStates.begin();
-				 it != mPendingStates.end() && resourceList.getResource().size() < mMaxPresenceInfoNotifiedAtATime ; /*nop*/ ) {
-				pair<const belle_sip_uri_t *, pair<shared_ptr<PresentityPresenceInformation>,bool>> presenceInformationPair = *it;
-				if (presenceInformationPair.second.first->isKnown()) { /* only notify for entity with known state*/
-					shared_ptr<PresentityPresenceInformation> presenceInformation = presenceInformationPair.second.first;
-					const belle_sip_uri_t *entity = presenceInformation->getEntity();
-					char *presentityUri = belle_sip_uri_to_string(entity);
-					Xsd::Rlmi::Resource resource(presentityUri);
+			for (PendingStateType::iterator it = mPendingStates.begin();
+				 it != mPendingStates.end() && !isBatchFull(instanceCount, bodySize); /*nop*/) {
+				shared_ptr<PresentityPresenceInformation> presenceInformation = it->second.first;
+				bool extended = it->second.second;
+				if (presenceInformation->isKnown()) { /* only notify for entity with known state*/
+					char *presentityUri = belle_sip_uri_to_string(presenceInformation->getEntity());
+					string resourceUri(presentityUri);
 					belle_sip_free(presentityUri);
-					if (!presenceInformation->getName().empty())
-						resource.getName().push_back(presenceInformation->getName());
-					addInstanceToResource(resource, multipartList, *presenceInformation, presenceInformationPair.second.second);
-					resourceList.getResource().push_back(resource);
+					/* only notify resources whose state changed since the previous notify */
+					if (hasChanged(resourceUri, *presenceInformation, extended)) {
+						auto cid = addInstance(resourceUri, multipartList, *presenceInformation, extended, bodySize);
+						resourceList.addResource(resourceUri, presenceInformation->getName(), cid);
+						instanceCount++;
+					} else {
+						SLOGD << "Presence info of [" << resourceUri << "] unchanged, not notified again";
+						unchangedSkipped = true;
+					}
 				}
 				it = mPendingStates.erase(it); //erase in any case
 			}
+			if (instanceCount == 0 && unchangedSkipped && getState() == active) {
+				SLOGD << "Nothing changed for list [" << mName.get() << "], no notify sent";
+				return;
+			}
 		}
 
 		// now building full body
@@ -151,18 +194,10 @@ void ListSubscription::notify(bool isFullState) {
 		ostringstream cid;
 		cid << (const char *)cid_rand_part << "@" << belle_sip_uri_get_host(mName.get());
 
-		// Serialize the object model to XML.
-		//
-		Xsd::XmlSchema::NamespaceInfomap map;
-		map[""].name = "urn:ietf:params:xml:ns:rlmi";
-		stringstream out;
-		Xsd::Rlmi::serializeList(out, resourceList, map);
-
+		const string &rlmi = resourceList.finish();
 		belle_sip_memory_body_handler_t *firstBodyPart = belle_sip_memory_body_handler_new_copy_from_buffer(
-			(void *)out.str().c_str(), out.str().length(), nullptr, nullptr);
+			(void *)rlmi.c_str(), rlmi.length(), nullptr, nullptr);
 		belle_sip_body_handler_add_header(BELLE_SIP_BODY_HANDLER(firstBodyPart), belle_sip_header_create("Content-Transfer-Encoding", "binary"));
-		ostringstream content_id;
-		content_id << "<" << cid.str() << ">";
 		belle_sip_body_handler_add_header(BELLE_SIP_BODY_HANDLER(firstBodyPart), belle_sip_header_create("Content-Id", cid.str().c_str()));
 		belle_sip_body_handler_add_header(
 			BELLE_SIP_BODY_HANDLER(firstBodyPart),
@@ -191,8 +226,6 @@ void ListSubscription::notify(bool isFullState) {
 				"timer for list notify"
 			);
 		}
-	} catch (const Xsd::XmlSchema::Serialization &e) {
-		throw FLEXISIP_EXCEPTION << "serialization error: " << e.diagnostics();
 	} catch (exception &e) {
 		throw FLEXISIP_EXCEPTION << "Cannot get build list notidy for [" << mName.get() << "]error [" << e.what() << "]";
 	}
@@ -265,6 +298,13 @@ void ListSubscription::finishCreation(belle_sip_server_transaction_t *ist) {
 	);
 }
 
+void ListSubscription::forgetResource(const belle_sip_uri_t *uri) {
+	mPendingStates.erase(uri);
+	char *resourceUri = belle_sip_uri_to_string(uri);
+	mNotifiedStates.erase(resourceUri);
+	belle_sip_free(resourceUri);
+}
+
 /// PresentityResourceListener//
 
 PresentityResourceListener::PresentityResourceListener(ListSubscription &aListSubscription, const belle_sip_uri_t *presentity, const string &name)
@@ -20,6 +20,7 @@
 #define flexisip_rls_subscription_hh
 
 #include <chrono>
+#include <string>
 #include <unordered_map>
 
 #include <belle-sip/mainloop.h>
@@ -28,7 +29,6 @@
 #include <flexisip/sofia-wrapper/home.hh>
 
 #include "subscription.hh"
-#include "xml/rlmi+xml.hh"
 
 typedef struct _belle_sip_uri belle_sip_uri_t;
 typedef struct belle_sip_server_transaction belle_sip_server_transaction_t;
@@ -89,6 +89,8 @@ protected:
 	friend PresentityResourceListener;
 	void onInformationChanged(PresentityPresenceInformation &presenceInformation, bool extended);
 	void finishCreation(belle_sip_server_transaction_t *ist);
+	// forget the pending and notified states of a resource removed from the list
+	void forgetResource(const belle_sip_uri_t *uri);
 
 	std::list<std::shared_ptr<PresentityPresenceInformationListener>> mListeners;
 	/*
@@ -104,8 +106,16 @@ protected:
 private:
 	// return true if a real notify can be sent.
 	bool isTimeToNotify();
-	void addInstanceToResource(Xsd::Rlmi::Resource &resource, std::list<belle_sip_body_handler_t *> &multipartList,
-							   PresentityPresenceInformation &presentityInformation, bool extended);
+	/*
+	 * add the pidf of a presentity to the body parts and remember the notified version.
+	 * @return the Content-Id of the part
+	 */
+	std::string addInstance(const std::string &uri, std::list<belle_sip_body_handler_t *> &multipartList,
+							PresentityPresenceInformation &presentityInformation, bool extended, size_t &bodySize);
+	// return true if the presence information differs from the one last notified for this uri
+	bool hasChanged(const std::string &uri, PresentityPresenceInformation &presentityInformation, bool extended) const;
+	// return true if one more presence information may be added to a notify
+	bool isBatchFull(unsigned resourceCount, size_t bodySize) const;
 
 	using PendingStateType = std::unordered_map<const belle_sip_uri_t *, std::pair<std::shared_ptr<PresentityPresenceInformation>,bool>,
 						  std::hash<const belle_sip_uri_t *>, bellesip::UriComparator>;
@@ -113,6 +123,14 @@ private:
 	std::chrono::time_point<std::chrono::system_clock> mLastNotify{std::chrono::system_clock::time_point::min()};
 	std::chrono::seconds mMinNotifyInterval{2};
 
+	struct NotifiedState {
+		std::weak_ptr<PresentityPresenceInformation> presentity;
+		uint64_t version;
+		bool extended;
+	};
+	// presence information last notified for each resource, by uri, so that unchanged ones are not sent again
+	std::unordered_map<std::string, NotifiedState> mNotifiedStates;
+
 	/*
 	 * rfc 4662
 	 * 5.2.  List Attributes
@@ -125,6 +143,7 @@ private:
 	uint32_t mVersion{0};
 	BelleSipSourcePtr mTimer;
 	size_t mMaxPresenceInfoNotifiedAtATime{0}; //maximum number of presentity available in a sigle notify
+	size_t mMaxNotifyBodySize{0}; //maximum size of the pidf documents of a single notify, 0 if unlimited
 	std::function<void(std::shared_ptr<ListSubscription>)> mListAvailable;
 	sofiasip::Home home;
 };
@@ -0,0 +1,116 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ctime>
+#include <sstream>
+
+#include "flexisip/logmanager.hh"
+
+#include "resource-list-cache.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+ResourceListCache::ResourceListCache(int expires) : mExpires(expires) {
+}
+
+string ResourceListCache::makeKey(const string& fromUri, const string& toUri) {
+	return fromUri + '\n' + toUri;
+}
+
+bool ResourceListCache::get(const string& key, Callback&& callback) {
+	if (mExpires > 0) {
+		ListPtr list{};
+		if (mCache.get(key, time(nullptr), list) == ExpiringCache<ListPtr>::Status::Hit) {
+			mHitCount++;
+			callback(list);
+			return false;
+		}
+	}
+
+	unique_lock<mutex> lck(mPendingMutex);
+	auto& pending = mPendingLoads[key];
+	pending.callbacks.push_back(move(callback));
+	if (pending.callbacks.size() > 1) {
+		mCoalescedCount++;
+		return false;
+	}
+	mMissCount++;
+	return true;
+}
+
+void ResourceListCache::onLoaded(const string& key, const ListPtr& list) {
+	PendingLoad pending{};
+	{
+		unique_lock<mutex> lck(mPendingMutex);
+		auto it = mPendingLoads.find(key);
+		if (it != mPendingLoads.end()) {
+			pending = move(it->second);
+			mPendingLoads.erase(it);
+		}
+		// Stored before releasing the lock, so that a lookup never misses both the cache and the pending load.
+		if (list && mExpires > 0 && !pending.invalidated) mCache.put(key, list, time(nullptr), mExpires);
+	}
+	for (const auto& callback : pending.callbacks) {
+		callback(list);
+	}
+}
+
+void ResourceListCache::invalidate(const string& key) {
+	unique_lock<mutex> lck(mPendingMutex);
+	mCache.erase(key);
+	auto it = mPendingLoads.find(key);
+	if (it != mPendingLoads.end()) it->second.invalidated = true;
+}
+
+void ResourceListCache::invalidateAll() {
+	unique_lock<mutex> lck(mPendingMutex);
+	mCache.clear();
+	for (auto& pending : mPendingLoads) {
+		pending.second.invalidated = true;
+	}
+}
+
+string ResourceListCache::handleCommand(const string& command, const vector<string>& args) {
+	if (command != "RLS_CACHE") return "";
+
+	if (args.size() == 3 && args[0] == "INVALIDATE") {
+		invalidate(makeKey(args[1], args[2]));
+		SLOGI << "Resource list of [" << args[1] << "] for [" << args[2] << "] invalidated from the CLI";
+		return "Done";
+	}
+	if (args.size() == 1 && args[0] == "CLEAR") {
+		invalidateAll();
+		SLOGI << "Resource list cache cleared from the CLI";
+		return "Done";
+	}
+	if (args.size() == 1 && args[0] == "STATS") {
+		ostringstream os;
+		os << "Cached lists: " << mCache.size() << "\nHits: " << mHitCount << "\nMisses: " << mMissCount
+		   << "\nCoalesced lookups: " << mCoalescedCount;
+		return os.str();
+	}
+	return "Valid subcommands for RLS_CACHE:\n"
+	       "  INVALIDATE <subscriber-uri> <list-uri>  forgets the list, which is fetched again from the database on the "
+	       "next SUBSCRIBE.\n"
+	       "  CLEAR  forgets all the lists.\n"
+	       "  STATS  displays the number of cached lists, hits, misses and coalesced lookups.";
+}
+
+} // namespace flexisip
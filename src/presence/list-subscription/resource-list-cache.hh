@@ -0,0 +1,108 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cli.hh"
+#include "utils/expiring-cache.hh"
+
+namespace flexisip {
+
+/**
+ * A resource of a list, as found in the resource list database.
+ */
+struct ListedResource {
+	std::string uri;
+	std::string name;
+};
+using ResourceList = std::vector<ListedResource>;
+
+/**
+ * Cache of the resource lists fetched from the database by the list subscriptions, keyed by subscriber and list, so
+ * that the SQL request is not executed again for every SUBSCRIBE of the same list.
+ * Concurrent lookups of a list which isn't cached wait for a single load. The cache is thread-safe.
+ *
+ * Entries can be invalidated with the RLS_CACHE command of the CLI of the presence server.
+ */
+class ResourceListCache : public CliHandler {
+public:
+	using ListPtr = std::shared_ptr<const ResourceList>;
+	// Called with nullptr if the list could not be loaded.
+	using Callback = std::function<void(const ListPtr&)>;
+
+	/**
+	 * @param expires Lifetime of the entries in seconds. With 0, lists are never cached but concurrent loads are still
+	 * shared.
+	 */
+	explicit ResourceListCache(int expires);
+
+	static std::string makeKey(const std::string& fromUri, const std::string& toUri);
+
+	/**
+	 * Look a list up. If it is cached, the callback is called before returning. Otherwise, it is called by the thread
+	 * which calls onLoaded() for this key.
+	 * @return true if the caller is in charge of loading the list then calling onLoaded(), false if a load is already
+	 * in progress or not needed.
+	 */
+	bool get(const std::string& key, Callback&& callback);
+	/**
+	 * Store the list loaded for the key, unless it was invalidated meanwhile, and give it to every waiting lookup.
+	 * @param list nullptr if the load failed, nothing is cached then.
+	 */
+	void onLoaded(const std::string& key, const ListPtr& list);
+
+	void invalidate(const std::string& key);
+	void invalidateAll();
+
+	std::string handleCommand(const std::string& command, const std::vector<std::string>& args) override;
+
+	unsigned long getHitCount() const {
+		return mHitCount;
+	}
+	unsigned long getMissCount() const {
+		return mMissCount;
+	}
+	unsigned long getCoalescedCount() const {
+		return mCoalescedCount;
+	}
+
+private:
+	struct PendingLoad {
+		std::vector<Callback> callbacks;
+		// The list is being loaded from a database state older than the invalidation, don't cache it.
+		bool invalidated = false;
+	};
+
+	const int mExpires;
+	ExpiringCache<ListPtr> mCache{};
+	std::mutex mPendingMutex{};
+	std::unordered_map<std::string, PendingLoad> mPendingLoads{};
+	std::atomic<unsigned long> mHitCount{0};
+	std::atomic<unsigned long> mMissCount{0};
+	std::atomic<unsigned long> mCoalescedCount{0};
+};
+
+} // namespace flexisip
@@ -0,0 +1,87 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "rlmi-writer.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+namespace {
+
+void appendEscaped(string& out, const string& value) {
+	for (auto c : value) {
+		switch (c) {
+			case '&':
+				out += "&amp;";
+				break;
+			case '<':
+				out += "&lt;";
+				break;
+			case '>':
+				out += "&gt;";
+				break;
+			case '"':
+				out += "&quot;";
+				break;
+			default:
+				out += c;
+		}
+	}
+}
+
+} // namespace
+
+RlmiWriter::RlmiWriter(const string& listUri, uint32_t version, bool fullState) {
+	mDocument.reserve(256);
+	mDocument += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
+	             "<list xmlns=\"urn:ietf:params:xml:ns:rlmi\" uri=\"";
+	appendEscaped(mDocument, listUri);
+	mDocument += "\" version=\"";
+	mDocument += to_string(version);
+	mDocument += fullState ? "\" fullState=\"true\">" : "\" fullState=\"false\">";
+}
+
+void RlmiWriter::addResource(const string& uri, const string& name, const string& cid) {
+	if (mFinished) return;
+	mDocument += "<resource uri=\"";
+	appendEscaped(mDocument, uri);
+	mDocument += "\">";
+	if (!name.empty()) {
+		mDocument += "<name>";
+		appendEscaped(mDocument, name);
+		mDocument += "</name>";
+	}
+	if (!cid.empty()) {
+		mDocument += "<instance id=\"1\" state=\"active\" cid=\"";
+		appendEscaped(mDocument, cid);
+		mDocument += "\"/>";
+	}
+	mDocument += "</resource>";
+	mResourceCount++;
+}
+
+const string& RlmiWriter::finish() {
+	if (!mFinished) {
+		mDocument += "</list>\n";
+		mFinished = true;
+	}
+	return mDocument;
+}
+
+} // namespace flexisip
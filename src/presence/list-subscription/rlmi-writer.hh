@@ -0,0 +1,57 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace flexisip {
+
+/**
+ * Writer of the RLMI document of a list NOTIFY (RFC 4662), appending the resources one after the other instead of
+ * building the XSD object model of the whole list.
+ * Instances are always in the active state, as no other state is implemented by the presence server.
+ */
+class RlmiWriter {
+public:
+	RlmiWriter(const std::string& listUri, std::uint32_t version, bool fullState);
+
+	/**
+	 * @param name Name of the resource, omitted if empty.
+	 * @param cid Content-ID of the body part holding the state of the resource. If empty, the resource is written
+	 * without instance.
+	 */
+	void addResource(const std::string& uri, const std::string& name, const std::string& cid = "");
+
+	unsigned getResourceCount() const {
+		return mResourceCount;
+	}
+
+	/**
+	 * Close the document and return it. No resource may be added afterwards.
+	 */
+	const std::string& finish();
+
+private:
+	std::string mDocument{};
+	unsigned mResourceCount = 0;
+	bool mFinished = false;
+};
+
+} // namespace flexisip
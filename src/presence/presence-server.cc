@@ -30,11 +30,16 @@
 #include "utils/thread/auto-thread-pool.hh"
 
 #include "bellesip-signaling-exception.hh"
+#include "cluster/presence-cluster.hh"
+#if ENABLE_REDIS
+#include "cluster/redis-presence-store.hh"
+#endif
 #include "list-subscription/body-list-subscription.hh"
 #if ENABLE_SOCI
 #include "list-subscription/external-list-subscription.hh"
 #endif
 #include "presentity-presenceinformation.hh"
+#include "streaming-pidf.hh"
 #include "subscription.hh"
 #include "utils/belle-sip-utils.hh"
 #include "xml/pidf+xml.hh"
@@ -66,6 +71,30 @@ PresenceServer::Init::Init() {
 	     ""},
 	    {Integer, "rls-database-max-thread", "Max number of threads.", "50"},
 	    {Integer, "rls-database-max-thread-queue-size", "Max legnth of threads queue.", "50"},
+	    {Integer, "rls-database-cache-expire",
+	     "Duration in seconds during which the resource lists fetched from the database are kept in memory, so that "
+	     "the subscriptions to the same list don't execute the request again. A list can be forgotten before with "
+	     "the 'RLS_CACHE INVALIDATE' command of the CLI. 0 disables the cache.",
+	     "300"},
+	    {Boolean, "rls-database-update-on-refresh",
+	     "Fetch the resource list again on each refresh of a subscription, and only add or remove the resources "
+	     "which changed since the previous fetch. The list is taken from the cache if it still holds it.",
+	     "false"},
+	    {StringList, "cluster-nodes",
+	     "SIP URIs of all the nodes of a cluster of presence servers, as given to the 'presence-server-cluster' "
+	     "parameter of the Presence module of the proxies. Each presentity is owned by a node, which receives its "
+	     "PUBLISH requests and shares its state with the other nodes through Redis. Empty disables the cluster.",
+	     ""},
+	    {String, "cluster-local-node", "The URI of this node, as written in 'cluster-nodes'.", ""},
+	    {String, "cluster-redis-server-domain", "Domain of the Redis server sharing the presentities of the cluster.",
+	     "localhost"},
+	    {Integer, "cluster-redis-server-port", "Port of the Redis server sharing the presentities of the cluster.",
+	     "6379"},
+	    {String, "cluster-redis-auth-password", "Password of the Redis server, if it requires one.", ""},
+	    {Integer, "cluster-state-expire",
+	     "Duration in seconds during which the state of a presentity stays in Redis after its last change. It must "
+	     "be longer than the expiration of the PUBLISH requests.",
+	     "3600"},
 	    {String, "soci-user-with-phone-request",
 	     "Soci SQL request used to obtain the username associated with a phone alias.\n"
 	     "The string MUST contains the ':phone' keyword which will be replaced by the phone number to look for.\n"
@@ -83,6 +112,20 @@ PresenceServer::Init::Init() {
 	     "flexisip to work.\n"
 	     "Example: select login, domain, phone from accounts where phone in (:phones)",
 	     ""},
+	    {Integer, "phone-alias-batch-max-size",
+	     "When 'soci-users-with-phones-request' is set, the phone aliases looked up by all the subscriptions are "
+	     "gathered in batches, each resolved by a single request. Maximum number of phone aliases per batch.",
+	     "100"},
+	    {Integer, "phone-alias-batch-max-delay",
+	     "Maximum time in milliseconds a phone alias lookup waits for other lookups to join its batch.", "20"},
+	    {Integer, "phone-alias-cache-size",
+	     "Maximum number of phone aliases resolved from the database kept in memory, the least recently used ones "
+	     "being forgotten first. 0 disables the cache.",
+	     "100000"},
+	    {Integer, "phone-alias-cache-expire",
+	     "Duration in seconds during which the user found for a phone alias is kept in memory.", "1800"},
+	    {Integer, "phone-alias-cache-negative-expire",
+	     "Duration in seconds during which a phone alias without user is remembered as such. 0 disables it.", "60"},
 
 	    // Hidden parameters
 	    {String, "bypass-condition", "If user agent contains it, can bypass extended notifiy verification.", "false"},
@@ -105,8 +148,22 @@ PresenceServer::Init::Init() {
 	auto s = GenericManager::get()->getRoot()->addChild(move(uS));
 	s->addChildrenValues(items);
 
+	s->createStat("count-phone-alias-batch-requests", "Number of requests resolving a batch of phone aliases.");
+	s->createStat("count-phone-alias-coalesced-lookups",
+	              "Number of phone alias lookups which waited for the result of an identical lookup being run.");
+	s->createStat("count-pidf-cache-hits", "Number of NOTIFY bodies taken from the PIDF document cache.");
+	s->createStat("count-pidf-cache-misses", "Number of PIDF documents serialized because they were not cached.");
+	s->createStat("count-presentities", "Number of presentities in memory.");
+	s->createStat("presentities-bytes", "Estimation of the memory used by the presentities, in bytes.");
+	s->createStat("presentity-average-bytes", "Estimation of the average memory used by a presentity, in bytes.");
+	s->createStat("count-cluster-published-states",
+	              "Number of states of the presentities owned by this node written to the cluster store.");
+	s->createStat("count-cluster-received-states",
+	              "Number of states of presentities owned by other nodes received from the cluster store.");
+
 	s->get<ConfigString>("bypass-condition")->setExportable(false);
 	s->get<ConfigBoolean>("leak-detector")->setExportable(false);
+	s->get<ConfigString>("cluster-redis-auth-password")->setExportable(false);
 
 	auto sociConnectionString = s->get<ConfigString>("soci-connection-string");
 	sociConnectionString->setDeprecated({"2020-06-02", "2.0.0", "Renamed into 'rls-database-connection'"});
@@ -161,6 +218,11 @@ PresenceServer::PresenceServer(const std::shared_ptr<sofiasip::SuRoot>& root) :
 	mBypass = config->get<ConfigString>("bypass-condition")->read();
 	mEnabled = config->get<ConfigBoolean>("enabled")->read();
 	mRequest = config->get<ConfigString>("rls-database-request")->read();
+	mStats.countPidfCacheHits = config->get<StatCounter64>("count-pidf-cache-hits");
+	mStats.countPidfCacheMisses = config->get<StatCounter64>("count-pidf-cache-misses");
+	mStats.countPresentities = config->get<StatCounter64>("count-presentities");
+	mStats.presentitiesBytes = config->get<StatCounter64>("presentities-bytes");
+	mStats.presentityAverageBytes = config->get<StatCounter64>("presentity-average-bytes");
 
 	if (mRequest.empty()) return;
 
@@ -169,6 +231,8 @@ PresenceServer::PresenceServer(const std::shared_ptr<sofiasip::SuRoot>& root) :
 
 	mThreadPool = make_unique<AutoThreadPool>(maxThreads, maxQueueSize);
 #if ENABLE_SOCI
+	mResourceListCache = make_shared<ResourceListCache>(config->get<ConfigInt>("rls-database-cache-expire")->read());
+	mUpdateListsOnRefresh = config->get<ConfigBoolean>("rls-database-update-on-refresh")->read();
 	const string& connectionString = config->get<ConfigString>("rls-database-connection")->read();
 	mConnPool = new soci::connection_pool(maxThreads);
 
@@ -189,6 +253,10 @@ static void remove_listening_point(belle_sip_listening_point_t* lp, belle_sip_pr
 }
 
 PresenceServer::~PresenceServer() {
+	// The copies of the remote presentities don't need to be updated anymore.
+	mCluster.reset();
+	if (mTimerWheelTicker) belle_sip_source_cancel(mTimerWheelTicker.get());
+	mTimerWheelTicker.reset();
 	belle_sip_provider_clean_channels(mProvider);
 	const belle_sip_list_t* lps = belle_sip_provider_get_listening_points(mProvider);
 	belle_sip_list_t* tmp_list = belle_sip_list_copy(lps);
@@ -264,6 +332,37 @@ void PresenceServer::_init() {
 				throw FLEXISIP_EXCEPTION << "Cannot add lp for [" << transport << "]";
 		}
 	}
+
+	const auto* config = cr->get<GenericStruct>("presence-server");
+	const auto clusterNodes = config->get<ConfigStringList>("cluster-nodes")->read();
+	if (!clusterNodes.empty()) {
+		const auto& localNode = config->get<ConfigString>("cluster-local-node")->read();
+		if (find(clusterNodes.begin(), clusterNodes.end(), localNode) == clusterNodes.end()) {
+			throw FLEXISIP_EXCEPTION << "'cluster-local-node' [" << localNode << "] is not one of 'cluster-nodes'";
+		}
+#if ENABLE_REDIS
+		auto store = make_unique<RedisPresenceStore>(
+		    mRoot, config->get<ConfigString>("cluster-redis-server-domain")->read(),
+		    config->get<ConfigInt>("cluster-redis-server-port")->read(),
+		    config->get<ConfigString>("cluster-redis-auth-password")->read());
+		mCluster = make_unique<PresenceCluster>(clusterNodes, localNode, move(store),
+		                                        config->get<ConfigInt>("cluster-state-expire")->read());
+		mCluster->setStats({config->get<StatCounter64>("count-cluster-published-states"),
+		                    config->get<StatCounter64>("count-cluster-received-states")});
+		SLOGI << "Presence server is the node [" << localNode << "] of a cluster of " << clusterNodes.size()
+		      << " nodes";
+#else
+		throw FLEXISIP_EXCEPTION << "'cluster-nodes' is set but Flexisip is built without Redis support";
+#endif
+	}
+
+	mTimerWheelTicker = belle_sip_main_loop_create_cpp_timeout(
+	    belle_sip_stack_get_main_loop(mStack),
+	    [this](unsigned int) {
+		    mTimerWheel.tick();
+		    return BELLE_SIP_CONTINUE;
+	    },
+	    1000, "presence timer wheel");
 }
 
 void PresenceServer::_run() {
@@ -498,15 +597,20 @@ void PresenceServer::processPublishRequestEvent(const belle_sip_request_event_t*
 	// At that point, we are safe
 
 	if (belle_sip_message_get_body_size(BELLE_SIP_MESSAGE(request)) > 0) {
-		unique_ptr<Xsd::Pidf::Presence> presence_body = nullptr;
-		try {
-			istringstream data(belle_sip_message_get_body(BELLE_SIP_MESSAGE(request)));
-			presence_body = Xsd::Pidf::parsePresence(data, Xsd::XmlSchema::Flags::dont_validate);
-		} catch (const Xsd::XmlSchema::Exception& e) {
-			ostringstream os;
-			os << "Cannot parse body caused by [" << e << "]";
-			// todo check error code
-			throw BELLESIP_SIGNALING_EXCEPTION_1(400, belle_sip_header_create("Warning", os.str().c_str())) << os.str();
+		const char* body = belle_sip_message_get_body(BELLE_SIP_MESSAGE(request));
+		// The bodies of the usual clients are parsed without building a DOM, the XSD parser handles the other ones.
+		auto presence_body = StreamingPidf::parse(body, belle_sip_message_get_body_size(BELLE_SIP_MESSAGE(request)));
+		if (!presence_body) {
+			try {
+				istringstream data(body);
+				presence_body = Xsd::Pidf::parsePresence(data, Xsd::XmlSchema::Flags::dont_validate);
+			} catch (const Xsd::XmlSchema::Exception& e) {
+				ostringstream os;
+				os << "Cannot parse body caused by [" << e << "]";
+				// todo check error code
+				throw BELLESIP_SIGNALING_EXCEPTION_1(400, belle_sip_header_create("Warning", os.str().c_str()))
+				    << os.str();
+			}
 		}
 
 		// check entity
@@ -530,6 +634,14 @@ void PresenceServer::processPublishRequestEvent(const belle_sip_request_event_t*
 		} else {
 			SLOGD << "Presentity [" << *presenceInfo << "] found";
 		}
+		if (mCluster && !mCluster->isLocal(entity.get())) {
+			SLOGW << "Presentity [" << *presenceInfo << "] is owned by another node of the cluster, check that the "
+			      << "proxies use the same nodes in 'presence-server-cluster'";
+			if (presenceInfo->isRemote()) {
+				mCluster->unwatch(*presenceInfo);
+				presenceInfo->setRemote(false);
+			}
+		}
 		eTag = eTag.empty()
 		           ? presenceInfo->putTuples(presence_body->getTuple(), presence_body->getPerson().get(), expires)
 		           : presenceInfo->updateTuples(presence_body->getTuple(), presence_body->getPerson().get(), eTag,
@@ -743,7 +855,7 @@ void PresenceServer::processSubscribeRequestEvent(const belle_sip_request_event_
 
 					listSubscription = make_shared<ExternalListSubscription>(
 					    expires, server_transaction, mProvider, mMaxPresenceInfoNotifiedAtATime, listAvailableLambda,
-					    mRequest, mConnPool, mThreadPool.get());
+					    mRequest, mConnPool, mThreadPool.get(), mResourceListCache);
 #else
 					goto error;
 #endif
@@ -844,6 +956,25 @@ void PresenceServer::processSubscribeRequestEvent(const belle_sip_request_event_
 						listener->enableBypass(bypass); // expiration is handled by dialog
 					}
 					addOrUpdateListeners(listSubscription->getListeners(), expires);
+#if ENABLE_SOCI
+					auto externalListSubscription = dynamic_pointer_cast<ExternalListSubscription>(subscription);
+					if (externalListSubscription && mUpdateListsOnRefresh) {
+						externalListSubscription->reloadList(
+						    [this, bypass, listSubscription](ExternalListSubscription::ListenerList& added,
+						                                     ExternalListSubscription::ListenerList& removed) {
+							    SLOGD << "List of subscription [" << listSubscription << "] updated: " << added.size()
+							          << " resource(s) added, " << removed.size() << " removed";
+							    for (const auto& listener : removed) {
+								    removeListener(listener);
+							    }
+							    for (auto& listener : added) {
+								    listener->enableBypass(bypass);
+							    }
+							    addOrUpdateListeners(added);
+							    listSubscription->notify(true);
+						    });
+					}
+#endif
 				}
 			}
 			break;
@@ -870,6 +1001,21 @@ void PresenceServer::addPresenceInfo(const shared_ptr<PresentityPresenceInformat
 	mPresenceInformations[presenceInfo->getEntity()] = presenceInfo;
 }
 
+void PresenceServer::watchIfRemote(const shared_ptr<PresentityPresenceInformation>& presenceInfo) {
+	if (!mCluster || mCluster->isLocal(presenceInfo->getEntity())) return;
+	presenceInfo->setRemote(true);
+	mCluster->watch(presenceInfo);
+}
+
+void PresenceServer::onPresentityChanged(PresentityPresenceInformation& presenceInfo) {
+	if (!mCluster || !mCluster->isLocal(presenceInfo.getEntity())) return;
+	if (presenceInfo.isKnown()) {
+		mCluster->publish(presenceInfo.getEntity(), *presenceInfo.getPidf(false), *presenceInfo.getPidf(true));
+	} else {
+		mCluster->remove(presenceInfo.getEntity());
+	}
+}
+
 void PresenceServer::addPresenceInfoObserver(const shared_ptr<PresenceInfoObserver>& observer) {
 	mPresenceInfoObservers.push_back(observer);
 }
@@ -929,6 +1075,7 @@ void PresenceServer::addOrUpdateListener(shared_ptr<PresentityPresenceInformatio
 		                                                          belle_sip_stack_get_main_loop(mStack));
 		SLOGD << "New Presentity [" << *presenceInfo << "] created from SUBSCRIBE";
 		addPresenceInfo(presenceInfo);
+		watchIfRemote(presenceInfo);
 	}
 
 	// notify observers that a listener is added or updated
@@ -970,6 +1117,7 @@ void PresenceServer::addOrUpdateListeners(list<shared_ptr<PresentityPresenceInfo
 			                                                          belle_sip_stack_get_main_loop(mStack));
 			SLOGD << "New Presentity [" << *presenceInfo << "] created from SUBSCRIBE";
 			addPresenceInfo(presenceInfo);
+			watchIfRemote(presenceInfo);
 		}
 
 		presenceInfo->addListenerIfNecessary(listener);
@@ -1005,6 +1153,7 @@ void PresenceServer::removeListener(const shared_ptr<PresentityPresenceInformati
 		presenceInfo->removeListener(listener);
 		if (presenceInfo->getNumberOfListeners() == 0 && presenceInfo->getNumberOfInformationElements() == 0) {
 			SLOGD << "Presentity [" << *presenceInfo << "] no longer referenced by any SUBSCRIBE nor PUBLISH, removing";
+			if (presenceInfo->isRemote()) mCluster->unwatch(*presenceInfo);
 			mPresenceInformations.erase(presenceInfo->getEntity());
 		}
 	} else
@@ -24,6 +24,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "belle-sip/mainloop.h"
 #include "belle-sip/sip-uri.h"
 
 #include "bellesip-signaling-exception.hh"
@@ -51,6 +52,8 @@ namespace flexisip {
 class Subscription;
 class PresentityPresenceInformation;
 class Listener;
+class PresenceCluster;
+class ResourceListCache;
 
 // Purpose of this class is to be notify when a presence info is created or when a new listener is added for a presence
 // info. Used by long term presence
@@ -74,6 +77,10 @@ public:
 	belle_sip_main_loop_t* getBelleSipMainLoop();
 	void addPresenceInfoObserver(const std::shared_ptr<PresenceInfoObserver>& observer);
 	void removePresenceInfoObserver(const std::shared_ptr<PresenceInfoObserver>& observer);
+	// nullptr if the resource lists are not fetched from a database
+	const std::shared_ptr<ResourceListCache>& getResourceListCache() const {
+		return mResourceListCache;
+	}
 
 private:
 	// Used to declare the service configuration
@@ -92,7 +99,13 @@ private:
 #if ENABLE_SOCI
 	soci::connection_pool* mConnPool = nullptr;
 #endif
+	std::shared_ptr<ResourceListCache> mResourceListCache{};
+	// Set when the presence server is a node of a cluster.
+	std::unique_ptr<PresenceCluster> mCluster{};
+	bool mUpdateListsOnRefresh = false;
 	std::unique_ptr<ThreadPool> mThreadPool{};
+	// Drives the timer wheel of the presentities.
+	BelleSipSourcePtr mTimerWheelTicker{};
 	bool mEnabled;
 	size_t mMaxPresenceInfoNotifiedAtATime;
 
@@ -131,6 +144,9 @@ private:
 	 * */
 	std::shared_ptr<PresentityPresenceInformation> getPresenceInfo(const belle_sip_uri_t* identity) const;
 	void addPresenceInfo(const std::shared_ptr<PresentityPresenceInformation>&);
+	// Keep a presentity created for a subscriber up to date with the node owning it, if it isn't this one.
+	void watchIfRemote(const std::shared_ptr<PresentityPresenceInformation>& presenceInfo);
+	void onPresentityChanged(PresentityPresenceInformation& presenceInfo) override;
 
 	void invalidateETag(const std::string& eTag) override;
 	void modifyEtag(const std::string& oldEtag, const std::string& newEtag) override;
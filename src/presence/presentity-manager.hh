@@ -20,19 +20,49 @@
 
 #include "etag-manager.hh"
 #include "string"
+#include "utils/timer-wheel.hh"
+#include <flexisip/configmanager.hh>
 #include <flexisip/flexisip-exception.hh>
 
 namespace flexisip {
+class PresentityPresenceInformation;
 class PresentityPresenceInformationListener;
 
+// Statistics updated by the presentities. The counters may be null.
+struct PresenceStats {
+	StatCounter64 *countPidfCacheHits = nullptr;
+	StatCounter64 *countPidfCacheMisses = nullptr;
+	StatCounter64 *countPresentities = nullptr;
+	StatCounter64 *presentitiesBytes = nullptr;
+	StatCounter64 *presentityAverageBytes = nullptr;
+
+	// Account for presentities created or deleted, and for the change of the memory they use.
+	void updatePresentities(int64_t countDelta, int64_t bytesDelta) const {
+		if (!countPresentities || !presentitiesBytes || !presentityAverageBytes) return;
+		countPresentities->set(countPresentities->read() + countDelta);
+		presentitiesBytes->set(presentitiesBytes->read() + bytesDelta);
+		const auto count = countPresentities->read();
+		presentityAverageBytes->set(count ? presentitiesBytes->read() / count : 0);
+	}
+};
+
 class PresentityManager : public EtagManager {
 	public:
+		const PresenceStats &getStats() const {return mStats;}
+		// Shared by the expiration timers of the published presence information, ticking every second.
+		TimerWheel &getTimerWheel() {return mTimerWheel;}
 		//fixme splitting into function add and function update will avoid to iterate on subscriber list
 		virtual void addOrUpdateListener(std::shared_ptr<PresentityPresenceInformationListener> &listerner, int expires) = 0;
 		//timerless version of addOrUpdateListener
 		virtual void addOrUpdateListener(std::shared_ptr<PresentityPresenceInformationListener> &listerner) = 0;
 		void addListenerIfNecessary(std::shared_ptr<PresentityPresenceInformationListener> &listerner);
 		virtual void removeListener(const std::shared_ptr<PresentityPresenceInformationListener> &listerner) = 0;
+		// called each time the listeners of a presentity are notified of a change of its local presence information
+		virtual void onPresentityChanged(PresentityPresenceInformation &presenceInformation) {}
+
+	protected:
+		PresenceStats mStats{};
+		TimerWheel mTimerWheel{};
 };
 
 }
@@ -28,6 +28,7 @@
 #include "etag-manager.hh"
 #include "presentity-manager.hh"
 #include "presentity-presenceinformation.hh"
+#include "streaming-pidf.hh"
 #include "utils/string-utils.hh"
 #include "xml/data-model.hh"
 #include "xml/pidf+xml.hh"
@@ -47,8 +48,7 @@ FlexisipException &operator<<(FlexisipException &e, const Xsd::XmlSchema::Except
 	return e;
 }
 
-PresenceInformationElement::PresenceInformationElement(const belle_sip_uri_t *contact)
-	: mDomDocument(::xsd::cxx::xml::dom::create_document<char>()) {
+PresenceInformationElement::PresenceInformationElement(const belle_sip_uri_t *contact) {
 	char *contact_as_string = belle_sip_uri_to_string(contact);
 	time_t t;
 	time(&t);
@@ -59,12 +59,11 @@ PresenceInformationElement::PresenceInformationElement(const belle_sip_uri_t *co
 	tup->setTimestamp(Xsd::XmlSchema::DateTime(now->tm_year + 1900, now->tm_mon + 1, now->tm_mday, now->tm_hour,
 											 now->tm_min, now->tm_sec));
 	tup->setContact(Xsd::Pidf::Contact(contact_as_string));
-	mTuples.clear(); // just in case
-	mTuples.push_back(unique_ptr<Xsd::Pidf::Tuple>(tup.release()));
+	mTuples.emplace_back(move(tup));
 	Xsd::Rpid::Activities act = Xsd::Rpid::Activities();
 	act.getAway().push_back(Xsd::Rpid::Empty());
-	mPerson.setId(generate_presence_id());
-	mPerson.getActivities().push_back(act);
+	mPersonId = generate_presence_id();
+	mActivities.emplace_back(act);
 	belle_sip_free(contact_as_string);
 }
 
@@ -74,6 +73,8 @@ PresentityPresenceInformation::PresentityPresenceInformation(const belle_sip_uri
 	  mBelleSipMainloop(mainloop) {
 	belle_sip_object_ref(mainloop);
 	belle_sip_object_ref((void *)mEntity);
+	mReportedMemoryUsage = getMemoryUsage();
+	mPresentityManager.getStats().updatePresentities(1, mReportedMemoryUsage);
 }
 
 PresenceInformationElement::~PresenceInformationElement() {
@@ -85,6 +86,7 @@ PresentityPresenceInformation::~PresentityPresenceInformation() {
 		delete it->second;
 	}
 	mInformationElements.clear();
+	mPresentityManager.getStats().updatePresentities(-1, -static_cast<int64_t>(mReportedMemoryUsage));
 	belle_sip_object_unref((void *)mEntity);
 	belle_sip_object_unref((void *)mBelleSipMainloop);
 	SLOGD << "Presence information [" << this << "] deleted";
@@ -119,10 +121,6 @@ string PresentityPresenceInformation::updateTuples(Xsd::Pidf::Presence::TupleSeq
 												   int expires) {
 	return setOrUpdate(&tuples, &person, &eTag, expires);
 }
-void PresenceInformationElement::clearTuples() {
-	mTuples.clear();
-}
-
 string PresentityPresenceInformation::setOrUpdate(Xsd::Pidf::Presence::TupleSequence *tuples,
 												  Xsd::DataModel::Person  *person, const string *eTag,
 												  int expires) {
@@ -153,7 +151,7 @@ string PresentityPresenceInformation::setOrUpdate(Xsd::Pidf::Presence::TupleSequ
 	}
 
 	if (!informationElement) { // create a new one if needed
-		informationElement = new PresenceInformationElement(tuples, person, mBelleSipMainloop);
+		informationElement = new PresenceInformationElement(tuples, person);
 		SLOGD << "Creating presence information element [" << informationElement << "]  for presentity [" << *this
 			  << "]";
 	}
@@ -166,26 +164,15 @@ string PresentityPresenceInformation::setOrUpdate(Xsd::Pidf::Presence::TupleSequ
 	informationElement->setEtag(generatedETag);
 
 	// cb function to invalidate an unrefreshed etag;
-	auto func = [this, generatedETag](unsigned int events) {
+	auto func = [this, generatedETag]() {
 		// find information element
 		this->removeTuplesForEtag(generatedETag);
 		mPresentityManager.invalidateETag(generatedETag);
 		SLOGD << "eTag [" << generatedETag << "] has expired";
-		return BELLE_SIP_STOP;
 	};
 
-	constexpr unsigned int valMax = numeric_limits<unsigned int>::max() / 1000U;
-	unsigned int expiresMs = (static_cast<unsigned int>(expires) > valMax) ? numeric_limits<unsigned int>::max() : static_cast<unsigned int>(expires) * 1000U;
-
-	// create timer
-	auto timer = belle_sip_main_loop_create_cpp_timeout(
-		mBelleSipMainloop,
-		func,
-		expiresMs,
-		"timer for presence Info"
-	);
-
-	// set expiration timer
+	// set expiration timer, on the wheel shared by all the presentities
+	auto timer = mPresentityManager.getTimerWheel().createTimer(chrono::seconds(max(expires, 0)), move(func));
 	informationElement->setExpiresTimer(move(timer));
 
 	// modify global etag list
@@ -199,6 +186,10 @@ string PresentityPresenceInformation::setOrUpdate(Xsd::Pidf::Presence::TupleSequ
 	// modify etag list for this presenceInfo
 	mInformationElements[generatedETag] = informationElement;
 
+	// a refresh doesn't change the presence information
+	if (tuples) invalidatePidf();
+	updateMemoryUsage();
+
 	// triger notify on all listeners
 	notifyAll();
 	SLOGD << "Etag [" << generatedETag << "] associated to Presentity [" << *this << "]";
@@ -212,12 +203,10 @@ string PresentityPresenceInformation::refreshTuplesForEtag(const string &eTag, i
 void PresentityPresenceInformation::setDefaultElement(const char *contact) {
 	mDefaultInformationElement = make_shared<PresenceInformationElement>(getEntity());
 
-	if (contact) {
-		for (auto &tup : mDefaultInformationElement->getTuples()) {
-			tup->setContact(Xsd::Pidf::Contact(contact));
-		}
-	}
+	if (contact) mDefaultInformationElement->setContact(contact);
 
+	invalidatePidf();
+	updateMemoryUsage();
 	notifyAll();
 }
 
@@ -227,6 +216,8 @@ void PresentityPresenceInformation::removeTuplesForEtag(const string &eTag) {
 		PresenceInformationElement *informationElement = it->second;
 		mInformationElements.erase(it);
 		delete informationElement;
+		invalidatePidf();
+		updateMemoryUsage();
 		notifyAll(); // Removing an event state change global state, so it should be notified
 	} else
 		SLOGD << "No tuples found for etag [" << eTag << "]";
@@ -325,8 +316,12 @@ void PresentityPresenceInformation::removeListener(const shared_ptr<PresentityPr
 void PresentityPresenceInformation::addCapability(const std::string &capability) {
 	if (mCapabilities.empty()) {
 		mCapabilities = capability;
+		invalidatePidf();
+		updateMemoryUsage();
 	} else if (mCapabilities.find(capability) == mCapabilities.npos) {
 		mCapabilities += ", " + capability;
+		invalidatePidf();
+		updateMemoryUsage();
 		notifyAll();
 	}
 }
@@ -335,9 +330,71 @@ bool PresentityPresenceInformation::hasDefaultElement() {
 	return !!mDefaultInformationElement;
 }
 bool PresentityPresenceInformation::isKnown() {
-	return mInformationElements.size() > 0 || hasDefaultElement();
+	return mInformationElements.size() > 0 || hasDefaultElement() || mRemoteKnown;
+}
+void PresentityPresenceInformation::setRemote(bool remote) {
+	if (mRemote == remote) return;
+	mRemote = remote;
+	mRemoteKnown = false;
+	mVersion++;
+	mPidfCache.fill(nullptr);
+	updateMemoryUsage();
+}
+void PresentityPresenceInformation::setRemoteState(const shared_ptr<const string> &pidf,
+												   const shared_ptr<const string> &extendedPidf) {
+	if (!mRemote) return;
+	mRemoteKnown = pidf != nullptr;
+	mVersion++;
+	mPidfCache = {pidf, extendedPidf ? extendedPidf : pidf};
+	updateMemoryUsage();
+	notifyAll();
+}
+shared_ptr<const string> PresentityPresenceInformation::getPidf(bool extended) {
+	const auto &stats = mPresentityManager.getStats();
+	auto &pidf = mPidfCache[extended];
+	if (pidf) {
+		if (stats.countPidfCacheHits) stats.countPidfCacheHits->incr();
+		return pidf;
+	}
+	if (stats.countPidfCacheMisses) stats.countPidfCacheMisses->incr();
+	pidf = make_shared<const string>(buildPidf(extended));
+	updateMemoryUsage();
+	return pidf;
 }
-string PresentityPresenceInformation::getPidf(bool extended) {
+
+void PresentityPresenceInformation::invalidatePidf() {
+	// The documents of a remote presentity only change with the state of its owner.
+	if (mRemote && mRemoteKnown) return;
+	mVersion++;
+	mPidfCache.fill(nullptr);
+}
+
+size_t PresentityPresenceInformation::getMemoryUsage() const {
+	auto usage = sizeof(*this) + getHeapUsage(mName) + getHeapUsage(mCapabilities);
+	for (const auto &element : mInformationElements) {
+		// node of the map and etag
+		usage += sizeof(element) + 4 * sizeof(void *) + getHeapUsage(element.first);
+		usage += element.second->getMemoryUsage();
+	}
+	if (mDefaultInformationElement) usage += mDefaultInformationElement->getMemoryUsage();
+	for (const auto &capability : mAddedCapabilities) {
+		usage += sizeof(capability) + 4 * sizeof(void *);
+		usage += getHeapUsage(capability.first) + getHeapUsage(capability.second);
+	}
+	for (const auto &pidf : mPidfCache) {
+		if (pidf) usage += sizeof(*pidf) + getHeapUsage(*pidf);
+	}
+	return usage;
+}
+
+void PresentityPresenceInformation::updateMemoryUsage() {
+	const auto usage = getMemoryUsage();
+	const auto delta = static_cast<int64_t>(usage) - static_cast<int64_t>(mReportedMemoryUsage);
+	mPresentityManager.getStats().updatePresentities(0, delta);
+	mReportedMemoryUsage = usage;
+}
+
+string PresentityPresenceInformation::buildPidf(bool extended) {
 	stringstream out;
 	try {
 		char *entity = belle_sip_uri_to_string(getEntity());
@@ -347,29 +404,28 @@ string PresentityPresenceInformation::getPidf(bool extended) {
 		if(extended) {
 			for (const auto &element : mInformationElements) {
 				// copy pidf
-				for (const unique_ptr<Xsd::Pidf::Tuple> &tup : element.second->getTuples()) {
+				for (const CompactTuple &tup : element.second->getTuples()) {
 					// check for multiple tupple id, may happend with buggy presence publisher
-					if (find(tupleList.begin(), tupleList.end(), tup.get()->getId()) == tupleList.end()) {
-						presence.getTuple().push_back(*tup);
-						tupleList.push_back(tup.get()->getId());
+					if (find(tupleList.begin(), tupleList.end(), tup.getId()) == tupleList.end()) {
+						presence.getTuple().push_back(tup.unpack());
+						tupleList.push_back(tup.getId());
 					} else {
-						SLOGW << "Already existing tuple id [" << tup.get()->getId() << " for [" << *this << "], skipping";
+						SLOGW << "Already existing tuple id [" << tup.getId() << " for [" << *this << "], skipping";
 					}
 				}
 				// copy extensions
-				Xsd::DataModel::Person dm_person = element.second->getPerson();
-				for(Xsd::DataModel::Person::ActivitiesIterator activity = dm_person.getActivities().begin(); activity != dm_person.getActivities().end();activity++) {
+				for (const CompactActivities &activities : element.second->getActivities()) {
 					if(!presence.getPerson()) {
-						Xsd::DataModel::Person person = Xsd::DataModel::Person(dm_person.getId());
+						Xsd::DataModel::Person person = Xsd::DataModel::Person(element.second->getPersonId());
 						presence.setPerson(person);
 					}
-					presence.getPerson()->getActivities().push_back(*activity);
+					presence.getPerson()->getActivities().push_back(activities.unpack());
 				}
 			}
 		}
 		if (mDefaultInformationElement) {
 			// inserting default tuple
-			Xsd::Pidf::Tuple *tup = mDefaultInformationElement->getTuples().begin()->get();
+			auto tup = mDefaultInformationElement->getTuples().front().unpack();
 			auto predicate = [](char c){ return ::isspace(c) || c == '"'; };
 			mCapabilities.erase(remove_if(mCapabilities.begin(), mCapabilities.end(), predicate), mCapabilities.end());
 			vector<string> capabilityVector = StringUtils::split(mCapabilities, ",");
@@ -398,17 +454,16 @@ string PresentityPresenceInformation::getPidf(bool extended) {
 				if (it == tup->getServiceDescription().end())
 					tup->getServiceDescription().push_back(service);
 			}
-			presence.getTuple().push_back(*tup);
+			presence.getTuple().push_back(move(tup));
 
 			// copy extensions of default element, only if no elements were given previously.
 			if (mInformationElements.empty()) {
-				Xsd::DataModel::Person dm_person = mDefaultInformationElement->getPerson();
-				for(Xsd::DataModel::Person::ActivitiesIterator activity = dm_person.getActivities().begin(); activity != dm_person.getActivities().end();activity++) {
+				for (const CompactActivities &activities : mDefaultInformationElement->getActivities()) {
 					if (!presence.getPerson()) {
-						Xsd::DataModel::Person person = Xsd::DataModel::Person(dm_person.getId());
+						Xsd::DataModel::Person person = Xsd::DataModel::Person(mDefaultInformationElement->getPersonId());
 						presence.setPerson(person);
 					}
-					presence.getPerson()->getActivities().push_back(*activity);
+					presence.getPerson()->getActivities().push_back(activities.unpack());
 				}
 			}
 			
@@ -422,8 +477,11 @@ string PresentityPresenceInformation::getPidf(bool extended) {
 			presence.getNote().push_back(value);
 		}
 
-		// Serialize the object model to XML.
+		// Serialize the object model to XML, through the DOM only for the content the streaming writer doesn't handle.
 		//
+		string pidf{};
+		if (StreamingPidf::serialize(presence, pidf)) return pidf;
+
 		Xsd::XmlSchema::NamespaceInfomap map;
 		map[""].name = "urn:ietf:params:xml:ns:pidf";
 
@@ -439,6 +497,7 @@ string PresentityPresenceInformation::getPidf(bool extended) {
 }
 
 void PresentityPresenceInformation::notifyAll() {
+	if (!mRemote) mPresentityManager.onPresentityChanged(*this);
 	forEachSubscriber(
 		[this](const shared_ptr<PresentityPresenceInformationListener> &listener) {
 			listener->onInformationChanged(*this, listener->extendedNotifyEnabled());
@@ -488,34 +547,21 @@ void PresentityPresenceInformationListener::enableBypass(bool enable) {
 
 // PresenceInformationElement
 
-PresenceInformationElement::PresenceInformationElement(
-	Xsd::Pidf::Presence::TupleSequence *tuples,
-	Xsd::DataModel::Person *person,
-	belle_sip_main_loop_t *mainLoop
-) :
-	mDomDocument(::xsd::cxx::xml::dom::create_document<char>()),
-	mBelleSipMainloop(mainLoop)
-{
+PresenceInformationElement::PresenceInformationElement(Xsd::Pidf::Presence::TupleSequence *tuples,
+													   Xsd::DataModel::Person *person) {
+	mTuples.reserve(tuples->size());
 	for (Xsd::Pidf::Presence::TupleSequence::iterator tupleIt = tuples->begin(); tupleIt != tuples->end();) {
 		SLOGD << "Adding tuple id [" << tupleIt->getId() << "] to presence info element [" << this << "]";
 		unique_ptr<Xsd::Pidf::Tuple> r;
 		tupleIt = tuples->detach(tupleIt, r);
-		mTuples.push_back(unique_ptr<Xsd::Pidf::Tuple>(r.release()));
+		mTuples.emplace_back(move(r));
 	}
-	if(person) {
-		for(Xsd::DataModel::Person::ActivitiesIterator activity = person->getActivities().begin(); activity != person->getActivities().end();activity++) {
-			mPerson.getActivities().push_back(*activity);
+	if (person) {
+		mActivities.reserve(person->getActivities().size());
+		for (const auto &activities : person->getActivities()) {
+			mActivities.emplace_back(activities);
 		}
 	}
-
-	/*for (Xsd::Pidf::Presence::PersonType::iterator domElement = extensions->begin(); domElement != extensions->end();
-		 domElement++) {
-		char * transcodedString = xercesc::XMLString::transcode(domElement->getNodeName());
-		SLOGD << "Adding extension element  [" << transcodedString
-			  << "] to presence info element [" << this << "]";
-		xercesc::XMLString::release(&transcodedString);
-		mExtensions.push_back(dynamic_cast<xercesc::DOMElement *>(mDomDocument->importNode(&*domElement, true)));
-	}*/
 }
 
 static string generate_presence_id(void) {
@@ -535,25 +581,25 @@ static string generate_presence_id(void) {
 	return id;
 }
 
-const unique_ptr<Xsd::Pidf::Tuple> &PresenceInformationElement::getTuple(const string &id) const {
-	for (const unique_ptr<Xsd::Pidf::Tuple> &tup : mTuples) {
-		if (tup->getId().compare(id) == 0)
-			return tup;
+void PresenceInformationElement::setContact(const string &contact) {
+	for (auto &tup : mTuples) {
+		tup.setContact(contact);
 	}
-	throw FLEXISIP_EXCEPTION << "No tuple found for id [" << id << "]";
-}
-const list<unique_ptr<Xsd::Pidf::Tuple>> &PresenceInformationElement::getTuples() const {
-	return mTuples;
 }
-const Xsd::DataModel::Person PresenceInformationElement::getPerson() const {
-	return mPerson;
-}
-/*	void PresenceInformationElement::addTuple(pidf::Tuple* tup) {
-		mTuples.push_back(tup);
+
+size_t PresenceInformationElement::getMemoryUsage() const {
+	auto usage = sizeof(*this) + getHeapUsage(mPersonId) + getHeapUsage(mEtag);
+	usage += (mTuples.capacity() - mTuples.size()) * sizeof(CompactTuple);
+	for (const auto &tup : mTuples) {
+		usage += tup.getMemoryUsage();
 	}
-	void PresenceInformationElement::removeTuple(pidf::Tuple* tup) {
-		mTuples.remove(tup);
-	}*/
+	usage += (mActivities.capacity() - mActivities.size()) * sizeof(CompactActivities);
+	for (const auto &activities : mActivities) {
+		usage += activities.getMemoryUsage();
+	}
+	return usage;
+}
+
 const string &PresenceInformationElement::getEtag() {
 	return mEtag;
 }
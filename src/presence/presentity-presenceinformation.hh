@@ -18,11 +18,16 @@
 
 #pragma once
 
+#include <array>
 #include <list>
 #include <map>
+#include <memory>
+#include <vector>
 
 #include <flexisip/flexisip-exception.hh>
 
+#include "compact-presence.hh"
+#include "utils/timer-wheel.hh"
 #include "xml/pidf+xml.hh"
 
 typedef struct _belle_sip_uri belle_sip_uri_t;
@@ -42,37 +47,36 @@ struct BelleSipSourceCancelingDeleter {
 };
 
 class PresentityManager;
+/*
+ * Presence information published with a given eTag. The tuples and activities are stored in a packed form and turned
+ * back into XSD objects only when a PIDF document is built.
+ */
 class PresenceInformationElement {
   public:
-	/* Re-definition of BelleSipSourcePtr in order to use BelleSipSourceCancelingDeleter as deleter */
-	using BelleSipSourcePtr = std::unique_ptr<belle_sip_source_t, BelleSipSourceCancelingDeleter>;
-
-	PresenceInformationElement(Xsd::Pidf::Presence::TupleSequence *tuples, Xsd::DataModel::Person *person,
-							   belle_sip_main_loop_t *mainLoop);
+	PresenceInformationElement(Xsd::Pidf::Presence::TupleSequence *tuples, Xsd::DataModel::Person *person);
 	// create an information element with a default tuple set to closed.
 	PresenceInformationElement(const belle_sip_uri_t *contact);
 	~PresenceInformationElement();
 
-	time_t getExpitationTime() const;
+	void setExpiresTimer(TimerWheel::Timer &&timer) {mTimer = std::move(timer);}
 
-	template <typename T>
-	void setExpiresTimer(T &&timer) {mTimer = std::forward<T>(timer);}
-
-	const std::unique_ptr<Xsd::Pidf::Tuple> &getTuple(const std::string &id) const;
-	const std::list<std::unique_ptr<Xsd::Pidf::Tuple>> &getTuples() const;
-	const Xsd::DataModel::Person getPerson() const;
-	// void addTuple(pidf::Tuple*);
-	// void removeTuple(pidf::Tuple*);
-	void clearTuples();
+	const std::vector<CompactTuple> &getTuples() const {return mTuples;}
+	const std::vector<CompactActivities> &getActivities() const {return mActivities;}
+	const std::string &getPersonId() const {return mPersonId;}
+	void setContact(const std::string &contact);
 	const std::string &getEtag();
 	void setEtag(const std::string &eTag);
 
+	/*
+	 * Estimation of the memory used by the element, in bytes.
+	 */
+	size_t getMemoryUsage() const;
+
   private:
-	std::list<std::unique_ptr<Xsd::Pidf::Tuple>> mTuples;
-	Xsd::DataModel::Person mPerson{""};
-	Xsd::XmlSchema::dom::unique_ptr<xercesc::DOMDocument> mDomDocument; // needed to store extension nodes
-	belle_sip_main_loop_t *mBelleSipMainloop = nullptr;
-	BelleSipSourcePtr mTimer;
+	std::vector<CompactTuple> mTuples;
+	std::string mPersonId;
+	std::vector<CompactActivities> mActivities;
+	TimerWheel::Timer mTimer;
 	std::string mEtag;
 };
 /*
@@ -182,15 +186,38 @@ class PresentityPresenceInformation : public std::enable_shared_from_this<Presen
 	void removeListener(const std::shared_ptr<PresentityPresenceInformationListener> &listener);
 
 	/*
-	 * return the presence information for this entity in a pidf serilized format
+	 * return the presence information for this entity in a pidf serilized format.
+	 * The document is serialized once per version of the presence information and shared by all the listeners.
+	 */
+	std::shared_ptr<const std::string> getPidf(bool extended);
+
+	/*
+	 * return the version of the presence information, incremented each time the tuples or capabilities change
 	 */
-	std::string getPidf(bool extended);
+	uint64_t getVersion() const { return mVersion; }
+
+	/*
+	 * return an estimation of the memory used by the presence information, cached pidf included
+	 */
+	size_t getMemoryUsage() const;
 
 	/*
 	 * return true if a presence info is already known from a publish
 	 */
 	bool isKnown();
 
+	/*
+	 * Turn the presence information into a copy of a presentity owned by another node of a presence cluster, whose
+	 * pidf documents are given by setRemoteState(). Local publications are not notified while set.
+	 */
+	void setRemote(bool remote);
+	bool isRemote() const { return mRemote; }
+	/*
+	 * replace the pidf documents of a remote presentity and notify the listeners. Null documents mean that the owner
+	 * knows nothing about the presentity.
+	 */
+	void setRemoteState(const std::shared_ptr<const std::string> &pidf, const std::shared_ptr<const std::string> &extendedPidf);
+
 	/*
 	 * return true if a presence info has a default presence value previously set by setDefaultElement
 	 */
@@ -224,6 +251,16 @@ class PresentityPresenceInformation : public std::enable_shared_from_this<Presen
 	std::string setOrUpdate(Xsd::Pidf::Presence::TupleSequence *tuples, Xsd::DataModel::Person *, const std::string *eTag,
 					   int expires);
 
+	std::string buildPidf(bool extended);
+	/*
+	 * to be called on each change of the published presence information
+	 */
+	void invalidatePidf();
+	/*
+	 * report the change of the memory used by this presentity to the statistics
+	 */
+	void updateMemoryUsage();
+
 	/*
 	 *Notify all listener
 	 */
@@ -246,6 +283,14 @@ class PresentityPresenceInformation : public std::enable_shared_from_this<Presen
 	std::string mName;
 	std::string mCapabilities;
 	std::map<std::string, std::string> mAddedCapabilities;
+	uint64_t mVersion = 0;
+	// serialized pidf of the current version, indexed by 'extended'
+	std::array<std::shared_ptr<const std::string>, 2> mPidfCache{};
+	// memory usage last reported to the statistics
+	size_t mReportedMemoryUsage = 0;
+	bool mRemote = false;
+	// the owner of the remote presentity has a state for it
+	bool mRemoteKnown = false;
 };
 
 std::ostream &operator<<(std::ostream &__os, const PresentityPresenceInformation &);
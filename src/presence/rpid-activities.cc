@@ -0,0 +1,53 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "rpid-activities.hh"
+
+namespace flexisip {
+
+using Activities = Xsd::Rpid::Activities;
+
+const std::array<RpidEmptyActivity, 24> rpidEmptyActivities = {{
+    {"appointment", &Activities::getAppointment, &Activities::getAppointment},
+    {"away", &Activities::getAway, &Activities::getAway},
+    {"breakfast", &Activities::getBreakfast, &Activities::getBreakfast},
+    {"busy", &Activities::getBusy, &Activities::getBusy},
+    {"dinner", &Activities::getDinner, &Activities::getDinner},
+    {"holiday", &Activities::getHoliday, &Activities::getHoliday},
+    {"in-transit", &Activities::getInTransit, &Activities::getInTransit},
+    {"looking-for-work", &Activities::getLookingForWork, &Activities::getLookingForWork},
+    {"meal", &Activities::getMeal, &Activities::getMeal},
+    {"meeting", &Activities::getMeeting, &Activities::getMeeting},
+    {"on-the-phone", &Activities::getOnThePhone, &Activities::getOnThePhone},
+    {"performance", &Activities::getPerformance, &Activities::getPerformance},
+    {"permanent-absence", &Activities::getPermanentAbsence, &Activities::getPermanentAbsence},
+    {"playing", &Activities::getPlaying, &Activities::getPlaying},
+    {"presentation", &Activities::getPresentation, &Activities::getPresentation},
+    {"shopping", &Activities::getShopping, &Activities::getShopping},
+    {"sleeping", &Activities::getSleeping, &Activities::getSleeping},
+    {"spectator", &Activities::getSpectator, &Activities::getSpectator},
+    {"steering", &Activities::getSteering, &Activities::getSteering},
+    {"travel", &Activities::getTravel, &Activities::getTravel},
+    {"tv", &Activities::getTv, &Activities::getTv},
+    {"vacation", &Activities::getVacation, &Activities::getVacation},
+    {"working", &Activities::getWorking, &Activities::getWorking},
+    {"worship", &Activities::getWorship, &Activities::getWorship},
+}};
+
+} // namespace flexisip
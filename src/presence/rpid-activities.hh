@@ -0,0 +1,42 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <array>
+
+#include "xml/rpid.hh"
+
+namespace flexisip {
+
+/**
+ * The RPID activities without content, such as <rpid:away/>, in the order of the schema.
+ */
+struct RpidEmptyActivity {
+	using Activities = Xsd::Rpid::Activities;
+	using Sequence = Activities::AwaySequence;
+
+	const char* name;
+	const Sequence& (Activities::*get)() const;
+	Sequence& (Activities::*getMutable)();
+};
+
+extern const std::array<RpidEmptyActivity, 24> rpidEmptyActivities;
+
+} // namespace flexisip
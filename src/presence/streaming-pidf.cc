@@ -0,0 +1,465 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <sstream>
+
+#include "utils/xml-pull-parser.hh"
+#include "xml/data-model.hh"
+#include "xml/pidf-oma-pres.hh"
+#include "xml/rpid.hh"
+
+#include "rpid-activities.hh"
+#include "streaming-pidf.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+namespace {
+
+constexpr const char* sPidfNs = "urn:ietf:params:xml:ns:pidf";
+constexpr const char* sDataModelNs = "urn:ietf:params:xml:ns:pidf:data-model";
+constexpr const char* sRpidNs = "urn:ietf:params:xml:ns:pidf:rpid";
+constexpr const char* sOmaPresNs = "urn:oma:xml:prs:pidf:oma-pres";
+constexpr const char* sXmlNs = "http://www.w3.org/XML/1998/namespace";
+
+using Activities = Xsd::Rpid::Activities;
+
+/*
+ * Build the object model while pulling the events of the parser. Each read method is called on the StartElement event
+ * of its element and returns after having consumed the matching EndElement event.
+ */
+class PidfBuilder {
+public:
+	PidfBuilder(const char* data, size_t size) : mParser(data, size) {
+	}
+
+	unique_ptr<Xsd::Pidf::Presence> build() {
+		if (mParser.next() != XmlPullParser::Event::StartElement || !mParser.isElement(sPidfNs, "presence")) {
+			return nullptr;
+		}
+		StringView entity{};
+		if (!checkAttributes("", "entity", &entity) || entity.data == nullptr) return nullptr;
+
+		auto presence = make_unique<Xsd::Pidf::Presence>(Xsd::Pidf::Presence::EntityType(entity.trim().str()));
+		while (nextChild()) {
+			if (mParser.isElement(sPidfNs, "tuple")) {
+				auto tuple = readTuple();
+				if (!tuple) return nullptr;
+				presence->getTuple().push_back(move(tuple));
+			} else if (mParser.isElement(sPidfNs, "note")) {
+				auto note = readNote<Xsd::Pidf::Note>();
+				if (!note) return nullptr;
+				presence->getNote().push_back(move(note));
+			} else if (mParser.isElement(sDataModelNs, "person") && !presence->getPerson()) {
+				auto person = readPerson();
+				if (!person) return nullptr;
+				presence->setPerson(move(person));
+			} else {
+				return nullptr;
+			}
+		}
+		if (mError || mParser.next() != XmlPullParser::Event::EndDocument) return nullptr;
+		return presence;
+	}
+
+private:
+	/*
+	 * Move to the next child element of the current element.
+	 * Return false once the end of the current element is reached, or on error.
+	 */
+	bool nextChild() {
+		while (true) {
+			switch (mParser.next()) {
+				case XmlPullParser::Event::StartElement:
+					return true;
+				case XmlPullParser::Event::EndElement:
+					return false;
+				case XmlPullParser::Event::Text:
+					if (mParser.getText().isBlank()) continue;
+					mError = true;
+					return false;
+				default:
+					mError = true;
+					return false;
+			}
+		}
+	}
+
+	/*
+	 * Read the content of an element made of text only.
+	 */
+	bool readText(StringView& text) {
+		text = StringView{};
+		while (true) {
+			switch (mParser.next()) {
+				case XmlPullParser::Event::Text:
+					// Text split by a comment.
+					if (text.data) return false;
+					text = mParser.getText();
+					break;
+				case XmlPullParser::Event::EndElement:
+					return true;
+				default:
+					return false;
+			}
+		}
+	}
+
+	bool readEmpty() {
+		StringView text{};
+		return checkAttributes() && readText(text) && text.isBlank();
+	}
+
+	/*
+	 * Check that the current element has no other attribute than the given one, and get its value.
+	 */
+	bool checkAttributes(const char* ns = nullptr, const char* name = nullptr, StringView* value = nullptr) {
+		for (const auto& attribute : mParser.getAttributes()) {
+			if (name == nullptr || attribute.ns != ns || attribute.name != name) return false;
+			*value = attribute.value;
+		}
+		return true;
+	}
+
+	template <typename NoteT>
+	unique_ptr<NoteT> readNote() {
+		StringView lang{}, text{};
+		if (!checkAttributes(sXmlNs, "lang", &lang) || !readText(text)) return nullptr;
+		auto note = make_unique<NoteT>(text.str());
+		if (lang.data) note->setLang(typename NoteT::LangType(lang.trim().str()));
+		return note;
+	}
+
+	unique_ptr<Xsd::XmlSchema::DateTime> readDateTime() {
+		StringView text{};
+		if (!checkAttributes() || !readText(text)) return nullptr;
+		// Only check the layout of the value, as the XSD parser doesn't report errors for it.
+		const auto value = text.trim().str();
+		if (value.size() < 19 || value[4] != '-' || value[7] != '-' || value[10] != 'T' || value[13] != ':' ||
+		    value[16] != ':') {
+			return nullptr;
+		}
+		return make_unique<Xsd::XmlSchema::DateTime>(value, nullptr);
+	}
+
+	unique_ptr<Xsd::Pidf::Tuple> readTuple() {
+		StringView id{};
+		if (!checkAttributes("", "id", &id) || id.data == nullptr) return nullptr;
+
+		auto tuple = make_unique<Xsd::Pidf::Tuple>(Xsd::Pidf::Status(), id.trim().str());
+		bool hasStatus = false;
+		while (nextChild()) {
+			if (mParser.isElement(sPidfNs, "status") && !hasStatus) {
+				if (!readStatus(tuple->getStatus())) return nullptr;
+				hasStatus = true;
+			} else if (mParser.isElement(sPidfNs, "contact") && !tuple->getContact()) {
+				StringView priority{}, uri{};
+				if (!checkAttributes("", "priority", &priority) || !readText(uri)) return nullptr;
+				auto contact = make_unique<Xsd::Pidf::Contact>(Xsd::XmlSchema::Uri(uri.trim().str()));
+				if (priority.data) {
+					const auto value = priority.trim().str();
+					char* end = nullptr;
+					const auto q = strtod(value.c_str(), &end);
+					if (value.empty() || *end != '\0' || q < 0 || q > 1) return nullptr;
+					contact->setPriority(Xsd::Pidf::Qvalue(q));
+				}
+				tuple->setContact(move(contact));
+			} else if (mParser.isElement(sPidfNs, "note")) {
+				auto note = readNote<Xsd::Pidf::Note>();
+				if (!note) return nullptr;
+				tuple->getNote().push_back(move(note));
+			} else if (mParser.isElement(sPidfNs, "timestamp") && !tuple->getTimestamp()) {
+				auto timestamp = readDateTime();
+				if (!timestamp) return nullptr;
+				tuple->setTimestamp(move(timestamp));
+			} else if (mParser.isElement(sOmaPresNs, "service-description")) {
+				auto service = readServiceDescription();
+				if (!service) return nullptr;
+				tuple->getServiceDescription().push_back(move(service));
+			} else {
+				return nullptr;
+			}
+		}
+		if (mError || !hasStatus) return nullptr;
+		return tuple;
+	}
+
+	bool readStatus(Xsd::Pidf::Status& status) {
+		if (!checkAttributes()) return false;
+		while (nextChild()) {
+			StringView basic{};
+			if (!mParser.isElement(sPidfNs, "basic") || status.getBasic() || !checkAttributes() || !readText(basic)) {
+				return false;
+			}
+			const auto value = basic.trim();
+			if (value != "open" && value != "closed") return false;
+			status.setBasic(Xsd::Pidf::Basic(value.str()));
+		}
+		return !mError;
+	}
+
+	unique_ptr<Xsd::Pidf::Tuple::ServiceDescriptionType> readServiceDescription() {
+		if (!checkAttributes()) return nullptr;
+		StringView serviceId{}, version{}, description{};
+		bool hasDescription = false;
+		while (nextChild()) {
+			if (mParser.isElement(sOmaPresNs, "service-id") && serviceId.data == nullptr) {
+				if (!checkAttributes() || !readText(serviceId) || serviceId.data == nullptr) return nullptr;
+			} else if (mParser.isElement(sOmaPresNs, "version") && version.data == nullptr) {
+				if (!checkAttributes() || !readText(version) || version.data == nullptr) return nullptr;
+			} else if (mParser.isElement(sOmaPresNs, "description") && !hasDescription) {
+				if (!checkAttributes() || !readText(description)) return nullptr;
+				hasDescription = true;
+			} else {
+				return nullptr;
+			}
+		}
+		if (mError || serviceId.data == nullptr || version.data == nullptr) return nullptr;
+
+		auto service =
+		    make_unique<Xsd::Pidf::Tuple::ServiceDescriptionType>(serviceId.trim().str(), version.trim().str());
+		if (hasDescription) {
+			service->setDescription(Xsd::Pidf::Tuple::ServiceDescriptionType::DescriptionType(description.trim().str()));
+		}
+		return service;
+	}
+
+	unique_ptr<Xsd::DataModel::Person> readPerson() {
+		StringView id{};
+		if (!checkAttributes("", "id", &id) || id.data == nullptr) return nullptr;
+
+		auto person = make_unique<Xsd::DataModel::Person>(id.trim().str());
+		while (nextChild()) {
+			if (mParser.isElement(sDataModelNs, "note")) {
+				auto note = readNote<Xsd::DataModel::Note_t>();
+				if (!note) return nullptr;
+				person->getNote().push_back(move(note));
+			} else if (mParser.isElement(sRpidNs, "activities")) {
+				auto activities = readActivities();
+				if (!activities) return nullptr;
+				person->getActivities().push_back(move(activities));
+			} else if (mParser.isElement(sDataModelNs, "timestamp") && !person->getTimestamp()) {
+				auto timestamp = readDateTime();
+				if (!timestamp) return nullptr;
+				person->setTimestamp(Xsd::DataModel::Timestamp_t(*timestamp));
+			} else {
+				return nullptr;
+			}
+		}
+		if (mError) return nullptr;
+		return person;
+	}
+
+	unique_ptr<Activities> readActivities() {
+		if (!checkAttributes()) return nullptr;
+
+		auto activities = make_unique<Activities>();
+		while (nextChild()) {
+			if (mParser.getNamespace() != sRpidNs) return nullptr;
+			if (mParser.getName() == "note") {
+				auto note = readNote<Xsd::Rpid::Note_t>();
+				if (!note) return nullptr;
+				activities->getNote().push_back(move(note));
+			} else if (mParser.getName() == "other") {
+				auto other = readNote<Xsd::Rpid::Note_t>();
+				if (!other) return nullptr;
+				activities->getOther().push_back(move(other));
+			} else if (mParser.getName() == "unknown" && !activities->getUnknown()) {
+				if (!readEmpty()) return nullptr;
+				activities->setUnknown(Xsd::Rpid::Empty());
+			} else {
+				auto activity =
+				    find_if(rpidEmptyActivities.begin(), rpidEmptyActivities.end(),
+				            [this](const RpidEmptyActivity& activity) { return mParser.getName() == activity.name; });
+				if (activity == rpidEmptyActivities.end() || !readEmpty()) return nullptr;
+				((*activities).*(activity->getMutable))().push_back(Xsd::Rpid::Empty());
+			}
+		}
+		if (mError) return nullptr;
+		return activities;
+	}
+
+	XmlPullParser mParser;
+	bool mError = false;
+};
+
+void escape(ostream& out, const string& value) {
+	for (auto c : value) {
+		switch (c) {
+			case '&':
+				out << "&amp;";
+				break;
+			case '<':
+				out << "&lt;";
+				break;
+			case '>':
+				out << "&gt;";
+				break;
+			case '"':
+				out << "&quot;";
+				break;
+			default:
+				out << c;
+		}
+	}
+}
+
+template <typename NoteT>
+void writeNote(ostream& out, const char* tag, const NoteT& note) {
+	out << "<" << tag;
+	if (note.getLang()) {
+		out << " xml:lang=\"";
+		escape(out, *note.getLang());
+		out << "\"";
+	}
+	out << ">";
+	escape(out, note);
+	out << "</" << tag << ">";
+}
+
+// Tell whether the object model only holds what the writer supports, that is what the parser accepts.
+bool isSupported(const Xsd::Pidf::Presence& presence) {
+	for (const auto& tuple : presence.getTuple()) {
+		if (!tuple.getStatus().getAny().empty()) return false;
+		for (const auto& service : tuple.getServiceDescription()) {
+			if (!service.getAny().empty() || !service.getAnyAttribute().empty()) return false;
+		}
+	}
+	if (presence.getPerson()) {
+		const auto& person = *presence.getPerson();
+		if (!person.getAnyAttribute().empty()) return false;
+		for (const auto& activities : person.getActivities()) {
+			if (!activities.getAny().empty() || !activities.getAnyAttribute().empty() || activities.getId() ||
+			    activities.getFrom() || activities.getUntil()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void writeTuple(ostream& out, const Xsd::Pidf::Tuple& tuple) {
+	out << "<tuple id=\"";
+	escape(out, tuple.getId());
+	out << "\"><status>";
+	if (tuple.getStatus().getBasic()) {
+		out << "<basic>";
+		escape(out, *tuple.getStatus().getBasic());
+		out << "</basic>";
+	}
+	out << "</status>";
+	if (tuple.getContact()) {
+		const auto& contact = *tuple.getContact();
+		out << "<contact";
+		if (contact.getPriority()) out << " priority=\"" << static_cast<double>(*contact.getPriority()) << "\"";
+		out << ">";
+		escape(out, contact);
+		out << "</contact>";
+	}
+	for (const auto& note : tuple.getNote()) {
+		writeNote(out, "note", note);
+	}
+	if (tuple.getTimestamp()) out << "<timestamp>" << *tuple.getTimestamp() << "</timestamp>";
+	for (const auto& service : tuple.getServiceDescription()) {
+		out << "<oma-pres:service-description><oma-pres:service-id>";
+		escape(out, service.getServiceId());
+		out << "</oma-pres:service-id><oma-pres:version>";
+		escape(out, service.getVersion());
+		out << "</oma-pres:version>";
+		if (service.getDescription()) {
+			out << "<oma-pres:description>";
+			escape(out, *service.getDescription());
+			out << "</oma-pres:description>";
+		}
+		out << "</oma-pres:service-description>";
+	}
+	out << "</tuple>";
+}
+
+void writePerson(ostream& out, const Xsd::DataModel::Person& person) {
+	out << "<dm:person id=\"";
+	escape(out, person.getId());
+	out << "\">";
+	for (const auto& note : person.getNote()) {
+		writeNote(out, "dm:note", note);
+	}
+	for (const auto& activities : person.getActivities()) {
+		out << "<rpid:activities>";
+		for (const auto& note : activities.getNote()) {
+			writeNote(out, "rpid:note", note);
+		}
+		if (activities.getUnknown()) out << "<rpid:unknown/>";
+		for (const auto& activity : rpidEmptyActivities) {
+			for (size_t i = 0; i < (activities.*(activity.get))().size(); i++) {
+				out << "<rpid:" << activity.name << "/>";
+			}
+		}
+		for (const auto& other : activities.getOther()) {
+			writeNote(out, "rpid:other", other);
+		}
+		out << "</rpid:activities>";
+	}
+	if (person.getTimestamp()) out << "<dm:timestamp>" << *person.getTimestamp() << "</dm:timestamp>";
+	out << "</dm:person>";
+}
+
+} // namespace
+
+unique_ptr<Xsd::Pidf::Presence> StreamingPidf::parse(const char* data, size_t size) {
+	try {
+		return PidfBuilder{data, size}.build();
+	} catch (const Xsd::XmlSchema::Exception&) {
+		// Invalid value, let the XSD parser report it.
+		return nullptr;
+	}
+}
+
+bool StreamingPidf::serialize(const Xsd::Pidf::Presence& presence, string& out) {
+	if (!isSupported(presence)) return false;
+
+	bool hasServiceDescription = false;
+	for (const auto& tuple : presence.getTuple()) {
+		if (!tuple.getServiceDescription().empty()) hasServiceDescription = true;
+	}
+
+	ostringstream os{};
+	os << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+	os << "<presence xmlns=\"" << sPidfNs << "\"";
+	if (presence.getPerson()) os << " xmlns:dm=\"" << sDataModelNs << "\" xmlns:rpid=\"" << sRpidNs << "\"";
+	if (hasServiceDescription) os << " xmlns:oma-pres=\"" << sOmaPresNs << "\"";
+	os << " entity=\"";
+	escape(os, presence.getEntity());
+	os << "\">";
+	for (const auto& tuple : presence.getTuple()) {
+		writeTuple(os, tuple);
+	}
+	for (const auto& note : presence.getNote()) {
+		writeNote(os, "note", note);
+	}
+	if (presence.getPerson()) writePerson(os, *presence.getPerson());
+	os << "</presence>\n";
+
+	out = os.str();
+	return true;
+}
+
+} // namespace flexisip
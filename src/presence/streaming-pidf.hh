@@ -0,0 +1,50 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "xml/pidf+xml.hh"
+
+namespace flexisip {
+
+/**
+ * Parser and writer of PIDF documents going without the Xerces DOM, for the part of PIDF, RPID and of the data model
+ * used by the Linphone clients: tuples made of status, contact, notes, timestamp and service descriptions, notes, and a
+ * person made of notes, activities and timestamp.
+ * Both fail on any other content, so that the caller falls back to the XSD bindings.
+ */
+class StreamingPidf {
+public:
+	/**
+	 * Build the object model of a PIDF document.
+	 * @return nullptr if the document isn't well-formed or holds unsupported content.
+	 */
+	static std::unique_ptr<Xsd::Pidf::Presence> parse(const char* data, std::size_t size);
+
+	/**
+	 * Serialize a PIDF object model, with the PIDF namespace as default namespace.
+	 * @return false if the object model holds unsupported content, out being left untouched.
+	 */
+	static bool serialize(const Xsd::Pidf::Presence& presence, std::string& out);
+};
+
+} // namespace flexisip
@@ -143,7 +143,7 @@ void PresenceSubscription::onInformationChanged(PresentityPresenceInformation &p
 	belle_sip_header_content_type_t *content_type = NULL;
 	try {
 		if (getState() == active) {
-			body += presenceInformation.getPidf(extended);
+			body += *presenceInformation.getPidf(extended);
 			content_type = belle_sip_header_content_type_create("application", "pidf+xml");
 		}
 	} catch (FlexisipException &e) {
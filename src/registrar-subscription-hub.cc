@@ -0,0 +1,123 @@
+/*
+	Flexisip, a flexible SIP proxy server with media capabilities.
+	Copyright (C) 2010-2022  Belledonne Communications SARL, All rights reserved.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as
+	published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "flexisip/common.hh"
+#include "flexisip/logmanager.hh"
+
+#include "registrar-subscription-hub.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+RegistrarSubscriptionHub &RegistrarSubscriptionHub::get() {
+	static RegistrarSubscriptionHub sInstance{};
+	return sInstance;
+}
+
+void RegistrarSubscriptionHub::subscribe(const SipUri &aor, const shared_ptr<ContactRegisteredListener> &listener) {
+	const auto key = Record::defineKeyFromUrl(aor.get());
+	auto &topic = mTopics[key];
+	if (!topic) {
+		SLOGD << "RegistrarSubscriptionHub: subscribing to '" << key << "'";
+		topic = make_shared<Topic>(aor);
+		RegistrarDb::get()->subscribe(key, topic);
+	}
+	topic->addListener(listener);
+}
+
+void RegistrarSubscriptionHub::unsubscribe(const SipUri &aor, const shared_ptr<ContactRegisteredListener> &listener) {
+	const auto key = Record::defineKeyFromUrl(aor.get());
+	auto it = mTopics.find(key);
+	if (it == mTopics.end()) return;
+	if (it->second->removeListener(listener)) return;
+
+	SLOGD << "RegistrarSubscriptionHub: no more listener of '" << key << "', unsubscribing";
+	RegistrarDb::get()->unsubscribe(key, it->second);
+	mTopics.erase(it);
+}
+
+void RegistrarSubscriptionHub::Topic::addListener(const shared_ptr<ContactRegisteredListener> &listener) {
+	if (find(mListeners.cbegin(), mListeners.cend(), listener) == mListeners.cend()) {
+		mListeners.push_back(listener);
+	}
+	if (isRecordValid()) {
+		listener->onContactRegistered(mRecord, "");
+		return;
+	}
+	if (find(mPendingListeners.cbegin(), mPendingListeners.cend(), listener) == mPendingListeners.cend()) {
+		mPendingListeners.push_back(listener);
+	}
+	fetch();
+}
+
+bool RegistrarSubscriptionHub::Topic::removeListener(const shared_ptr<ContactRegisteredListener> &listener) {
+	mListeners.remove(listener);
+	mPendingListeners.remove(listener);
+	return !mListeners.empty();
+}
+
+bool RegistrarSubscriptionHub::Topic::isRecordValid() const {
+	if (!mRecord) return false;
+	const auto now = getCurrentTime();
+	const auto &contacts = mRecord->getExtendedContacts();
+	return none_of(contacts.cbegin(), contacts.cend(), [now](const auto &ec) { return ec->mExpireAt <= now; });
+}
+
+void RegistrarSubscriptionHub::Topic::fetch() {
+	if (mFetching) return;
+	mFetching = true;
+	RegistrarDb::get()->fetch(mAor, shared_from_this(), true);
+}
+
+void RegistrarSubscriptionHub::Topic::onRecordFound(const shared_ptr<Record> &r) {
+	mFetching = false;
+	auto record = r ?: make_shared<Record>(mAor);
+	// The listeners already knowing the record are only told about it if it has changed meanwhile.
+	const bool changed = !mRecord || !mRecord->isSame(*record);
+	mRecord = record;
+	auto listeners = changed ? mListeners : move(mPendingListeners);
+	mPendingListeners.clear();
+	notify(listeners, mRecord, "");
+}
+
+void RegistrarSubscriptionHub::Topic::onError() {
+	mFetching = false;
+	SLOGE << "RegistrarSubscriptionHub: failed to fetch the record of '" << mAor.str() << "'";
+	mPendingListeners.clear();
+}
+
+void RegistrarSubscriptionHub::Topic::onContactRegistered(const shared_ptr<Record> &r, const string &uid) {
+	mRecord = r;
+	mPendingListeners.clear();
+	notify(mListeners, mRecord, uid);
+}
+
+void RegistrarSubscriptionHub::Topic::notify(const list<shared_ptr<ContactRegisteredListener>> &listeners,
+                                             const shared_ptr<Record> &r,
+                                             const string &uid) {
+	/* The listeners may unsubscribe when called back: they are called from a copy of the list. */
+	const auto listenersCopy = listeners;
+	for (const auto &listener : listenersCopy) {
+		listener->onContactRegistered(r, uid);
+	}
+}
+
+} // namespace flexisip
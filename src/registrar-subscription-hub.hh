@@ -0,0 +1,97 @@
+/*
+	Flexisip, a flexible SIP proxy server with media capabilities.
+	Copyright (C) 2010-2022  Belledonne Communications SARL, All rights reserved.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as
+	published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <flexisip/registrardb.hh>
+
+namespace flexisip {
+
+/**
+ * Share the RegistrarDb subscription of an AOR between all the local listeners of this AOR (registration event
+ * subscriptions, conference participants...): each AOR is subscribed to and fetched once, whatever the number of
+ * listeners, which saves a Redis channel and a HGETALL per listener.
+ * The last record of the AOR is kept for the listeners joining afterwards, until the last listener leaves.
+ *
+ * The listeners are called back through onContactRegistered(), with an empty uid when the record comes from a fetch
+ * rather than from the registration of a contact. The record is never null.
+ * It must be used from the main thread only.
+ */
+class RegistrarSubscriptionHub {
+public:
+	static RegistrarSubscriptionHub &get();
+
+	/**
+	 * Add a listener of the AOR. It receives the current record, at once if the cached one is still valid, otherwise
+	 * once fetched, then each change of the record.
+	 * Subscribing a listener already subscribed makes it receive the current record again.
+	 */
+	void subscribe(const SipUri &aor, const std::shared_ptr<ContactRegisteredListener> &listener);
+	void unsubscribe(const SipUri &aor, const std::shared_ptr<ContactRegisteredListener> &listener);
+
+	std::size_t getTopicCount() const {
+		return mTopics.size();
+	}
+
+private:
+	class Topic : public ContactUpdateListener,
+	              public ContactRegisteredListener,
+	              public std::enable_shared_from_this<Topic> {
+	public:
+		Topic(const SipUri &aor) : mAor(aor) {}
+
+		void addListener(const std::shared_ptr<ContactRegisteredListener> &listener);
+		// Return whether listeners remain.
+		bool removeListener(const std::shared_ptr<ContactRegisteredListener> &listener);
+
+		void onRecordFound(const std::shared_ptr<Record> &r) override;
+		void onError() override;
+		void onInvalid() override {
+			onError();
+		}
+		void onContactUpdated(const std::shared_ptr<ExtendedContact> &ec) override {}
+		void onContactRegistered(const std::shared_ptr<Record> &r, const std::string &uid) override;
+
+	private:
+		// Whether the contacts of the cached record are all still registered.
+		bool isRecordValid() const;
+		void fetch();
+		static void notify(const std::list<std::shared_ptr<ContactRegisteredListener>> &listeners,
+		                   const std::shared_ptr<Record> &r,
+		                   const std::string &uid);
+
+		const SipUri mAor;
+		std::shared_ptr<Record> mRecord{};
+		bool mFetching = false;
+		std::list<std::shared_ptr<ContactRegisteredListener>> mListeners{};
+		// Listeners waiting for the record being fetched.
+		std::list<std::shared_ptr<ContactRegisteredListener>> mPendingListeners{};
+	};
+
+	RegistrarSubscriptionHub() = default;
+
+	// By record key.
+	std::unordered_map<std::string, std::shared_ptr<Topic>> mTopics{};
+};
+
+} // namespace flexisip
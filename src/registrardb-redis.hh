@@ -33,6 +33,7 @@
 #include "flexisip/registrardb.hh"
 #include "flexisip/sofia-wrapper/su-root.hh"
 
+#include "overload-control.hh"
 #include "recordserializer.hh"
 
 namespace flexisip {
@@ -100,6 +101,7 @@ struct RedisRegisterContext {
 	BindingParameters mBindingParameters;
 	std::string mUniqueIdToFetch;
 	bool mUpdateExpire = false;
+	BackendRequestGuard mBackendRequest{}; // The operation is pending until the context is deleted.
 
 	template <typename T>
 	RedisRegisterContext(RegistrarDbRedisAsync *s, T &&url, const std::shared_ptr<ContactUpdateListener> &listener) :
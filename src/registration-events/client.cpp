@@ -16,6 +16,7 @@
 	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -45,6 +46,7 @@ void Client::subscribe() {
 		LOGE("Already subscribed.");
 		return;
 	}
+	mFullStateReceived = false;
 	mSubscribeEvent = mFactory->getCore()->createSubscribe(mTo, "reg", 600);
 	mSubscribeEvent->addCustomHeader("Accept", "application/reginfo+xml");
 	mSubscribeEvent->setData(eventKey, *this);
@@ -76,44 +78,90 @@ void Client::setListener(ClientListener *listener){
 	mListener = listener;
 }
 
+void Client::resubscribe(){
+	unsubscribe();
+	subscribe();
+}
+
 void Client::onNotifyReceived(const std::shared_ptr<const linphone::Content> & body){
-	istringstream data(body->getUtf8Text());
+	processReginfo(body->getUtf8Text());
+}
+
+void Client::processReginfo(const string &document){
+	istringstream data(document);
 
 	unique_ptr<Reginfo> ri(parseReginfo(data, Xsd::XmlSchema::Flags::dont_validate));
 
+	const bool fullState = ri->getState() == State::Value::full;
+	if (!fullState) {
+		if (!mFullStateReceived || ri->getVersion() > mVersion + 1) {
+			// A notification has been lost: subscribe again to get the full state.
+			LOGW("RegistrationEvent::Client: missing notification before version %llu, subscribing again.",
+			     (unsigned long long)ri->getVersion());
+			resubscribe();
+			return;
+		}
+		if (ri->getVersion() <= mVersion) return; // Already received.
+	}
+	mFullStateReceived = true;
+	mVersion = ri->getVersion();
+	if (fullState) mDevices.clear();
+
 	for (const auto &registration : ri->getRegistration()) {
-		list<shared_ptr<ParticipantDeviceIdentity>> participantDevices;
 		size_t refreshed = 0;
+		size_t updated = 0;
 
 		for (const auto &contact : registration.getContact()) {
-			auto partDeviceAddr = Factory::get()->createAddress(contact.getUri());
-
-			Contact::UnknownParamSequence ups = contact.getUnknownParam();
-
-			for (const auto &param : ups) {
-				if (param.getName() != "+org.linphone.specs") continue;
-				string displayName = contact.getDisplayName() ? contact.getDisplayName()->c_str() : string("");
-				shared_ptr<ParticipantDeviceIdentity> identity = Factory::get()->createParticipantDeviceIdentity(partDeviceAddr, displayName);
-				identity->setCapabilityDescriptor(StringUtils::unquote(param));
-				
-				if (contact.getEvent() == reginfo::Event::refreshed){
-					if (mListener) mListener->onRefreshed(identity);
-					refreshed++;
+			auto device = find_if(mDevices.begin(), mDevices.end(), [&contact](const auto &entry) {
+				return entry.first == contact.getId();
+			});
+			shared_ptr<ParticipantDeviceIdentity> identity;
+			if (contact.getState() == Contact::StateType::active) identity = createDeviceIdentity(contact);
+			if (!identity) {
+				// The device has unregistered, or is not a participant device anymore.
+				if (device != mDevices.end()) {
+					mDevices.erase(device);
+					updated++;
 				}
-				participantDevices.push_back(identity);
-				break;
+				continue;
 			}
-		}
 
-		auto partAddr = Factory::get()->createAddress(registration.getAor());
+			if (contact.getEvent() == reginfo::Event::refreshed){
+				if (mListener) mListener->onRefreshed(identity);
+				refreshed++;
+			}
+			if (device == mDevices.end()) {
+				mDevices.emplace_back(contact.getId(), identity);
+				updated++;
+			} else {
+				device->second = identity;
+				if (contact.getEvent() != reginfo::Event::refreshed) updated++;
+			}
+		}
 
 		if (registration.getState() == Registration::StateType::terminated) {
-			participantDevices.clear(); // We'll notify that 0 devices are registered.
+			mDevices.clear(); // We'll notify that 0 devices are registered.
 		}
-		if (refreshed != participantDevices.size()){
+		// A full state only made of refreshed devices, or a partial state without change, is useless.
+		if (fullState ? refreshed != mDevices.size() : updated != 0) {
+			list<shared_ptr<ParticipantDeviceIdentity>> participantDevices;
+			for (const auto &device : mDevices) participantDevices.push_back(device.second);
 			if (mListener) mListener->onNotifyReceived(participantDevices);
-		}/*otherwise it's useless */
+		}
+	}
+}
+
+shared_ptr<ParticipantDeviceIdentity> Client::createDeviceIdentity(const Contact &contact) {
+	auto partDeviceAddr = Factory::get()->createAddress(contact.getUri());
+
+	for (const auto &param : contact.getUnknownParam()) {
+		if (param.getName() != "+org.linphone.specs") continue;
+		string displayName = contact.getDisplayName() ? contact.getDisplayName()->c_str() : string("");
+		shared_ptr<ParticipantDeviceIdentity> identity = Factory::get()->createParticipantDeviceIdentity(partDeviceAddr, displayName);
+		identity->setCapabilityDescriptor(StringUtils::unquote(param));
+		return identity;
 	}
+	return nullptr;
 }
 
 void Client::onSubscriptionStateChanged(linphone::SubscriptionState state){
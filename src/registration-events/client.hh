@@ -19,9 +19,16 @@
 #pragma once
 
 #include <iostream>
+#include <list>
+#include <string>
+#include <utility>
 
 #include <linphone++/linphone.hh>
 
+namespace reginfo {
+class Contact;
+}
+
 namespace flexisip {
 
 namespace RegistrationEvent {
@@ -69,19 +76,28 @@ private:
 class Client{
 friend class ClientFactory;
 	public:
-		~Client ();
+		virtual ~Client ();
 		void subscribe();
 		void unsubscribe();
 		void setListener(ClientListener *listener);
 	protected:
 		Client(const std::shared_ptr<ClientFactory> & factory, const std::shared_ptr<const linphone::Address> &to);
+		/* Apply a full or partial state to the known devices and notify the listener. */
+		void processReginfo(const std::string &document);
+		/* Called when a notification is missing, to get the full state again. */
+		virtual void resubscribe();
 	private:
 		void onNotifyReceived(const std::shared_ptr<const linphone::Content> & body);
 		void onSubscriptionStateChanged(linphone::SubscriptionState state);
+		static std::shared_ptr<linphone::ParticipantDeviceIdentity> createDeviceIdentity(const reginfo::Contact &contact);
 		std::shared_ptr<linphone::Event> mSubscribeEvent;
 		ClientListener *mListener = nullptr;
 		std::shared_ptr<ClientFactory> mFactory;
 		std::shared_ptr<linphone::Address> mTo;
+		// Devices of the last notified state, with the id of their contact. Partial states are applied to it.
+		std::list<std::pair<std::string, std::shared_ptr<linphone::ParticipantDeviceIdentity>>> mDevices;
+		unsigned long long mVersion = 0;
+		bool mFullStateReceived = false;
 		static constexpr const char *eventKey = "Regevent::Client";
 };
 
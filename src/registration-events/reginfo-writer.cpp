@@ -0,0 +1,118 @@
+/*
+	Flexisip, a flexible SIP proxy server with media capabilities.
+	Copyright (C) 2010-2022  Belledonne Communications SARL, All rights reserved.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as
+	published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "reginfo-writer.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+namespace RegistrationEvent {
+
+namespace {
+
+void appendEscaped(string& out, const string& value) {
+	for (auto c : value) {
+		switch (c) {
+			case '&':
+				out += "&amp;";
+				break;
+			case '<':
+				out += "&lt;";
+				break;
+			case '>':
+				out += "&gt;";
+				break;
+			case '"':
+				out += "&quot;";
+				break;
+			default:
+				out += c;
+		}
+	}
+}
+
+void appendHeader(string& out, uint32_t version, bool fullState) {
+	out += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
+	       "<reginfo xmlns=\"urn:ietf:params:xml:ns:reginfo\" version=\"";
+	out += to_string(version);
+	out += fullState ? "\" state=\"full\">" : "\" state=\"partial\">";
+}
+
+} // namespace
+
+void ReginfoWriter::appendContact(string& out, const ReginfoContact& contact, const char* state, const char* event) {
+	out += "<contact id=\"";
+	appendEscaped(out, contact.uri);
+	out += "\" state=\"";
+	out += state;
+	out += "\" event=\"";
+	out += event;
+	if (contact.expires >= 0) {
+		out += "\" expires=\"";
+		out += to_string(contact.expires);
+	}
+	out += "\"><uri>";
+	appendEscaped(out, contact.uri);
+	out += "</uri>";
+	if (!contact.displayName.empty()) {
+		out += "<display-name>";
+		appendEscaped(out, contact.displayName);
+		out += "</display-name>";
+	}
+	for (const auto& param : contact.unknownParams) {
+		out += "<unknown-param name=\"";
+		appendEscaped(out, param.first);
+		out += "\">";
+		appendEscaped(out, param.second);
+		out += "</unknown-param>";
+	}
+	out += "</contact>";
+}
+
+string ReginfoWriter::writeDocument(uint32_t version,
+                                    bool fullState,
+                                    const string& aor,
+                                    const string& id,
+                                    const char* registrationState,
+                                    const string& contacts) {
+	string document{};
+	document.reserve(256 + contacts.size());
+	appendHeader(document, version, fullState);
+	document += "<registration aor=\"";
+	appendEscaped(document, aor);
+	document += "\" id=\"";
+	appendEscaped(document, id);
+	document += "\" state=\"";
+	document += registrationState;
+	document += "\">";
+	document += contacts;
+	document += "</registration></reginfo>\n";
+	return document;
+}
+
+string ReginfoWriter::writeEmptyDocument(uint32_t version, bool fullState) {
+	string document{};
+	appendHeader(document, version, fullState);
+	document += "</reginfo>\n";
+	return document;
+}
+
+} // namespace RegistrationEvent
+
+} // namespace flexisip
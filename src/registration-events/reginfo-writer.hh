@@ -0,0 +1,79 @@
+/*
+	Flexisip, a flexible SIP proxy server with media capabilities.
+	Copyright (C) 2010-2022  Belledonne Communications SARL, All rights reserved.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as
+	published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace flexisip {
+
+namespace RegistrationEvent {
+
+/**
+ * Information about a contact of a registration, as written in a reginfo document (RFC 3680).
+ */
+struct ReginfoContact {
+	std::string uri{};
+	std::string displayName{};
+	int expires = -1; // Not written if negative.
+	std::vector<std::pair<std::string, std::string>> unknownParams{};
+
+	bool operator==(const ReginfoContact& other) const {
+		return uri == other.uri && displayName == other.displayName && expires == other.expires &&
+		       unknownParams == other.unknownParams;
+	}
+	bool operator!=(const ReginfoContact& other) const {
+		return !(*this == other);
+	}
+};
+
+/**
+ * Writer of the pieces of a reginfo document, instead of building the XSD object model of the whole registration for
+ * each NOTIFY. The contacts written once can be kept and concatenated into the bodies of the following notifications.
+ * The contact id is its URI.
+ */
+class ReginfoWriter {
+public:
+	/**
+	 * @param state "active" or "terminated".
+	 * @param event One of the contact events of RFC 3680 ("registered", "refreshed", "unregistered"...).
+	 */
+	static void appendContact(std::string& out, const ReginfoContact& contact, const char* state, const char* event);
+
+	/**
+	 * Write a whole document holding a single registration, whose contacts are already written in 'contacts'.
+	 * @param registrationState "active" or "terminated".
+	 */
+	static std::string writeDocument(std::uint32_t version,
+	                                 bool fullState,
+	                                 const std::string& aor,
+	                                 const std::string& id,
+	                                 const char* registrationState,
+	                                 const std::string& contacts);
+	/**
+	 * Write a document without registration.
+	 */
+	static std::string writeEmptyDocument(std::uint32_t version, bool fullState);
+};
+
+} // namespace RegistrationEvent
+
+} // namespace flexisip
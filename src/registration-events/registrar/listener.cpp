@@ -16,28 +16,29 @@
 	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <unordered_map>
+
 #include "registration-events/utils.hh"
 #include "utils/string-utils.hh"
-#include "xml/reginfo.hh"
-#include "xml/resource-lists.hh"
 
 #include "listener.hh"
 
 using namespace std;
-using namespace linphone;
-using namespace reginfo;
-using namespace flexisip::Xsd::ResourceLists;
-using namespace flexisip::Xsd::XmlSchema;
 
 namespace flexisip {
 
 namespace RegistrationEvent {
 namespace Registrar {
 
-Listener::Listener(const shared_ptr<linphone::Event> &lev): mEvent(lev) {}
+Listener::Listener(const string &aor, const string &id) : mAor(aor), mId(id) {}
+
+void Listener::addSubscription(const void *key, NotifyFunction &&notify) {
+	mSubscriptions.push_back(Subscription{key, move(notify)});
+}
 
-void Listener::onRecordFound(const shared_ptr<Record> &r) {
-	processRecord(r, "");
+void Listener::removeSubscription(const void *key) {
+	mSubscriptions.remove_if([key](const Subscription &subscription) { return subscription.key == key; });
 }
 
 void Listener::onContactRegistered(const shared_ptr<Record> &r, const string &uid) {
@@ -45,69 +46,92 @@ void Listener::onContactRegistered(const shared_ptr<Record> &r, const string &ui
 }
 
 void Listener::processRecord(const shared_ptr<Record> &r, const string &uidOfFreshlyRegistered) {
-	Reginfo ri(0, State::Value::full);
-
+	vector<ContactEntry> contacts{};
+	string freshlyRegisteredUri{};
 	if (r) {
-		Registration re = Registration(
-			Uri(mEvent->getTo()->asString().c_str()),
-			r->getKey().c_str(),
-			Registration::StateType::active
-		);
 		sofiasip::Home home;
-
 		for (const shared_ptr<ExtendedContact> &ec : r->getExtendedContacts()) {
 			auto addr = r->getPubGruu(ec, home.home());
-			bool justRegistered = (ec->getUniqueId() == uidOfFreshlyRegistered);
+			if (!addr) continue;
 
-			Contact contact(url_as_string(home.home(), addr), Contact::StateType::active,
-				justRegistered ?  Contact::EventType::refreshed : Contact::EventType::registered, url_as_string(home.home(), addr));
-
-			// expires
+			ContactEntry entry{};
+			entry.info.uri = url_as_string(home.home(), addr);
+			entry.info.displayName = RegistrationEvent::Utils::getDeviceName(ec);
 			if (ec->mSipContact->m_expires) {
-				contact.setExpires(atoi(ec->mSipContact->m_expires));
+				entry.info.expires = max(atoi(ec->mSipContact->m_expires), 0);
 			}
-
-			// unknown-params
 			if (ec->mSipContact->m_params) {
-				size_t i;
-
-				for (i = 0; ec->mSipContact->m_params[i]; i++) {
+				for (size_t i = 0; ec->mSipContact->m_params[i]; i++) {
 					vector<string> param = StringUtils::split(ec->mSipContact->m_params[i], "=");
-
-					auto unknownParam = UnknownParam(param.front());
-					if (param.size() == 2) {
-						unknownParam.append(StringUtils::unquote(param.back()));
-					}
-
-					contact.getUnknownParam().push_back(unknownParam);
+					entry.info.unknownParams.emplace_back(
+					    param.front(), param.size() == 2 ? StringUtils::unquote(param.back()) : string{});
 				}
 			}
+			ReginfoWriter::appendContact(entry.fragment, entry.info, "active", "registered");
 
-			contact.setDisplayName(RegistrationEvent::Utils::getDeviceName(ec));
-			re.getContact().push_back(contact);
-
-			// If there is some contacts, we set the sate to active
-			re.setState(Registration::StateType::active);
+			if (ec->getUniqueId() == uidOfFreshlyRegistered) freshlyRegisteredUri = entry.info.uri;
+			contacts.push_back(move(entry));
 		}
+	}
 
-		if (r->getExtendedContacts().size() == 0) {
-			re.setState(Registration::StateType::terminated);
+	// Contacts added or modified since the previous state, then the removed ones.
+	unordered_map<string, const ContactEntry *> previousContacts{};
+	for (const auto &entry : mContacts) previousContacts.emplace(entry.info.uri, &entry);
+	string changes{};
+	bool modified = !mRecordFetched || mRecordFound != (r != nullptr);
+	for (const auto &entry : contacts) {
+		auto it = previousContacts.find(entry.info.uri);
+		const bool changed = it == previousContacts.end() || it->second->info != entry.info;
+		if (it != previousContacts.end()) previousContacts.erase(it);
+		modified = modified || changed;
+
+		if (entry.info.uri == freshlyRegisteredUri) {
+			ReginfoWriter::appendContact(changes, entry.info, "active", "refreshed");
+		} else if (changed) {
+			changes += entry.fragment;
 		}
+	}
+	for (const auto &entry : mContacts) {
+		if (previousContacts.count(entry.info.uri) == 0) continue;
+		ReginfoWriter::appendContact(changes, entry.info, "terminated", "unregistered");
+		modified = true;
+	}
 
-		ri.getRegistration().push_back(re);
+	mRecordFetched = true;
+	mRecordFound = r != nullptr;
+	if (modified) {
+		mContacts = move(contacts);
+		mFullStateDocument.clear();
 	}
 
-	stringstream xmlBody;
-	serializeReginfo(xmlBody, ri);
-	string body = xmlBody.str();
+	const char *registrationState = mContacts.empty() ? "terminated" : "active";
+	for (auto &subscription : mSubscriptions) {
+		if (subscription.version == 0) {
+			notify(subscription, getFullStateDocument());
+		} else if (!changes.empty()) {
+			notify(subscription, ReginfoWriter::writeDocument(subscription.version, false, mAor, mId,
+			                                                  registrationState, changes));
+		}
+	}
+}
 
-	auto notifyContent = Factory::get()->createContent();
-	notifyContent->setBuffer((uint8_t *)body.data(), body.length());
-	notifyContent->setType("application");
-	notifyContent->setSubtype("reginfo+xml");
+const string &Listener::getFullStateDocument() {
+	if (!mFullStateDocument.empty()) return mFullStateDocument;
+	if (!mRecordFound) {
+		mFullStateDocument = ReginfoWriter::writeEmptyDocument(0, true);
+		return mFullStateDocument;
+	}
+	string contacts{};
+	for (const auto &entry : mContacts) contacts += entry.fragment;
+	mFullStateDocument = ReginfoWriter::writeDocument(0, true, mAor, mId,
+	                                                  mContacts.empty() ? "terminated" : "active", contacts);
+	return mFullStateDocument;
+}
 
-	mEvent->notify(notifyContent);
-};
+void Listener::notify(Subscription &subscription, const string &body) {
+	subscription.notify(body);
+	subscription.version++;
+}
 
 }
 }
@@ -18,26 +18,72 @@
 
 #pragma once
 
-#include <linphone++/linphone.hh>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include <flexisip/registrardb.hh>
 
+#include "registration-events/reginfo-writer.hh"
+
 namespace flexisip {
 namespace RegistrationEvent {
 namespace Registrar {
-	
-class Listener : public ContactRegisteredListener, public ContactUpdateListener {
+
+/**
+ * Listener of the record of an AOR, shared by all the 'reg' subscriptions to this AOR.
+ * A new subscription receives the full state of the registration, the document being written once per change of the
+ * record for all the subscriptions. Then only the contacts which have changed are sent, in partial state documents
+ * (RFC 3680, section 5.3), each subscription having its own version counter.
+ */
+class Listener : public ContactRegisteredListener {
 public:
-	Listener(const std::shared_ptr<linphone::Event> &lev);
-	void onRecordFound(const std::shared_ptr<Record> &r) override;
-	void onError() override {}
-	void onInvalid() override {}
+	/**
+	 * @param aor The AOR written in the documents.
+	 * @param id The registration id written in the documents, that is the key of the record.
+	 */
+	Listener(const std::string &aor, const std::string &id);
+
+	using NotifyFunction = std::function<void(const std::string &body)>;
+
+	/**
+	 * The subscription receives the full state with the next record given to the listener.
+	 * @param key Identifies the subscription, e.g. its linphone::Event.
+	 * @param notify Sends a reginfo document to the subscriber.
+	 */
+	void addSubscription(const void *key, NotifyFunction &&notify);
+	void removeSubscription(const void *key);
+	bool hasSubscriptions() const {
+		return !mSubscriptions.empty();
+	}
+
 	void onContactRegistered(const std::shared_ptr<Record> &r, const std::string &uid) override;
-	void onContactUpdated(const std::shared_ptr<ExtendedContact> &ec) override {}
+
 private:
-	const std::shared_ptr<linphone::Event> mEvent;
+	struct Subscription {
+		const void *key;
+		NotifyFunction notify;
+		std::uint32_t version = 0;
+	};
+	struct ContactEntry {
+		ReginfoContact info{};
+		std::string fragment{}; // The contact written as active and registered.
+	};
+
 	void processRecord(const std::shared_ptr<Record> &r, const std::string &uidOfFreshlyRegistered);
-	// version, previouscontacts
+	const std::string &getFullStateDocument();
+	static void notify(Subscription &subscription, const std::string &body);
+
+	const std::string mAor;
+	const std::string mId;
+	std::list<Subscription> mSubscriptions{};
+	bool mRecordFetched = false;
+	bool mRecordFound = false;
+	std::vector<ContactEntry> mContacts{}; // In the order of the record.
+	std::string mFullStateDocument{};      // Cleared when the contacts change.
 };
 
 }
@@ -18,6 +18,7 @@
 
 #include <flexisip/registrardb.hh>
 
+#include "registrar-subscription-hub.hh"
 #include "registrar/listener.hh"
 
 #include "server.hh"
@@ -42,26 +43,55 @@ void Server::onSubscribeReceived(
 	string eventHeader = lev->getName();
 	if (eventHeader != "reg") {
 		lev->denySubscription(Reason::BadEvent);
+		return;
 	}
 
 	string acceptHeader = lev->getCustomHeader("Accept");
 	if (acceptHeader != RegistrationEvent::CONTENT_TYPE) {
 		lev->denySubscription(Reason::NotAcceptable);
+		return;
 	}
 
 	lev->acceptSubscription();
 
-	auto listener = make_shared<Registrar::Listener>(lev);
-
 	try {
 		SipUri url{lev->getTo()->asStringUriOnly()};
-		RegistrarDb::get()->subscribe(url, listener);
-		RegistrarDb::get()->fetch(url, listener, true);
+		string key = Record::defineKeyFromUrl(url.get());
+		auto &listener = mListeners[key];
+		if (!listener) listener = make_shared<Registrar::Listener>(lev->getTo()->asStringUriOnly(), key);
+		listener->addSubscription(lev.get(), [lev](const string &body) {
+			auto notifyContent = Factory::get()->createContent();
+			notifyContent->setBuffer((uint8_t *)body.data(), body.length());
+			notifyContent->setType("application");
+			notifyContent->setSubtype("reginfo+xml");
+			lev->notify(notifyContent);
+		});
+		// The new subscription gets the full state with the current record.
+		RegistrarSubscriptionHub::get().subscribe(url, listener);
 	} catch (const sofiasip::InvalidUrlError &e) {
 		SLOGE << "invalid URI in 'To' header: " << e.getUrl();
 	}
 }
 
+void Server::onSubscriptionStateChanged(
+    const shared_ptr<Core> & lc,
+    const shared_ptr<Event> & lev,
+    SubscriptionState state
+) noexcept {
+	if (state != SubscriptionState::Terminated && state != SubscriptionState::Error) return;
+	try {
+		SipUri url{lev->getTo()->asStringUriOnly()};
+		auto it = mListeners.find(Record::defineKeyFromUrl(url.get()));
+		if (it == mListeners.end()) return;
+		it->second->removeSubscription(lev.get());
+		if (!it->second->hasSubscriptions()) {
+			RegistrarSubscriptionHub::get().unsubscribe(url, it->second);
+			mListeners.erase(it);
+		}
+	} catch (const sofiasip::InvalidUrlError &e) {
+	}
+}
+
 void Server::_init () {
 	mCore = Factory::get()->createCore("", "", nullptr);
 	auto config = GenericManager::get()->getRoot()->get<GenericStruct>("regevent-server");
@@ -19,9 +19,12 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 #include <linphone++/linphone.hh>
 
+#include "registration-events/registrar/listener.hh"
 #include "service-server.hh"
 
 namespace flexisip {
@@ -42,6 +45,11 @@ class Server : public ServiceServer
 			const std::string & subscribeEvent,
 			const std::shared_ptr<const linphone::Content> & body
 		) noexcept override;
+		void onSubscriptionStateChanged(
+			const std::shared_ptr<linphone::Core> & lc,
+			const std::shared_ptr<linphone::Event> & lev,
+			linphone::SubscriptionState state
+		) noexcept override;
 
 		protected:
 		void _init () override;
@@ -55,6 +63,8 @@ class Server : public ServiceServer
 	};
 	static Init sStaticInit;
 	std::shared_ptr<linphone::Core> mCore;
+	// Registrar listeners of the subscribed AORs, by record key.
+	std::unordered_map<std::string, std::shared_ptr<Registrar::Listener>> mListeners;
 };
 
 }
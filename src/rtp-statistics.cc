@@ -0,0 +1,156 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <cstring>
+
+#include <arpa/inet.h>
+
+#include "media-filter.hh"
+
+#include "rtp-statistics.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+
+namespace {
+constexpr uint8_t sRtcpSenderReport = 200;
+constexpr uint8_t sRtcpReceiverReport = 201;
+constexpr size_t sRtcpReportBlockSize = 24;
+} // namespace
+
+void RtpStreamStatistics::resetSequence(uint16_t seq) {
+	if (mStarted) {
+		mPreviousExpected += uint64_t(mCycles) + mMaxSeq - mBaseSeq + 1;
+		mPreviousReceived += mReceived;
+	}
+	mBaseSeq = seq;
+	mMaxSeq = seq;
+	mCycles = 0;
+	mReceived = 0;
+}
+
+/*
+ * Simplified version of RFC 3550 A.1: there is no probation, a big jump in sequence numbers restarts the sequence.
+ */
+void RtpStreamStatistics::updateSequence(uint16_t seq) {
+	uint16_t delta = seq - mMaxSeq;
+	if (delta < sMaxDropout) {
+		// In order, with permissible gap.
+		if (seq < mMaxSeq) mCycles += 1 << 16;
+		mMaxSeq = seq;
+	} else if (delta <= (1 << 16) - sMaxMisorder) {
+		// Very large jump, the sender has probably restarted.
+		resetSequence(seq);
+	}
+	// Otherwise duplicate or reordered packet, only counted as received.
+	mReceived++;
+}
+
+void RtpStreamStatistics::updateJitter(uint32_t rtpTimestamp, Clock::time_point arrival) {
+	const int64_t clockRate = mClockRate.load(memory_order_relaxed);
+	const int64_t arrivalUs = duration_cast<microseconds>(arrival - mFirstArrival).count();
+	const int64_t transit = arrivalUs * clockRate / 1000000 - int64_t(rtpTimestamp);
+	if (mReceived > 1) {
+		// Cast to handle RTP timestamp wrap-around.
+		const int32_t d = static_cast<int32_t>(static_cast<uint32_t>(transit - mLastTransit));
+		mJitter += (abs(double(d)) - mJitter) / 16.0;
+		mJitterMs.store(mJitter * 1000.0 / double(clockRate), memory_order_relaxed);
+	}
+	mLastTransit = transit;
+	mDurationUs.store(arrivalUs, memory_order_relaxed);
+}
+
+void RtpStreamStatistics::onRtpPacket(const uint8_t* data, size_t size, Clock::time_point arrival) {
+	const auto header = RtpHeaderInfo::parse(data, size);
+	if (!header.valid) return;
+
+	if (!mStarted || header.ssrc != mSsrc) {
+		resetSequence(header.seqNumber);
+		mSsrc = header.ssrc;
+		if (!mStarted) mFirstArrival = arrival;
+		mStarted = true;
+		mJitter = 0;
+	}
+	updateSequence(header.seqNumber);
+	updateJitter(header.timestamp, arrival);
+
+	mPackets.fetch_add(1, memory_order_relaxed);
+	mBytes.fetch_add(size, memory_order_relaxed);
+	mExpected.store(mPreviousExpected + uint64_t(mCycles) + mMaxSeq - mBaseSeq + 1, memory_order_relaxed);
+	mReceivedInSequence.store(mPreviousReceived + mReceived, memory_order_relaxed);
+}
+
+void RtpStreamStatistics::onReportBlock(const uint8_t* block) {
+	uint32_t jitter;
+	memcpy(&jitter, block + 12, sizeof(jitter));
+	mRemoteFractionLost.store(block[4], memory_order_relaxed);
+	mRemoteJitter.store(ntohl(jitter), memory_order_relaxed);
+}
+
+/*
+ * Walk through a compound RTCP packet and keep the first report block of the last SR or RR.
+ */
+void RtpStreamStatistics::onRtcpPacket(const uint8_t* data, size_t size) {
+	const uint8_t* p = data;
+	const uint8_t* end = data + size;
+	while (end - p >= 8) {
+		if ((p[0] >> 6) != 2) break;
+		const int reportCount = p[0] & 0x1f;
+		const uint8_t packetType = p[1];
+		uint16_t length;
+		memcpy(&length, p + 2, sizeof(length));
+		const size_t packetSize = (size_t(ntohs(length)) + 1) * 4;
+		if (packetSize > size_t(end - p)) break;
+
+		size_t blockOffset = 0;
+		if (packetType == sRtcpSenderReport) blockOffset = 28;
+		else if (packetType == sRtcpReceiverReport) blockOffset = 8;
+		if (blockOffset != 0 && reportCount > 0 && packetSize >= blockOffset + sRtcpReportBlockSize) {
+			onReportBlock(p + blockOffset);
+		}
+		p += packetSize;
+	}
+	mRtcpPackets.fetch_add(1, memory_order_relaxed);
+}
+
+RtpStreamStatistics::Snapshot RtpStreamStatistics::getSnapshot() const {
+	Snapshot s;
+	s.packets = mPackets.load(memory_order_relaxed);
+	s.bytes = mBytes.load(memory_order_relaxed);
+	s.expected = mExpected.load(memory_order_relaxed);
+	s.lost = int64_t(s.expected) - int64_t(mReceivedInSequence.load(memory_order_relaxed));
+	s.jitterMs = mJitterMs.load(memory_order_relaxed);
+	const auto durationUs = mDurationUs.load(memory_order_relaxed);
+	s.bitrateKbps = durationUs > 0 ? double(s.bytes) * 8.0 * 1000.0 / double(durationUs) : 0.0;
+	s.rtcpPackets = mRtcpPackets.load(memory_order_relaxed);
+	s.remoteFractionLost = mRemoteFractionLost.load(memory_order_relaxed) * 100.0 / 256.0;
+	s.remoteJitterMs = mRemoteJitter.load(memory_order_relaxed) * 1000.0 / mClockRate.load(memory_order_relaxed);
+	return s;
+}
+
+ostream& operator<<(ostream& os, const RtpStreamStatistics::Snapshot& s) {
+	return os << "packets=" << s.packets << " bytes=" << s.bytes << " lost=" << s.lost << " loss-rate="
+	          << s.getLossRate() << "% jitter=" << s.jitterMs << "ms bitrate=" << s.bitrateKbps
+	          << "kbit/s rtcp-packets=" << s.rtcpPackets << " remote-fraction-lost=" << s.remoteFractionLost
+	          << "% remote-jitter=" << s.remoteJitterMs << "ms";
+}
+
+} // namespace flexisip
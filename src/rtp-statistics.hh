@@ -0,0 +1,106 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace flexisip {
+
+/**
+ * Quality statistics of the RTP stream received by one side of a RelayChannel: packet loss, interarrival jitter
+ * (RFC 3550 appendix A.1, A.3 and A.8), bitrate, plus the loss and jitter the remote party reports in its RTCP
+ * SR/RR report blocks.
+ *
+ * Packets are analysed by the relay thread, which is the only writer. Results are published through relaxed atomics
+ * so that they can be read at any time from another thread (CLI, main loop) without taking any lock.
+ */
+class RtpStreamStatistics {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Snapshot {
+		uint64_t packets = 0;
+		uint64_t bytes = 0;
+		// Number of packets expected minus number of packets received. May be negative in case of duplicates.
+		int64_t lost = 0;
+		uint64_t expected = 0;
+		double jitterMs = 0;
+		double bitrateKbps = 0;
+		uint64_t rtcpPackets = 0;
+		// Fraction of lost packets (in %) and jitter last reported by the remote party through RTCP.
+		double remoteFractionLost = 0;
+		double remoteJitterMs = 0;
+
+		double getLossRate() const {
+			return expected ? (lost > 0 ? double(lost) * 100.0 / double(expected) : 0.0) : 0.0;
+		}
+	};
+
+	void setClockRate(int clockRate) {
+		if (clockRate > 0) mClockRate.store(clockRate, std::memory_order_relaxed);
+	}
+
+	void onRtpPacket(const uint8_t* data, size_t size, Clock::time_point arrival);
+	void onRtcpPacket(const uint8_t* data, size_t size);
+
+	Snapshot getSnapshot() const;
+
+private:
+	static constexpr uint32_t sMaxDropout = 3000;
+	static constexpr uint32_t sMaxMisorder = 100;
+
+	void resetSequence(uint16_t seq);
+	void updateSequence(uint16_t seq);
+	void updateJitter(uint32_t rtpTimestamp, Clock::time_point arrival);
+	void onReportBlock(const uint8_t* block);
+
+	// Relay thread only.
+	bool mStarted = false;
+	uint32_t mSsrc = 0;
+	uint16_t mMaxSeq = 0;
+	uint32_t mCycles = 0;
+	uint32_t mBaseSeq = 0;
+	uint64_t mReceived = 0;
+	// Counters of the sequences that preceded the last restart (SSRC change or big jump in sequence numbers).
+	uint64_t mPreviousExpected = 0;
+	uint64_t mPreviousReceived = 0;
+	int64_t mLastTransit = 0;
+	double mJitter = 0; // In RTP timestamp units.
+	Clock::time_point mFirstArrival{};
+
+	// Published values.
+	std::atomic_int mClockRate{8000};
+	std::atomic_uint64_t mPackets{0};
+	std::atomic_uint64_t mBytes{0};
+	std::atomic_uint64_t mExpected{0};
+	std::atomic_uint64_t mReceivedInSequence{0};
+	std::atomic<double> mJitterMs{0};
+	std::atomic_int64_t mDurationUs{0};
+	std::atomic_uint64_t mRtcpPackets{0};
+	std::atomic_uint mRemoteFractionLost{0}; // Raw 8 bits value from the report block.
+	std::atomic_uint mRemoteJitter{0};       // In RTP timestamp units.
+};
+
+std::ostream& operator<<(std::ostream& os, const RtpStreamStatistics::Snapshot& s);
+
+} // namespace flexisip
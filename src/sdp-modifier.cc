@@ -211,6 +211,16 @@ bool SdpModifier::initFromSipMsg(sip_t *sip){
 	return true;
 }
 
+bool SdpModifier::initFromSession(sip_t *sip, const sdp_session_t *session){
+	mSession=sdp_session_dup(mHome, session);
+	if (mSession==NULL) {
+		LOGE("Cannot copy SDP session");
+		return false;
+	}
+	mSip=sip;
+	return true;
+}
+
 SdpModifier::SdpModifier(su_home_t *home, std::string nortproxy) : mHome(home), mNortproxy(nortproxy) {
 	mParser=NULL;
 	mSip=NULL;
@@ -727,3 +737,39 @@ end:
 	if (printer) sdp_printer_free(printer);
 	return err;
 }
+
+SdpParseCache::~SdpParseCache(){
+	clear();
+}
+
+void SdpParseCache::clear(){
+	if (mParser) sdp_parser_free(mParser);
+	mParser=NULL;
+	mBody.clear();
+}
+
+shared_ptr<SdpModifier> SdpParseCache::createModifier(su_home_t *home, sip_t *sip, const string &nortproxy, bool *cacheHit){
+	sip_payload_t *payload=sip->sip_payload;
+	if (cacheHit) *cacheHit=false;
+	if (!payload || !payload->pl_data) return shared_ptr<SdpModifier>();
+
+	if (mParser==NULL || mBody.size()!=payload->pl_len || mBody.compare(0, string::npos, payload->pl_data, payload->pl_len)!=0){
+		clear();
+		mMisses++;
+		mParser=sdp_parse(NULL, payload->pl_data, (int)payload->pl_len, 0);
+		sdp_session_t *session=sdp_session(mParser);
+		if (session==NULL || session->sdp_media==NULL){
+			if (session==NULL) LOGE("SDP parsing error: %s",sdp_parsing_error(mParser));
+			else LOGE("SDP with no mline.");
+			clear();
+			return shared_ptr<SdpModifier>();
+		}
+		mBody.assign(payload->pl_data, payload->pl_len);
+	}else{
+		mHits++;
+		if (cacheHit) *cacheHit=true;
+	}
+	auto sm=make_shared<SdpModifier>(home, nortproxy);
+	if (!sm->initFromSession(sip, sdp_session(mParser))) sm.reset();
+	return sm;
+}
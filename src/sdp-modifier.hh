@@ -80,6 +80,8 @@ class SdpModifier{
 		static std::shared_ptr<SdpModifier> createFromSipMsg(su_home_t *home, sip_t *sip, const std::string &nortproxy = "");
 		static bool hasSdp(const sip_t *sip);
 		bool initFromSipMsg(sip_t *sip);
+		/* Initialize with a copy of an already parsed session, instead of parsing the SIP message payload. */
+		bool initFromSession(sip_t *sip, const sdp_session_t *session);
 		std::list<PayloadType *> readPayloads();
 		void replacePayloads(const std::list<PayloadType *> &payloads, const std::list<PayloadType *> &preserved_numbers);
 		static std::list<PayloadType *> findCommon(const std::list<PayloadType *> &offer, const std::list<PayloadType *> &answer, bool use_offer_numbering);
@@ -123,4 +125,34 @@ class SdpModifier{
 		std::string mNortproxy;
 };
 
+/**
+ * Keeps the parsed SDP of the last message it was given, so that the messages carrying the same SDP body, such as
+ * the branches of a forked INVITE, are parsed only once.
+ * Every SdpModifier created from the cache works on its own copy of the parsed session: the per-branch changes
+ * (connection addresses, ports, ICE candidates) are only applied to this copy.
+**/
+class SdpParseCache{
+	public:
+		SdpParseCache() = default;
+		SdpParseCache(const SdpParseCache &) = delete;
+		~SdpParseCache();
+		/**
+		 * Same as SdpModifier::createFromSipMsg(), but the payload is parsed only if it differs from the previous one.
+		 * @param cacheHit if not null, set to true when the parsed session was reused.
+		 */
+		std::shared_ptr<SdpModifier> createModifier(su_home_t *home, sip_t *sip, const std::string &nortproxy = "", bool *cacheHit = nullptr);
+		void clear();
+		unsigned long getHits()const{
+			return mHits;
+		}
+		unsigned long getMisses()const{
+			return mMisses;
+		}
+	private:
+		sdp_parser_t *mParser = nullptr;
+		std::string mBody;
+		unsigned long mHits = 0;
+		unsigned long mMisses = 0;
+};
+
 }
\ No newline at end of file
@@ -21,62 +21,66 @@
 #include "flexisip/expressionparser-impl.cc"
 #include "sofia-sip/sip.h"
 
+#include <cstdio>
+
 using namespace std;
 
 namespace flexisip{
 
 shared_ptr<SipBooleanExpressionBuilder> SipBooleanExpressionBuilder::sInstance;
 
-static inline string stringFromC(const char *s){
-	return s ? string(s) : string();
+static StringRef formatNumber(unsigned value, ScratchBuffer &buffer){
+	int len = snprintf(buffer.data(), buffer.size(), "%u", value);
+	return StringRef(buffer.data(), len > 0 ? size_t(len) : 0);
 }
 
+/*
+ * The variables are only defined through their accessors, which return references into the sip_t: this allows the
+ * compiled expressions to evaluate them without allocating. The interpreter uses a copy of these values.
+ */
 static ExpressionRules<sip_t> rules = {
+	{},
+	{
+		{"is_request", [](const sip_t & sip)->bool {return sip.sip_request != nullptr;} },
+		{"is_response", [](const sip_t & sip)->bool {return sip.sip_request == nullptr;} }
+	},
 	{
-		{"direction", [](const sip_t &sip)->string {return sip.sip_request != nullptr ? "request" : "response";} },
+		{"direction", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_request != nullptr ? "request" : "response";} },
 		
-		{"request.method-name", [](const sip_t &sip)->string {
-			return stringFromC((sip.sip_request && sip.sip_request->rq_method_name) ? sip.sip_request->rq_method_name : nullptr);} },
-		{"request.method", [](const sip_t &sip)->string {
-			return stringFromC((sip.sip_request && sip.sip_request->rq_method_name) ? sip.sip_request->rq_method_name : nullptr);} },
-		{"request.uri.domain", [](const sip_t &sip)->string {
-			return stringFromC(sip.sip_request ? sip.sip_request->rq_url->url_host : nullptr);} },
-		{"request.uri.user", [](const sip_t &sip)->string {
-			return stringFromC(sip.sip_request ? sip.sip_request->rq_url->url_user : nullptr);} },
-		{"request.uri.params", [](const sip_t &sip)->string {
-			return stringFromC(sip.sip_request ? sip.sip_request->rq_url->url_params : nullptr);} },
+		{"request.method-name", [](const sip_t &sip, ScratchBuffer &)->StringRef {
+			return sip.sip_request ? sip.sip_request->rq_method_name : nullptr;} },
+		{"request.method", [](const sip_t &sip, ScratchBuffer &)->StringRef {
+			return sip.sip_request ? sip.sip_request->rq_method_name : nullptr;} },
+		{"request.uri.domain", [](const sip_t &sip, ScratchBuffer &)->StringRef {
+			return sip.sip_request ? sip.sip_request->rq_url->url_host : nullptr;} },
+		{"request.uri.user", [](const sip_t &sip, ScratchBuffer &)->StringRef {
+			return sip.sip_request ? sip.sip_request->rq_url->url_user : nullptr;} },
+		{"request.uri.params", [](const sip_t &sip, ScratchBuffer &)->StringRef {
+			return sip.sip_request ? sip.sip_request->rq_url->url_params : nullptr;} },
 		
-		{"from.uri.domain", [](const sip_t &sip)->string {return stringFromC(sip.sip_from ? sip.sip_from->a_url->url_host : nullptr);} },
-		{"from.uri.user", [](const sip_t &sip)->string {return stringFromC(sip.sip_from ? sip.sip_from->a_url->url_user : nullptr);} },
-		{"from.uri.params", [](const sip_t &sip)->string {return stringFromC(sip.sip_from ? sip.sip_from->a_url->url_params : nullptr);} },
+		{"from.uri.domain", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_from ? sip.sip_from->a_url->url_host : nullptr;} },
+		{"from.uri.user", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_from ? sip.sip_from->a_url->url_user : nullptr;} },
+		{"from.uri.params", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_from ? sip.sip_from->a_url->url_params : nullptr;} },
 		
-		{"to.uri.domain", [](const sip_t &sip)->string {return stringFromC(sip.sip_to ? sip.sip_to->a_url->url_host : nullptr);} },
-		{"to.uri.user", [](const sip_t &sip)->string {return stringFromC(sip.sip_to ? sip.sip_to->a_url->url_user : nullptr);} },
-		{"to.uri.params", [](const sip_t &sip)->string {return stringFromC(sip.sip_to ? sip.sip_to->a_url->url_params : nullptr);} },
+		{"to.uri.domain", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_to ? sip.sip_to->a_url->url_host : nullptr;} },
+		{"to.uri.user", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_to ? sip.sip_to->a_url->url_user : nullptr;} },
+		{"to.uri.params", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_to ? sip.sip_to->a_url->url_params : nullptr;} },
 		
-		{"contact.uri.domain", [](const sip_t &sip)->string {return stringFromC(sip.sip_contact ? sip.sip_contact->m_url->url_host : nullptr);} },
-		{"contact.uri.user", [](const sip_t &sip)->string {return stringFromC(sip.sip_contact ? sip.sip_contact->m_url->url_user : nullptr);} },
-		{"contact.uri.params", [](const sip_t &sip)->string {return stringFromC(sip.sip_contact ? sip.sip_contact->m_url->url_params : nullptr);} },
+		{"contact.uri.domain", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_contact ? sip.sip_contact->m_url->url_host : nullptr;} },
+		{"contact.uri.user", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_contact ? sip.sip_contact->m_url->url_user : nullptr;} },
+		{"contact.uri.params", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_contact ? sip.sip_contact->m_url->url_params : nullptr;} },
 		
-		{"user-agent", [](const sip_t &sip)->string {return stringFromC(sip.sip_user_agent ? sip.sip_user_agent->g_string : nullptr);} },
+		{"user-agent", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_user_agent ? sip.sip_user_agent->g_string : nullptr;} },
 		
-		{"call-id", [](const sip_t &sip)->string {return stringFromC(sip.sip_call_id ? sip.sip_call_id->i_id : nullptr);} },
-		{"call-id.hash", [](const sip_t &sip)->string {
-			ostringstream ostr;
-			if (sip.sip_call_id) ostr << sip.sip_call_id->i_hash;
-			return ostr.str();
+		{"call-id", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_call_id ? sip.sip_call_id->i_id : nullptr;} },
+		{"call-id.hash", [](const sip_t &sip, ScratchBuffer &buffer)->StringRef {
+			return sip.sip_call_id ? formatNumber(sip.sip_call_id->i_hash, buffer) : StringRef();
 		} },
 		
-		{"status.phrase", [](const sip_t &sip)->string {return stringFromC(sip.sip_status ? sip.sip_status->st_phrase : nullptr);} },
-		{"status.code", [](const sip_t &sip)->string {
-			ostringstream ostr;
-			if (sip.sip_status) ostr << sip.sip_status->st_status;
-			return ostr.str();
+		{"status.phrase", [](const sip_t &sip, ScratchBuffer &)->StringRef {return sip.sip_status ? sip.sip_status->st_phrase : nullptr;} },
+		{"status.code", [](const sip_t &sip, ScratchBuffer &buffer)->StringRef {
+			return sip.sip_status ? formatNumber(sip.sip_status->st_status, buffer) : StringRef();
 		} }
-	},
-	{
-		{"is_request", [](const sip_t & sip)->bool {return sip.sip_request != nullptr;} },
-		{"is_response", [](const sip_t & sip)->bool {return sip.sip_request == nullptr;} }
 	}
 };
 
@@ -94,4 +98,8 @@ shared_ptr<SipBooleanExpression> SipBooleanExpressionBuilder::parse(const string
 	return BooleanExpressionBuilder<sip_t>::parse(expression);
 }
 
+shared_ptr<SipBooleanExpression> SipBooleanExpressionBuilder::parseInterpreted(const string &expression){
+	return BooleanExpressionBuilder<sip_t>::parseInterpreted(expression);
+}
+
 }//end of namespace
@@ -35,6 +35,35 @@ MsgSip::MsgSip(const MsgSip& msgSip) {
 	LOGD("New MsgSip %p copied from MsgSip %p", this, &msgSip);
 }
 
+shared_ptr<MsgSip> MsgSip::makeShallowCopy(const MsgSip& msgSip) {
+	// The chain of the original message is copied with the encoded headers, which must thus be up to date.
+	msgSip.serialize();
+	msg_t* shallowCopy = msg_copy(msgSip.mMsg);
+	if (shallowCopy == nullptr) {
+		LOGE("MsgSip %p cannot be shallow-copied, making a deep copy instead", &msgSip);
+		return make_shared<MsgSip>(msgSip);
+	}
+	auto copy = make_shared<MsgSip>(shallowCopy, true);
+
+	auto* sip = copy->getSip();
+	auto* home = copy->getHome();
+	auto duplicateAll = [&](msg_header_t* header) {
+		while (header) {
+			auto* next = header->sh_next;
+			msg_header_replace(shallowCopy, (msg_pub_t*)sip, header, msg_header_dup_one(home, header));
+			header = next;
+		}
+	};
+	duplicateAll((msg_header_t*)sip->sip_request);
+	duplicateAll((msg_header_t*)sip->sip_via);
+	duplicateAll((msg_header_t*)sip->sip_route);
+	duplicateAll((msg_header_t*)sip->sip_record_route);
+	duplicateAll((msg_header_t*)sip->sip_contact);
+
+	LOGD("New MsgSip %p shallow-copied from MsgSip %p", copy.get(), &msgSip);
+	return copy;
+}
+
 MsgSip::MsgSip(int flags, const std::string& msg) {
 	mMsg = msg_make(sip_default_mclass(), flags, msg.c_str(), msg.size());
 	if (!mMsg || msg_has_error(mMsg)) {
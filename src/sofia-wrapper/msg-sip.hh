@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <memory>
 #include <ostream>
 #include <string>
 
@@ -51,6 +52,14 @@ public:
 		msg_unref(mMsg);
 	}
 
+	/**
+	 * Copy a message without duplicating its strings and its payload, which are shared with the original msg_t the
+	 * copy keeps a reference on. Only the header structures are copied, except for the request line, Via, Route,
+	 * Record-Route and Contact headers that are fully duplicated since they are commonly rewritten on each fork branch.
+	 * The strings of the other headers must not be modified in place: they must be duplicated first, as usual.
+	 */
+	static std::shared_ptr<MsgSip> makeShallowCopy(const MsgSip& msgSip);
+
 	msg_t* getMsg() const {
 		return mMsg;
 	}
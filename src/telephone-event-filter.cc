@@ -17,26 +17,25 @@
  */
 
 #include "telephone-event-filter.hh"
-#include <ortp/rtp.h>
+#include <flexisip/logmanager.hh>
 
 using namespace flexisip;
 
 TelephoneEventFilter::TelephoneEventFilter(int telephone_event_pt) : mTelephoneEventPt(telephone_event_pt) {
 }
 
-bool TelephoneEventFilter::onIncomingTransfer(uint8_t *data, size_t size, const struct sockaddr *sockaddr,
-											  socklen_t addrlen) {
-	rtp_header_t *h = (rtp_header_t *)data;
-	if (size < sizeof(rtp_header_t))
+bool TelephoneEventFilter::onIncomingTransfer(const RtpHeaderInfo &header, uint8_t *data, size_t size,
+											  const struct sockaddr *sockaddr, socklen_t addrlen) {
+	if (!header.valid)
 		return true;
-	if (h->paytype == mTelephoneEventPt) {
+	if (header.payloadType == mTelephoneEventPt) {
 		LOGD("Detected telephone event in stream, dropping.");
 		return false;
 	}
 	return true;
 }
 
-bool TelephoneEventFilter::onOutgoingTransfer(uint8_t *data, size_t size, const struct sockaddr *sockaddr,
-											  socklen_t addrlen) {
+bool TelephoneEventFilter::onOutgoingTransfer(const RtpHeaderInfo &header, uint8_t *data, size_t size,
+											  const struct sockaddr *sockaddr, socklen_t addrlen) {
 	return true;
 }
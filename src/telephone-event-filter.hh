@@ -18,15 +18,20 @@
 
 #pragma once
 
-#include "mediarelay.hh"
+#include "media-filter.hh"
 
 namespace flexisip {
 
 class TelephoneEventFilter : public MediaFilter {
   public:
 	TelephoneEventFilter(int telephone_event_pt);
-	virtual bool onIncomingTransfer(uint8_t *data, size_t size, const struct sockaddr *sockaddr, socklen_t addrlen);
-	virtual bool onOutgoingTransfer(uint8_t *data, size_t size, const struct sockaddr *sockaddr, socklen_t addrlen);
+	bool onIncomingTransfer(const RtpHeaderInfo &header, uint8_t *data, size_t size, const struct sockaddr *sockaddr,
+							socklen_t addrlen) override;
+	bool onOutgoingTransfer(const RtpHeaderInfo &header, uint8_t *data, size_t size, const struct sockaddr *sockaddr,
+							socklen_t addrlen) override;
+	int getPayloadType() const {
+		return mTelephoneEventPt;
+	}
 
   private:
 	int mTelephoneEventPt;
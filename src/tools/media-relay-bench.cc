@@ -0,0 +1,479 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Load benchmark of the media relay.
+ *
+ * Relay sessions are created directly on MediaRelayServer instances (no SIP involved), each call having a front
+ * and a back RelayChannel. Every call is driven by two local UDP endpoints playing the caller and the callee, which
+ * send RTP at the rate of the chosen codec profile and measure the latency added by the relay.
+ * The number of calls can be increased step by step to find the number of calls the relay sustains within the
+ * given packet loss and latency limits.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "flexisip/agent.hh"
+#include "flexisip/configmanager.hh"
+#include "flexisip/logmanager.hh"
+#include "flexisip/sofia-wrapper/su-root.hh"
+
+#include "mediarelay.hh"
+
+using namespace std;
+using namespace std::chrono;
+using namespace flexisip;
+
+namespace {
+
+/* Traffic generated in each direction of a call. */
+struct CodecProfile {
+	const char* name;
+	uint8_t payloadType;
+	int clockRate;
+	int frameRate;
+	size_t packetSize;      // RTP header included.
+	int packetsPerFrame;
+	int keyFrameInterval;   // In frames, 0 if there is no key frame.
+	int keyFramePackets;
+};
+
+const CodecProfile sProfiles[] = {
+    // G.711, 20ms packets: 50 pps, 69 kbit/s.
+    {"audio", 0, 8000, 50, 172, 1, 0, 0},
+    // VP8 at about 1 Mbit/s: 30 fps, 4 packets per frame.
+    {"vp8", 96, 90000, 30, 1100, 4, 0, 0},
+    // H264 at about 1.5 Mbit/s, with a key frame of 30 packets every 2 seconds.
+    {"h264", 97, 90000, 30, 1100, 5, 60, 30},
+};
+
+struct BenchArgs {
+	int calls = 100;
+	int callsStep = 0;
+	int maxCalls = 0;
+	int duration = 10;
+	int servers = 1;
+	double maxLoss = 1.0;
+	double maxLatencyMs = 20.0;
+	bool statistics = true;
+	bool debug = false;
+	const CodecProfile* profile = &sProfiles[0];
+
+	static void usage(const char* app) {
+		cout << "Usage: " << app << " [options]" << endl
+		     << endl
+		     << "    --codec {audio|vp8|h264}  traffic profile of each call (default: audio)" << endl
+		     << "    --calls n                 number of calls of the first step (default: 100)" << endl
+		     << "    --calls-step n            calls added at each step (default: 0, single step)" << endl
+		     << "    --max-calls n             number of calls of the last step (default: --calls)" << endl
+		     << "    --duration s              duration of each step in seconds (default: 10)" << endl
+		     << "    --servers n               number of MediaRelayServer threads (default: 1)" << endl
+		     << "    --max-loss percent        packet loss above which a step is failed (default: 1)" << endl
+		     << "    --max-latency ms          99th percentile of the latency above which a step is failed "
+		        "(default: 20)"
+		     << endl
+		     << "    --no-statistics           disable the call quality statistics of the relay" << endl
+		     << "    --debug" << endl;
+	}
+
+	void parse(int argc, char* argv[]) {
+		for (int i = 1; i < argc; ++i) {
+			string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--codec" && hasValue) {
+				string name = argv[++i];
+				auto it = find_if(begin(sProfiles), end(sProfiles),
+				                  [&name](const CodecProfile& p) { return name == p.name; });
+				if (it == end(sProfiles)) {
+					cerr << "Unknown codec profile: " << name << endl;
+					exit(-1);
+				}
+				profile = &*it;
+			} else if (arg == "--calls" && hasValue) {
+				calls = atoi(argv[++i]);
+			} else if (arg == "--calls-step" && hasValue) {
+				callsStep = atoi(argv[++i]);
+			} else if (arg == "--max-calls" && hasValue) {
+				maxCalls = atoi(argv[++i]);
+			} else if (arg == "--duration" && hasValue) {
+				duration = atoi(argv[++i]);
+			} else if (arg == "--servers" && hasValue) {
+				servers = atoi(argv[++i]);
+			} else if (arg == "--max-loss" && hasValue) {
+				maxLoss = atof(argv[++i]);
+			} else if (arg == "--max-latency" && hasValue) {
+				maxLatencyMs = atof(argv[++i]);
+			} else if (arg == "--no-statistics") {
+				statistics = false;
+			} else if (arg == "--debug") {
+				debug = true;
+			} else if (arg == "--help" || arg == "-h") {
+				usage(*argv);
+				exit(0);
+			} else {
+				cerr << "? arg" << i << " " << arg << endl;
+				usage(*argv);
+				exit(-1);
+			}
+		}
+		if (maxCalls < calls) maxCalls = calls;
+		if (calls <= 0 || duration <= 0 || servers <= 0) {
+			usage(*argv);
+			exit(-1);
+		}
+	}
+};
+
+/* Latency histogram with a 10us resolution, up to one second. */
+class LatencyHistogram {
+public:
+	void add(nanoseconds latency) {
+		auto bucket = static_cast<size_t>(max<int64_t>(0, latency.count()) / sResolutionNs);
+		mBuckets[min(bucket, mBuckets.size() - 1)]++;
+		mCount++;
+		mMax = max(mMax, latency);
+	}
+	double percentileMs(double p) const {
+		if (mCount == 0) return 0;
+		uint64_t target = static_cast<uint64_t>(p / 100.0 * double(mCount));
+		uint64_t seen = 0;
+		for (size_t i = 0; i < mBuckets.size(); ++i) {
+			seen += mBuckets[i];
+			if (seen > target) return double((i + 1) * sResolutionNs) / 1e6;
+		}
+		return double(mBuckets.size() * sResolutionNs) / 1e6;
+	}
+	double maxMs() const {
+		return double(mMax.count()) / 1e6;
+	}
+
+private:
+	static constexpr int64_t sResolutionNs = 10000;
+	vector<uint64_t> mBuckets = vector<uint64_t>(100000, 0);
+	uint64_t mCount = 0;
+	nanoseconds mMax{0};
+};
+
+/* One of the two parties of a call. */
+struct Endpoint {
+	int socket = -1;
+	int port = 0;
+	sockaddr_in relayAddr{}; // The relay channel this party sends to.
+	uint16_t seq = 0;
+	uint32_t ssrc = 0;
+};
+
+struct BenchCall {
+	shared_ptr<RelaySession> session;
+	Endpoint parties[2]; // Caller, callee.
+	steady_clock::time_point nextFrame;
+	uint32_t frameCount = 0;
+};
+
+struct StepResult {
+	int calls = 0;
+	uint64_t sent = 0;
+	uint64_t received = 0;
+	double pps = 0;
+	double lossPercent = 0;
+	double p50Ms = 0, p99Ms = 0, maxMs = 0;
+	double relayCpuPercent = 0; // Of one core.
+	bool passed = false;
+};
+
+int openEndpoint(Endpoint& ep) {
+	ep.socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+	if (ep.socket == -1) return -1;
+	int bufSize = 1 << 20;
+	setsockopt(ep.socket, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	if (bind(ep.socket, (sockaddr*)&addr, len) == -1 || getsockname(ep.socket, (sockaddr*)&addr, &len) == -1) {
+		close(ep.socket);
+		ep.socket = -1;
+		return -1;
+	}
+	ep.port = ntohs(addr.sin_port);
+	return 0;
+}
+
+RelayTransport makeLoopbackTransport() {
+	RelayTransport rt;
+	rt.mIpv4Address = rt.mIpv4BindAddress = "127.0.0.1";
+	rt.mIpv6Address = rt.mIpv6BindAddress = "::1";
+	rt.mPreferredFamily = AF_INET;
+	rt.mDualStackRequired = false;
+	return rt;
+}
+
+bool setupCall(BenchCall& call, MediaRelayServer& server, int index) {
+	auto rt = makeLoopbackTransport();
+	call.session = server.createSession("caller", rt, "bench-call-" + to_string(index));
+	auto front = call.session->getChannel("caller", "");
+	auto back = call.session->createBranch("callee", rt, false);
+	call.session->setEstablished("callee");
+	if (!call.session->checkChannels()) return false;
+
+	shared_ptr<RelayChannel> channels[2] = {front, back};
+	for (int i = 0; i < 2; ++i) {
+		auto& ep = call.parties[i];
+		if (openEndpoint(ep) == -1) return false;
+		ep.ssrc = static_cast<uint32_t>(index * 2 + i + 1);
+		ep.relayAddr.sin_family = AF_INET;
+		ep.relayAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		ep.relayAddr.sin_port = htons(channels[i]->getRelayTransport().mRtpPort);
+		// No RTCP is generated, the RTCP destination does not matter.
+		channels[i]->setRemoteAddr("127.0.0.1", ep.port, ep.port, RelayChannel::SendRecv);
+	}
+	return true;
+}
+
+void teardownCall(BenchCall& call) {
+	if (call.session) call.session->unuse();
+	call.session.reset();
+	for (auto& ep : call.parties) {
+		if (ep.socket != -1) close(ep.socket);
+		ep.socket = -1;
+	}
+}
+
+nanoseconds threadCpuTime() {
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec);
+}
+
+nanoseconds processCpuTime() {
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+	       microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/*
+ * Send the frames that are due for every call, in both directions. The send time is written in the payload so
+ * that the receiver can compute the latency.
+ */
+void generate(vector<BenchCall>& calls, const CodecProfile& profile, steady_clock::time_point end,
+              atomic_uint64_t& sent, nanoseconds& cpuTime) {
+	const auto framePeriod = duration_cast<nanoseconds>(seconds(1)) / profile.frameRate;
+	const uint32_t tsIncrement = profile.clockRate / profile.frameRate;
+	vector<uint8_t> packet(profile.packetSize, 0);
+	packet[0] = 0x80;
+
+	while (true) {
+		auto now = steady_clock::now();
+		if (now >= end) break;
+		auto nextWakeUp = end;
+		for (auto& call : calls) {
+			while (call.nextFrame <= now) {
+				bool keyFrame = profile.keyFrameInterval > 0 && call.frameCount % profile.keyFrameInterval == 0;
+				int packetCount = keyFrame ? profile.keyFramePackets : profile.packetsPerFrame;
+				uint32_t ts = htonl(call.frameCount * tsIncrement);
+				for (auto& ep : call.parties) {
+					uint32_t ssrc = htonl(ep.ssrc);
+					memcpy(&packet[4], &ts, sizeof(ts));
+					memcpy(&packet[8], &ssrc, sizeof(ssrc));
+					for (int i = 0; i < packetCount; ++i) {
+						packet[1] = (i == packetCount - 1 ? 0x80 : 0) | profile.payloadType;
+						uint16_t seq = htons(ep.seq++);
+						memcpy(&packet[2], &seq, sizeof(seq));
+						int64_t sendTime = steady_clock::now().time_since_epoch().count();
+						memcpy(&packet[12], &sendTime, sizeof(sendTime));
+						if (sendto(ep.socket, packet.data(), packet.size(), 0, (sockaddr*)&ep.relayAddr,
+						           sizeof(ep.relayAddr)) > 0) {
+							sent++;
+						}
+					}
+				}
+				call.frameCount++;
+				call.nextFrame += framePeriod;
+			}
+			nextWakeUp = min(nextWakeUp, call.nextFrame);
+		}
+		this_thread::sleep_until(nextWakeUp);
+	}
+	cpuTime = threadCpuTime();
+}
+
+void receive(vector<BenchCall>& calls, const atomic_bool& running, atomic_uint64_t& received,
+             LatencyHistogram& latencies, nanoseconds& cpuTime) {
+	int epfd = epoll_create1(0);
+	for (auto& call : calls) {
+		for (auto& ep : call.parties) {
+			epoll_event ev{};
+			ev.events = EPOLLIN;
+			ev.data.fd = ep.socket;
+			epoll_ctl(epfd, EPOLL_CTL_ADD, ep.socket, &ev);
+		}
+	}
+	epoll_event events[256];
+	uint8_t buf[1500];
+	while (running) {
+		int n = epoll_wait(epfd, events, 256, 100);
+		for (int i = 0; i < n; ++i) {
+			ssize_t len;
+			while ((len = recv(events[i].data.fd, buf, sizeof(buf), 0)) > 0) {
+				auto now = steady_clock::now();
+				if (len < 12 + (ssize_t)sizeof(int64_t)) continue;
+				int64_t sendTime;
+				memcpy(&sendTime, &buf[12], sizeof(sendTime));
+				latencies.add(now - steady_clock::time_point(steady_clock::duration(sendTime)));
+				received++;
+			}
+		}
+	}
+	close(epfd);
+	cpuTime = threadCpuTime();
+}
+
+StepResult runStep(const BenchArgs& args, vector<shared_ptr<MediaRelayServer>>& servers, int callCount) {
+	StepResult result;
+	result.calls = callCount;
+	vector<BenchCall> calls(callCount);
+	for (int i = 0; i < callCount; ++i) {
+		if (!setupCall(calls[i], *servers[i % servers.size()], i)) {
+			cerr << "Cannot create call " << i << ": out of ports or file descriptors?" << endl;
+			for (auto& call : calls) teardownCall(call);
+			return result;
+		}
+	}
+	for (auto& server : servers) server->update();
+	// Let the relay threads take the new sessions into account.
+	this_thread::sleep_for(milliseconds(200));
+
+	// Spread the calls over one frame period.
+	const auto framePeriod = duration_cast<nanoseconds>(seconds(1)) / args.profile->frameRate;
+	auto start = steady_clock::now();
+	for (int i = 0; i < callCount; ++i) calls[i].nextFrame = start + framePeriod * i / callCount;
+
+	atomic_uint64_t sent{0}, received{0};
+	atomic_bool running{true};
+	LatencyHistogram latencies;
+	nanoseconds generatorCpu{0}, receiverCpu{0};
+	auto cpuStart = processCpuTime();
+
+	thread receiver(receive, ref(calls), cref(running), ref(received), ref(latencies), ref(receiverCpu));
+	thread generator(generate, ref(calls), cref(*args.profile), start + seconds(args.duration), ref(sent),
+	                 ref(generatorCpu));
+	generator.join();
+	// Wait for the packets still in flight.
+	this_thread::sleep_for(milliseconds(200));
+	running = false;
+	receiver.join();
+	auto wallTime = steady_clock::now() - start;
+	auto relayCpu = processCpuTime() - cpuStart - generatorCpu - receiverCpu;
+
+	for (auto& call : calls) teardownCall(call);
+	// Wake up the relay threads so that they release the terminated sessions.
+	for (auto& server : servers) server->update();
+
+	result.sent = sent;
+	result.received = received;
+	result.pps = double(result.received) / args.duration;
+	result.lossPercent = result.sent ? 100.0 * double(result.sent - min(result.sent, result.received)) / result.sent : 0;
+	result.p50Ms = latencies.percentileMs(50);
+	result.p99Ms = latencies.percentileMs(99);
+	result.maxMs = latencies.maxMs();
+	result.relayCpuPercent = 100.0 * duration<double>(relayCpu).count() / duration<double>(wallTime).count();
+	result.passed = result.lossPercent <= args.maxLoss && result.p99Ms <= args.maxLatencyMs;
+	return result;
+}
+
+void printResult(const StepResult& r) {
+	double callsPerCore = r.relayCpuPercent > 0 ? r.calls * 100.0 / r.relayCpuPercent : 0;
+	cout << fixed << setprecision(2) << setw(7) << r.calls << setw(12) << r.pps << setw(8) << r.lossPercent
+	     << setw(9) << r.p50Ms << setw(9) << r.p99Ms << setw(9) << r.maxMs << setw(10) << r.relayCpuPercent
+	     << setw(12) << callsPerCore << "  " << (r.passed ? "ok" : "FAILED") << endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	BenchArgs args{};
+	args.parse(argc, argv);
+
+	LogManager::Parameters logParams{};
+	logParams.level = args.debug ? BCTBX_LOG_DEBUG : BCTBX_LOG_ERROR;
+	logParams.enableSyslog = false;
+	logParams.enableStdout = true;
+	LogManager::get().initialize(logParams);
+
+	// Each call uses 6 sockets: 2 per relay channel, and one per party.
+	rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	auto root = make_shared<sofiasip::SuRoot>();
+	auto agent = make_shared<Agent>(root);
+	auto cfg = GenericManager::get();
+	cfg->load("");
+	auto relayConfig = cfg->getRoot()->get<GenericStruct>("module::MediaRelay");
+	relayConfig->get<ConfigValue>("enabled")->set("true");
+	// Calls are relayed between local addresses.
+	relayConfig->get<ConfigValue>("prevent-loops")->set("false");
+	relayConfig->get<ConfigValue>("call-quality-statistics")->set(args.statistics ? "true" : "false");
+	auto module = dynamic_pointer_cast<MediaRelay>(agent->findModule("MediaRelay"));
+	module->load();
+
+	vector<shared_ptr<MediaRelayServer>> servers;
+	for (int i = 0; i < args.servers; ++i) servers.push_back(make_shared<MediaRelayServer>(module.get()));
+
+	const auto& p = *args.profile;
+	int ppsPerCall = 2 * (p.frameRate * p.packetsPerFrame +
+	                      (p.keyFrameInterval ? p.frameRate * (p.keyFramePackets - p.packetsPerFrame) /
+	                                                p.keyFrameInterval
+	                                          : 0));
+	cout << "Media relay benchmark: backend poll, " << args.servers << " relay thread(s), codec " << p.name << " ("
+	     << ppsPerCall << " pps per call), " << args.duration << "s per step" << endl
+	     << "  calls   relay pps   loss%  p50(ms)  p99(ms)  max(ms)  relayCPU%  calls/core" << endl;
+
+	int sustained = 0;
+	for (int calls = args.calls; calls <= args.maxCalls; calls += args.callsStep) {
+		auto result = runStep(args, servers, calls);
+		printResult(result);
+		if (!result.passed) break;
+		sustained = calls;
+		if (args.callsStep <= 0) break;
+	}
+	cout << "Sustained calls: " << sustained << endl;
+
+	servers.clear();
+	module->unload();
+	return sustained > 0 ? 0 : 1;
+}
@@ -0,0 +1,674 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Load benchmark of the presence server.
+ *
+ * A PresenceServer runs in its own thread, listening on the loopback interface. The benchmark plays, with a belle-sip
+ * stack of its own, N publishers sending PUBLISH requests at a given rate and M watchers holding individual
+ * subscriptions and resource list subscriptions (RFC 5367, the list being in the body of the SUBSCRIBE).
+ * Each PUBLISH carries a sequence number in a note of the PIDF document, which is found back in the NOTIFY bodies to
+ * measure the time between the sending of a PUBLISH and the reception of the NOTIFY carrying the new state.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <belle-sip/belle-sip.h>
+
+#include "flexisip/agent.hh"
+#include "flexisip/configmanager.hh"
+#include "flexisip/logmanager.hh"
+#include "flexisip/sofia-wrapper/su-root.hh"
+
+#include "presence/presence-server.hh"
+#include "utils/belle-sip-utils.hh"
+
+using namespace std;
+using namespace std::chrono;
+using namespace flexisip;
+
+namespace {
+
+constexpr const char* sDomain = "bench.example.org";
+constexpr const char* sUserAgent = "presence-bench";
+// Written in the note of the published tuples, followed by "<publisher>.<sequence number>".
+constexpr const char* sMarker = "presence-bench ";
+
+struct BenchArgs {
+	int publishers = 1000;
+	double publishRate = 0.1;
+	int watchers = 100;
+	int subscriptions = 10;
+	int lists = 1;
+	int listSize = 100;
+	int duration = 30;
+	int port = 15065;
+	bool extended = false;
+	bool debug = false;
+
+	static void usage(const char* app) {
+		cout << "Usage: " << app << " [options]" << endl
+		     << endl
+		     << "    --publishers n       number of presentities publishing their state (default: 1000)" << endl
+		     << "    --publish-rate r     PUBLISH requests per second of each publisher (default: 0.1)" << endl
+		     << "    --watchers n         number of watchers (default: 100)" << endl
+		     << "    --subscriptions n    individual subscriptions of each watcher (default: 10)" << endl
+		     << "    --lists n            resource list subscriptions of each watcher (default: 1)" << endl
+		     << "    --list-size n        resources of each list (default: 100)" << endl
+		     << "    --duration s         duration of the measure in seconds (default: 30)" << endl
+		     << "    --port p             TCP port of the presence server on 127.0.0.1 (default: 15065)" << endl
+		     << "    --extended           let the watchers bypass the mutual subscription check, so that they "
+		        "receive the extended PIDF documents"
+		     << endl
+		     << "    --debug" << endl;
+	}
+
+	void parse(int argc, char* argv[]) {
+		for (int i = 1; i < argc; ++i) {
+			string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--publishers" && hasValue) {
+				publishers = atoi(argv[++i]);
+			} else if (arg == "--publish-rate" && hasValue) {
+				publishRate = atof(argv[++i]);
+			} else if (arg == "--watchers" && hasValue) {
+				watchers = atoi(argv[++i]);
+			} else if (arg == "--subscriptions" && hasValue) {
+				subscriptions = atoi(argv[++i]);
+			} else if (arg == "--lists" && hasValue) {
+				lists = atoi(argv[++i]);
+			} else if (arg == "--list-size" && hasValue) {
+				listSize = atoi(argv[++i]);
+			} else if (arg == "--duration" && hasValue) {
+				duration = atoi(argv[++i]);
+			} else if (arg == "--port" && hasValue) {
+				port = atoi(argv[++i]);
+			} else if (arg == "--extended") {
+				extended = true;
+			} else if (arg == "--debug") {
+				debug = true;
+			} else if (arg == "--help" || arg == "-h") {
+				usage(*argv);
+				exit(0);
+			} else {
+				cerr << "? arg" << i << " " << arg << endl;
+				usage(*argv);
+				exit(-1);
+			}
+		}
+		if (publishers <= 0 || publishRate < 0 || watchers < 0 || subscriptions < 0 || lists < 0 || listSize <= 0 ||
+		    duration <= 0 || port <= 0) {
+			usage(*argv);
+			exit(-1);
+		}
+		listSize = min(listSize, publishers);
+	}
+};
+
+/* Latency histogram with a 100us resolution, up to ten seconds. */
+class LatencyHistogram {
+public:
+	void add(nanoseconds latency) {
+		auto bucket = static_cast<size_t>(max<int64_t>(0, latency.count()) / sResolutionNs);
+		mBuckets[min(bucket, mBuckets.size() - 1)]++;
+		mCount++;
+		mMax = max(mMax, latency);
+	}
+	uint64_t count() const {
+		return mCount;
+	}
+	double percentileMs(double p) const {
+		if (mCount == 0) return 0;
+		uint64_t target = static_cast<uint64_t>(p / 100.0 * double(mCount));
+		uint64_t seen = 0;
+		for (size_t i = 0; i < mBuckets.size(); ++i) {
+			seen += mBuckets[i];
+			if (seen > target) return double((i + 1) * sResolutionNs) / 1e6;
+		}
+		return double(mBuckets.size() * sResolutionNs) / 1e6;
+	}
+	double maxMs() const {
+		return double(mMax.count()) / 1e6;
+	}
+
+private:
+	static constexpr int64_t sResolutionNs = 100000;
+	vector<uint64_t> mBuckets = vector<uint64_t>(100000, 0);
+	uint64_t mCount = 0;
+	nanoseconds mMax{0};
+};
+
+struct Publisher {
+	static constexpr uint32_t sSendTimeSlots = 32;
+
+	int index = 0;
+	string uri{};
+	string eTag{};
+	uint32_t seq = 0;
+	bool pending = false;
+	// Sending time of the last PUBLISH requests, indexed by sequence number.
+	steady_clock::time_point sendTimes[sSendTimeSlots]{};
+};
+
+struct Watch {
+	bool isList = false;
+	bool accepted = false;
+	bool rejected = false;
+	uint64_t notifyCount = 0;
+	// Last sequence number received for each publisher, so that the unchanged resources of a full state list NOTIFY
+	// are not counted.
+	unordered_map<int, uint32_t> lastSeqs{};
+};
+
+struct Counters {
+	uint64_t publishSent = 0;
+	uint64_t publishOk = 0;
+	uint64_t publishFailed = 0;
+	uint64_t publishSkipped = 0; // Due while the previous one was not answered yet.
+	uint64_t notifies = 0;
+	uint64_t notifyBytes = 0;
+	uint64_t resourceStates = 0;
+};
+
+nanoseconds threadCpuTime() {
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec);
+}
+
+nanoseconds processCpuTime() {
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+	       microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+size_t residentMemory() {
+	size_t pages = 0, resident = 0;
+	ifstream statm{"/proc/self/statm"};
+	statm >> pages >> resident;
+	return resident * size_t(sysconf(_SC_PAGESIZE));
+}
+
+string userUri(int index) {
+	return "sip:user" + to_string(index) + "@" + sDomain;
+}
+
+/*
+ * The publishers and watchers, sharing a single belle-sip stack.
+ */
+class BenchClient {
+public:
+	BenchClient(const BenchArgs& args) : mArgs(args) {
+		mStack = belle_sip_stack_new(nullptr);
+		auto* lp = belle_sip_stack_create_listening_point(mStack, "127.0.0.1", BELLE_SIP_LISTENING_POINT_RANDOM_PORT,
+		                                                  "TCP");
+		mProvider = belle_sip_stack_create_provider(mStack, lp);
+		mLocalPort = belle_sip_listening_point_get_port(lp);
+		mServerUri.reset(belle_sip_uri_parse(
+		    ("sip:127.0.0.1:" + to_string(args.port) + ";transport=tcp").c_str()));
+
+		belle_sip_listener_callbacks_t callbacks{};
+		callbacks.process_request_event = [](void* data, const belle_sip_request_event_t* event) {
+			static_cast<BenchClient*>(data)->onRequest(event);
+		};
+		callbacks.process_response_event = [](void* data, const belle_sip_response_event_t* event) {
+			static_cast<BenchClient*>(data)->onResponse(event);
+		};
+		callbacks.process_timeout = [](void* data, const belle_sip_timeout_event_t* event) {
+			static_cast<BenchClient*>(data)->onTimeout(event);
+		};
+		mListener = belle_sip_listener_create_from_callbacks(&callbacks, this);
+		belle_sip_provider_add_sip_listener(mProvider, mListener);
+
+		mPublishers.resize(args.publishers);
+		for (int i = 0; i < args.publishers; ++i) {
+			mPublishers[i].index = i;
+			mPublishers[i].uri = userUri(i);
+		}
+		mWatches.resize(size_t(args.watchers) * (args.subscriptions + args.lists));
+	}
+	~BenchClient() {
+		belle_sip_provider_remove_sip_listener(mProvider, mListener);
+		belle_sip_object_unref(mListener);
+		mServerUri.reset(nullptr);
+		belle_sip_object_unref(mProvider);
+		belle_sip_object_unref(mStack);
+	}
+
+	void iterate(milliseconds duration) {
+		belle_sip_main_loop_sleep(belle_sip_stack_get_main_loop(mStack), int(duration.count()));
+	}
+
+	/* Iterate until the condition is met, return false on timeout. */
+	bool waitFor(const function<bool()>& condition, seconds timeout) {
+		auto end = steady_clock::now() + timeout;
+		while (!condition()) {
+			if (steady_clock::now() >= end) return false;
+			iterate(milliseconds(10));
+		}
+		return true;
+	}
+
+	void publish(Publisher& publisher) {
+		if (publisher.pending) {
+			if (mMeasuring) mCounters.publishSkipped++;
+			return;
+		}
+		publisher.seq++;
+		auto* request = createRequest("PUBLISH", publisher.uri, publisher.uri);
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(request),
+		                             BELLE_SIP_HEADER(belle_sip_header_expires_create(3600)));
+		if (!publisher.eTag.empty()) {
+			belle_sip_message_add_header(BELLE_SIP_MESSAGE(request),
+			                             belle_sip_header_create("SIP-If-Match", publisher.eTag.c_str()));
+		}
+		setBody(request, "application", "pidf+xml", makePidf(publisher));
+
+		auto* transaction = belle_sip_provider_create_client_transaction(mProvider, request);
+		belle_sip_transaction_set_application_data(BELLE_SIP_TRANSACTION(transaction), &publisher);
+		publisher.pending = true;
+		publisher.sendTimes[publisher.seq % Publisher::sSendTimeSlots] = steady_clock::now();
+		if (mMeasuring) mCounters.publishSent++;
+		belle_sip_client_transaction_send_request_to(transaction, mServerUri.get());
+	}
+
+	/* Subscribe each watcher to its individual presentities and resource lists, spread over the publishers. */
+	void subscribeAll() {
+		size_t watchIndex = 0;
+		for (int w = 0; w < mArgs.watchers; ++w) {
+			const auto watcherUri = "sip:watcher" + to_string(w) + "@" + sDomain;
+			for (int s = 0; s < mArgs.subscriptions; ++s) {
+				const auto target = (w * mArgs.subscriptions + s) % mArgs.publishers;
+				subscribe(mWatches[watchIndex++], watcherUri, userUri(target), "");
+			}
+			for (int l = 0; l < mArgs.lists; ++l) {
+				const auto first = (w * 7919 + l * mArgs.listSize) % mArgs.publishers;
+				string body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+				              "<resource-lists xmlns=\"urn:ietf:params:xml:ns:resource-lists\"><list>";
+				for (int r = 0; r < mArgs.listSize; ++r) {
+					body += "<entry uri=\"" + userUri((first + r) % mArgs.publishers) + "\"/>";
+				}
+				body += "</list></resource-lists>";
+				subscribe(mWatches[watchIndex++], watcherUri, "sip:list" + to_string(l) + "@" + sDomain, body);
+			}
+		}
+	}
+
+	vector<Publisher>& getPublishers() {
+		return mPublishers;
+	}
+	const vector<Watch>& getWatches() const {
+		return mWatches;
+	}
+	const Counters& getCounters() const {
+		return mCounters;
+	}
+	const LatencyHistogram& getLatencies() const {
+		return mLatencies;
+	}
+	void startMeasure() {
+		mCounters = Counters{};
+		mMeasuring = true;
+	}
+	void stopMeasure() {
+		mMeasuring = false;
+	}
+
+private:
+	belle_sip_request_t* createRequest(const char* method, const string& from, const string& to) {
+		auto* request = belle_sip_request_create(
+		    belle_sip_uri_parse(to.c_str()), method, belle_sip_provider_create_call_id(mProvider),
+		    belle_sip_header_cseq_create(1, method), belle_sip_header_from_create2(from.c_str(), BELLE_SIP_RANDOM_TAG),
+		    belle_sip_header_to_create2(to.c_str(), nullptr), belle_sip_header_via_new(), 70);
+		auto* contact = belle_sip_header_contact_new();
+		auto* contactUri = belle_sip_uri_parse(from.c_str());
+		belle_sip_uri_set_host(contactUri, "127.0.0.1");
+		belle_sip_uri_set_port(contactUri, mLocalPort);
+		belle_sip_uri_set_transport_param(contactUri, "tcp");
+		belle_sip_header_address_set_uri(BELLE_SIP_HEADER_ADDRESS(contact), contactUri);
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(request), BELLE_SIP_HEADER(contact));
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(request),
+		                             BELLE_SIP_HEADER(belle_sip_header_event_create("presence")));
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(request), belle_sip_header_create("User-Agent", sUserAgent));
+		return request;
+	}
+
+	static void setBody(belle_sip_request_t* request, const char* type, const char* subtype, const string& body) {
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(request),
+		                             BELLE_SIP_HEADER(belle_sip_header_content_type_create(type, subtype)));
+		belle_sip_message_set_body(BELLE_SIP_MESSAGE(request), body.c_str(), body.size());
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(request),
+		                             BELLE_SIP_HEADER(belle_sip_header_content_length_create(body.size())));
+	}
+
+	/* A PIDF document as published by Linphone, with an activity changing at each publication. */
+	static string makePidf(const Publisher& publisher) {
+		static const char* activities[] = {"away", "busy", "on-the-phone", "meal"};
+		string pidf = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		              "<presence xmlns=\"urn:ietf:params:xml:ns:pidf\" "
+		              "xmlns:dm=\"urn:ietf:params:xml:ns:pidf:data-model\" "
+		              "xmlns:rpid=\"urn:ietf:params:xml:ns:pidf:rpid\" entity=\"" +
+		              publisher.uri + "\">";
+		pidf += "<tuple id=\"bench" + to_string(publisher.index) + "\"><status><basic>open</basic></status><contact>" +
+		        publisher.uri + "</contact><note>" + sMarker + to_string(publisher.index) + "." +
+		        to_string(publisher.seq) + "</note></tuple>";
+		pidf += "<dm:person id=\"bench" + to_string(publisher.index) + "\"><rpid:activities><rpid:" +
+		        activities[publisher.seq % 4] + "/></rpid:activities></dm:person></presence>";
+		return pidf;
+	}
+
+	void subscribe(Watch& watch, const string& watcherUri, const string& target, const string& listBody) {
+		auto* request = createRequest("SUBSCRIBE", watcherUri, target);
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(request),
+		                             BELLE_SIP_HEADER(belle_sip_header_expires_create(mArgs.duration + 600)));
+		watch.isList = !listBody.empty();
+		if (watch.isList) {
+			belle_sip_message_add_header(BELLE_SIP_MESSAGE(request), belle_sip_header_create("Supported", "eventlist"));
+			belle_sip_message_add_header(
+			    BELLE_SIP_MESSAGE(request),
+			    belle_sip_header_create("Accept", "application/pidf+xml, application/rlmi+xml, multipart/related"));
+			belle_sip_message_add_header(BELLE_SIP_MESSAGE(request),
+			                             belle_sip_header_create("Content-Disposition", "recipient-list"));
+			setBody(request, "application", "resource-lists+xml", listBody);
+		} else {
+			belle_sip_message_add_header(BELLE_SIP_MESSAGE(request),
+			                             belle_sip_header_create("Accept", "application/pidf+xml"));
+		}
+
+		auto* transaction = belle_sip_provider_create_client_transaction(mProvider, request);
+		belle_sip_transaction_set_application_data(BELLE_SIP_TRANSACTION(transaction), &watch);
+		auto* dialog = belle_sip_provider_create_dialog(mProvider, BELLE_SIP_TRANSACTION(transaction));
+		belle_sip_dialog_set_application_data(dialog, &watch);
+		belle_sip_client_transaction_send_request_to(transaction, mServerUri.get());
+	}
+
+	static const char* getMethod(belle_sip_client_transaction_t* transaction) {
+		return belle_sip_request_get_method(belle_sip_transaction_get_request(BELLE_SIP_TRANSACTION(transaction)));
+	}
+
+	void onRequest(const belle_sip_request_event_t* event) {
+		auto* request = belle_sip_request_event_get_request(event);
+		auto* transaction = belle_sip_provider_create_server_transaction(mProvider, request);
+		auto isNotify = strcmp(belle_sip_request_get_method(request), "NOTIFY") == 0;
+		belle_sip_server_transaction_send_response(
+		    transaction, belle_sip_response_create_from_request(request, isNotify ? 200 : 405));
+		auto* dialog = belle_sip_request_event_get_dialog(event);
+		if (!isNotify || !dialog) return;
+		auto* watch = static_cast<Watch*>(belle_sip_dialog_get_application_data(dialog));
+		if (!watch) return;
+
+		watch->notifyCount++;
+		const auto* body = belle_sip_message_get_body(BELLE_SIP_MESSAGE(request));
+		const auto bodySize = belle_sip_message_get_body_size(BELLE_SIP_MESSAGE(request));
+		if (mMeasuring) {
+			mCounters.notifies++;
+			mCounters.notifyBytes += bodySize;
+		}
+		if (!body) return;
+
+		const auto now = steady_clock::now();
+		const string content{body, bodySize};
+		const auto markerSize = strlen(sMarker);
+		for (auto pos = content.find(sMarker); pos != string::npos; pos = content.find(sMarker, pos)) {
+			pos += markerSize;
+			char* end = nullptr;
+			const auto index = strtol(content.c_str() + pos, &end, 10);
+			if (*end != '.' || index < 0 || index >= long(mPublishers.size())) continue;
+			const auto seq = uint32_t(strtoul(end + 1, nullptr, 10));
+
+			auto& lastSeq = watch->lastSeqs[int(index)];
+			if (seq <= lastSeq) continue;
+			lastSeq = seq;
+			if (!mMeasuring) continue;
+			mCounters.resourceStates++;
+			const auto& publisher = mPublishers[index];
+			if (seq + Publisher::sSendTimeSlots > publisher.seq) {
+				mLatencies.add(now - publisher.sendTimes[seq % Publisher::sSendTimeSlots]);
+			}
+		}
+	}
+
+	void onResponse(const belle_sip_response_event_t* event) {
+		auto* transaction = belle_sip_response_event_get_client_transaction(event);
+		if (!transaction) return;
+		auto* response = belle_sip_response_event_get_response(event);
+		const auto code = belle_sip_response_get_status_code(response);
+		if (code < 200) return;
+		auto* data = belle_sip_transaction_get_application_data(BELLE_SIP_TRANSACTION(transaction));
+		const auto* method = getMethod(transaction);
+
+		if (strcmp(method, "PUBLISH") == 0) {
+			auto* publisher = static_cast<Publisher*>(data);
+			publisher->pending = false;
+			if (code < 300) {
+				auto* eTag = belle_sip_message_get_header(BELLE_SIP_MESSAGE(response), "SIP-ETag");
+				if (eTag) publisher->eTag = belle_sip_header_get_unparsed_value(eTag);
+				if (mMeasuring) mCounters.publishOk++;
+			} else {
+				// The publication is lost (412), the next PUBLISH starts a new one.
+				publisher->eTag.clear();
+				if (mMeasuring) mCounters.publishFailed++;
+			}
+		} else if (strcmp(method, "SUBSCRIBE") == 0) {
+			auto* watch = static_cast<Watch*>(data);
+			if (code < 300) watch->accepted = true;
+			else watch->rejected = true;
+		}
+	}
+
+	void onTimeout(const belle_sip_timeout_event_t* event) {
+		auto* transaction = belle_sip_timeout_event_get_client_transaction(event);
+		if (!transaction) return;
+		auto* data = belle_sip_transaction_get_application_data(BELLE_SIP_TRANSACTION(transaction));
+		const auto* method = getMethod(transaction);
+		if (strcmp(method, "PUBLISH") == 0) {
+			auto* publisher = static_cast<Publisher*>(data);
+			publisher->pending = false;
+			publisher->eTag.clear();
+			if (mMeasuring) mCounters.publishFailed++;
+		} else if (strcmp(method, "SUBSCRIBE") == 0) {
+			static_cast<Watch*>(data)->rejected = true;
+		}
+	}
+
+	const BenchArgs& mArgs;
+	belle_sip_stack_t* mStack = nullptr;
+	belle_sip_provider_t* mProvider = nullptr;
+	belle_sip_listener_t* mListener = nullptr;
+	int mLocalPort = 0;
+	bellesip::shared_ptr<belle_sip_uri_t> mServerUri{};
+	vector<Publisher> mPublishers{};
+	vector<Watch> mWatches{};
+	Counters mCounters{};
+	LatencyHistogram mLatencies{};
+	bool mMeasuring = false;
+};
+
+/*
+ * Send the PUBLISH requests that are due, each publisher at the requested rate, until the end of the measure.
+ */
+void runPublishers(BenchClient& client, double rate, steady_clock::time_point end) {
+	auto& publishers = client.getPublishers();
+	using Due = pair<steady_clock::time_point, int>;
+	priority_queue<Due, vector<Due>, greater<Due>> queue{};
+	if (rate > 0) {
+		const auto period = duration_cast<nanoseconds>(duration<double>(1.0 / rate));
+		// Spread the publishers over one period.
+		const auto start = steady_clock::now();
+		for (size_t i = 0; i < publishers.size(); ++i) {
+			queue.emplace(start + period * int64_t(i) / int64_t(publishers.size()), int(i));
+		}
+		while (steady_clock::now() < end) {
+			const auto now = steady_clock::now();
+			while (!queue.empty() && queue.top().first <= now) {
+				auto due = queue.top();
+				queue.pop();
+				client.publish(publishers[due.second]);
+				queue.emplace(due.first + period, due.second);
+			}
+			client.iterate(milliseconds(1));
+		}
+	} else {
+		while (steady_clock::now() < end) client.iterate(milliseconds(10));
+	}
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	BenchArgs args{};
+	args.parse(argc, argv);
+
+	LogManager::Parameters logParams{};
+	logParams.level = args.debug ? BCTBX_LOG_DEBUG : BCTBX_LOG_ERROR;
+	logParams.enableSyslog = false;
+	logParams.enableStdout = true;
+	LogManager::get().initialize(logParams);
+
+	rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	// The Agent declares the configuration items read by the presence server.
+	auto root = make_shared<sofiasip::SuRoot>();
+	auto agent = make_shared<Agent>(root);
+	auto cfg = GenericManager::get();
+	cfg->load("");
+	auto presenceConfig = cfg->getRoot()->get<GenericStruct>("presence-server");
+	presenceConfig->get<ConfigValue>("transports")->set("sip:127.0.0.1:" + to_string(args.port) + ";transport=tcp");
+	presenceConfig->get<ConfigValue>("long-term-enabled")->set("false");
+	if (args.extended) presenceConfig->get<ConfigValue>("bypass-condition")->set(sUserAgent);
+
+	auto presenceServer = make_shared<PresenceServer>(root);
+	try {
+		presenceServer->init();
+	} catch (const exception& e) {
+		cerr << "Cannot start the presence server: " << e.what() << endl;
+		return 1;
+	}
+
+	atomic_bool serverRunning{true};
+	thread serverThread{[&root, &serverRunning]() {
+		while (serverRunning) root->step(milliseconds(100));
+	}};
+
+	const auto subscriptionCount = size_t(args.watchers) * (args.subscriptions + args.lists);
+	cout << "Presence server benchmark: " << args.publishers << " publishers at " << args.publishRate
+	     << " PUBLISH/s each, " << args.watchers << " watchers with " << args.subscriptions
+	     << " individual subscription(s) and " << args.lists << " list(s) of " << args.listSize << " resources"
+	     << (args.extended ? ", extended PIDF" : "") << endl;
+
+	int status = 0;
+	{
+		BenchClient client{args};
+		const auto rssStart = residentMemory();
+
+		// Setup: one publication per presentity, then the subscriptions and their first NOTIFY.
+		auto start = steady_clock::now();
+		for (auto& publisher : client.getPublishers()) {
+			client.publish(publisher);
+			// Let the server answer from time to time, not to overflow the transport.
+			if (publisher.index % 100 == 99) client.iterate(milliseconds(1));
+		}
+		auto published = client.waitFor(
+		    [&client]() {
+			    const auto& publishers = client.getPublishers();
+			    return none_of(publishers.begin(), publishers.end(), [](const Publisher& p) { return p.pending; });
+		    },
+		    seconds(60));
+		const auto publishTime = duration<double>(steady_clock::now() - start).count();
+
+		start = steady_clock::now();
+		client.subscribeAll();
+		auto subscribed = client.waitFor(
+		    [&client]() {
+			    const auto& watches = client.getWatches();
+			    return all_of(watches.begin(), watches.end(),
+			                  [](const Watch& w) { return w.rejected || (w.accepted && w.notifyCount > 0); });
+		    },
+		    seconds(120));
+		const auto subscribeTime = duration<double>(steady_clock::now() - start).count();
+		const auto& watches = client.getWatches();
+		const auto rejected = count_if(watches.begin(), watches.end(), [](const Watch& w) { return w.rejected; });
+		const auto rssSetup = residentMemory();
+
+		cout << fixed << setprecision(2) << "Setup: " << args.publishers << " presentities published in "
+		     << publishTime << "s" << (published ? "" : " (TIMEOUT)") << ", " << subscriptionCount
+		     << " subscriptions in " << subscribeTime << "s" << (subscribed ? "" : " (TIMEOUT)") << ", " << rejected
+		     << " rejected" << endl;
+
+		// Measure.
+		client.startMeasure();
+		const auto cpuStart = processCpuTime();
+		const auto clientCpuStart = threadCpuTime();
+		start = steady_clock::now();
+		runPublishers(client, args.publishRate, start + seconds(args.duration));
+		// Wait for the NOTIFY requests still in flight.
+		client.iterate(seconds(1));
+		client.stopMeasure();
+		const auto wallTime = duration<double>(steady_clock::now() - start).count();
+		const auto serverCpu = processCpuTime() - cpuStart - (threadCpuTime() - clientCpuStart);
+
+		const auto& c = client.getCounters();
+		const auto& latencies = client.getLatencies();
+		cout << "Measure (" << args.duration << "s):" << endl
+		     << "  PUBLISH:   " << c.publishSent / double(args.duration) << "/s sent, " << c.publishOk << " ok, "
+		     << c.publishFailed << " failed, " << c.publishSkipped << " skipped (previous one unanswered)" << endl
+		     << "  NOTIFY:    " << c.notifies / wallTime << "/s, " << c.notifyBytes / wallTime / 1024
+		     << " kB/s of bodies, " << c.resourceStates / wallTime << " new resource states/s" << endl
+		     << "  Latency from PUBLISH to NOTIFY (ms): p50 " << latencies.percentileMs(50) << ", p90 "
+		     << latencies.percentileMs(90) << ", p99 " << latencies.percentileMs(99) << ", max "
+		     << latencies.maxMs() << " (" << latencies.count() << " samples)" << endl
+		     << "  Presence server CPU: " << 100.0 * duration<double>(serverCpu).count() / wallTime << "% of a core"
+		     << endl;
+
+		serverRunning = false;
+		serverThread.join();
+
+		const auto presentities = presenceConfig->get<StatCounter64>("count-presentities")->read();
+		cout << "Memory: " << presentities << " presentities, "
+		     << presenceConfig->get<StatCounter64>("presentity-average-bytes")->read()
+		     << " bytes per presentity as estimated by the presence server, "
+		     << (presentities ? double(rssSetup - min(rssSetup, rssStart)) / presentities : 0.0)
+		     << " bytes of resident memory per presentity (subscriptions and benchmark client included)" << endl;
+
+		if (!published || !subscribed || (args.publishRate > 0 && c.publishOk == 0)) status = 1;
+	}
+
+	presenceServer.reset();
+	return status;
+}
@@ -0,0 +1,103 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace flexisip {
+
+/**
+ * Groups items added from any thread into batches.
+ * A batch is handed to the flush callback as soon as it holds maxSize items, or when its first item has waited for
+ * maxDelay. The callback is called from a thread owned by the batcher, one batch at a time, so it should only dispatch
+ * the processing of the batch. The items still queued are flushed on destruction.
+ */
+template <typename T>
+class Batcher {
+public:
+	using FlushCallback = std::function<void(std::vector<T>&&)>;
+
+	Batcher(std::size_t maxSize, std::chrono::milliseconds maxDelay, const FlushCallback& flush)
+	    : mMaxSize(maxSize > 0 ? maxSize : 1), mMaxDelay(maxDelay), mFlush(flush) {
+		mThread = std::thread{&Batcher::run, this};
+	}
+	~Batcher() {
+		{
+			std::unique_lock<std::mutex> lck(mMutex);
+			mStopped = true;
+		}
+		mCond.notify_one();
+		mThread.join();
+	}
+	Batcher(const Batcher&) = delete;
+	Batcher& operator=(const Batcher&) = delete;
+
+	void add(T&& item) {
+		std::unique_lock<std::mutex> lck(mMutex);
+		if (mItems.empty()) mFirstItemDate = std::chrono::steady_clock::now();
+		mItems.push_back(std::move(item));
+		// The thread only has to be woken up to start the delay of a new batch, or when the batch is full.
+		if (mItems.size() == 1 || mItems.size() >= mMaxSize) {
+			lck.unlock();
+			mCond.notify_one();
+		}
+	}
+
+private:
+	void run() {
+		std::unique_lock<std::mutex> lck(mMutex);
+		while (true) {
+			mCond.wait(lck, [this] { return mStopped || !mItems.empty(); });
+			if (mItems.empty()) return;
+			mCond.wait_until(lck, mFirstItemDate + mMaxDelay,
+			                 [this] { return mStopped || mItems.size() >= mMaxSize; });
+
+			std::vector<T> batch{};
+			if (mItems.size() <= mMaxSize) {
+				batch.swap(mItems);
+			} else {
+				batch.assign(std::make_move_iterator(mItems.begin()),
+				             std::make_move_iterator(mItems.begin() + mMaxSize));
+				mItems.erase(mItems.begin(), mItems.begin() + mMaxSize);
+				mFirstItemDate = std::chrono::steady_clock::now();
+			}
+			lck.unlock();
+			mFlush(std::move(batch));
+			lck.lock();
+		}
+	}
+
+	const std::size_t mMaxSize;
+	const std::chrono::milliseconds mMaxDelay;
+	const FlushCallback mFlush;
+	std::mutex mMutex{};
+	std::condition_variable mCond{};
+	std::vector<T> mItems{};
+	std::chrono::steady_clock::time_point mFirstItemDate{};
+	bool mStopped = false;
+	std::thread mThread{};
+};
+
+} // namespace flexisip
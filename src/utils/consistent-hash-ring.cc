@@ -0,0 +1,88 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "consistent-hash-ring.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+namespace {
+
+const string sNoNode{};
+
+// Spread the bits of the FNV hash, whose low bits are poorly mixed for close inputs.
+uint64_t mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+} // namespace
+
+ConsistentHashRing::ConsistentHashRing(const vector<string>& nodes, unsigned pointsPerNode)
+    : mPointsPerNode(max(pointsPerNode, 1U)) {
+	for (const auto& node : nodes) {
+		addNode(node);
+	}
+}
+
+uint64_t ConsistentHashRing::hash(const string& data) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (auto c : data) {
+		h ^= static_cast<unsigned char>(c);
+		h *= 0x100000001b3ULL;
+	}
+	return mix(h);
+}
+
+void ConsistentHashRing::addNode(const string& node) {
+	if (find(mNodes.begin(), mNodes.end(), node) != mNodes.end()) return;
+	mNodes.push_back(node);
+	for (unsigned i = 0; i < mPointsPerNode; i++) {
+		// On a collision, the node whose name is the smallest keeps the point, whatever the order of insertion.
+		auto inserted = mRing.emplace(hash(node + '#' + to_string(i)), node);
+		if (!inserted.second && node < inserted.first->second) inserted.first->second = node;
+	}
+}
+
+void ConsistentHashRing::removeNode(const string& node) {
+	auto it = find(mNodes.begin(), mNodes.end(), node);
+	if (it == mNodes.end()) return;
+	mNodes.erase(it);
+	mRing.clear();
+	auto nodes = move(mNodes);
+	mNodes.clear();
+	for (const auto& remaining : nodes) {
+		addNode(remaining);
+	}
+}
+
+const string& ConsistentHashRing::getOwner(const string& key) const {
+	if (mRing.empty()) return sNoNode;
+	auto it = mRing.lower_bound(hash(key));
+	if (it == mRing.end()) it = mRing.begin();
+	return it->second;
+}
+
+} // namespace flexisip
@@ -0,0 +1,66 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace flexisip {
+
+/**
+ * Assignment of keys to the nodes of a cluster by consistent hashing: each node is placed at several points of a ring
+ * of hashes, and a key belongs to the first node found after its own hash. Adding or removing a node only moves the
+ * keys of its neighbourhood.
+ * The hash function doesn't depend on the platform, so that every process of the cluster given the same nodes agrees
+ * on the owners.
+ */
+class ConsistentHashRing {
+public:
+	/**
+	 * @param pointsPerNode Number of points of the ring per node, the more evenly the keys are spread.
+	 */
+	explicit ConsistentHashRing(const std::vector<std::string>& nodes = {}, unsigned pointsPerNode = 160);
+
+	void addNode(const std::string& node);
+	void removeNode(const std::string& node);
+
+	bool empty() const {
+		return mRing.empty();
+	}
+	const std::vector<std::string>& getNodes() const {
+		return mNodes;
+	}
+
+	/**
+	 * @return The node owning the key, or an empty string if the ring has no node.
+	 */
+	const std::string& getOwner(const std::string& key) const;
+
+	// 64 bits FNV-1a.
+	static std::uint64_t hash(const std::string& data);
+
+private:
+	unsigned mPointsPerNode;
+	std::vector<std::string> mNodes{};
+	std::map<std::uint64_t, std::string> mRing{};
+};
+
+} // namespace flexisip
@@ -0,0 +1,168 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace flexisip {
+
+/**
+ * Thread-safe cache whose entries expire after a duration given on insertion.
+ * Entries are spread over several shards, each with its own lock, so that concurrent accesses to different keys
+ * seldom contend.
+ * The cache can also remember that a key is known to have no value (negative entries), and tells its user once when
+ * an entry enters the last part of its lifetime, so that it can be refreshed before expiring (refresh-ahead).
+ * Expired entries are removed when they are looked up, and each shard is purged from time to time on insertion.
+ */
+template <typename ValueT>
+class ExpiringCache {
+public:
+	enum class Status {
+		Hit,         // A valid value has been found.
+		NegativeHit, // The key is known to have no value.
+		Expired,     // The entry of the key has expired, the expired value is returned anyway.
+		Miss,
+	};
+
+	/**
+	 * @param refreshAheadPercent Percentage of the lifetime of the entries, at its end, during which their refresh is
+	 * requested. 0 disables the refresh-ahead.
+	 */
+	explicit ExpiringCache(unsigned refreshAheadPercent = 0) : mRefreshAheadPercent(refreshAheadPercent) {
+	}
+
+	/**
+	 * Only affects the entries inserted afterwards. Not thread-safe.
+	 */
+	void setRefreshAheadPercent(unsigned refreshAheadPercent) {
+		mRefreshAheadPercent = refreshAheadPercent;
+	}
+
+	/**
+	 * @param[out] value The value found, if any.
+	 * @param[out] refresh Set to true if the caller should refresh the entry. This happens only once per entry.
+	 */
+	Status get(const std::string& key, std::time_t now, ValueT& value, bool* refresh = nullptr) {
+		auto& shard = getShard(key);
+		std::unique_lock<std::mutex> lck(shard.mutex);
+		auto it = shard.entries.find(key);
+		if (it == shard.entries.end()) return Status::Miss;
+		auto& entry = it->second;
+		if (now >= entry.expireDate) {
+			const bool negative = entry.negative;
+			if (!negative) value = std::move(entry.value);
+			shard.entries.erase(it);
+			return negative ? Status::Miss : Status::Expired;
+		}
+		if (refresh && !entry.refreshing && now >= entry.refreshDate) {
+			entry.refreshing = true;
+			*refresh = true;
+		}
+		if (entry.negative) return Status::NegativeHit;
+		value = entry.value;
+		return Status::Hit;
+	}
+
+	void put(const std::string& key, const ValueT& value, std::time_t now, int expires) {
+		insert(key, Entry{value, false, now, expires, mRefreshAheadPercent}, now);
+	}
+	/**
+	 * Remember that the key has no value. Negative entries are not refreshed ahead of their expiration.
+	 */
+	void putNegative(const std::string& key, std::time_t now, int expires) {
+		insert(key, Entry{ValueT{}, true, now, expires, 0}, now);
+	}
+
+	void erase(const std::string& key) {
+		auto& shard = getShard(key);
+		std::unique_lock<std::mutex> lck(shard.mutex);
+		shard.entries.erase(key);
+	}
+
+	void clear() {
+		for (auto& shard : mShards) {
+			std::unique_lock<std::mutex> lck(shard.mutex);
+			shard.entries.clear();
+		}
+	}
+
+	size_t size() {
+		size_t size = 0;
+		for (auto& shard : mShards) {
+			std::unique_lock<std::mutex> lck(shard.mutex);
+			size += shard.entries.size();
+		}
+		return size;
+	}
+
+private:
+	static constexpr size_t sShardCount = 16;
+	// Number of insertions in a shard between two purges of its expired entries.
+	static constexpr unsigned sPurgeInterval = 1024;
+
+	struct Entry {
+		Entry(const ValueT& v, bool n, std::time_t now, int expires, unsigned refreshAheadPercent)
+		    : value(v), expireDate(now + expires),
+		      refreshDate(expireDate - std::time_t(expires) * refreshAheadPercent / 100), negative(n),
+		      refreshing(refreshAheadPercent == 0) {
+		}
+
+		ValueT value;
+		std::time_t expireDate;
+		std::time_t refreshDate;
+		bool negative;
+		bool refreshing;
+	};
+
+	struct Shard {
+		std::mutex mutex{};
+		std::unordered_map<std::string, Entry> entries{};
+		unsigned insertionsSincePurge = 0;
+	};
+
+	Shard& getShard(const std::string& key) {
+		return mShards[std::hash<std::string>{}(key) % sShardCount];
+	}
+
+	void insert(const std::string& key, Entry&& entry, std::time_t now) {
+		auto& shard = getShard(key);
+		std::unique_lock<std::mutex> lck(shard.mutex);
+		if (++shard.insertionsSincePurge >= sPurgeInterval) {
+			// Entries which are never looked up again, negative ones typically, would stay forever otherwise.
+			shard.insertionsSincePurge = 0;
+			for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+				if (now >= it->second.expireDate) it = shard.entries.erase(it);
+				else ++it;
+			}
+		}
+		auto it = shard.entries.find(key);
+		if (it != shard.entries.end()) it->second = std::move(entry);
+		else shard.entries.emplace(key, std::move(entry));
+	}
+
+	std::array<Shard, sShardCount> mShards{};
+	unsigned mRefreshAheadPercent;
+};
+
+} // namespace flexisip
@@ -0,0 +1,137 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace flexisip {
+
+/**
+ * Thread-safe cache holding at most a given number of entries, the least recently used one being dropped to make
+ * room for a new one. Like ExpiringCache, entries expire after a duration given on insertion, and the cache can
+ * remember that a key has no value (negative entries).
+ */
+template <typename ValueT>
+class LruCache {
+public:
+	enum class Status {
+		Hit,         // A valid value has been found.
+		NegativeHit, // The key is known to have no value.
+		Miss,
+	};
+
+	/**
+	 * @param capacity Maximum number of entries. 0 disables the cache.
+	 */
+	explicit LruCache(std::size_t capacity = 0) : mCapacity(capacity) {
+	}
+
+	void setCapacity(std::size_t capacity) {
+		std::unique_lock<std::mutex> lck(mMutex);
+		mCapacity = capacity;
+		trim();
+	}
+
+	/**
+	 * @param[out] value The value found, if any.
+	 */
+	Status get(const std::string& key, std::time_t now, ValueT& value) {
+		std::unique_lock<std::mutex> lck(mMutex);
+		auto it = mIndex.find(key);
+		if (it == mIndex.end()) return Status::Miss;
+		auto entry = it->second;
+		if (now >= entry->second.expireDate) {
+			mIndex.erase(it);
+			mEntries.erase(entry);
+			return Status::Miss;
+		}
+		mEntries.splice(mEntries.begin(), mEntries, entry);
+		if (entry->second.negative) return Status::NegativeHit;
+		value = entry->second.value;
+		return Status::Hit;
+	}
+
+	void put(const std::string& key, const ValueT& value, std::time_t now, int expires) {
+		insert(key, Entry{value, now + expires, false});
+	}
+	void putNegative(const std::string& key, std::time_t now, int expires) {
+		insert(key, Entry{ValueT{}, now + expires, true});
+	}
+
+	void erase(const std::string& key) {
+		std::unique_lock<std::mutex> lck(mMutex);
+		auto it = mIndex.find(key);
+		if (it == mIndex.end()) return;
+		mEntries.erase(it->second);
+		mIndex.erase(it);
+	}
+
+	void clear() {
+		std::unique_lock<std::mutex> lck(mMutex);
+		mIndex.clear();
+		mEntries.clear();
+	}
+
+	std::size_t size() {
+		std::unique_lock<std::mutex> lck(mMutex);
+		return mEntries.size();
+	}
+
+private:
+	struct Entry {
+		ValueT value;
+		std::time_t expireDate;
+		bool negative;
+	};
+	// Most recently used first.
+	using EntryList = std::list<std::pair<std::string, Entry>>;
+
+	void insert(const std::string& key, Entry&& entry) {
+		std::unique_lock<std::mutex> lck(mMutex);
+		if (mCapacity == 0) return;
+		auto it = mIndex.find(key);
+		if (it != mIndex.end()) {
+			it->second->second = std::move(entry);
+			mEntries.splice(mEntries.begin(), mEntries, it->second);
+			return;
+		}
+		mEntries.emplace_front(key, std::move(entry));
+		mIndex.emplace(key, mEntries.begin());
+		trim();
+	}
+
+	void trim() {
+		while (mEntries.size() > mCapacity) {
+			mIndex.erase(mEntries.back().first);
+			mEntries.pop_back();
+		}
+	}
+
+	std::mutex mMutex{};
+	EntryList mEntries{};
+	std::unordered_map<std::string, typename EntryList::iterator> mIndex{};
+	std::size_t mCapacity;
+};
+
+} // namespace flexisip
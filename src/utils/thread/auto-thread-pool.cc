@@ -27,18 +27,6 @@ using namespace std;
 
 namespace flexisip {
 
-std::unique_ptr<AutoThreadPool> AutoThreadPool::sGlobalThreadPool{};
-
-std::unique_ptr<AutoThreadPool>& AutoThreadPool::getGlobalThreadPool() {
-	if (!sGlobalThreadPool) {
-		unsigned int cores = std::thread::hardware_concurrency();
-		auto threadCount = (cores ? cores : 8) * 8;
-		sGlobalThreadPool = std::make_unique<AutoThreadPool>(threadCount, 0);
-	}
-
-	return sGlobalThreadPool;
-}
-
 AutoThreadPool::AutoThreadPool(unsigned int maxThreadNumber, unsigned int maxQueueSize)
     : BaseThreadPool(maxQueueSize, maxThreadNumber) {
 	SLOGD << "AutoThreadPool [" << this << "]: init with " << maxThreadNumber << " threads and queue size "
@@ -42,8 +42,6 @@ public:
 
 	void stop() final;
 
-	static std::unique_ptr<AutoThreadPool>& getGlobalThreadPool();
-
 private:
 	/**
 	 * This method is called by the main thread.
@@ -57,8 +55,6 @@ private:
 
 	std::unique_ptr<std::thread> mainThread{};
 	std::atomic_uint mCurrentThreadNumber{0};
-
-	static std::unique_ptr<AutoThreadPool> sGlobalThreadPool;
 };
 
 } // namespace flexisip
@@ -0,0 +1,214 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <system_error>
+
+#include "flexisip/logmanager.hh"
+
+#include "work-stealing-thread-pool.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+
+constexpr size_t WorkStealingThreadPool::sPriorityCount;
+thread_local WorkStealingThreadPool* WorkStealingThreadPool::sCurrentPool = nullptr;
+thread_local size_t WorkStealingThreadPool::sCurrentWorker = 0;
+unique_ptr<WorkStealingThreadPool> WorkStealingThreadPool::sGlobalThreadPool{};
+
+unique_ptr<WorkStealingThreadPool>& WorkStealingThreadPool::getGlobalThreadPool() {
+	if (!sGlobalThreadPool) {
+		unsigned int cores = thread::hardware_concurrency();
+		// Most of the tasks of the global pool wait for a database, hence many more threads than cores.
+		auto threadCount = (cores ? cores : 8) * 8;
+		sGlobalThreadPool = make_unique<WorkStealingThreadPool>(threadCount, threadCount * 100);
+	}
+
+	return sGlobalThreadPool;
+}
+
+WorkStealingThreadPool::WorkStealingThreadPool(unsigned int maxThreadNumber, unsigned int maxQueueSize)
+    : mMaxQueueSize(maxQueueSize) {
+	SLOGD << "WorkStealingThreadPool [" << this << "]: init with " << maxThreadNumber << " threads and queue size "
+	      << maxQueueSize;
+
+	if (maxThreadNumber == 0) maxThreadNumber = 1;
+	for (unsigned int i = 0; i < maxThreadNumber; i++) {
+		mWorkers.emplace_back(make_unique<Worker>());
+	}
+	mWorkers[0]->thread = thread{&WorkStealingThreadPool::_run, this, 0};
+	mStartedWorkers = 1;
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+	if (!mStopped) stop();
+}
+
+bool WorkStealingThreadPool::run(Task t) {
+	return run(move(t), Priority::Normal);
+}
+
+bool WorkStealingThreadPool::run(Task t, Priority priority) {
+	if (mShutdown) return false;
+	// Reserve a place in the queues first, so that the bound is never exceeded.
+	if (mQueuedTasks.fetch_add(1) >= mMaxQueueSize && mMaxQueueSize != 0) {
+		mQueuedTasks--;
+		mRejectedTasks++;
+		return false;
+	}
+
+	const auto workerIndex = sCurrentPool == this ? sCurrentWorker : mNextWorker++ % mStartedWorkers;
+	auto& worker = *mWorkers[workerIndex];
+	{
+		lock_guard<mutex> lock(worker.mutex);
+		worker.queues[static_cast<size_t>(priority)].push_back(QueuedTask{move(t), steady_clock::now()});
+	}
+
+	// Wake up a thread only if one is waiting. Both the number of queued tasks and of idle threads are sequentially
+	// consistent, so that a thread going to sleep either sees the new task, or is seen as idle here.
+	if (mIdleWorkers > 0) {
+		{ lock_guard<mutex> lock(mSleepMutex); }
+		mSleepCondition.notify_one();
+	}
+	startWorkerIfNeeded();
+	return true;
+}
+
+void WorkStealingThreadPool::startWorkerIfNeeded() {
+	if (mQueuedTasks <= mIdleWorkers || mStartedWorkers == mWorkers.size()) return;
+
+	lock_guard<mutex> lock(mStartMutex);
+	const size_t workerIndex = mStartedWorkers;
+	if (mShutdown || workerIndex == mWorkers.size()) return;
+	try {
+		mWorkers[workerIndex]->thread = thread{&WorkStealingThreadPool::_run, this, workerIndex};
+		mStartedWorkers++;
+	} catch (const system_error& e) {
+		// The threads already started run the task anyway.
+		SLOGE << "WorkStealingThreadPool [" << this << "]: error while creating a new thread (n°" << workerIndex + 1
+		      << "), with error :\n"
+		      << e.what();
+	}
+}
+
+void WorkStealingThreadPool::stop() {
+	SLOGD << "WorkStealingThreadPool [" << this << "]: shutdown";
+	{
+		lock_guard<mutex> lock(mSleepMutex);
+		mShutdown = true;
+	}
+
+	// Wake up all threads, they exit once all the queued tasks are done.
+	mSleepCondition.notify_all();
+
+	// No thread is started once shut down, but one may be being started right now.
+	size_t startedWorkers;
+	{
+		lock_guard<mutex> lock(mStartMutex);
+		startedWorkers = mStartedWorkers;
+	}
+	for (size_t i = 0; i < startedWorkers; i++) {
+		mWorkers[i]->thread.join();
+	}
+
+	mStopped = true;
+}
+
+WorkStealingThreadPool::Stats WorkStealingThreadPool::getStats() const {
+	return Stats{mQueuedTasks.load(),
+	             mExecutedTasks.load(),
+	             mRejectedTasks.load(),
+	             mStolenTasks.load(),
+	             microseconds{mTotalWaitTimeUs.load()},
+	             microseconds{mMaxWaitTimeUs.load()},
+	             microseconds{mTotalRunTimeUs.load()}};
+}
+
+void WorkStealingThreadPool::_run(size_t workerIndex) {
+	sCurrentPool = this;
+	sCurrentWorker = workerIndex;
+
+	QueuedTask task{};
+	while (true) {
+		if (popTask(workerIndex, task)) {
+			execute(task);
+			continue;
+		}
+
+		unique_lock<mutex> lock(mSleepMutex);
+		mIdleWorkers++;
+		mSleepCondition.wait(lock, [this]() { return mQueuedTasks > 0 || mShutdown; });
+		mIdleWorkers--;
+		// Once shut down, the threads keep running until all the queued tasks are done.
+		if (mShutdown && mQueuedTasks == 0) {
+			SLOGD << "WorkStealingThreadPool [" << this << "]: terminate thread";
+			return;
+		}
+	}
+}
+
+bool WorkStealingThreadPool::popTask(size_t workerIndex, QueuedTask& task) {
+	const size_t workerCount = mStartedWorkers;
+	for (size_t priority = 0; priority < sPriorityCount; priority++) {
+		// Own tasks first, in the order they were submitted.
+		{
+			auto& worker = *mWorkers[workerIndex];
+			lock_guard<mutex> lock(worker.mutex);
+			auto& queue = worker.queues[priority];
+			if (!queue.empty()) {
+				task = move(queue.front());
+				queue.pop_front();
+				mQueuedTasks--;
+				return true;
+			}
+		}
+		// Then the tasks of the other threads, in the order they were submitted too.
+		for (size_t i = 1; i < workerCount; i++) {
+			auto& victim = *mWorkers[(workerIndex + i) % workerCount];
+			lock_guard<mutex> lock(victim.mutex);
+			auto& queue = victim.queues[priority];
+			if (!queue.empty()) {
+				task = move(queue.front());
+				queue.pop_front();
+				mQueuedTasks--;
+				mStolenTasks++;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void WorkStealingThreadPool::execute(QueuedTask& task) {
+	const auto start = steady_clock::now();
+	const uint64_t waitTime = duration_cast<microseconds>(start - task.enqueueDate).count();
+	mTotalWaitTimeUs += waitTime;
+	auto maxWaitTime = mMaxWaitTimeUs.load();
+	while (waitTime > maxWaitTime && !mMaxWaitTimeUs.compare_exchange_weak(maxWaitTime, waitTime)) {
+	}
+
+	task.task();
+
+	mTotalRunTimeUs += duration_cast<microseconds>(steady_clock::now() - start).count();
+	mExecutedTasks++;
+	// Destroy the task, and what it captured, right away rather than when the next one is popped.
+	task.task = nullptr;
+}
+
+} // namespace flexisip
@@ -0,0 +1,137 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread-pool.hh"
+
+namespace flexisip {
+
+/**
+ * Provide a pool of threads for executing custom tasks, with priorities.
+ * Each thread has its own task queues, one per priority, so that submitting and picking tasks seldom contend on a
+ * shared lock. Tasks submitted from outside the pool are spread over the threads in turn, tasks submitted by a task go
+ * to the queue of its thread. A thread running out of tasks steals the oldest ones of the other threads, so that no
+ * queued task is overtaken by the ones submitted after it, and always runs the tasks of higher priority first.
+ * Only one thread is started at first, the others are started when tasks are waiting while no thread is idle, up to
+ * the given number.
+ * The number of queued tasks is bounded: run() fails when the limit is reached, so that the caller can react to the
+ * overload.
+ */
+class WorkStealingThreadPool : public ThreadPool {
+public:
+	enum class Priority { High, Normal, Low };
+
+	struct Stats {
+		std::size_t queuedTasks;
+		std::uint64_t executedTasks;
+		std::uint64_t rejectedTasks;
+		std::uint64_t stolenTasks;
+		// Time spent by the tasks in the queues, and running.
+		std::chrono::microseconds totalWaitTime;
+		std::chrono::microseconds maxWaitTime;
+		std::chrono::microseconds totalRunTime;
+	};
+
+	/**
+	 * @param maxThreadNumber Maximum number of threads.
+	 * @param maxQueueSize Maximum number of tasks waiting for a thread. 0 means unlimited.
+	 */
+	WorkStealingThreadPool(unsigned int maxThreadNumber, unsigned int maxQueueSize);
+	~WorkStealingThreadPool() override;
+
+	/**
+	 * Run a task of normal priority.
+	 */
+	bool run(Task t) override;
+	bool run(Task t, Priority priority);
+	void stop() final;
+
+	Stats getStats() const;
+
+	/**
+	 * The pool shared by the whole process, created on first use with up to eight threads per core and a hundred
+	 * queued tasks per thread.
+	 */
+	static std::unique_ptr<WorkStealingThreadPool>& getGlobalThreadPool();
+
+private:
+	static constexpr std::size_t sPriorityCount = 3;
+
+	struct QueuedTask {
+		Task task{};
+		std::chrono::steady_clock::time_point enqueueDate{};
+	};
+
+	struct Worker {
+		std::mutex mutex{};
+		std::array<std::deque<QueuedTask>, sPriorityCount> queues{};
+		std::thread thread{};
+	};
+
+	/**
+	 * This method is called by each thread.
+	 */
+	void _run(std::size_t workerIndex);
+	/**
+	 * Start one more thread if some tasks are waiting while no thread is idle, and the maximum isn't reached.
+	 */
+	void startWorkerIfNeeded();
+	bool popTask(std::size_t workerIndex, QueuedTask& task);
+	void execute(QueuedTask& task);
+
+	// Created at once, so that they can be read without lock, but only the first mStartedWorkers ones have a thread.
+	std::vector<std::unique_ptr<Worker>> mWorkers{};
+	std::atomic_size_t mStartedWorkers{0};
+	std::mutex mStartMutex{};
+	std::atomic_uint mNextWorker{0};
+	std::atomic_size_t mQueuedTasks{0};
+	unsigned mMaxQueueSize = 0;
+
+	std::mutex mSleepMutex{};
+	std::condition_variable mSleepCondition{};
+	std::atomic_uint mIdleWorkers{0};
+	std::atomic_bool mShutdown{false};
+	bool mStopped = false;
+
+	std::atomic<std::uint64_t> mExecutedTasks{0};
+	std::atomic<std::uint64_t> mRejectedTasks{0};
+	std::atomic<std::uint64_t> mStolenTasks{0};
+	std::atomic<std::uint64_t> mTotalWaitTimeUs{0};
+	std::atomic<std::uint64_t> mMaxWaitTimeUs{0};
+	std::atomic<std::uint64_t> mTotalRunTimeUs{0};
+
+	// The pool and the index of the worker running on the current thread, if any.
+	static thread_local WorkStealingThreadPool* sCurrentPool;
+	static thread_local std::size_t sCurrentWorker;
+
+	static std::unique_ptr<WorkStealingThreadPool> sGlobalThreadPool;
+};
+
+} // namespace flexisip
@@ -0,0 +1,90 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "timer-wheel.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+TimerWheel::Timer::Timer(Timer&& other) noexcept : mWheel(other.mWheel), mId(other.mId) {
+	other.mWheel = nullptr;
+}
+
+TimerWheel::Timer& TimerWheel::Timer::operator=(Timer&& other) noexcept {
+	if (this != &other) {
+		cancel();
+		mWheel = other.mWheel;
+		mId = other.mId;
+		other.mWheel = nullptr;
+	}
+	return *this;
+}
+
+void TimerWheel::Timer::cancel() {
+	if (mWheel) mWheel->cancel(mId);
+	mWheel = nullptr;
+}
+
+bool TimerWheel::Timer::isActive() const {
+	return mWheel && mWheel->contains(mId);
+}
+
+TimerWheel::TimerWheel(size_t slotCount) : mSlots(slotCount > 0 ? slotCount : 1) {
+}
+
+TimerWheel::Timer TimerWheel::createTimer(uint64_t ticks, Callback&& callback) {
+	if (ticks == 0) ticks = 1;
+	const auto slotCount = mSlots.size();
+	const auto slot = (mCurrentSlot + ticks) % slotCount;
+	const auto id = mNextSequence++ * slotCount + slot;
+	mSlots[slot].emplace(id, Entry{move(callback), (ticks - 1) / slotCount});
+	mSize++;
+	return Timer{*this, id};
+}
+
+void TimerWheel::tick() {
+	mCurrentSlot = (mCurrentSlot + 1) % mSlots.size();
+	auto& slot = mSlots[mCurrentSlot];
+
+	vector<uint64_t> expired{};
+	for (auto& entry : slot) {
+		if (entry.second.rounds > 0) entry.second.rounds--;
+		else expired.push_back(entry.first);
+	}
+	// The callbacks may create timers, or cancel the ones which haven't been fired yet.
+	for (auto id : expired) {
+		auto it = slot.find(id);
+		if (it == slot.end()) continue;
+		auto callback = move(it->second.callback);
+		slot.erase(it);
+		mSize--;
+		callback();
+	}
+}
+
+bool TimerWheel::contains(uint64_t id) const {
+	const auto& slot = mSlots[id % mSlots.size()];
+	return slot.find(id) != slot.end();
+}
+
+void TimerWheel::cancel(uint64_t id) {
+	mSize -= mSlots[id % mSlots.size()].erase(id);
+}
+
+} // namespace flexisip
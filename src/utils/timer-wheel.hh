@@ -0,0 +1,115 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace flexisip {
+
+/**
+ * Many coarse timers sharing a single periodic tick, for objects which are too numerous to own a timer of the main loop
+ * each. The owner of the wheel is in charge of calling tick() once per tick period, and the timers fire during the
+ * first tick following their expiration.
+ * The wheel is not thread-safe, it is meant to be used from a main loop.
+ */
+class TimerWheel {
+public:
+	using Callback = std::function<void()>;
+
+	/**
+	 * Handle on a timer of the wheel, cancelling it on destruction.
+	 */
+	class Timer {
+	public:
+		Timer() = default;
+		Timer(Timer&& other) noexcept;
+		Timer& operator=(Timer&& other) noexcept;
+		Timer(const Timer&) = delete;
+		Timer& operator=(const Timer&) = delete;
+		~Timer() {
+			cancel();
+		}
+
+		void cancel();
+		bool isActive() const;
+
+	private:
+		friend class TimerWheel;
+		Timer(TimerWheel& wheel, std::uint64_t id) : mWheel(&wheel), mId(id) {
+		}
+
+		TimerWheel* mWheel = nullptr;
+		std::uint64_t mId = 0;
+	};
+
+	/**
+	 * @param slotCount Number of ticks in a revolution of the wheel. Timers longer than a revolution are visited once
+	 * per revolution.
+	 */
+	explicit TimerWheel(std::size_t slotCount = 3600);
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+
+	/**
+	 * @param ticks Number of ticks before the timer fires, at least one. As the next tick may happen at any time, the
+	 * timer fires between ticks - 1 and ticks periods later.
+	 */
+	Timer createTimer(std::uint64_t ticks, Callback&& callback);
+	/**
+	 * Convenience overload for a wheel ticking every second. The timer never fires before the delay, and at most a
+	 * second after it.
+	 */
+	Timer createTimer(std::chrono::seconds delay, Callback&& callback) {
+		return createTimer(delay.count() > 0 ? static_cast<std::uint64_t>(delay.count()) + 1 : 1, std::move(callback));
+	}
+
+	/**
+	 * Move to the next tick and fire the timers expiring at it.
+	 */
+	void tick();
+
+	/**
+	 * Number of pending timers.
+	 */
+	std::size_t size() const {
+		return mSize;
+	}
+
+private:
+	struct Entry {
+		Callback callback;
+		// Number of revolutions of the wheel before the timer fires.
+		std::uint64_t rounds;
+	};
+
+	bool contains(std::uint64_t id) const;
+	void cancel(std::uint64_t id);
+
+	// Timers by id. The slot of a timer is its id modulo the number of slots.
+	std::vector<std::unordered_map<std::uint64_t, Entry>> mSlots;
+	std::size_t mCurrentSlot = 0;
+	std::uint64_t mNextSequence = 1;
+	std::size_t mSize = 0;
+};
+
+} // namespace flexisip
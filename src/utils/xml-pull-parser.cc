@@ -0,0 +1,235 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "xml-pull-parser.hh"
+
+using namespace std;
+
+namespace flexisip {
+
+namespace {
+
+bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool isNameEnd(char c) {
+	return isSpace(c) || c == '=' || c == '/' || c == '>' || c == '<' || c == '"' || c == '\'';
+}
+
+bool contains(const StringView& view, char c) {
+	return view.size > 0 && memchr(view.data, c, view.size) != nullptr;
+}
+
+constexpr const char* sXmlNamespace = "http://www.w3.org/XML/1998/namespace";
+
+} // namespace
+
+StringView StringView::trim() const {
+	auto begin = data;
+	auto end = data + size;
+	while (begin < end && isSpace(*begin))
+		begin++;
+	while (end > begin && isSpace(*(end - 1)))
+		end--;
+	return StringView{begin, static_cast<size_t>(end - begin)};
+}
+
+XmlPullParser::Event XmlPullParser::next() {
+	if (mFailed) return Event::Error;
+	if (mEmptyElement) {
+		mEmptyElement = false;
+		return closeElement();
+	}
+
+	while (mPos < mEnd) {
+		if (*mPos != '<') {
+			auto start = mPos;
+			auto lt = static_cast<const char*>(memchr(mPos, '<', mEnd - mPos));
+			mPos = lt ? lt : mEnd;
+			StringView text{start, static_cast<size_t>(mPos - start)};
+			if (mOpenElements.empty()) {
+				if (!text.isBlank()) return fail();
+				continue;
+			}
+			if (contains(text, '&')) return fail();
+			mText = text;
+			return Event::Text;
+		}
+
+		if (startsWith("<?")) {
+			if (!skipPast("?>")) return fail();
+		} else if (startsWith("<!--")) {
+			if (!skipPast("-->")) return fail();
+		} else if (startsWith("<!")) {
+			// CDATA section or document type declaration.
+			return fail();
+		} else if (startsWith("</")) {
+			return parseEndElement();
+		} else {
+			if (mRootParsed) return fail();
+			return parseStartElement();
+		}
+	}
+
+	if (!mRootParsed || !mOpenElements.empty()) return fail();
+	return Event::EndDocument;
+}
+
+XmlPullParser::Event XmlPullParser::fail() {
+	mFailed = true;
+	mPos = mEnd;
+	return Event::Error;
+}
+
+XmlPullParser::Event XmlPullParser::parseStartElement() {
+	mPos++;
+	StringView qname{};
+	if (!parseName(qname)) return fail();
+
+	const auto depth = mOpenElements.size() + 1;
+	mRawAttributes.clear();
+	while (true) {
+		skipSpaces();
+		if (mPos >= mEnd) return fail();
+		if (*mPos == '>') {
+			mPos++;
+			break;
+		}
+		if (startsWith("/>")) {
+			mPos += 2;
+			mEmptyElement = true;
+			break;
+		}
+
+		StringView attrName{};
+		if (!parseName(attrName)) return fail();
+		skipSpaces();
+		if (mPos >= mEnd || *mPos != '=') return fail();
+		mPos++;
+		skipSpaces();
+		if (mPos >= mEnd || (*mPos != '"' && *mPos != '\'')) return fail();
+		const auto quote = *mPos++;
+		auto end = static_cast<const char*>(memchr(mPos, quote, mEnd - mPos));
+		if (!end) return fail();
+		StringView value{mPos, static_cast<size_t>(end - mPos)};
+		mPos = end + 1;
+		if (contains(value, '&') || contains(value, '<')) return fail();
+
+		if (attrName == "xmlns") {
+			mBindings.push_back({StringView{}, value, depth});
+		} else if (attrName.size > 6 && strncmp(attrName.data, "xmlns:", 6) == 0) {
+			mBindings.push_back({StringView{attrName.data + 6, attrName.size - 6}, value, depth});
+		} else {
+			mRawAttributes.emplace_back(attrName, value);
+		}
+	}
+	mOpenElements.push_back(qname);
+
+	// The namespace declarations of the element apply to its own name and attributes.
+	if (!resolve(qname, false, mNamespace, mName)) return fail();
+	mAttributes.clear();
+	for (const auto& raw : mRawAttributes) {
+		Attribute attribute{};
+		if (!resolve(raw.first, true, attribute.ns, attribute.name)) return fail();
+		attribute.value = raw.second;
+		mAttributes.push_back(attribute);
+	}
+	return Event::StartElement;
+}
+
+XmlPullParser::Event XmlPullParser::parseEndElement() {
+	mPos += 2;
+	StringView qname{};
+	if (!parseName(qname)) return fail();
+	skipSpaces();
+	if (mPos >= mEnd || *mPos != '>') return fail();
+	mPos++;
+	if (mOpenElements.empty() || !(mOpenElements.back() == qname)) return fail();
+	return closeElement();
+}
+
+XmlPullParser::Event XmlPullParser::closeElement() {
+	if (!resolve(mOpenElements.back(), false, mNamespace, mName)) return fail();
+	const auto depth = mOpenElements.size();
+	while (!mBindings.empty() && mBindings.back().depth == depth)
+		mBindings.pop_back();
+	mOpenElements.pop_back();
+	if (mOpenElements.empty()) mRootParsed = true;
+	return Event::EndElement;
+}
+
+bool XmlPullParser::parseName(StringView& name) {
+	auto start = mPos;
+	while (mPos < mEnd && !isNameEnd(*mPos))
+		mPos++;
+	name = StringView{start, static_cast<size_t>(mPos - start)};
+	return !name.empty();
+}
+
+bool XmlPullParser::skipPast(const char* pattern) {
+	const auto patternEnd = pattern + strlen(pattern);
+	auto found = search(mPos, mEnd, pattern, patternEnd);
+	if (found == mEnd) return false;
+	mPos = found + (patternEnd - pattern);
+	return true;
+}
+
+void XmlPullParser::skipSpaces() {
+	while (mPos < mEnd && isSpace(*mPos))
+		mPos++;
+}
+
+bool XmlPullParser::startsWith(const char* pattern) const {
+	const auto length = strlen(pattern);
+	return static_cast<size_t>(mEnd - mPos) >= length && strncmp(mPos, pattern, length) == 0;
+}
+
+bool XmlPullParser::resolve(const StringView& qname, bool isAttribute, StringView& ns, StringView& name) const {
+	auto colon = static_cast<const char*>(memchr(qname.data, ':', qname.size));
+	StringView prefix{};
+	if (colon) {
+		prefix = StringView{qname.data, static_cast<size_t>(colon - qname.data)};
+		name = StringView{colon + 1, qname.size - prefix.size - 1};
+		if (prefix.empty() || name.empty()) return false;
+	} else {
+		name = qname;
+	}
+
+	if (prefix == "xml") {
+		ns = StringView{sXmlNamespace, strlen(sXmlNamespace)};
+		return true;
+	}
+	// Unprefixed attributes have no namespace, the default namespace only applies to elements.
+	if (!colon && isAttribute) {
+		ns = StringView{};
+		return true;
+	}
+	auto binding = find_if(mBindings.rbegin(), mBindings.rend(),
+	                       [&prefix](const Binding& binding) { return binding.prefix == prefix; });
+	if (binding == mBindings.rend()) {
+		ns = StringView{};
+		return !colon;
+	}
+	ns = binding->uri;
+	return true;
+}
+
+} // namespace flexisip
@@ -0,0 +1,143 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace flexisip {
+
+/**
+ * A piece of a buffer owned by someone else.
+ */
+struct StringView {
+	const char* data = nullptr;
+	std::size_t size = 0;
+
+	bool empty() const {
+		return size == 0;
+	}
+	std::string str() const {
+		return size ? std::string(data, size) : std::string();
+	}
+	/**
+	 * Return the view without its leading and trailing spaces.
+	 */
+	StringView trim() const;
+	bool isBlank() const {
+		return trim().empty();
+	}
+
+	bool operator==(const StringView& other) const {
+		return size == other.size && (size == 0 || std::memcmp(data, other.data, size) == 0);
+	}
+	bool operator==(const char* str) const {
+		return *this == StringView{str, std::strlen(str)};
+	}
+	bool operator!=(const char* str) const {
+		return !(*this == str);
+	}
+};
+
+/**
+ * Pull parser working in place on a XML document, for the simple documents exchanged by SIP: elements with namespaces,
+ * attributes, text, comments and processing instructions.
+ * Names, values and text are returned as views into the document, which must outlive the parser. Entity and character
+ * references, CDATA sections and document type declarations are not supported and make the parsing fail, so that the
+ * caller may use a complete parser for such documents.
+ */
+class XmlPullParser {
+public:
+	enum class Event { StartElement, EndElement, Text, EndDocument, Error };
+
+	struct Attribute {
+		StringView ns;
+		StringView name;
+		StringView value;
+	};
+
+	XmlPullParser(const char* data, std::size_t size) : mPos(data), mEnd(data + size) {
+	}
+
+	/**
+	 * Move to the next event of the document. An empty element produces both a StartElement and an EndElement.
+	 * Once an error has been met, all the following events are errors.
+	 */
+	Event next();
+
+	/**
+	 * Namespace URI and local name of the element of the last StartElement or EndElement event.
+	 */
+	const StringView& getNamespace() const {
+		return mNamespace;
+	}
+	const StringView& getName() const {
+		return mName;
+	}
+	bool isElement(const char* ns, const char* name) const {
+		return mNamespace == ns && mName == name;
+	}
+	/**
+	 * Attributes of the element of the last StartElement event, namespace declarations excluded.
+	 */
+	const std::vector<Attribute>& getAttributes() const {
+		return mAttributes;
+	}
+	/**
+	 * Content of the last Text event.
+	 */
+	const StringView& getText() const {
+		return mText;
+	}
+
+private:
+	struct Binding {
+		StringView prefix;
+		StringView uri;
+		std::size_t depth;
+	};
+
+	Event fail();
+	Event parseStartElement();
+	Event parseEndElement();
+	Event closeElement();
+	bool parseName(StringView& name);
+	bool skipPast(const char* pattern);
+	void skipSpaces();
+	bool startsWith(const char* pattern) const;
+	bool resolve(const StringView& qname, bool isAttribute, StringView& ns, StringView& name) const;
+
+	const char* mPos;
+	const char* const mEnd;
+	// Qualified names of the elements being parsed, and the namespace declarations made by them.
+	std::vector<StringView> mOpenElements{};
+	std::vector<Binding> mBindings{};
+	std::vector<std::pair<StringView, StringView>> mRawAttributes{};
+	std::vector<Attribute> mAttributes{};
+	StringView mNamespace{};
+	StringView mName{};
+	StringView mText{};
+	bool mEmptyElement = false;
+	bool mRootParsed = false;
+	bool mFailed = false;
+};
+
+} // namespace flexisip
@@ -0,0 +1,240 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "flexisip-config.h"
+
+#include "utils/batcher.hh"
+#include "utils/lru-cache.hh"
+
+#if ENABLE_SOCI
+#include "authdb.hh"
+#endif
+
+#include "tester.hh"
+#include "utils/proxy-server.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+namespace tester {
+
+class BatcherTest : public Test {
+public:
+	void operator()() override {
+		mutex mtx{};
+		vector<size_t> batchSizes{};
+		auto flush = [&](vector<int>&& batch) {
+			lock_guard<mutex> lck(mtx);
+			batchSizes.push_back(batch.size());
+		};
+		auto getBatchSizes = [&]() {
+			lock_guard<mutex> lck(mtx);
+			return batchSizes;
+		};
+
+		{
+			Batcher<int> batcher{10, milliseconds{200}, flush};
+			for (int i = 0; i < 25; ++i) batcher.add(move(i));
+			// Full batches are flushed without waiting.
+			this_thread::sleep_for(milliseconds{50});
+			BC_ASSERT_TRUE(getBatchSizes() == (vector<size_t>{10, 10}));
+			// The last one is flushed once its first item has waited long enough.
+			this_thread::sleep_for(milliseconds{300});
+			BC_ASSERT_TRUE(getBatchSizes() == (vector<size_t>{10, 10, 5}));
+		}
+
+		batchSizes.clear();
+		{
+			Batcher<int> batcher{10, hours{1}, flush};
+			for (int i = 0; i < 3; ++i) batcher.add(move(i));
+		}
+		// The pending items are flushed on destruction.
+		BC_ASSERT_TRUE(getBatchSizes() == (vector<size_t>{3}));
+	}
+};
+
+class LruCacheTest : public Test {
+public:
+	void operator()() override {
+		LruCache<string> cache{3};
+		string value{};
+		cache.put("a", "1", 0, 100);
+		cache.put("b", "2", 0, 100);
+		cache.putNegative("c", 0, 10);
+		BC_ASSERT_TRUE(cache.get("a", 1, value) == LruCache<string>::Status::Hit);
+		BC_ASSERT_STRING_EQUAL(value.c_str(), "1");
+		BC_ASSERT_TRUE(cache.get("c", 1, value) == LruCache<string>::Status::NegativeHit);
+
+		// "b" is the least recently used entry, it makes room for "d".
+		cache.put("d", "4", 1, 100);
+		BC_ASSERT_TRUE(cache.size() == 3);
+		BC_ASSERT_TRUE(cache.get("b", 1, value) == LruCache<string>::Status::Miss);
+		BC_ASSERT_TRUE(cache.get("a", 1, value) == LruCache<string>::Status::Hit);
+
+		// Expired entries are forgotten.
+		BC_ASSERT_TRUE(cache.get("c", 10, value) == LruCache<string>::Status::Miss);
+		BC_ASSERT_TRUE(cache.size() == 2);
+
+		// Replacing a negative entry by a value.
+		cache.putNegative("e", 10, 10);
+		cache.put("e", "5", 11, 100);
+		BC_ASSERT_TRUE(cache.get("e", 12, value) == LruCache<string>::Status::Hit);
+		BC_ASSERT_STRING_EQUAL(value.c_str(), "5");
+
+		cache.setCapacity(1);
+		BC_ASSERT_TRUE(cache.size() == 1);
+		BC_ASSERT_TRUE(cache.get("e", 12, value) == LruCache<string>::Status::Hit);
+
+		LruCache<string> disabled{};
+		disabled.put("a", "1", 0, 100);
+		BC_ASSERT_TRUE(disabled.get("a", 0, value) == LruCache<string>::Status::Miss);
+	}
+};
+
+#if ENABLE_SOCI
+class UsersWithPhonesRequestTest : public Test {
+public:
+	void operator()() override {
+		const auto request = SociAuthDB::makeUsersWithPhonesRequest(
+		    "select login, domain, phone from accounts where phone in (:phones)", 3);
+		BC_ASSERT_STRING_EQUAL(request.c_str(),
+		                       "select login, domain, phone from accounts where phone in (:phone0, :phone1, :phone2)");
+	}
+};
+
+class BatchPasswordRequestTest : public Test {
+public:
+	void operator()() override {
+		const auto request = SociAuthDB::makeBatchPasswordRequest(
+		    "select password, algorithm, login, domain from accounts where (login, domain) in (:credentials)", 3);
+		BC_ASSERT_STRING_EQUAL(request.c_str(),
+		                       "select password, algorithm, login, domain from accounts where (login, domain) in "
+		                       "((:id0, :domain0), (:id1, :domain1), (:id2, :domain2))");
+	}
+};
+#endif
+
+#if ENABLE_SOCI && ENABLE_UNIT_TESTS_MYSQL
+/**
+ * Look up the passwords of many users at once, as after a restart of the proxy, and check that they are fetched by a
+ * few batch requests.
+ */
+class BatchPasswordLoadTest : public Test {
+public:
+	void operator()() override {
+		constexpr int userCount = 2000;
+		const string connectionString =
+		    "db='flexisip_messages' user='belledonne' password='cOmmu2015nicatiOns' host='127.0.0.1'";
+		{
+			soci::session sql{"mysql", connectionString};
+			sql << "drop table if exists batch_accounts";
+			sql << "create table batch_accounts (login varchar(64), domain varchar(64), password varchar(64), "
+			       "algorithm varchar(16), primary key (login, domain))";
+			soci::transaction tr{sql};
+			for (int i = 0; i < userCount; ++i) {
+				sql << "insert into batch_accounts values ('user" << i << "', 'sip.example.org', 'secret" << i
+				    << "', 'CLRTXT')";
+			}
+			tr.commit();
+		}
+
+		Server proxy{{
+		    {"module::Authentication/db-implementation", "soci"},
+		    {"module::Authentication/soci-backend", "mysql"},
+		    {"module::Authentication/soci-connection-string", connectionString},
+		    {"module::Authentication/soci-password-request",
+		     "select password, algorithm from batch_accounts where login = :id and domain = :domain"},
+		    {"module::Authentication/soci-password-batch-request",
+		     "select password, algorithm, login, domain from batch_accounts where (login, domain) in (:credentials)"},
+		    {"module::Authentication/soci-password-batch-max-size", "50"},
+		    {"module::Authentication/soci-password-batch-max-delay", "5"},
+		    {"module::Authentication/soci-poolsize", "10"},
+		    {"module::Authentication/soci-max-queue-size", "10000"},
+		}};
+		AuthDbBackend::resetAuthDB();
+		auto& authDb = AuthDbBackend::get();
+		auto* batchRequests = GenericManager::get()
+		                          ->getRoot()
+		                          ->get<GenericStruct>("module::Authentication")
+		                          ->get<StatCounter64>("count-password-batch-requests");
+		const auto batchRequestsBefore = batchRequests->read();
+
+		mutex mtx{};
+		condition_variable cond{};
+		int results = 0;
+		atomic_int found{0}, notFound{0};
+		auto onResult = [&](AuthDbResult result, const AuthDbBackend::PwList& passwd) {
+			if (result == PASSWORD_FOUND && passwd.size() == 3) found++;
+			else if (result == PASSWORD_NOT_FOUND) notFound++;
+			lock_guard<mutex> lck(mtx);
+			results++;
+			cond.notify_one();
+		};
+
+		const auto start = steady_clock::now();
+		for (int i = 0; i < userCount; ++i) {
+			authDb.getPassword("user" + to_string(i), "sip.example.org", "user" + to_string(i), onResult);
+		}
+		authDb.getPassword("unknown", "sip.example.org", "unknown", onResult);
+		{
+			unique_lock<mutex> lck(mtx);
+			BC_ASSERT_TRUE(cond.wait_for(lck, seconds{30}, [&] { return results == userCount + 1; }));
+		}
+		SLOGI << "Fetched " << userCount << " passwords in "
+		      << duration_cast<milliseconds>(steady_clock::now() - start).count() << "ms";
+
+		BC_ASSERT_EQUAL(found, userCount, int, "%d");
+		BC_ASSERT_EQUAL(notFound, 1, int, "%d");
+		const auto batchCount = batchRequests->read() - batchRequestsBefore;
+		BC_ASSERT_TRUE(batchCount >= userCount / 50);
+		BC_ASSERT_TRUE(batchCount < userCount / 10);
+
+		AuthDbBackend::resetAuthDB();
+		soci::session sql{"mysql", connectionString};
+		sql << "drop table batch_accounts";
+	}
+};
+#endif
+
+static test_t tests[] = {
+    TEST_NO_TAG("Batcher", run<BatcherTest>),
+    TEST_NO_TAG("LRU cache", run<LruCacheTest>),
+#if ENABLE_SOCI
+    TEST_NO_TAG("Batch password request", run<BatchPasswordRequestTest>),
+    TEST_NO_TAG("Users with phones request", run<UsersWithPhonesRequestTest>),
+#endif
+#if ENABLE_SOCI && ENABLE_UNIT_TESTS_MYSQL
+    TEST_NO_TAG("Batch password lookups under load", run<BatchPasswordLoadTest>),
+#endif
+};
+
+test_suite_t authDbBatchSuite = {
+    "AuthDb batches", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
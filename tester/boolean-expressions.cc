@@ -17,7 +17,12 @@
  */
 
 
+#include <chrono>
+#include <vector>
+
+#include "flexisip-config.h"
 #include "tester.hh"
+#include "flexisip/logmanager.hh"
 #include "sofia-sip/sip.h"
 #include "sofia-sip/sip_parser.h"
 #include "flexisip/sip-boolean-expressions.hh"
@@ -258,6 +263,77 @@ static void invalid_expressions(void){
 	
 }
 
+/* Filters such as those found in entry filters and conditional routes. */
+static const char *representativeFilters[] = {
+	"is_request && request.method == 'INVITE'",
+	"from.uri.domain == 'sip.linphone.org' && request.method in 'INVITE MESSAGE REGISTER'",
+	"!(defined request.uri.user) && (from.uri.user in 'jehan-mac jehan-michel') && user-agent contains 'Linphone'",
+	"((from.uri.user in 'jehan-kevin jehan-patrick') && user-agent contains 'Linphone' ) || request.method == 'REGISTER'",
+	"request.uri.user regex '\\+33[0-9]+' || to.uri.user regex 'jeanne|ghislaine'",
+	"is_response && status.code == '180' && call-id.hash != '0'",
+	"numeric call-id && !(contact.uri.domain contains '192.168.')",
+	"'a' == 'a' && (to.uri.domain contains 'linphone' || 'b' == 'c')"
+};
+
+static void compiled_expressions(void){
+	msg_t *requests[] = {makeRequest(raw_request_2), makeRequest(raw_request_3), makeRequest(raw_request_4)};
+	vector<const sip_t *> messages = {&getRequest(), &getResponse()};
+	for (auto request : requests) messages.push_back((const sip_t *)msg_object(request));
+
+	for (const char *filter : representativeFilters){
+		auto compiled = SipBooleanExpressionBuilder::get().parse(filter);
+		auto interpreted = SipBooleanExpressionBuilder::get().parseInterpreted(filter);
+		BC_ASSERT_PTR_NOT_NULL(compiled);
+		BC_ASSERT_PTR_NOT_NULL(interpreted);
+		if (!compiled || !interpreted) continue;
+		for (const sip_t *sip : messages){
+			if (compiled->eval(*sip) != interpreted->eval(*sip)){
+				BC_FAIL(filter);
+			}
+		}
+	}
+
+	/* Constant folding */
+	shared_ptr<SipBooleanExpression> expr = SipBooleanExpressionBuilder::get().parse("is_request && 'toto' == 'titi'");
+	BC_ASSERT_PTR_NOT_NULL(expr);
+	if (expr){
+		BC_ASSERT_FALSE(expr->eval(getRequest()));
+		BC_ASSERT_FALSE(expr->eval(getResponse()));
+	}
+	expr = SipBooleanExpressionBuilder::get().parse("!('toto' contains 'x') && is_response");
+	BC_ASSERT_PTR_NOT_NULL(expr);
+	if (expr){
+		BC_ASSERT_FALSE(expr->eval(getRequest()));
+		BC_ASSERT_TRUE(expr->eval(getResponse()));
+	}
+
+	for (auto request : requests) msg_unref(request);
+}
+
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+/*
+ * Evaluation time of the representative filters, interpreted and compiled. The numbers are only reported.
+ */
+static void compiled_expressions_benchmark(void){
+	const int iterations = 100000;
+	for (const char *filter : representativeFilters){
+		double nsPerEval[2];
+		int matches = 0;
+		auto exprs = {SipBooleanExpressionBuilder::get().parseInterpreted(filter), SipBooleanExpressionBuilder::get().parse(filter)};
+		int i = 0;
+		for (const auto &expr : exprs){
+			auto start = chrono::steady_clock::now();
+			for (int k = 0; k < iterations; ++k){
+				matches += expr->eval(getRequest());
+			}
+			nsPerEval[i++] = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count() / double(iterations);
+		}
+		BC_ASSERT_TRUE(matches == 0 || matches == 2 * iterations);
+		SLOGI << "Filter [" << filter << "]: interpreted " << nsPerEval[0] << " ns, compiled " << nsPerEval[1] << " ns";
+	}
+}
+#endif
+
 string serializeRoute(const sip_route_t *route){
 	string ret;
 	size_t len;
@@ -316,6 +392,10 @@ static test_t tests[] = {
 	TEST_NO_TAG("Basic message inspection", basic_message_inspection),
 	TEST_NO_TAG("More complex expressions", complex_expressions),
 	TEST_NO_TAG("Invalid expressions", invalid_expressions),
+	TEST_NO_TAG("Compiled expressions", compiled_expressions),
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+	TEST_NO_TAG("Compiled expressions benchmark", compiled_expressions_benchmark),
+#endif
 	TEST_NO_TAG("Route-condition map", route_condition_map)
 };
 
@@ -0,0 +1,207 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "presence/compact-presence.hh"
+#include "presence/rpid-activities.hh"
+#include "xml/data-model.hh"
+#include "xml/pidf+xml.hh"
+#include "xml/rpid.hh"
+
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+
+namespace flexisip {
+namespace tester {
+
+namespace {
+
+// Every field of a tuple, with and without the optional parts, and the same service description in two tuples.
+const string fullPidf =
+    R"(<?xml version="1.0" encoding="UTF-8"?>
+<presence xmlns="urn:ietf:params:xml:ns:pidf" xmlns:op="urn:oma:xml:prs:pidf:oma-pres" entity="sip:alice@sip.example.org">
+  <tuple id="t1">
+    <status><basic>open</basic></status>
+    <contact priority="0.8">sip:alice@sip.example.org</contact>
+    <note xml:lang="en">Back soon</note>
+    <note>Sans langue</note>
+    <timestamp>2022-05-17T10:42:03.25+02:00</timestamp>
+    <op:service-description>
+      <op:service-id>org.openmobilealliance:IM-session</op:service-id>
+      <op:version>1.0</op:version>
+      <op:description>Instant messaging</op:description>
+    </op:service-description>
+  </tuple>
+  <tuple id="t2">
+    <status><basic>closed</basic></status>
+    <contact>sip:alice@10.0.0.1:5060</contact>
+    <timestamp>2022-05-17T10:42:03Z</timestamp>
+    <op:service-description>
+      <op:service-id>org.openmobilealliance:IM-session</op:service-id>
+      <op:version>1.0</op:version>
+      <op:description>Instant messaging</op:description>
+    </op:service-description>
+    <op:service-description>
+      <op:service-id>org.3gpp.urn:urn-7:3gpp-service.ims.icsi.mmtel</op:service-id>
+      <op:version>1.0</op:version>
+    </op:service-description>
+  </tuple>
+  <tuple id="t3">
+    <status/>
+    <timestamp>2022-05-17T10:42:03</timestamp>
+  </tuple>
+  <tuple id="t4">
+    <status><basic>open</basic></status>
+    <op:service-description xmlns:x="urn:x" x:origin="device">
+      <op:service-id>org.openmobilealliance:PoC-session</op:service-id>
+      <op:version>1.0</op:version>
+    </op:service-description>
+  </tuple>
+  <tuple id="t5">
+    <status><basic>closed</basic><im:im xmlns:im="urn:ietf:params:xml:ns:pidf:im">busy</im:im></status>
+    <contact priority="0.5">sip:alice@sip.example.org</contact>
+  </tuple>
+</presence>
+)";
+
+unique_ptr<Xsd::Pidf::Presence> parseWithXsd(const string& body) {
+	istringstream data(body);
+	return Xsd::Pidf::parsePresence(data, Xsd::XmlSchema::Flags::dont_validate);
+}
+
+string serializeWithXsd(const Xsd::Pidf::Presence& presence) {
+	ostringstream out;
+	Xsd::XmlSchema::NamespaceInfomap map;
+	map[""].name = "urn:ietf:params:xml:ns:pidf";
+	Xsd::Pidf::serializePresence(out, presence, map);
+	return out.str();
+}
+
+string serializeActivities(const Xsd::Rpid::Activities& activities) {
+	Xsd::Pidf::Presence presence{"sip:alice@sip.example.org"};
+	presence.setPerson(Xsd::DataModel::Person{"p1"});
+	presence.getPerson()->getActivities().push_back(activities);
+	return serializeWithXsd(presence);
+}
+
+} // namespace
+
+/*
+ * Pack then unpack the tuples of a document, which must serialize to the same document.
+ */
+class CompactTupleTest : public Test {
+public:
+	void operator()() override {
+		const auto original = parseWithXsd(fullPidf);
+		BC_HARD_ASSERT_TRUE(original != nullptr);
+		BC_HARD_ASSERT_TRUE(original->getTuple().size() == 5);
+
+		Xsd::Pidf::Presence rebuilt{*original};
+		rebuilt.getTuple().clear();
+		for (const auto& tuple : original->getTuple()) {
+			CompactTuple compact{make_unique<Xsd::Pidf::Tuple>(tuple)};
+			BC_ASSERT_STRING_EQUAL(compact.getId().c_str(), tuple.getId().c_str());
+			// Only the extension of the status requires the XSD object model.
+			BC_ASSERT_TRUE(compact.isPacked() == (tuple.getId() != "t5"));
+			rebuilt.getTuple().push_back(*compact.unpack());
+		}
+		BC_ASSERT_STRING_EQUAL(serializeWithXsd(rebuilt).c_str(), serializeWithXsd(*original).c_str());
+
+		// The service descriptions shared by several tuples are unpacked as they were published by each one.
+		CompactTuple first{make_unique<Xsd::Pidf::Tuple>(original->getTuple()[0])};
+		CompactTuple second{make_unique<Xsd::Pidf::Tuple>(original->getTuple()[1])};
+		const auto firstTuple = first.unpack();
+		const auto secondTuple = second.unpack();
+		BC_HARD_ASSERT_TRUE(firstTuple->getServiceDescription().size() == 1);
+		BC_HARD_ASSERT_TRUE(secondTuple->getServiceDescription().size() == 2);
+		BC_ASSERT_STRING_EQUAL(firstTuple->getServiceDescription()[0].getServiceId().c_str(),
+		                       secondTuple->getServiceDescription()[0].getServiceId().c_str());
+		BC_ASSERT_TRUE(firstTuple->getServiceDescription()[0].getDescription().present());
+		BC_ASSERT_FALSE(secondTuple->getServiceDescription()[1].getDescription().present());
+
+		// Changing the contact keeps its priority, whether the tuple is packed or not.
+		for (auto index : {0, 4}) {
+			CompactTuple compact{make_unique<Xsd::Pidf::Tuple>(original->getTuple()[index])};
+			compact.setContact("sip:alice@192.168.1.1");
+			const auto tuple = compact.unpack();
+			BC_HARD_ASSERT_TRUE(tuple->getContact().present());
+			BC_ASSERT_STRING_EQUAL(tuple->getContact()->c_str(), "sip:alice@192.168.1.1");
+			BC_ASSERT_TRUE(tuple->getContact()->getPriority().present());
+		}
+		CompactTuple withoutContact{make_unique<Xsd::Pidf::Tuple>(original->getTuple()[2])};
+		withoutContact.setContact("sip:alice@192.168.1.1");
+		BC_ASSERT_TRUE(withoutContact.unpack()->getContact().present());
+		BC_ASSERT_FALSE(withoutContact.unpack()->getContact()->getPriority().present());
+	}
+};
+
+/*
+ * Pack then unpack every RPID activity, alone and all together.
+ */
+class CompactActivitiesTest : public Test {
+public:
+	void operator()() override {
+		Xsd::Rpid::Activities all{};
+		for (const auto& activity : rpidEmptyActivities) {
+			Xsd::Rpid::Activities single{};
+			(single.*(activity.getMutable))().push_back(Xsd::Rpid::Empty());
+			(all.*(activity.getMutable))().push_back(Xsd::Rpid::Empty());
+
+			CompactActivities compact{single};
+			BC_ASSERT_TRUE(compact.isPacked());
+			const auto unpacked = compact.unpack();
+			BC_ASSERT_TRUE((unpacked.*(activity.get))().size() == 1);
+			BC_ASSERT_STRING_EQUAL(serializeActivities(unpacked).c_str(), serializeActivities(single).c_str());
+		}
+		all.setUnknown(Xsd::Rpid::Empty());
+		CompactActivities compactAll{all};
+		BC_ASSERT_TRUE(compactAll.isPacked());
+		BC_ASSERT_STRING_EQUAL(serializeActivities(compactAll.unpack()).c_str(), serializeActivities(all).c_str());
+
+		// No activity at all.
+		Xsd::Rpid::Activities none{};
+		CompactActivities compactNone{none};
+		BC_ASSERT_TRUE(compactNone.isPacked());
+		BC_ASSERT_STRING_EQUAL(serializeActivities(compactNone.unpack()).c_str(), serializeActivities(none).c_str());
+
+		// A repeated activity doesn't fit in a bit, it is kept as is.
+		Xsd::Rpid::Activities repeated{};
+		repeated.getAway().push_back(Xsd::Rpid::Empty());
+		repeated.getAway().push_back(Xsd::Rpid::Empty());
+		CompactActivities compactRepeated{repeated};
+		BC_ASSERT_FALSE(compactRepeated.isPacked());
+		BC_ASSERT_STRING_EQUAL(serializeActivities(compactRepeated.unpack()).c_str(),
+		                       serializeActivities(repeated).c_str());
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("Compact tuple round trip", run<CompactTupleTest>),
+    TEST_NO_TAG("Compact activities round trip", run<CompactActivitiesTest>),
+};
+
+test_suite_t compactPresenceSuite = {
+    "Compact presence", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
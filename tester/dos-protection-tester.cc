@@ -0,0 +1,143 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "dos/nftables-ban-list.hh"
+#include "dos/rate-limiter.hh"
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+namespace tester {
+
+static RateLimiter::Key makeKey(const char* ip, uint16_t port) {
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	inet_pton(AF_INET, ip, &addr.sin_addr);
+	return RateLimiter::Key{reinterpret_cast<const sockaddr*>(&addr)};
+}
+
+class RateLimiterTest : public Test {
+public:
+	void operator()() override {
+		// 10 packets per second, bursts of 30 packets.
+		RateLimiter limiter{10, 30, 100};
+		const auto start = steady_clock::now();
+		const auto key = makeKey("192.168.1.10", 5060);
+
+		for (int i = 0; i < 30; ++i) BC_ASSERT_TRUE(limiter.consume(key, start));
+		BC_ASSERT_FALSE(limiter.consume(key, start));
+		// Other ports and addresses have their own bucket.
+		BC_ASSERT_TRUE(limiter.consume(makeKey("192.168.1.10", 5061), start));
+		BC_ASSERT_TRUE(limiter.consume(makeKey("192.168.1.11", 5060), start));
+		// 100ms later, a single token has been added.
+		BC_ASSERT_TRUE(limiter.consume(key, start + milliseconds{100}));
+		BC_ASSERT_FALSE(limiter.consume(key, start + milliseconds{100}));
+		limiter.reset(key);
+		BC_ASSERT_TRUE(limiter.consume(key, start + milliseconds{100}));
+		BC_ASSERT_EQUAL(limiter.size(), 3, size_t, "%zu");
+	}
+};
+
+class RateLimiterExpiryTest : public Test {
+public:
+	void operator()() override {
+		constexpr size_t maxEntries = 1000;
+		RateLimiter limiter{10, 30, maxEntries};
+		const auto start = steady_clock::now();
+		auto keyOf = [](size_t i) {
+			return makeKey(("10.0." + to_string(i / 256) + "." + to_string(i % 256)).c_str(), 5060);
+		};
+
+		for (size_t i = 0; i < maxEntries; ++i) BC_ASSERT_TRUE(limiter.consume(keyOf(i), start));
+		BC_ASSERT_EQUAL(limiter.size(), maxEntries, size_t, "%zu");
+		// The table is full: new addresses are accepted without being tracked.
+		BC_ASSERT_TRUE(limiter.consume(makeKey("172.16.0.1", 5060), start));
+		BC_ASSERT_EQUAL(limiter.getOverflowCount(), 1, uint64_t, "%llu");
+
+		// Keep the buckets of the even addresses empty.
+		for (size_t i = 0; i < maxEntries; i += 2) {
+			while (limiter.consume(keyOf(i), start)) {
+			}
+		}
+		// 1s later, the buckets of the odd addresses are full again, but not the others.
+		const auto later = start + seconds{1};
+		size_t removed = 0;
+		for (size_t i = 0; i < 2 * limiter.getCapacity() && limiter.size() > maxEntries / 2; ++i) {
+			removed += limiter.expire(later, 64);
+		}
+		BC_ASSERT_EQUAL(removed, maxEntries / 2, size_t, "%zu");
+		BC_ASSERT_EQUAL(limiter.size(), maxEntries / 2, size_t, "%zu");
+		// The remaining buckets are still reachable despite the removal of their neighbours.
+		for (size_t i = 0; i < maxEntries; i += 2) {
+			for (int j = 0; j < 10; ++j) BC_ASSERT_TRUE(limiter.consume(keyOf(i), later));
+			BC_ASSERT_FALSE(limiter.consume(keyOf(i), later));
+		}
+		BC_ASSERT_EQUAL(limiter.size(), maxEntries / 2, size_t, "%zu");
+	}
+};
+
+class NftablesBanListTest : public Test {
+public:
+	void operator()() override {
+		NftablesBanList banList{"flexisip"};
+		const auto setup = banList.getSetupCommands();
+		BC_ASSERT_TRUE(setup.find("delete table inet flexisip") != string::npos);
+		BC_ASSERT_TRUE(setup.find("add set inet flexisip banned-ipv4 { type ipv4_addr . inet_proto . inet_service; "
+		                          "flags timeout; }") != string::npos);
+		BC_ASSERT_TRUE(setup.find("ip6 saddr . meta l4proto . th sport @banned-ipv6 reject") != string::npos);
+		BC_ASSERT_STRING_EQUAL(banList.getCleanupCommands().c_str(), "delete table inet flexisip");
+
+		BC_ASSERT_STRING_EQUAL(banList.takePendingCommands().c_str(), "");
+		banList.add("192.168.1.10", "5060", "udp", minutes{2});
+		banList.add("::ffff:192.168.1.11", "5070", "udp", minutes{2});
+		banList.add("2001:db8::1", "5061", "tcp", seconds{30});
+		BC_ASSERT_STRING_EQUAL(banList.takePendingCommands().c_str(),
+		                       "add element inet flexisip banned-ipv4 { 192.168.1.10 . udp . 5060 timeout 120s, "
+		                       "192.168.1.11 . udp . 5070 timeout 120s }; "
+		                       "add element inet flexisip banned-ipv6 { 2001:db8::1 . tcp . 5061 timeout 30s }");
+		BC_ASSERT_STRING_EQUAL(banList.takePendingCommands().c_str(), "");
+
+		// The table name goes through a shell.
+		BC_ASSERT_TRUE(NftablesBanList::isValidTableName("flexisip_ban-1"));
+		BC_ASSERT_FALSE(NftablesBanList::isValidTableName(""));
+		BC_ASSERT_FALSE(NftablesBanList::isValidTableName("flexisip'; rm -rf /; '"));
+		BC_ASSERT_FALSE(NftablesBanList::isValidTableName("flexisip table"));
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("Rate limiter", run<RateLimiterTest>),
+    TEST_NO_TAG("Rate limiter expiry", run<RateLimiterExpiryTest>),
+    TEST_NO_TAG("nftables ban list", run<NftablesBanListTest>),
+};
+
+test_suite_t dosProtectionSuite = {
+    "DoS protection", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
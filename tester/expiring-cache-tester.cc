@@ -0,0 +1,118 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string>
+
+#include "utils/expiring-cache.hh"
+
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+
+namespace flexisip {
+namespace tester {
+
+using Status = ExpiringCache<string>::Status;
+
+class ExpiringCacheTest : public Test {
+public:
+	void operator()() override {
+		ExpiringCache<string> cache{};
+		const time_t now = 1000000;
+		string value{};
+
+		BC_ASSERT_TRUE(cache.get("alice", now, value) == Status::Miss);
+		cache.put("alice", "secret", now, 60);
+		cache.putNegative("mallory", now, 10);
+		BC_ASSERT_TRUE(cache.get("alice", now + 59, value) == Status::Hit);
+		BC_ASSERT_STRING_EQUAL(value.c_str(), "secret");
+		BC_ASSERT_TRUE(cache.get("mallory", now + 9, value) == Status::NegativeHit);
+		BC_ASSERT_EQUAL(cache.size(), 2, size_t, "%zu");
+
+		// Expired entries are removed when looked up. The expired value is still returned.
+		value.clear();
+		BC_ASSERT_TRUE(cache.get("alice", now + 60, value) == Status::Expired);
+		BC_ASSERT_STRING_EQUAL(value.c_str(), "secret");
+		BC_ASSERT_TRUE(cache.get("alice", now + 60, value) == Status::Miss);
+		BC_ASSERT_TRUE(cache.get("mallory", now + 10, value) == Status::Miss);
+		BC_ASSERT_EQUAL(cache.size(), 0, size_t, "%zu");
+
+		// A known user replaces a negative entry.
+		cache.putNegative("bob", now, 10);
+		cache.put("bob", "password", now, 60);
+		BC_ASSERT_TRUE(cache.get("bob", now + 1, value) == Status::Hit);
+		cache.erase("bob");
+		BC_ASSERT_TRUE(cache.get("bob", now + 1, value) == Status::Miss);
+	}
+};
+
+class ExpiringCacheRefreshTest : public Test {
+public:
+	void operator()() override {
+		ExpiringCache<string> cache{20};
+		const time_t now = 1000000;
+		string value{};
+		bool refresh = false;
+
+		cache.put("alice", "secret", now, 100);
+		cache.putNegative("mallory", now, 100);
+		BC_ASSERT_TRUE(cache.get("alice", now + 79, value, &refresh) == Status::Hit);
+		BC_ASSERT_FALSE(refresh);
+		// The refresh is requested once, during the last 20% of the lifetime of the entry.
+		BC_ASSERT_TRUE(cache.get("alice", now + 80, value, &refresh) == Status::Hit);
+		BC_ASSERT_TRUE(refresh);
+		refresh = false;
+		BC_ASSERT_TRUE(cache.get("alice", now + 81, value, &refresh) == Status::Hit);
+		BC_ASSERT_FALSE(refresh);
+		// Negative entries are never refreshed.
+		BC_ASSERT_TRUE(cache.get("mallory", now + 99, value, &refresh) == Status::NegativeHit);
+		BC_ASSERT_FALSE(refresh);
+
+		// The refreshed entry may be refreshed again.
+		cache.put("alice", "secret", now + 90, 100);
+		BC_ASSERT_TRUE(cache.get("alice", now + 170, value, &refresh) == Status::Hit);
+		BC_ASSERT_TRUE(refresh);
+	}
+};
+
+class ExpiringCachePurgeTest : public Test {
+public:
+	void operator()() override {
+		ExpiringCache<string> cache{};
+		const time_t now = 1000000;
+
+		for (int i = 0; i < 1000; ++i) cache.putNegative("unknown" + to_string(i), now, 10);
+		BC_ASSERT_EQUAL(cache.size(), 1000, size_t, "%zu");
+		// Expired entries which are never looked up again are eventually removed by the insertions.
+		for (int i = 0; i < 40000; ++i) cache.put("user" + to_string(i % 1000), "password", now + 10, 60);
+		BC_ASSERT_EQUAL(cache.size(), 1000, size_t, "%zu");
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("Expiring cache", run<ExpiringCacheTest>),
+    TEST_NO_TAG("Expiring cache refresh-ahead", run<ExpiringCacheRefreshTest>),
+    TEST_NO_TAG("Expiring cache purge", run<ExpiringCachePurgeTest>),
+};
+
+test_suite_t expiringCacheSuite = {
+    "Expiring cache", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
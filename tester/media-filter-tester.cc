@@ -0,0 +1,212 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include <arpa/inet.h>
+
+#include "flexisip-config.h"
+#include "flexisip/logmanager.hh"
+
+#include "h264iframefilter.hh"
+#include "media-filter.hh"
+#include "telephone-event-filter.hh"
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+namespace tester {
+
+static constexpr int sTelephoneEventPt = 101;
+static constexpr int sH264Pt = 96;
+
+static vector<uint8_t> makeRtpPacket(uint8_t pt, uint16_t seq, uint32_t ts, bool marker, uint8_t nalType) {
+	vector<uint8_t> packet(160, 0);
+	packet[0] = 0x80;
+	packet[1] = (marker ? 0x80 : 0) | (pt & 0x7f);
+	uint16_t nseq = htons(seq);
+	memcpy(&packet[2], &nseq, sizeof(nseq));
+	uint32_t nts = htonl(ts);
+	memcpy(&packet[4], &nts, sizeof(nts));
+	uint32_t ssrc = htonl(0x12345678);
+	memcpy(&packet[8], &ssrc, sizeof(ssrc));
+	packet[12] = nalType;
+	return packet;
+}
+
+/*
+ * Generate a stream mixing audio, telephone-events, and H264 I-frames and P-frames.
+ */
+static vector<vector<uint8_t>> makeStream(size_t count) {
+	vector<vector<uint8_t>> stream;
+	stream.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		uint16_t seq = static_cast<uint16_t>(i);
+		uint32_t ts = static_cast<uint32_t>(i / 10) * 3000;
+		if (i % 50 == 0) stream.emplace_back(makeRtpPacket(sTelephoneEventPt, seq, ts, true, 0));
+		else if (i % 100 < 10) stream.emplace_back(makeRtpPacket(sH264Pt, seq, ts, false, 5 /*IDR*/));
+		else stream.emplace_back(makeRtpPacket(sH264Pt, seq, ts, i % 10 == 9, 1 /*non-IDR slice*/));
+	}
+	return stream;
+}
+
+class RtpHeaderParsingTest : public Test {
+public:
+	void operator()() override {
+		auto packet = makeRtpPacket(sTelephoneEventPt, 0xabcd, 0x01020304, true, 5);
+		auto header = RtpHeaderInfo::parse(packet.data(), packet.size());
+		BC_ASSERT_TRUE(header.valid);
+		BC_ASSERT_TRUE(header.marker);
+		BC_ASSERT_EQUAL(header.payloadType, sTelephoneEventPt, int, "%i");
+		BC_ASSERT_EQUAL(header.seqNumber, 0xabcd, int, "%i");
+		BC_ASSERT_EQUAL(header.timestamp, 0x01020304, uint32_t, "%u");
+		BC_ASSERT_EQUAL(header.ssrc, 0x12345678, uint32_t, "%u");
+		BC_ASSERT_EQUAL(header.payloadOffset, 12, size_t, "%zu");
+
+		// Two CSRCs and a one-word header extension.
+		packet[0] = 0x80 | 0x10 | 0x02;
+		packet[12 + 8 + 3] = 1;
+		header = RtpHeaderInfo::parse(packet.data(), packet.size());
+		BC_ASSERT_TRUE(header.valid);
+		BC_ASSERT_EQUAL(header.payloadOffset, 12 + 8 + 4 + 4, size_t, "%zu");
+
+		// Too short, or not RTP version 2.
+		BC_ASSERT_FALSE(RtpHeaderInfo::parse(packet.data(), 11).valid);
+		packet[0] = 0x40;
+		BC_ASSERT_FALSE(RtpHeaderInfo::parse(packet.data(), packet.size()).valid);
+	}
+};
+
+class MediaFilterChainTest : public Test {
+public:
+	void operator()() override {
+		MediaFilterChain chain;
+		auto stream = makeStream(1000);
+		sockaddr_storage addr{};
+
+		// An empty chain lets everything pass.
+		for (auto& p : stream) {
+			BC_ASSERT_TRUE(chain.onIncomingTransfer(p.data(), p.size(), (sockaddr*)&addr, sizeof(addr)));
+		}
+
+		// Several filters on the same chain, each one keeps its own role.
+		chain.add(make_shared<TelephoneEventFilter>(sTelephoneEventPt));
+		chain.add(make_shared<H264IFrameFilter>(2));
+		BC_ASSERT_EQUAL(chain.size(), 2, size_t, "%zu");
+
+		int telephoneEventsIn = 0;
+		int framesOut = 0;
+		for (auto& p : stream) {
+			if (chain.onIncomingTransfer(p.data(), p.size(), (sockaddr*)&addr, sizeof(addr))) {
+				auto header = RtpHeaderInfo::parse(p.data(), p.size());
+				if (header.payloadType == sTelephoneEventPt) telephoneEventsIn++;
+			}
+			if (chain.onOutgoingTransfer(p.data(), p.size(), (sockaddr*)&addr, sizeof(addr))) framesOut++;
+		}
+		BC_ASSERT_EQUAL(telephoneEventsIn, 0, int, "%i");
+		// P-frames are always dropped, I-frames are decimated.
+		BC_ASSERT_TRUE(framesOut > 0);
+		BC_ASSERT_TRUE(framesOut < 100);
+
+		// Replacing the filters keeps the given instances, and their state.
+		const auto filters = chain.getFilters();
+		chain.set({filters->back()});
+		BC_ASSERT_EQUAL(chain.size(), 1, size_t, "%zu");
+		BC_ASSERT_TRUE(chain.getFilters()->front() == filters->back());
+
+		chain.clear();
+		BC_ASSERT_TRUE(chain.empty());
+	}
+};
+
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+/*
+ * Compare the former approach, where every filter parses the RTP header on its own, to the MediaFilterChain.
+ * Timings are only reported, not asserted.
+ */
+class MediaFilterChainBenchmark : public Test {
+public:
+	void operator()() override {
+		constexpr size_t packetCount = 200000;
+		constexpr int filterCount = 4;
+		auto stream = makeStream(packetCount);
+		sockaddr_storage addr{};
+
+		auto makeFilters = [&]() {
+			MediaFilterChain::FilterList filters;
+			for (int i = 0; i < filterCount / 2; ++i) {
+				filters.push_back(make_shared<TelephoneEventFilter>(sTelephoneEventPt + 1 + i));
+				filters.push_back(make_shared<H264IFrameFilter>(1));
+			}
+			return filters;
+		};
+
+		// Former behavior: one header parsing per filter.
+		auto perFilter = makeFilters();
+		size_t perFilterPassed = 0;
+		auto start = steady_clock::now();
+		for (auto& p : stream) {
+			bool pass = true;
+			for (auto& f : perFilter) {
+				if (!f->onOutgoingTransfer(RtpHeaderInfo::parse(p.data(), p.size()), p.data(), p.size(),
+				                           (sockaddr*)&addr, sizeof(addr))) {
+					pass = false;
+					break;
+				}
+			}
+			if (pass) perFilterPassed++;
+		}
+		auto perFilterDuration = steady_clock::now() - start;
+
+		MediaFilterChain chain;
+		for (auto& f : makeFilters()) chain.add(f);
+		size_t chainPassed = 0;
+		start = steady_clock::now();
+		for (auto& p : stream) {
+			if (chain.onOutgoingTransfer(p.data(), p.size(), (sockaddr*)&addr, sizeof(addr))) chainPassed++;
+		}
+		auto chainDuration = steady_clock::now() - start;
+
+		BC_ASSERT_EQUAL(chainPassed, perFilterPassed, size_t, "%zu");
+
+		auto nsPerPacket = [&](auto d) { return duration_cast<nanoseconds>(d).count() / double(packetCount); };
+		SLOGI << "MediaFilterChainBenchmark: " << packetCount << " packets, " << filterCount << " filters\n"
+		      << "\tper filter parsing: " << nsPerPacket(perFilterDuration) << " ns/packet\n"
+		      << "\tfilter chain:       " << nsPerPacket(chainDuration) << " ns/packet";
+	}
+};
+#endif
+
+static test_t tests[] = {
+    TEST_NO_TAG("RTP header parsing", run<RtpHeaderParsingTest>),
+    TEST_NO_TAG("Media filter chain", run<MediaFilterChainTest>),
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+    TEST_NO_TAG("Media filter chain benchmark", run<MediaFilterChainBenchmark>),
+#endif
+};
+
+test_suite_t mediaFilterSuite = {
+    "Media filter", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
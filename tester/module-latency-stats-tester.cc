@@ -0,0 +1,92 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+
+#include "module-latency-stats.hh"
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+namespace tester {
+
+class LatencyHistogramTest : public Test {
+public:
+	void operator()() override {
+		BC_ASSERT_EQUAL(LatencyHistogram::getBucket(0), 0, size_t, "%zu");
+		BC_ASSERT_EQUAL(LatencyHistogram::getBucket(1), 1, size_t, "%zu");
+		BC_ASSERT_EQUAL(LatencyHistogram::getBucket(3), 2, size_t, "%zu");
+		BC_ASSERT_EQUAL(LatencyHistogram::getBucket(1000), 10, size_t, "%zu");
+		BC_ASSERT_EQUAL(LatencyHistogram::getBucket(uint64_t(1) << 40), LatencyHistogram::sBucketCount - 1, size_t,
+		                "%zu");
+
+		LatencyHistogram histogram;
+		BC_ASSERT_EQUAL(histogram.getPercentileUs(99), 0, uint64_t, "%llu");
+		// 90 fast events (~100us), 9 slower ones (~5ms) and a very slow one (~2s).
+		for (int i = 0; i < 90; ++i) histogram.record(microseconds{100});
+		for (int i = 0; i < 9; ++i) histogram.record(milliseconds{5});
+		histogram.record(seconds{2});
+		BC_ASSERT_EQUAL(histogram.getCount(), 100, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(histogram.getMaxUs(), 2000000, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(histogram.getMeanUs(), (90 * 100 + 9 * 5000 + 2000000) / 100, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(histogram.getPercentileUs(50), 128, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(histogram.getPercentileUs(95), 8192, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(histogram.getPercentileUs(99.5), uint64_t(1) << 21, uint64_t, "%llu");
+	}
+};
+
+class ModuleLatencyCountersTest : public Test {
+public:
+	void operator()() override {
+		auto* moduleConfig = GenericManager::get()->getRoot()->addChild(
+		    make_unique<GenericStruct>("module::LatencyTest", "Module latency test", 999));
+		ModuleLatencyStats stats{moduleConfig};
+		stats.recordSuspension(microseconds{500});
+		stats.recordSuspension(milliseconds{20});
+		stats.recordSuspension(seconds{3});
+
+		auto read = [&](const string& name) { return moduleConfig->get<StatCounter64>(name)->read(); };
+		BC_ASSERT_EQUAL(read("count-suspension-latency-under-1ms"), 1, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(read("count-suspension-latency-under-10ms"), 0, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(read("count-suspension-latency-under-100ms"), 1, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(read("count-suspension-latency-over-1000ms"), 1, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(read("count-suspension-latency-total-us"), 3020500, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(read("count-request-latency-under-1ms"), 0, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(stats.getSuspensionHistogram().getCount(), 3, uint64_t, "%llu");
+
+		ostringstream dump;
+		stats.dump(dump);
+		BC_ASSERT_TRUE(dump.str().find("suspensions: count=3") != string::npos);
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("Latency histogram", run<LatencyHistogramTest>),
+    TEST_NO_TAG("Module latency counters", run<ModuleLatencyCountersTest>),
+};
+
+test_suite_t moduleLatencyStatsSuite = {
+    "Module latency statistics", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
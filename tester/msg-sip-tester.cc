@@ -0,0 +1,195 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <sofia-sip/sip_protos.h>
+
+#include "flexisip-config.h"
+#include "flexisip/logmanager.hh"
+
+#include "sofia-wrapper/msg-sip.hh"
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace std::chrono;
+using namespace sofiasip;
+
+namespace flexisip {
+namespace tester {
+
+static const string sInvite{"INVITE sip:jean.claude@sip.linphone.org SIP/2.0\r\n"
+                            "Via: SIP/2.0/TLS 192.168.1.197:5061;branch=z9hG4bK.Ku1n0uR3k;rport\r\n"
+                            "Route: <sip:sip.linphone.org;transport=tls;lr>\r\n"
+                            "Max-Forwards: 70\r\n"
+                            "From: \"Kijou\" <sip:kijou@sip.linphone.org>;tag=08HMIWXqx\r\n"
+                            "To: \"Jean Claude\" <sip:jean.claude@sip.linphone.org>\r\n"
+                            "Call-ID: NISmf-QUnD\r\n"
+                            "CSeq: 20 INVITE\r\n"
+                            "Contact: <sip:kijou@sip.linphone.org;gr=urn:uuid:5b8f2a6c>;+sip.instance=\"<urn:uuid:5b8f2a6c>\"\r\n"
+                            "User-Agent: Linphone Desktop/4.3.2 (Linux) LinphoneCore/4.5.0\r\n"
+                            "Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, NOTIFY, MESSAGE, SUBSCRIBE, INFO, UPDATE\r\n"
+                            "Supported: replaces, outbound, gruu\r\n"
+                            "Content-Type: application/sdp\r\n"
+                            "Content-Length: 0\r\n"
+                            "\r\n"};
+
+static const string sSdp{"v=0\r\n"
+                         "o=kijou 2959 756 IN IP4 192.168.1.197\r\n"
+                         "s=Talk\r\n"
+                         "c=IN IP4 192.168.1.197\r\n"
+                         "t=0 0\r\n"
+                         "a=ice-pwd:fe26e5da31eb0957ad9eb1f0\r\n"
+                         "a=ice-ufrag:caba7d03\r\n"
+                         "m=audio 7254 RTP/AVPF 96 0 8 101\r\n"
+                         "a=rtpmap:96 opus/48000/2\r\n"
+                         "a=fmtp:96 useinbandfec=1\r\n"
+                         "a=rtpmap:101 telephone-event/8000\r\n"
+                         "a=candidate:1 1 UDP 2130706303 192.168.1.197 7254 typ host\r\n"
+                         "a=candidate:1 2 UDP 2130706302 192.168.1.197 7255 typ host\r\n"
+                         "m=video 9078 RTP/AVPF 96 97\r\n"
+                         "a=rtpmap:96 VP8/90000\r\n"
+                         "a=rtpmap:97 H264/90000\r\n"
+                         "a=fmtp:97 profile-level-id=42801F\r\n"
+                         "a=candidate:1 1 UDP 2130706303 192.168.1.197 9078 typ host\r\n"
+                         "a=candidate:1 2 UDP 2130706302 192.168.1.197 9079 typ host\r\n"};
+
+static shared_ptr<MsgSip> makeInvite() {
+	auto invite = sInvite;
+	invite.replace(invite.find("Content-Length: 0"), 17, "Content-Length: " + to_string(sSdp.size()));
+	return make_shared<MsgSip>(0, invite + sSdp);
+}
+
+/* What the Router does on each fork branch: rewrite the request-uri and replace the routes. */
+static void rewriteBranch(MsgSip& msg, int branch) {
+	auto* sip = msg.getSip();
+	auto* home = msg.getHome();
+	auto* dest = url_make(home, ("sip:jean.claude@192.168.1." + to_string(branch % 250) + ":5060").c_str());
+	sip->sip_request->rq_url[0] = *dest;
+	sip->sip_route = nullptr;
+	sip_header_insert(msg.getMsg(), sip, (sip_header_t*)sip_route_make(home, "<sip:10.0.0.1;lr>"));
+	msg.serialize();
+}
+
+class ShallowCopyTest : public Test {
+public:
+	void operator()() override {
+		auto original = makeInvite();
+		const auto originalText = original->printString();
+		auto copy = MsgSip::makeShallowCopy(*original);
+
+		// The body is shared, the headers rewritten on each branch are not.
+		auto* sip = original->getSip();
+		auto* copySip = copy->getSip();
+		BC_HARD_ASSERT_TRUE(copySip->sip_payload != nullptr);
+		BC_ASSERT_PTR_EQUAL(copySip->sip_payload->pl_data, sip->sip_payload->pl_data);
+		BC_ASSERT_PTR_NOT_EQUAL(copySip->sip_request, sip->sip_request);
+		BC_ASSERT_PTR_NOT_EQUAL(copySip->sip_via->v_params, sip->sip_via->v_params);
+		BC_ASSERT_PTR_NOT_EQUAL(copySip->sip_contact->m_params, sip->sip_contact->m_params);
+
+		// Modifying the copy does not alter the original.
+		rewriteBranch(*copy, 42);
+		msg_header_replace_param(copy->getHome(), (msg_common_t*)copySip->sip_via, "received=10.0.0.2");
+		msg_header_remove_param((msg_common_t*)copySip->sip_contact, "+sip.instance");
+		sip_header_insert(copy->getMsg(), copySip,
+		                  (sip_header_t*)sip_via_make(copy->getHome(), "SIP/2.0/UDP 10.0.0.1;branch=z9hG4bK.fork"));
+		BC_ASSERT_STRING_EQUAL(original->printString().c_str(), originalText.c_str());
+
+		// The copy outlives the original message.
+		original.reset();
+		const auto copyText = copy->printString();
+		BC_ASSERT_TRUE(copyText.find("INVITE sip:jean.claude@192.168.1.42:5060 SIP/2.0") == 0);
+		BC_ASSERT_TRUE(copyText.find("Route: <sip:10.0.0.1;lr>") != string::npos);
+		BC_ASSERT_TRUE(copyText.find("received=10.0.0.2") != string::npos);
+		BC_ASSERT_TRUE(copyText.find("+sip.instance") == string::npos);
+		BC_ASSERT_TRUE(copyText.find("From: \"Kijou\" <sip:kijou@sip.linphone.org>;tag=08HMIWXqx") != string::npos);
+		BC_ASSERT_TRUE(copyText.find(sSdp) != string::npos);
+
+		// Copies of copies are allowed, as done for the fork context event and then each of its branches.
+		auto copyOfCopy = MsgSip::makeShallowCopy(*copy);
+		copy.reset();
+		BC_ASSERT_STRING_EQUAL(copyOfCopy->printString().c_str(), copyText.c_str());
+	}
+};
+
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+static size_t allocatedBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Memory and CPU cost per forked INVITE, with the former deep copy and with the shallow copy. The numbers are only
+ * reported, not asserted.
+ */
+class ForkCopyBenchmark : public Test {
+public:
+	void operator()() override {
+		constexpr int branchCount = 2000;
+		auto original = makeInvite();
+		original->serialize();
+
+		auto measure = [&](const function<shared_ptr<MsgSip>(const MsgSip&)>& makeCopy, size_t& bytes) {
+			vector<shared_ptr<MsgSip>> branches;
+			branches.reserve(branchCount);
+			const auto memoryBefore = allocatedBytes();
+			const auto start = steady_clock::now();
+			for (int i = 0; i < branchCount; ++i) {
+				branches.emplace_back(makeCopy(*original));
+				rewriteBranch(*branches.back(), i);
+			}
+			const auto duration = steady_clock::now() - start;
+			bytes = allocatedBytes() - memoryBefore;
+			return duration_cast<nanoseconds>(duration).count() / double(branchCount) / 1000.0;
+		};
+
+		size_t deepBytes = 0, shallowBytes = 0;
+		const auto deepUs = measure([](const MsgSip& msg) { return make_shared<MsgSip>(msg); }, deepBytes);
+		const auto shallowUs = measure(MsgSip::makeShallowCopy, shallowBytes);
+
+		SLOGI << "ForkCopyBenchmark: " << branchCount << " branches of a " << original->printString().size()
+		      << " bytes INVITE\n"
+		      << "\tdeep copy:    " << deepUs << " us/branch, " << deepBytes / branchCount << " bytes/branch\n"
+		      << "\tshallow copy: " << shallowUs << " us/branch, " << shallowBytes / branchCount << " bytes/branch";
+	}
+};
+#endif
+
+static test_t tests[] = {
+    TEST_NO_TAG("Shallow copy", run<ShallowCopyTest>),
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+    TEST_NO_TAG("Fork copy benchmark", run<ForkCopyBenchmark>),
+#endif
+};
+
+test_suite_t msgSipSuite = {"MsgSip", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
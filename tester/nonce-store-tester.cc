@@ -0,0 +1,148 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <string>
+
+#include <sofia-sip/sip_header.h>
+
+#include "flexisip/auth/nonce-store.hh"
+#include "flexisip/sofia-wrapper/home.hh"
+#include "flexisip/sofia-wrapper/su-root.hh"
+
+#include "auth/flexisip-auth-module.hh"
+
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+
+namespace flexisip {
+namespace tester {
+
+class StatelessNonceValidationTest : public Test {
+public:
+	void operator()() override {
+		using Validity = StatelessNonceStore::Validity;
+		StatelessNonceStore store{3600};
+		const time_t now = 1000000;
+		const string client = "sip.example.org:alice@sip.example.org";
+		const auto nonce = store.generate(client, now);
+		time_t issued = 0;
+
+		BC_ASSERT_TRUE(store.validate(nonce, client, now + 10, issued) == Validity::Valid);
+		BC_ASSERT_EQUAL(issued, now, long, "%ld");
+		// The nonce is bound to the client.
+		BC_ASSERT_TRUE(store.validate(nonce, "sip.example.org:bob@sip.example.org", now, issued) == Validity::Invalid);
+		// Tampered nonces, including their issuing time, are rejected.
+		auto tampered = nonce;
+		tampered[15] = tampered[15] == '0' ? '1' : '0';
+		BC_ASSERT_TRUE(store.validate(tampered, client, now, issued) == Validity::Invalid);
+		BC_ASSERT_TRUE(store.validate(nonce.substr(1), client, now, issued) == Validity::Invalid);
+		BC_ASSERT_TRUE(store.validate("not a nonce", client, now, issued) == Validity::Invalid);
+		// Nonces issued by another store are rejected.
+		StatelessNonceStore otherStore{3600};
+		BC_ASSERT_TRUE(otherStore.validate(nonce, client, now, issued) == Validity::Invalid);
+		// Expired nonces are stale.
+		BC_ASSERT_TRUE(store.validate(nonce, client, now + 3601, issued) == Validity::Stale);
+	}
+};
+
+class StatelessNonceCountTest : public Test {
+public:
+	void operator()() override {
+		StatelessNonceStore store{3600};
+		const time_t now = 1000000;
+		const auto nonce1 = store.generate("realm:alice@sip.example.org", now);
+		const auto nonce2 = store.generate("realm:bob@sip.example.org", now + 1000);
+
+		BC_ASSERT_FALSE(store.updateNc(nonce1, now, 0));
+		BC_ASSERT_TRUE(store.updateNc(nonce1, now, 1));
+		BC_ASSERT_FALSE(store.updateNc(nonce1, now, 1)); // Replay.
+		BC_ASSERT_TRUE(store.updateNc(nonce1, now, 3));
+		BC_ASSERT_FALSE(store.updateNc(nonce1, now, 2));
+		BC_ASSERT_TRUE(store.updateNc(nonce2, now + 1000, 1));
+		BC_ASSERT_EQUAL(store.getTrackedNonceCount(), 2, size_t, "%zu");
+		BC_ASSERT_TRUE(store.getMemoryUsage() > 0);
+
+		// Only the counts of the expired nonces are dropped.
+		store.cleanExpired(now + 3600 + 1000);
+		BC_ASSERT_EQUAL(store.getTrackedNonceCount(), 1, size_t, "%zu");
+		store.cleanExpired(now + 3600 + 2000);
+		BC_ASSERT_EQUAL(store.getTrackedNonceCount(), 0, size_t, "%zu");
+	}
+};
+
+/*
+ * A request authenticated with an expired nonce is challenged again with stale=true, but isn't considered as forged.
+ */
+class StatelessNonceStaleChallengeTest : public Test {
+public:
+	void operator()() override {
+		sofiasip::SuRoot root{};
+		sofiasip::Home home{};
+		FlexisipAuthModule module{root.getCPtr(), "sip.example.org", 3600, false};
+		module.enableStatelessNonces();
+		auto *store = module.statelessNonceStore();
+		BC_HARD_ASSERT_TRUE(store != nullptr);
+
+		const auto *userUri = url_make(home.home(), "sip:alice@sip.example.org");
+		const auto nonce = store->generate("sip.example.org:alice@sip.example.org", getCurrentTime() - 3600 - 10);
+		auto *credentials = sip_authorization_make(
+		    home.home(), ("Digest username=\"alice\", realm=\"sip.example.org\", nonce=\"" + nonce +
+		                  "\", uri=\"sip:sip.example.org\", response=\"00000000000000000000000000000000\", "
+		                  "algorithm=MD5, opaque=\"+GNywA==\"")
+		                     .c_str());
+		BC_HARD_ASSERT_TRUE(credentials != nullptr);
+
+		auth_challenger_t challenger{};
+		challenger.ach_status = 401;
+		challenger.ach_phrase = sip_401_Unauthorized;
+		challenger.ach_header = sip_www_authenticate_class;
+		challenger.ach_info = sip_authentication_info_class;
+
+		FlexisipAuthStatus as{nullptr};
+		as.method("REGISTER");
+		as.userUri(userUri);
+		as.realm("sip.example.org");
+		as.usedAlgo() = {"MD5"};
+		auto notified = false;
+		as.callback([&notified](AuthStatus&) { notified = true; });
+
+		module.verify(as, credentials, &challenger);
+		BC_ASSERT_TRUE(notified);
+		BC_ASSERT_TRUE(as.status() == 401);
+		BC_ASSERT_TRUE(as.stale());
+		BC_ASSERT_FALSE(as.blacklist());
+		BC_HARD_ASSERT_TRUE(as.response() != nullptr);
+		const auto *challenge = sip_header_as_string(home.home(), reinterpret_cast<sip_header_t*>(as.response()));
+		BC_ASSERT_TRUE(strstr(challenge, "stale=true") != nullptr);
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("Stateless nonce validation", run<StatelessNonceValidationTest>),
+    TEST_NO_TAG("Stateless nonce count", run<StatelessNonceCountTest>),
+    TEST_NO_TAG("Stale stateless nonce challenge", run<StatelessNonceStaleChallengeTest>),
+};
+
+test_suite_t nonceStoreSuite = {
+    "Nonce store", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
@@ -0,0 +1,122 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "flexisip/sofia-wrapper/su-root.hh"
+
+#include "overload-control.hh"
+#include "sofia-wrapper/msg-sip.hh"
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace std::chrono;
+using namespace sofiasip;
+
+namespace flexisip {
+namespace tester {
+
+static OverloadControl::Priority getPriority(const string& request) {
+	MsgSip msg{0, request};
+	return OverloadControl::getPriority(*msg.getSip());
+}
+
+static string makeRequest(const string& method, int cseq, const string& toTag = "", const string& extraHeaders = "") {
+	return method + " sip:jean.claude@sip.linphone.org SIP/2.0\r\n" +
+	       "Via: SIP/2.0/UDP 192.168.1.197:5060;branch=z9hG4bK.Ku1n0uR3k;rport;oc\r\n" +
+	       "From: <sip:kijou@sip.linphone.org>;tag=08HMIWXqx\r\n" +
+	       "To: <sip:jean.claude@sip.linphone.org>" + (toTag.empty() ? "" : ";tag=" + toTag) + "\r\n" +
+	       "Call-ID: NISmf-QUnD\r\n" + "CSeq: " + to_string(cseq) + " " + method + "\r\n" + extraHeaders +
+	       "Content-Length: 0\r\n\r\n";
+}
+
+class RequestPriorityTest : public Test {
+public:
+	void operator()() override {
+		using Priority = OverloadControl::Priority;
+		BC_ASSERT_TRUE(getPriority(makeRequest("INVITE", 1)) == Priority::Normal);
+		BC_ASSERT_TRUE(getPriority(makeRequest("MESSAGE", 20)) == Priority::Normal);
+		BC_ASSERT_TRUE(getPriority(makeRequest("REGISTER", 1)) == Priority::Normal);
+		// Refreshes, and REGISTER answering a challenge.
+		BC_ASSERT_TRUE(getPriority(makeRequest("REGISTER", 12)) == Priority::High);
+		BC_ASSERT_TRUE(
+		    getPriority(makeRequest("REGISTER", 1, "",
+		                            "Authorization: Digest realm=\"sip.linphone.org\", nonce=\"abcd\", "
+		                            "username=\"kijou\", uri=\"sip:sip.linphone.org\", response=\"0123\"\r\n")) ==
+		    Priority::High);
+		// In-dialog requests, ACK and CANCEL.
+		BC_ASSERT_TRUE(getPriority(makeRequest("BYE", 21, "PelIhu0")) == Priority::Exempt);
+		BC_ASSERT_TRUE(getPriority(makeRequest("INVITE", 22, "PelIhu0")) == Priority::Exempt);
+		BC_ASSERT_TRUE(getPriority(makeRequest("ACK", 1)) == Priority::Exempt);
+		BC_ASSERT_TRUE(getPriority(makeRequest("CANCEL", 1)) == Priority::Exempt);
+	}
+};
+
+class ReductionTest : public Test {
+public:
+	void operator()() override {
+		BC_ASSERT_EQUAL(OverloadControl::computeReduction(50, 100), 0, unsigned, "%u");
+		BC_ASSERT_EQUAL(OverloadControl::computeReduction(100, 100), 0, unsigned, "%u");
+		BC_ASSERT_EQUAL(OverloadControl::computeReduction(101, 100), 1, unsigned, "%u");
+		BC_ASSERT_EQUAL(OverloadControl::computeReduction(200, 100), 50, unsigned, "%u");
+		BC_ASSERT_EQUAL(OverloadControl::computeReduction(1000, 100), 90, unsigned, "%u");
+		BC_ASSERT_EQUAL(OverloadControl::computeReduction(1000, 0), 0, unsigned, "%u");
+		BC_ASSERT_STRING_EQUAL(OverloadControl::formatSequence(milliseconds{1650000000042}).c_str(), "1650000000.042");
+		BC_ASSERT_STRING_EQUAL(OverloadControl::formatSequence(milliseconds{1650000000500}).c_str(), "1650000000.500");
+
+		static ConfigItemDescriptor items[] = {
+		    {Boolean, "enabled", "", "true"},
+		    {Integer, "max-main-loop-lag", "", "200"},
+		    {Integer, "max-suspended-events", "", "100"},
+		    {Integer, "max-backend-requests", "", "0"},
+		    {Integer, "retry-after", "", "5"},
+		    config_item_end};
+		auto* config = GenericManager::get()->getRoot()->addChild(
+		    make_unique<GenericStruct>("overload-control-test", "Overload control test", 998));
+		config->addChildrenValues(items);
+		auto root = make_shared<SuRoot>();
+		OverloadControl overloadControl{config};
+		overloadControl.load(root);
+
+		overloadControl.update(milliseconds{100}, 50, 100000); // The backend requests criterion is disabled.
+		BC_ASSERT_EQUAL(overloadControl.getReduction(), 0, unsigned, "%u");
+		overloadControl.update(milliseconds{400}, 50, 0);
+		BC_ASSERT_EQUAL(overloadControl.getReduction(), 50, unsigned, "%u");
+		// The most overloaded criterion is used.
+		overloadControl.update(milliseconds{400}, 1000, 0);
+		BC_ASSERT_EQUAL(overloadControl.getReduction(), 90, unsigned, "%u");
+		BC_ASSERT_EQUAL(config->get<StatCounter64>("count-reduction-percentage")->read(), 90, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(config->get<StatCounter64>("count-suspended-events")->read(), 1000, uint64_t, "%llu");
+		overloadControl.update(milliseconds{0}, 0, 0);
+		BC_ASSERT_EQUAL(overloadControl.getReduction(), 0, unsigned, "%u");
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("Request priority", run<RequestPriorityTest>),
+    TEST_NO_TAG("Reduction", run<ReductionTest>),
+};
+
+test_suite_t overloadControlSuite = {
+    "Overload control", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
@@ -0,0 +1,280 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include <belle-sip/belle-sip.h>
+
+#include "presence/cluster/presence-cluster.hh"
+#include "presence/presentity-manager.hh"
+#include "presence/presentity-presenceinformation.hh"
+#include "utils/belle-sip-utils.hh"
+#include "utils/consistent-hash-ring.hh"
+
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+
+namespace flexisip {
+namespace tester {
+
+namespace {
+
+/*
+ * Store remembering what is written to it. The states are only sent to the listener by deliver().
+ */
+class MemoryPresenceStore : public PresenceStore {
+public:
+	void publish(const string& presentity, const string& state, int) override {
+		states[presentity] = state;
+	}
+	void remove(const string& presentity, const string& finalState) override {
+		states.erase(presentity);
+		finalStates[presentity] = finalState;
+	}
+	void watch(const string& presentity) override {
+		watched.insert(presentity);
+	}
+	void unwatch(const string& presentity) override {
+		watched.erase(presentity);
+	}
+
+	void deliver(const string& presentity, const string& state) {
+		if (mListener) mListener->onPresentityState(presentity, state);
+	}
+
+	map<string, string> states{};
+	map<string, string> finalStates{};
+	set<string> watched{};
+};
+
+/*
+ * Presentity manager releasing the presentities like the presence server: a remote presentity is unwatched once its
+ * last listener is removed.
+ */
+class ClusterPresentityManager : public PresentityManager {
+public:
+	explicit ClusterPresentityManager(PresenceCluster& cluster) : mCluster(cluster) {
+	}
+
+	void invalidateETag(const string&) override {
+	}
+	void modifyEtag(const string&, const string&) override {
+	}
+	void addEtag(const shared_ptr<PresentityPresenceInformation>&, const string&) override {
+	}
+	void addOrUpdateListener(shared_ptr<PresentityPresenceInformationListener>& listener, int) override {
+		addOrUpdateListener(listener);
+	}
+	void addOrUpdateListener(shared_ptr<PresentityPresenceInformationListener>& listener) override {
+		presentity->addOrUpdateListener(listener);
+	}
+	void removeListener(const shared_ptr<PresentityPresenceInformationListener>& listener) override {
+		presentity->removeListener(listener);
+		if (presentity->getNumberOfListeners() == 0 && presentity->isRemote()) mCluster.unwatch(*presentity);
+	}
+
+	shared_ptr<PresentityPresenceInformation> presentity{};
+
+private:
+	PresenceCluster& mCluster;
+};
+
+/*
+ * Subscriber remembering the last document it was notified.
+ */
+class PidfRecorder : public PresentityPresenceInformationListener {
+public:
+	explicit PidfRecorder(const belle_sip_uri_t* presentity) : mPresentity(presentity) {
+	}
+
+	const belle_sip_uri_t* getPresentityUri() const override {
+		return mPresentity;
+	}
+	void onInformationChanged(PresentityPresenceInformation& presenceInformation, bool extended) override {
+		known = presenceInformation.isKnown();
+		pidf = known ? *presenceInformation.getPidf(extended) : "";
+		notifyCount++;
+	}
+	void onExpired(PresentityPresenceInformation&) override {
+	}
+	const belle_sip_uri_t* getFrom() override {
+		return mPresentity;
+	}
+	const belle_sip_uri_t* getTo() override {
+		return mPresentity;
+	}
+
+	bool known = false;
+	string pidf{};
+	int notifyCount = 0;
+
+private:
+	const belle_sip_uri_t* mPresentity;
+};
+
+} // namespace
+
+class PresenceClusterStateTest : public Test {
+public:
+	void operator()() override {
+		uint64_t version = 0;
+		string pidf{}, extendedPidf{};
+		BC_ASSERT_TRUE(PresenceCluster::decodeState(PresenceCluster::encodeState(42, "<basic/>", "<extended/>"),
+		                                            version, pidf, extendedPidf));
+		BC_ASSERT_TRUE(version == 42);
+		BC_ASSERT_STRING_EQUAL(pidf.c_str(), "<basic/>");
+		BC_ASSERT_STRING_EQUAL(extendedPidf.c_str(), "<extended/>");
+
+		BC_ASSERT_TRUE(PresenceCluster::decodeState(PresenceCluster::encodeState(UINT64_MAX, "", ""), version, pidf,
+		                                            extendedPidf));
+		BC_ASSERT_TRUE(version == UINT64_MAX);
+		BC_ASSERT_TRUE(pidf.empty() && extendedPidf.empty());
+
+		BC_ASSERT_FALSE(PresenceCluster::decodeState("", version, pidf, extendedPidf));
+		BC_ASSERT_FALSE(PresenceCluster::decodeState("8\n<basic/>", version, pidf, extendedPidf));
+		BC_ASSERT_FALSE(PresenceCluster::decodeState("1 12\n<basic/>", version, pidf, extendedPidf));
+		BC_ASSERT_FALSE(PresenceCluster::decodeState("x 8\n<basic/>", version, pidf, extendedPidf));
+		BC_ASSERT_FALSE(PresenceCluster::decodeState(" 8\n<basic/>", version, pidf, extendedPidf));
+	}
+};
+
+class PresenceClusterOwnershipTest : public Test {
+public:
+	void operator()() override {
+		const vector<string> nodes{"sip:presence1.example.org", "sip:presence2.example.org"};
+		auto* store = new MemoryPresenceStore{};
+		PresenceCluster cluster{nodes, nodes[0], unique_ptr<PresenceStore>{store}, 60};
+		const ConsistentHashRing ring{nodes};
+
+		int localCount = 0;
+		for (int i = 0; i < 100; i++) {
+			const auto user = "user" + to_string(i);
+			bellesip::shared_ptr<belle_sip_uri_t> uri{
+			    belle_sip_uri_parse(("sip:" + user + "@example.org;transport=tcp").c_str())};
+			BC_HARD_ASSERT_TRUE(uri != nullptr);
+			BC_ASSERT_STRING_EQUAL(PresenceCluster::getPresentityKey(uri.get()).c_str(),
+			                       (user + "@example.org").c_str());
+			// The proxies find the same owner from the request URI.
+			const auto local = cluster.isLocal(uri.get());
+			BC_ASSERT_TRUE(local == (ring.getOwner(user + "@example.org") == nodes[0]));
+			if (local) localCount++;
+
+			cluster.publish(uri.get(), "<basic " + user + "/>", "<extended " + user + "/>");
+		}
+		BC_ASSERT_TRUE(localCount > 0 && localCount < 100);
+
+		BC_HARD_ASSERT_TRUE(store->states.size() == 100);
+		uint64_t version = 0, previousVersion = 0;
+		string pidf{}, extendedPidf{};
+		BC_ASSERT_TRUE(PresenceCluster::decodeState(store->states["user0@example.org"], previousVersion, pidf,
+		                                            extendedPidf));
+		BC_ASSERT_TRUE(
+		    PresenceCluster::decodeState(store->states["user1@example.org"], version, pidf, extendedPidf));
+		BC_ASSERT_STRING_EQUAL(pidf.c_str(), "<basic user1/>");
+		BC_ASSERT_STRING_EQUAL(extendedPidf.c_str(), "<extended user1/>");
+		// The versions keep increasing, even when published within the same microsecond.
+		BC_ASSERT_TRUE(version > previousVersion);
+
+		bellesip::shared_ptr<belle_sip_uri_t> uri{belle_sip_uri_parse("sip:user1@example.org")};
+		cluster.remove(uri.get());
+		BC_ASSERT_TRUE(store->states.count("user1@example.org") == 0);
+		previousVersion = version;
+		BC_ASSERT_TRUE(
+		    PresenceCluster::decodeState(store->finalStates["user1@example.org"], version, pidf, extendedPidf));
+		BC_ASSERT_TRUE(version > previousVersion);
+		BC_ASSERT_TRUE(pidf.empty());
+	}
+};
+
+/*
+ * Copy of a presentity owned by another node: the states received from the store are given to its subscribers, unless
+ * older than the last one, and the presentity is unwatched when its last subscriber leaves.
+ */
+class PresenceClusterRemoteCopyTest : public Test {
+public:
+	void operator()() override {
+		const vector<string> nodes{"sip:presence1.example.org", "sip:presence2.example.org"};
+		auto* store = new MemoryPresenceStore{};
+		PresenceCluster cluster{nodes, nodes[0], unique_ptr<PresenceStore>{store}, 60};
+		ClusterPresentityManager manager{cluster};
+		bellesip::shared_ptr<belle_sip_main_loop_t> mainLoop{belle_sip_main_loop_new()};
+		bellesip::shared_ptr<belle_sip_uri_t> uri{belle_sip_uri_parse("sip:user%2Bremote@example.org")};
+		const string key = "user+remote@example.org";
+		BC_ASSERT_STRING_EQUAL(PresenceCluster::getPresentityKey(uri.get()).c_str(), key.c_str());
+
+		manager.presentity = make_shared<PresentityPresenceInformation>(uri.get(), manager, mainLoop.get());
+		manager.presentity->setRemote(true);
+		cluster.watch(manager.presentity);
+		BC_ASSERT_TRUE(store->watched.count(key) == 1);
+		auto recorder = make_shared<PidfRecorder>(uri.get());
+		auto listener = static_pointer_cast<PresentityPresenceInformationListener>(recorder);
+		manager.addOrUpdateListener(listener);
+		BC_ASSERT_FALSE(manager.presentity->isKnown());
+
+		// Nothing stored yet.
+		store->deliver(key, "");
+		BC_ASSERT_FALSE(manager.presentity->isKnown());
+
+		store->deliver(key, PresenceCluster::encodeState(10, "<basic 10/>", "<extended 10/>"));
+		BC_ASSERT_TRUE(manager.presentity->isKnown());
+		BC_ASSERT_TRUE(recorder->known);
+		BC_ASSERT_STRING_EQUAL(recorder->pidf.c_str(), "<basic 10/>");
+		const auto notifyCount = recorder->notifyCount;
+
+		// Older states, such as a fetch answered after a newer notification, are dropped.
+		store->deliver(key, PresenceCluster::encodeState(9, "<basic 9/>", "<extended 9/>"));
+		store->deliver(key, PresenceCluster::encodeState(10, "<basic 10/>", "<extended 10/>"));
+		store->deliver(key, "");
+		BC_ASSERT_EQUAL(recorder->notifyCount, notifyCount, int, "%d");
+		BC_ASSERT_STRING_EQUAL(recorder->pidf.c_str(), "<basic 10/>");
+
+		recorder->enableExtendedNotify(true);
+		store->deliver(key, PresenceCluster::encodeState(11, "<basic 11/>", "<extended 11/>"));
+		BC_ASSERT_STRING_EQUAL(recorder->pidf.c_str(), "<extended 11/>");
+
+		// A removal by the owner makes the presentity unknown.
+		store->deliver(key, PresenceCluster::encodeState(12, "", ""));
+		BC_ASSERT_FALSE(manager.presentity->isKnown());
+		BC_ASSERT_FALSE(recorder->known);
+
+		// The presentity is unwatched with its last subscriber, and doesn't receive the states anymore.
+		manager.removeListener(listener);
+		BC_ASSERT_TRUE(store->watched.count(key) == 0);
+		const auto finalNotifyCount = recorder->notifyCount;
+		store->deliver(key, PresenceCluster::encodeState(13, "<basic 13/>", "<extended 13/>"));
+		BC_ASSERT_FALSE(manager.presentity->isKnown());
+		BC_ASSERT_EQUAL(recorder->notifyCount, finalNotifyCount, int, "%d");
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("State encoding", run<PresenceClusterStateTest>),
+    TEST_NO_TAG("Ownership of the presentities", run<PresenceClusterOwnershipTest>),
+    TEST_NO_TAG("Copy of a remote presentity", run<PresenceClusterRemoteCopyTest>),
+};
+
+test_suite_t presenceClusterSuite = {
+    "Presence cluster", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
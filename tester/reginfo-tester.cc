@@ -0,0 +1,374 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <linphone++/linphone.hh>
+
+#include "flexisip/registrardb.hh"
+
+#include "registration-events/client.hh"
+#include "registration-events/reginfo-writer.hh"
+#include "registration-events/registrar/listener.hh"
+#include "xml/reginfo.hh"
+
+#include "tester.hh"
+#include "utils/test-paterns/agent-test.hh"
+
+using namespace std;
+
+namespace flexisip {
+namespace tester {
+
+namespace {
+
+const string aor = "sip:dave@sip.example.org";
+
+unique_ptr<reginfo::Reginfo> parseReginfo(const string& body) {
+	istringstream data(body);
+	return reginfo::parseReginfo(data, Xsd::XmlSchema::Flags::dont_validate);
+}
+
+string gruu(const string& uuid) {
+	return aor + ";gr=urn:uuid:" + uuid;
+}
+
+const reginfo::Contact* findContact(const reginfo::Reginfo& ri, const string& uuid) {
+	if (ri.getRegistration().empty()) return nullptr;
+	for (const auto& contact : ri.getRegistration().front().getContact()) {
+		if (contact.getId() == gruu(uuid)) return &contact;
+	}
+	return nullptr;
+}
+
+size_t contactCount(const reginfo::Reginfo& ri) {
+	return ri.getRegistration().empty() ? 0 : ri.getRegistration().front().getContact().size();
+}
+
+} // namespace
+
+/*
+ * Read back the documents written by the ReginfoWriter with the XSD bindings.
+ */
+class ReginfoWriterTest : public Test {
+public:
+	void operator()() override {
+		using namespace RegistrationEvent;
+
+		ReginfoContact first{};
+		first.uri = "sip:user@sip.example.org;gr=urn:uuid:1&2";
+		first.displayName = "Phone <\"1\">";
+		first.expires = 3600;
+		first.unknownParams.emplace_back("+org.linphone.specs", "groupchat,lime");
+		first.unknownParams.emplace_back("+sip.instance", "");
+		ReginfoContact second{};
+		second.uri = "sip:user@sip.example.org;gr=urn:uuid:3";
+
+		string contacts{};
+		ReginfoWriter::appendContact(contacts, first, "active", "registered");
+		ReginfoWriter::appendContact(contacts, second, "terminated", "unregistered");
+		auto ri = parseReginfo(ReginfoWriter::writeDocument(4, false, "sip:user@sip.example.org",
+		                                                    "user@sip.example.org", "active", contacts));
+		BC_HARD_ASSERT_TRUE(ri != nullptr);
+		BC_ASSERT_TRUE(ri->getVersion() == 4);
+		BC_ASSERT_TRUE(ri->getState() == reginfo::State::partial);
+		BC_HARD_ASSERT_TRUE(ri->getRegistration().size() == 1);
+		const auto& registration = ri->getRegistration().front();
+		BC_ASSERT_STRING_EQUAL(registration.getAor().c_str(), "sip:user@sip.example.org");
+		BC_ASSERT_STRING_EQUAL(registration.getId().c_str(), "user@sip.example.org");
+		BC_ASSERT_TRUE(registration.getState() == reginfo::Registration::StateType::active);
+		BC_HARD_ASSERT_TRUE(registration.getContact().size() == 2);
+
+		const auto& active = registration.getContact().front();
+		BC_ASSERT_STRING_EQUAL(active.getId().c_str(), first.uri.c_str());
+		BC_ASSERT_STRING_EQUAL(active.getUri().c_str(), first.uri.c_str());
+		BC_ASSERT_TRUE(active.getState() == reginfo::Contact::StateType::active);
+		BC_ASSERT_TRUE(active.getEvent() == reginfo::Event::registered);
+		BC_ASSERT_TRUE(active.getExpires() && *active.getExpires() == 3600);
+		BC_ASSERT_TRUE(active.getDisplayName() && *active.getDisplayName() == first.displayName);
+		BC_HARD_ASSERT_TRUE(active.getUnknownParam().size() == 2);
+		BC_ASSERT_STRING_EQUAL(active.getUnknownParam().front().getName().c_str(), "+org.linphone.specs");
+		BC_ASSERT_STRING_EQUAL(active.getUnknownParam().front().c_str(), "groupchat,lime");
+
+		const auto& terminated = registration.getContact().back();
+		BC_ASSERT_TRUE(terminated.getState() == reginfo::Contact::StateType::terminated);
+		BC_ASSERT_TRUE(terminated.getEvent() == reginfo::Event::unregistered);
+		BC_ASSERT_FALSE(terminated.getExpires());
+		BC_ASSERT_FALSE(terminated.getDisplayName());
+
+		ri = parseReginfo(ReginfoWriter::writeEmptyDocument(0, true));
+		BC_HARD_ASSERT_TRUE(ri != nullptr);
+		BC_ASSERT_TRUE(ri->getState() == reginfo::State::full);
+		BC_ASSERT_TRUE(ri->getRegistration().empty());
+	}
+};
+
+/*
+ * Give successive records to the registrar listener of the regevent server, and check the documents sent to each of
+ * its subscriptions.
+ */
+class RegistrarListenerTest : public AgentTest {
+protected:
+	void onAgentConfiguration(GenericManager& cfg) override {
+		AgentTest::onAgentConfiguration(cfg);
+		auto* registrarConf = cfg.getRoot()->get<GenericStruct>("module::Registrar");
+		registrarConf->get<ConfigValue>("db-implementation")->set("internal");
+	}
+
+	void onExec() override {
+		RegistrationEvent::Registrar::Listener listener{aor, "dave@sip.example.org"};
+		vector<string> first{}, second{}, third{};
+		listener.addSubscription(&first, [&first](const string& body) { first.push_back(body); });
+
+		// A new subscription gets the full state, at version 0.
+		listener.onContactRegistered(makeRecord({makeContact("1", "groupchat"), makeContact("2", "groupchat")}), "");
+		BC_HARD_ASSERT_TRUE(first.size() == 1);
+		auto ri = parseReginfo(first.back());
+		BC_ASSERT_TRUE(ri->getState() == reginfo::State::full);
+		BC_ASSERT_TRUE(ri->getVersion() == 0);
+		BC_HARD_ASSERT_TRUE(contactCount(*ri) == 2);
+		BC_ASSERT_TRUE(ri->getRegistration().front().getState() == reginfo::Registration::StateType::active);
+		auto contact = findContact(*ri, "1");
+		BC_HARD_ASSERT_TRUE(contact != nullptr);
+		BC_ASSERT_TRUE(contact->getState() == reginfo::Contact::StateType::active);
+		BC_ASSERT_TRUE(contact->getEvent() == reginfo::Event::registered);
+		BC_ASSERT_TRUE(contact->getExpires() && *contact->getExpires() == 3600);
+
+		// Only the modified contact is sent.
+		listener.onContactRegistered(makeRecord({makeContact("1", "groupchat"), makeContact("2", "groupchat,lime")}),
+		                             "");
+		BC_HARD_ASSERT_TRUE(first.size() == 2);
+		ri = parseReginfo(first.back());
+		BC_ASSERT_TRUE(ri->getState() == reginfo::State::partial);
+		BC_ASSERT_TRUE(ri->getVersion() == 1);
+		BC_HARD_ASSERT_TRUE(contactCount(*ri) == 1);
+		contact = findContact(*ri, "2");
+		BC_HARD_ASSERT_TRUE(contact != nullptr);
+		BC_ASSERT_TRUE(contact->getEvent() == reginfo::Event::registered);
+
+		// A contact registered again without change is sent as refreshed. The subscription added meanwhile gets the
+		// full state with the modified contact.
+		listener.addSubscription(&second, [&second](const string& body) { second.push_back(body); });
+		auto contacts = vector<shared_ptr<ExtendedContact>>{makeContact("1", "groupchat"),
+		                                                    makeContact("2", "groupchat,lime")};
+		listener.onContactRegistered(makeRecord(contacts), contacts.front()->getUniqueId());
+		BC_HARD_ASSERT_TRUE(first.size() == 3);
+		ri = parseReginfo(first.back());
+		BC_ASSERT_TRUE(ri->getVersion() == 2);
+		BC_HARD_ASSERT_TRUE(contactCount(*ri) == 1);
+		contact = findContact(*ri, "1");
+		BC_HARD_ASSERT_TRUE(contact != nullptr);
+		BC_ASSERT_TRUE(contact->getEvent() == reginfo::Event::refreshed);
+		BC_HARD_ASSERT_TRUE(second.size() == 1);
+		ri = parseReginfo(second.back());
+		BC_ASSERT_TRUE(ri->getState() == reginfo::State::full);
+		BC_ASSERT_TRUE(ri->getVersion() == 0);
+		BC_ASSERT_TRUE(contactCount(*ri) == 2);
+		contact = findContact(*ri, "2");
+		BC_HARD_ASSERT_TRUE(contact != nullptr);
+		bool specsFound = false;
+		for (const auto& param : contact->getUnknownParam()) {
+			if (param.getName() != "+org.linphone.specs") continue;
+			BC_ASSERT_STRING_EQUAL(param.c_str(), "groupchat,lime");
+			specsFound = true;
+		}
+		BC_ASSERT_TRUE(specsFound);
+
+		// The removed contact is sent as unregistered, each subscription with its own version.
+		listener.onContactRegistered(makeRecord({makeContact("2", "groupchat,lime")}), "");
+		BC_HARD_ASSERT_TRUE(first.size() == 4);
+		BC_HARD_ASSERT_TRUE(second.size() == 2);
+		BC_ASSERT_TRUE(parseReginfo(first.back())->getVersion() == 3);
+		ri = parseReginfo(second.back());
+		BC_ASSERT_TRUE(ri->getState() == reginfo::State::partial);
+		BC_ASSERT_TRUE(ri->getVersion() == 1);
+		BC_HARD_ASSERT_TRUE(contactCount(*ri) == 1);
+		contact = findContact(*ri, "1");
+		BC_HARD_ASSERT_TRUE(contact != nullptr);
+		BC_ASSERT_TRUE(contact->getState() == reginfo::Contact::StateType::terminated);
+		BC_ASSERT_TRUE(contact->getEvent() == reginfo::Event::unregistered);
+
+		// An unchanged record sends nothing but the full state to the new subscriptions, written once for all of
+		// them from the last contacts.
+		vector<string> fourth{};
+		listener.addSubscription(&third, [&third](const string& body) { third.push_back(body); });
+		listener.addSubscription(&fourth, [&fourth](const string& body) { fourth.push_back(body); });
+		listener.onContactRegistered(makeRecord({makeContact("2", "groupchat,lime")}), "");
+		BC_ASSERT_TRUE(first.size() == 4);
+		BC_ASSERT_TRUE(second.size() == 2);
+		BC_HARD_ASSERT_TRUE(third.size() == 1);
+		BC_HARD_ASSERT_TRUE(fourth.size() == 1);
+		BC_ASSERT_STRING_EQUAL(third.back().c_str(), fourth.back().c_str());
+		ri = parseReginfo(third.back());
+		BC_ASSERT_TRUE(ri->getState() == reginfo::State::full);
+		BC_HARD_ASSERT_TRUE(contactCount(*ri) == 1);
+		BC_ASSERT_TRUE(findContact(*ri, "2") != nullptr);
+
+		// A removed subscription isn't notified anymore. Once the record is gone, the registration is terminated.
+		listener.removeSubscription(&first);
+		listener.removeSubscription(&fourth);
+		listener.onContactRegistered(nullptr, "");
+		BC_ASSERT_TRUE(first.size() == 4);
+		BC_ASSERT_TRUE(fourth.size() == 1);
+		BC_HARD_ASSERT_TRUE(third.size() == 2);
+		ri = parseReginfo(third.back());
+		BC_ASSERT_TRUE(ri->getVersion() == 1);
+		BC_HARD_ASSERT_TRUE(contactCount(*ri) == 1);
+		BC_ASSERT_TRUE(ri->getRegistration().front().getState() == reginfo::Registration::StateType::terminated);
+		contact = findContact(*ri, "2");
+		BC_HARD_ASSERT_TRUE(contact != nullptr);
+		BC_ASSERT_TRUE(contact->getState() == reginfo::Contact::StateType::terminated);
+		BC_ASSERT_TRUE(second.size() == 3);
+	}
+
+private:
+	shared_ptr<ExtendedContact> makeContact(const string& uuid, const string& specs) {
+		sofiasip::Home home;
+		const auto url = "sip:dave@10.0.0.1;transport=tcp;gr=urn:uuid:" + uuid;
+		const auto instance = "+sip.instance=\"<urn:uuid:" + uuid + ">\"";
+		const auto specsParam = "+org.linphone.specs=\"" + specs + "\"";
+		auto* contact = sip_contact_create(home.home(), reinterpret_cast<const url_string_t*>(url.c_str()),
+		                                   instance.c_str(), specsParam.c_str(), "expires=3600", nullptr);
+		ExtendedContactCommon common{{}, "call-" + uuid, "<urn:uuid:" + uuid + ">"};
+		return make_shared<ExtendedContact>(common, contact, 3600, 1, getCurrentTime(), false, list<string>{}, "");
+	}
+
+	shared_ptr<Record> makeRecord(const vector<shared_ptr<ExtendedContact>>& contacts) {
+		auto record = make_shared<Record>(SipUri{aor});
+		for (const auto& contact : contacts) record->pushContact(contact);
+		return record;
+	}
+};
+
+/*
+ * Give full and partial states to a regevent client, and check the devices it notifies.
+ */
+class ReginfoClientTest : public Test {
+public:
+	void operator()() override {
+		auto core = linphone::Factory::get()->createCore("", "", nullptr);
+		auto factory = make_shared<RegistrationEvent::ClientFactory>(core);
+		auto client = make_shared<TestClient>(factory, linphone::Factory::get()->createAddress(aor));
+		DeviceListener listener{};
+		client->setListener(&listener);
+
+		// A partial state received before the full state makes the client subscribe again.
+		client->processReginfo(writeDocument(1, false, {{"1", "active", "registered"}}));
+		BC_ASSERT_TRUE(client->resubscribeCount == 1);
+		BC_ASSERT_TRUE(listener.notifyCount == 0);
+
+		client->processReginfo(writeDocument(0, true, {{"1", "active", "registered"}, {"2", "active", "registered"}}));
+		BC_ASSERT_TRUE(listener.notifyCount == 1);
+		BC_ASSERT_TRUE(listener.devices == (list<string>{gruu("1"), gruu("2")}));
+
+		// The partial states are applied to the known devices.
+		client->processReginfo(writeDocument(1, false, {{"3", "active", "registered"}}));
+		BC_ASSERT_TRUE(listener.notifyCount == 2);
+		BC_ASSERT_TRUE(listener.devices == (list<string>{gruu("1"), gruu("2"), gruu("3")}));
+
+		// A version already received is ignored.
+		client->processReginfo(writeDocument(1, false, {{"4", "active", "registered"}}));
+		BC_ASSERT_TRUE(listener.notifyCount == 2);
+
+		client->processReginfo(writeDocument(2, false, {{"1", "terminated", "unregistered"}}));
+		BC_ASSERT_TRUE(listener.notifyCount == 3);
+		BC_ASSERT_TRUE(listener.devices == (list<string>{gruu("2"), gruu("3")}));
+
+		// A refreshed device doesn't change the list.
+		client->processReginfo(writeDocument(3, false, {{"2", "active", "refreshed"}}));
+		BC_ASSERT_TRUE(listener.notifyCount == 3);
+		BC_ASSERT_TRUE(listener.refreshCount == 1);
+
+		// A missing version makes the client subscribe again, without applying the state.
+		client->processReginfo(writeDocument(5, false, {{"2", "terminated", "unregistered"}}));
+		BC_ASSERT_TRUE(client->resubscribeCount == 2);
+		BC_ASSERT_TRUE(listener.notifyCount == 3);
+
+		// The full state following the new subscription replaces the devices.
+		client->processReginfo(writeDocument(0, true, {{"3", "active", "registered"}}));
+		BC_ASSERT_TRUE(listener.notifyCount == 4);
+		BC_ASSERT_TRUE(listener.devices == (list<string>{gruu("3")}));
+	}
+
+private:
+	class TestClient : public RegistrationEvent::Client {
+	public:
+		TestClient(const shared_ptr<RegistrationEvent::ClientFactory>& factory,
+		           const shared_ptr<const linphone::Address>& to)
+		    : Client(factory, to) {
+		}
+
+		using Client::processReginfo;
+
+		int resubscribeCount = 0;
+
+	protected:
+		void resubscribe() override {
+			resubscribeCount++;
+		}
+	};
+
+	struct DeviceListener : public RegistrationEvent::ClientListener {
+		void onNotifyReceived(const list<shared_ptr<linphone::ParticipantDeviceIdentity>>& participantDevices) override {
+			devices.clear();
+			for (const auto& device : participantDevices) devices.push_back(device->getAddress()->asStringUriOnly());
+			notifyCount++;
+		}
+		void onRefreshed(const shared_ptr<linphone::ParticipantDeviceIdentity>& participantDevice) override {
+			refreshCount++;
+		}
+
+		list<string> devices{};
+		int notifyCount = 0;
+		int refreshCount = 0;
+	};
+
+	struct ContactChange {
+		string uuid;
+		const char* state;
+		const char* event;
+	};
+
+	static string writeDocument(uint32_t version, bool fullState, const vector<ContactChange>& changes) {
+		string contacts{};
+		for (const auto& change : changes) {
+			RegistrationEvent::ReginfoContact contact{};
+			contact.uri = gruu(change.uuid);
+			contact.unknownParams.emplace_back("+org.linphone.specs", "groupchat");
+			RegistrationEvent::ReginfoWriter::appendContact(contacts, contact, change.state, change.event);
+		}
+		return RegistrationEvent::ReginfoWriter::writeDocument(version, fullState, aor, "dave@sip.example.org",
+		                                                       "active", contacts);
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("Reginfo writer", run<ReginfoWriterTest>),
+    TEST_NO_TAG("Registrar listener", run<RegistrarListenerTest>),
+    TEST_NO_TAG("Client partial states", run<ReginfoClientTest>),
+};
+
+test_suite_t reginfoSuite = {
+    "Reginfo", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
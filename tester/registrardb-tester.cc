@@ -19,6 +19,7 @@
 #include "flexisip/configmanager.hh"
 #include "flexisip/registrardb.hh"
 
+#include "registrar-subscription-hub.hh"
 #include "tester.hh"
 #include "utils/redis-server.hh"
 #include "utils/test-paterns/agent-test.hh"
@@ -110,6 +111,86 @@ protected:
 };
 
 
+// Check that the listeners of the same AOR share a single subscription and fetch through the RegistrarSubscriptionHub.
+class RegistrarSubscriptionHubTest : public RegistrarDbTest {
+protected:
+	struct RecordListener : public ContactRegisteredListener {
+		void onContactRegistered(const std::shared_ptr<Record>& r, const std::string& uid) override {
+			record = r;
+			lastUid = uid;
+			++count;
+		}
+
+		std::shared_ptr<Record> record{};
+		std::string lastUid{};
+		int count{0};
+	};
+	class BindListener : public ContactUpdateListener {
+	public:
+		void onRecordFound(const std::shared_ptr<Record>& r) override {
+			found = true;
+		}
+		void onError() override {
+		}
+		void onInvalid() override {
+		}
+		void onContactUpdated(const std::shared_ptr<ExtendedContact>& ec) override {
+		}
+
+		bool found{false};
+	};
+
+	void onAgentConfiguration(GenericManager& cfg) override {
+		AgentTest::onAgentConfiguration(cfg);
+		auto* registrarConf = cfg.getRoot()->get<GenericStruct>("module::Registrar");
+		registrarConf->get<ConfigValue>("db-implementation")->set("internal");
+	}
+
+	void onExec() noexcept override {
+		sofiasip::Home home;
+		auto* regDb = RegistrarDb::get();
+		auto& hub = RegistrarSubscriptionHub::get();
+		const SipUri aor{"sip:carol@sip.example.org"};
+
+		BindingParameters params;
+		params.globalExpire = 1000;
+		params.callId = "hub-call-id";
+		auto bindListener = make_shared<BindListener>();
+		regDb->bind(aor,
+		            sip_contact_create(home.home(), (url_string_t*)"sip:carol@10.0.0.1;transport=tcp",
+		                               "+sip.instance=\"<urn:uuid:carol-1>\"", nullptr),
+		            params, bindListener);
+		BC_HARD_ASSERT_TRUE(waitFor([bindListener]() { return bindListener->found; }, 1s));
+
+		auto first = make_shared<RecordListener>();
+		auto second = make_shared<RecordListener>();
+		hub.subscribe(aor, first);
+		BC_ASSERT_TRUE(waitFor([first]() { return first->count == 1; }, 1s));
+		// The record fetched for the first listener is given at once to the second one.
+		hub.subscribe(aor, second);
+		BC_ASSERT_EQUAL(second->count, 1, int, "%d");
+		BC_ASSERT_TRUE(hub.getTopicCount() == 1);
+		BC_HARD_ASSERT_TRUE(second->record != nullptr);
+		BC_ASSERT_TRUE(second->record->getExtendedContacts().size() == 1);
+		BC_ASSERT_TRUE(second->lastUid.empty());
+
+		// A new registration is fanned out to both listeners.
+		regDb->publish(Record::defineKeyFromUrl(aor.get()), "urn:uuid:carol-1");
+		BC_ASSERT_TRUE(waitFor([first, second]() { return first->count == 2 && second->count == 2; }, 1s));
+		BC_ASSERT_STRING_EQUAL(second->lastUid.c_str(), "urn:uuid:carol-1");
+
+		// The subscription is kept until the last listener leaves.
+		hub.unsubscribe(aor, first);
+		BC_ASSERT_TRUE(hub.getTopicCount() == 1);
+		hub.unsubscribe(aor, second);
+		BC_ASSERT_TRUE(hub.getTopicCount() == 0);
+		regDb->publish(Record::defineKeyFromUrl(aor.get()), "urn:uuid:carol-1");
+		waitFor(100ms);
+		BC_ASSERT_EQUAL(first->count, 2, int, "%d");
+		BC_ASSERT_EQUAL(second->count, 2, int, "%d");
+	}
+};
+
 class RegistrarTester : public RegistrarDbTest{
 	
 protected:
@@ -249,7 +330,8 @@ static test_t tests[] = {TEST_NO_TAG("Subsequent UNSUBSCRIBE/SUBSCRIBE with inte
                          TEST_NO_TAG("Subsequent UNSUBSCRIBE/SUBSCRIBE with Redis backend",
                                      run<SubsequentUnsubscribeSubscribeWithRedisTest>),
 			TEST_NO_TAG("Registrations with Redis backend",
-                                     run<RegistrarTester>)
+                                     run<RegistrarTester>),
+                         TEST_NO_TAG("Registrar subscription hub", run<RegistrarSubscriptionHubTest>)
 };
 
 test_suite_t registarDbSuite = {
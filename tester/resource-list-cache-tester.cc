@@ -0,0 +1,126 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+#include <string>
+
+#include "presence/list-subscription/resource-list-cache.hh"
+
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+
+namespace flexisip {
+namespace tester {
+
+namespace {
+
+const string key = ResourceListCache::makeKey("sip:user@sip.example.org", "sip:friends@sip.example.org");
+
+ResourceListCache::ListPtr makeList(const string& uri) {
+	return make_shared<const ResourceList>(ResourceList{{uri, "Friend"}});
+}
+
+} // namespace
+
+/**
+ * Lookups of a list being loaded wait for the load instead of loading it again, then the list is served from the
+ * cache until it is invalidated.
+ */
+class ResourceListCacheSingleFlightTest : public Test {
+public:
+	void operator()() override {
+		ResourceListCache cache{300};
+		ResourceListCache::ListPtr first{}, second{};
+		int calls = 0;
+
+		BC_ASSERT_TRUE(cache.get(key, [&](const ResourceListCache::ListPtr& list) {
+			first = list;
+			calls++;
+		}));
+		BC_ASSERT_FALSE(cache.get(key, [&](const ResourceListCache::ListPtr& list) {
+			second = list;
+			calls++;
+		}));
+		BC_ASSERT_TRUE(calls == 0);
+
+		cache.onLoaded(key, makeList("sip:a@sip.example.org"));
+		BC_ASSERT_TRUE(calls == 2);
+		BC_HARD_ASSERT_TRUE(first != nullptr);
+		BC_ASSERT_TRUE(first == second);
+		BC_ASSERT_TRUE(cache.getMissCount() == 1);
+		BC_ASSERT_TRUE(cache.getCoalescedCount() == 1);
+
+		ResourceListCache::ListPtr cached{};
+		BC_ASSERT_FALSE(cache.get(key, [&](const ResourceListCache::ListPtr& list) { cached = list; }));
+		BC_ASSERT_TRUE(cached == first);
+		BC_ASSERT_TRUE(cache.getHitCount() == 1);
+
+		BC_ASSERT_STRING_EQUAL(
+		    cache.handleCommand("RLS_CACHE", {"INVALIDATE", "sip:user@sip.example.org", "sip:friends@sip.example.org"})
+		        .c_str(),
+		    "Done");
+		BC_ASSERT_TRUE(cache.get(key, [](const ResourceListCache::ListPtr&) {}));
+		BC_ASSERT_TRUE(cache.handleCommand("SIP_BRIDGE", {"INFO"}).empty());
+	}
+};
+
+/**
+ * A list whose load started before an invalidation is given to the waiting lookups but not cached, and failed loads
+ * are not cached either.
+ */
+class ResourceListCacheInvalidationTest : public Test {
+public:
+	void operator()() override {
+		ResourceListCache cache{300};
+		ResourceListCache::ListPtr loaded{};
+
+		BC_ASSERT_TRUE(cache.get(key, [&](const ResourceListCache::ListPtr& list) { loaded = list; }));
+		cache.invalidateAll();
+		cache.onLoaded(key, makeList("sip:a@sip.example.org"));
+		BC_ASSERT_TRUE(loaded != nullptr);
+		BC_ASSERT_TRUE(cache.get(key, [](const ResourceListCache::ListPtr&) {}));
+
+		bool called = false;
+		cache.onLoaded(key, nullptr);
+		BC_ASSERT_TRUE(cache.get(key, [&](const ResourceListCache::ListPtr& list) {
+			called = true;
+			BC_ASSERT_TRUE(list == nullptr);
+		}));
+		cache.onLoaded(key, nullptr);
+		BC_ASSERT_TRUE(called);
+
+		// Without lifetime, lists are never served from the cache.
+		ResourceListCache uncached{0};
+		BC_ASSERT_TRUE(uncached.get(key, [](const ResourceListCache::ListPtr&) {}));
+		uncached.onLoaded(key, makeList("sip:a@sip.example.org"));
+		BC_ASSERT_TRUE(uncached.get(key, [](const ResourceListCache::ListPtr&) {}));
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("Single-flight loading", run<ResourceListCacheSingleFlightTest>),
+    TEST_NO_TAG("Invalidation", run<ResourceListCacheInvalidationTest>),
+};
+
+test_suite_t resourceListCacheSuite = {
+    "Resource list cache", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
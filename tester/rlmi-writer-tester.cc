@@ -0,0 +1,158 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include "flexisip-config.h"
+#include "flexisip/logmanager.hh"
+
+#include "presence/list-subscription/rlmi-writer.hh"
+#include "xml/rlmi+xml.hh"
+
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+namespace tester {
+
+namespace {
+
+const string listUri = "sip:friends@sip.example.org";
+
+string resourceUri(int i) {
+	return "sip:user" + to_string(i) + "@sip.example.org";
+}
+
+string serializeWithXsd(const Xsd::Rlmi::List& list) {
+	ostringstream out;
+	Xsd::XmlSchema::NamespaceInfomap map;
+	map[""].name = "urn:ietf:params:xml:ns:rlmi";
+	Xsd::Rlmi::serializeList(out, list, map);
+	return out.str();
+}
+
+unique_ptr<Xsd::Rlmi::List> parseWithXsd(const string& body) {
+	istringstream data(body);
+	return Xsd::Rlmi::parseList(data, Xsd::XmlSchema::Flags::dont_validate);
+}
+
+/*
+ * The list as built by the presence server before the RLMI writer.
+ */
+Xsd::Rlmi::List buildWithXsd(int resourceCount, bool withInstances) {
+	Xsd::Rlmi::List list(listUri, 3, true);
+	for (int i = 0; i < resourceCount; i++) {
+		Xsd::Rlmi::Resource resource(resourceUri(i));
+		resource.getName().push_back("User " + to_string(i));
+		if (withInstances) {
+			Xsd::Rlmi::Instance instance("1", Xsd::Rlmi::State::active);
+			instance.setCid("cid" + to_string(i) + "@sip.example.org");
+			resource.getInstance().push_back(instance);
+		}
+		list.getResource().push_back(resource);
+	}
+	return list;
+}
+
+string buildWithWriter(int resourceCount, bool withInstances) {
+	RlmiWriter writer(listUri, 3, true);
+	for (int i = 0; i < resourceCount; i++) {
+		writer.addResource(resourceUri(i), "User " + to_string(i),
+		                   withInstances ? "cid" + to_string(i) + "@sip.example.org" : "");
+	}
+	return writer.finish();
+}
+
+} // namespace
+
+class RlmiWriterTest : public Test {
+public:
+	void operator()() override {
+		// Reading the document back gives the same object model as the one the XSD serializer would have written.
+		const auto rlmi = buildWithWriter(3, true);
+		BC_ASSERT_STRING_EQUAL(serializeWithXsd(*parseWithXsd(rlmi)).c_str(),
+		                       serializeWithXsd(buildWithXsd(3, true)).c_str());
+
+		RlmiWriter writer("sip:a&b@sip.example.org", 0, false);
+		writer.addResource("sip:c@sip.example.org", "\"C\" <c>");
+		writer.addResource("sip:d@sip.example.org", "", "cid@sip.example.org");
+		BC_ASSERT_EQUAL(writer.getResourceCount(), 2, unsigned, "%u");
+		auto list = parseWithXsd(writer.finish());
+		BC_HARD_ASSERT_TRUE(list != nullptr);
+		BC_ASSERT_STRING_EQUAL(list->getUri().c_str(), "sip:a&b@sip.example.org");
+		BC_ASSERT_TRUE(list->getVersion() == 0);
+		BC_ASSERT_FALSE(list->getFullState());
+		BC_HARD_ASSERT_TRUE(list->getResource().size() == 2);
+		const auto& first = list->getResource().front();
+		BC_HARD_ASSERT_TRUE(first.getName().size() == 1);
+		BC_ASSERT_STRING_EQUAL(first.getName().front().c_str(), "\"C\" <c>");
+		BC_ASSERT_TRUE(first.getInstance().empty());
+		const auto& second = list->getResource().back();
+		BC_ASSERT_TRUE(second.getName().empty());
+		BC_HARD_ASSERT_TRUE(second.getInstance().size() == 1);
+		BC_ASSERT_TRUE(second.getInstance().front().getState() == Xsd::Rlmi::State::active);
+		BC_ASSERT_STRING_EQUAL(second.getInstance().front().getCid()->c_str(), "cid@sip.example.org");
+	}
+};
+
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+/**
+ * Compare the time spent building the RLMI document of the first NOTIFY of a large list, with the XSD bindings and
+ * with the RLMI writer.
+ */
+class RlmiWriterBenchmark : public Test {
+public:
+	void operator()() override {
+		constexpr int resourceCount = 2000;
+		constexpr int iterations = 20;
+
+		auto start = steady_clock::now();
+		for (int i = 0; i < iterations; i++) {
+			BC_HARD_ASSERT_FALSE(serializeWithXsd(buildWithXsd(resourceCount, true)).empty());
+		}
+		const auto xsdDuration = duration_cast<microseconds>(steady_clock::now() - start).count() / iterations;
+
+		start = steady_clock::now();
+		for (int i = 0; i < iterations; i++) {
+			BC_HARD_ASSERT_FALSE(buildWithWriter(resourceCount, true).empty());
+		}
+		const auto writerDuration = duration_cast<microseconds>(steady_clock::now() - start).count() / iterations;
+
+		SLOGI << "RLMI document of " << resourceCount << " resources: " << xsdDuration << "us with XSD, "
+		      << writerDuration << "us with the RLMI writer";
+	}
+};
+#endif
+
+static test_t tests[] = {
+    TEST_NO_TAG("RLMI writer", run<RlmiWriterTest>),
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+    TEST_NO_TAG("RLMI writer benchmark", run<RlmiWriterBenchmark>),
+#endif
+};
+
+test_suite_t rlmiWriterSuite = {
+    "RLMI writer", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
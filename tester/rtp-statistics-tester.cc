@@ -0,0 +1,128 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <vector>
+
+#include <arpa/inet.h>
+
+#include "rtp-statistics.hh"
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+namespace tester {
+
+static vector<uint8_t> makeRtpPacket(uint16_t seq, uint32_t ts, uint32_t ssrc = 0x1234) {
+	vector<uint8_t> packet(172, 0);
+	packet[0] = 0x80;
+	uint16_t nseq = htons(seq);
+	memcpy(&packet[2], &nseq, sizeof(nseq));
+	uint32_t nts = htonl(ts);
+	memcpy(&packet[4], &nts, sizeof(nts));
+	uint32_t nssrc = htonl(ssrc);
+	memcpy(&packet[8], &nssrc, sizeof(nssrc));
+	return packet;
+}
+
+class RtpLossAndJitterTest : public Test {
+public:
+	void operator()() override {
+		RtpStreamStatistics stats;
+		stats.setClockRate(8000);
+		auto start = RtpStreamStatistics::Clock::now();
+
+		// 20ms packets with a sequence wrap-around, every tenth packet is lost.
+		const uint16_t firstSeq = 65000;
+		const int count = 1000;
+		for (int i = 0; i < count; ++i) {
+			if (i % 10 == 5) continue;
+			auto packet = makeRtpPacket(uint16_t(firstSeq + i), 160 * i);
+			stats.onRtpPacket(packet.data(), packet.size(), start + milliseconds(20 * i));
+		}
+		auto snapshot = stats.getSnapshot();
+		BC_ASSERT_EQUAL(snapshot.packets, count - count / 10, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(snapshot.expected, count, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(snapshot.lost, count / 10, int64_t, "%lld");
+		// Perfectly regular arrival: no jitter.
+		BC_ASSERT_TRUE(snapshot.jitterMs < 0.01);
+		// 172 bytes each 20ms, 900 packets in ~20s.
+		BC_ASSERT_TRUE(snapshot.bitrateKbps > 60 && snapshot.bitrateKbps < 65);
+
+		// Irregular arrival: +/- 10ms around the expected time.
+		RtpStreamStatistics jittery;
+		for (int i = 0; i < count; ++i) {
+			auto packet = makeRtpPacket(uint16_t(i), 160 * i);
+			jittery.onRtpPacket(packet.data(), packet.size(), start + milliseconds(20 * i + (i % 2 ? 10 : 0)));
+		}
+		snapshot = jittery.getSnapshot();
+		BC_ASSERT_EQUAL(snapshot.lost, 0, int64_t, "%lld");
+		BC_ASSERT_TRUE(snapshot.jitterMs > 9 && snapshot.jitterMs < 11);
+
+		// A new SSRC restarts the sequence without counting the gap as lost.
+		auto packet = makeRtpPacket(30000, 0, 0x5678);
+		jittery.onRtpPacket(packet.data(), packet.size(), start + seconds(30));
+		snapshot = jittery.getSnapshot();
+		BC_ASSERT_EQUAL(snapshot.lost, 0, int64_t, "%lld");
+		BC_ASSERT_EQUAL(snapshot.expected, count + 1, uint64_t, "%llu");
+	}
+};
+
+class RtcpReportTest : public Test {
+public:
+	void operator()() override {
+		RtpStreamStatistics stats;
+		stats.setClockRate(8000);
+		// Compound packet: RR with one report block, followed by an SDES.
+		vector<uint8_t> rtcp(32 + 8, 0);
+		rtcp[0] = 0x81;
+		rtcp[1] = 201;
+		rtcp[3] = 7; // (32 / 4) - 1
+		rtcp[8 + 4] = 64; // fraction lost: 64/256 = 25%
+		uint32_t jitter = htonl(80); // 10ms at 8kHz
+		memcpy(&rtcp[8 + 12], &jitter, sizeof(jitter));
+		rtcp[32] = 0x81;
+		rtcp[33] = 202;
+		rtcp[35] = 1;
+		stats.onRtcpPacket(rtcp.data(), rtcp.size());
+
+		auto snapshot = stats.getSnapshot();
+		BC_ASSERT_EQUAL(snapshot.rtcpPackets, 1, uint64_t, "%llu");
+		BC_ASSERT_TRUE(snapshot.remoteFractionLost > 24.9 && snapshot.remoteFractionLost < 25.1);
+		BC_ASSERT_TRUE(snapshot.remoteJitterMs > 9.9 && snapshot.remoteJitterMs < 10.1);
+
+		// Truncated packets are ignored.
+		rtcp[8 + 4] = 0;
+		stats.onRtcpPacket(rtcp.data(), 20);
+		BC_ASSERT_TRUE(stats.getSnapshot().remoteFractionLost > 24.9);
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("RTP loss and jitter", run<RtpLossAndJitterTest>),
+    TEST_NO_TAG("RTCP report blocks", run<RtcpReportTest>),
+};
+
+test_suite_t rtpStatisticsSuite = {
+    "RTP statistics", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
@@ -0,0 +1,178 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "flexisip-config.h"
+#include "flexisip/logmanager.hh"
+
+#include "sdp-modifier.hh"
+#include "sofia-wrapper/msg-sip.hh"
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+namespace tester {
+
+static const string sOfferSdp{"v=0\r\n"
+                              "o=kijou 2959 756 IN IP4 192.168.1.197\r\n"
+                              "s=Talk\r\n"
+                              "c=IN IP4 192.168.1.197\r\n"
+                              "t=0 0\r\n"
+                              "a=ice-pwd:fe26e5da31eb0957ad9eb1f0\r\n"
+                              "a=ice-ufrag:caba7d03\r\n"
+                              "m=audio 7254 RTP/AVPF 96 0 8 101\r\n"
+                              "a=rtpmap:96 opus/48000/2\r\n"
+                              "a=fmtp:96 useinbandfec=1\r\n"
+                              "a=rtpmap:101 telephone-event/8000\r\n"
+                              "a=candidate:1 1 UDP 2130706303 192.168.1.197 7254 typ host\r\n"
+                              "a=candidate:1 2 UDP 2130706302 192.168.1.197 7255 typ host\r\n"
+                              "m=video 9078 RTP/AVPF 96\r\n"
+                              "a=rtpmap:96 VP8/90000\r\n"
+                              "a=candidate:1 1 UDP 2130706303 192.168.1.197 9078 typ host\r\n"
+                              "a=candidate:1 2 UDP 2130706302 192.168.1.197 9079 typ host\r\n"};
+
+/* One branch of a forked INVITE: only the Via branch and the request-uri differ. */
+static shared_ptr<MsgSip> makeBranch(int branch, const string& sdp = sOfferSdp) {
+	string request{"INVITE sip:jean.claude@192.168.1." + to_string(10 + branch) + ":5060 SIP/2.0\r\n"
+	               "Via: SIP/2.0/UDP 192.168.1.197:5060;branch=z9hG4bK." + to_string(branch) + ";rport\r\n"
+	               "Max-Forwards: 70\r\n"
+	               "From: \"Kijou\" <sip:kijou@sip.linphone.org>;tag=08HMIWXqx\r\n"
+	               "To: \"Jean Claude\" <sip:jean.claude@sip.linphone.org>\r\n"
+	               "Call-ID: 6g7z4~lD8M\r\n"
+	               "CSeq: 20 INVITE\r\n"
+	               "Contact: <sip:kijou@192.168.1.197>\r\n"
+	               "Content-Type: application/sdp\r\n"
+	               "Content-Length: " + to_string(sdp.size()) + "\r\n"
+	               "\r\n" +
+	               sdp};
+	return make_shared<MsgSip>(0, request);
+}
+
+class SdpParseCacheTest : public Test {
+public:
+	void operator()() override {
+		SdpParseCache cache;
+		auto first = makeBranch(1);
+		auto second = makeBranch(2);
+
+		bool hit = true;
+		auto m1 = cache.createModifier(first->getHome(), first->getSip(), "nortpproxy", &hit);
+		BC_HARD_ASSERT_TRUE(m1 != nullptr);
+		BC_ASSERT_FALSE(hit);
+		auto m2 = cache.createModifier(second->getHome(), second->getSip(), "nortpproxy", &hit);
+		BC_HARD_ASSERT_TRUE(m2 != nullptr);
+		BC_ASSERT_TRUE(hit);
+		BC_ASSERT_EQUAL(cache.getHits(), 1, unsigned long, "%lu");
+		BC_ASSERT_EQUAL(cache.getMisses(), 1, unsigned long, "%lu");
+
+		// Each branch works on its own copy of the session.
+		BC_ASSERT_TRUE(m1->mSession != m2->mSession);
+		m1->changeAudioIpPort("10.0.0.1", 20000);
+		m1->addAttribute("nortpproxy", "yes");
+		string ip;
+		int port = 0;
+		m2->getAudioIpPort(&ip, &port);
+		BC_ASSERT_STRING_EQUAL(ip.c_str(), "192.168.1.197");
+		BC_ASSERT_EQUAL(port, 7254, int, "%i");
+		BC_ASSERT_FALSE(m2->hasAttribute("nortpproxy"));
+
+		// The rewritten SDP only differs by what was patched.
+		BC_ASSERT_EQUAL(m1->update(first->getMsg(), first->getSip()), 0, int, "%i");
+		BC_ASSERT_EQUAL(m2->update(second->getMsg(), second->getSip()), 0, int, "%i");
+		string body1{first->getSip()->sip_payload->pl_data, first->getSip()->sip_payload->pl_len};
+		string body2{second->getSip()->sip_payload->pl_data, second->getSip()->sip_payload->pl_len};
+		BC_ASSERT_TRUE(body1.find("m=audio 20000 ") != string::npos);
+		BC_ASSERT_TRUE(body1.find("a=nortpproxy:yes") != string::npos);
+		BC_ASSERT_TRUE(body2.find("m=audio 7254 ") != string::npos);
+		BC_ASSERT_TRUE(body2.find("a=candidate:1 1 UDP 2130706303 192.168.1.197 9078 typ host") != string::npos);
+
+		// A different body (re-INVITE) is parsed again.
+		string other{sOfferSdp};
+		other.replace(other.find("7254 RTP"), 4, "7354");
+		auto third = makeBranch(3, other);
+		auto m3 = cache.createModifier(third->getHome(), third->getSip(), "nortpproxy", &hit);
+		BC_HARD_ASSERT_TRUE(m3 != nullptr);
+		BC_ASSERT_FALSE(hit);
+		m3->getAudioIpPort(&ip, &port);
+		BC_ASSERT_EQUAL(port, 7354, int, "%i");
+
+		// Invalid SDP is not cached.
+		auto invalid = makeBranch(4, "v=0\r\nthis is not sdp\r\n");
+		BC_ASSERT_TRUE(cache.createModifier(invalid->getHome(), invalid->getSip(), "", &hit) == nullptr);
+		BC_ASSERT_TRUE(cache.createModifier(invalid->getHome(), invalid->getSip(), "", &hit) == nullptr);
+		BC_ASSERT_FALSE(hit);
+	}
+};
+
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+/*
+ * Cost of preparing the SDP of a ten branches fork, with and without the cache. Timings are only reported.
+ */
+class SdpParseCacheBenchmark : public Test {
+public:
+	void operator()() override {
+		constexpr int forkCount = 1000;
+		constexpr int branchCount = 10;
+		vector<shared_ptr<MsgSip>> branches;
+		for (int i = 0; i < branchCount; ++i) branches.push_back(makeBranch(i));
+
+		auto start = steady_clock::now();
+		for (int f = 0; f < forkCount; ++f) {
+			for (auto& b : branches) {
+				auto m = SdpModifier::createFromSipMsg(b->getHome(), b->getSip());
+				m->changeAudioIpPort("10.0.0.1", 20000);
+			}
+		}
+		auto parseDuration = steady_clock::now() - start;
+
+		start = steady_clock::now();
+		for (int f = 0; f < forkCount; ++f) {
+			SdpParseCache cache;
+			for (auto& b : branches) {
+				auto m = cache.createModifier(b->getHome(), b->getSip());
+				m->changeAudioIpPort("10.0.0.1", 20000);
+			}
+		}
+		auto cacheDuration = steady_clock::now() - start;
+
+		auto usPerFork = [&](auto d) { return duration_cast<nanoseconds>(d).count() / 1000.0 / forkCount; };
+		SLOGI << "SdpParseCacheBenchmark: " << forkCount << " forks of " << branchCount << " branches\n"
+		      << "\tparse per branch: " << usPerFork(parseDuration) << " us/fork\n"
+		      << "\tparse cache:      " << usPerFork(cacheDuration) << " us/fork";
+	}
+};
+#endif
+
+static test_t tests[] = {
+    TEST_NO_TAG("SDP parse cache", run<SdpParseCacheTest>),
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+    TEST_NO_TAG("SDP parse cache benchmark", run<SdpParseCacheBenchmark>),
+#endif
+};
+
+test_suite_t sdpModifierSuite = {
+    "SDP modifier", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
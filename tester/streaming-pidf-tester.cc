@@ -0,0 +1,216 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include "flexisip-config.h"
+#include "flexisip/logmanager.hh"
+
+#include "presence/streaming-pidf.hh"
+#include "utils/xml-pull-parser.hh"
+#include "xml/data-model.hh"
+#include "xml/pidf+xml.hh"
+#include "xml/rpid.hh"
+
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace flexisip {
+namespace tester {
+
+namespace {
+
+// As published by Linphone.
+const string linphonePidf =
+    R"(<?xml version="1.0" encoding="UTF-8"?>
+<presence xmlns="urn:ietf:params:xml:ns:pidf" xmlns:dm="urn:ietf:params:xml:ns:pidf:data-model" xmlns:rpid="urn:ietf:params:xml:ns:pidf:rpid" entity="sip:alice@sip.example.org">
+  <tuple id="qmn5wj">
+    <status>
+      <basic>open</basic>
+    </status>
+    <contact priority="0.8">sip:alice@sip.example.org</contact>
+    <timestamp>2022-05-17T10:42:03Z</timestamp>
+  </tuple>
+  <dm:person id="ce1ezt">
+    <dm:note xml:lang="en">Back soon</dm:note>
+    <rpid:activities>
+      <rpid:away/>
+    </rpid:activities>
+  </dm:person>
+</presence>
+)";
+
+// With an extension of the status unknown to Flexisip.
+const string extendedPidf =
+    R"(<?xml version="1.0" encoding="UTF-8"?>
+<presence xmlns="urn:ietf:params:xml:ns:pidf" entity="sip:bob@sip.example.org">
+  <tuple id="a1">
+    <status><basic>closed</basic><im:im xmlns:im="urn:ietf:params:xml:ns:pidf:im">busy</im:im></status>
+  </tuple>
+</presence>
+)";
+
+unique_ptr<Xsd::Pidf::Presence> parseWithXsd(const string& body) {
+	istringstream data(body);
+	return Xsd::Pidf::parsePresence(data, Xsd::XmlSchema::Flags::dont_validate);
+}
+
+string serializeWithXsd(const Xsd::Pidf::Presence& presence) {
+	ostringstream out;
+	Xsd::XmlSchema::NamespaceInfomap map;
+	map[""].name = "urn:ietf:params:xml:ns:pidf";
+	Xsd::Pidf::serializePresence(out, presence, map);
+	return out.str();
+}
+
+} // namespace
+
+class XmlPullParserTest : public Test {
+public:
+	void operator()() override {
+		using Event = XmlPullParser::Event;
+		const string doc =
+		    R"(<?xml version="1.0"?><a xmlns="urn:a" xmlns:b="urn:b" x="1"><!-- comment --><b:c b:y='2'/>text</a>)";
+		XmlPullParser parser{doc.data(), doc.size()};
+
+		BC_HARD_ASSERT_TRUE(parser.next() == Event::StartElement);
+		BC_ASSERT_TRUE(parser.isElement("urn:a", "a"));
+		BC_HARD_ASSERT_TRUE(parser.getAttributes().size() == 1);
+		BC_ASSERT_TRUE(parser.getAttributes()[0].ns.empty());
+		BC_ASSERT_TRUE(parser.getAttributes()[0].value == "1");
+		BC_HARD_ASSERT_TRUE(parser.next() == Event::StartElement);
+		BC_ASSERT_TRUE(parser.isElement("urn:b", "c"));
+		BC_HARD_ASSERT_TRUE(parser.getAttributes().size() == 1);
+		BC_ASSERT_TRUE(parser.getAttributes()[0].ns == "urn:b");
+		BC_ASSERT_TRUE(parser.getAttributes()[0].value == "2");
+		BC_HARD_ASSERT_TRUE(parser.next() == Event::EndElement);
+		BC_ASSERT_TRUE(parser.isElement("urn:b", "c"));
+		BC_HARD_ASSERT_TRUE(parser.next() == Event::Text);
+		BC_ASSERT_TRUE(parser.getText() == "text");
+		BC_HARD_ASSERT_TRUE(parser.next() == Event::EndElement);
+		BC_ASSERT_TRUE(parser.isElement("urn:a", "a"));
+		BC_ASSERT_TRUE(parser.next() == Event::EndDocument);
+
+		// Unsupported or malformed documents.
+		for (const string invalid :
+		     {"<a><b></a>", "<a>&amp;</a>", "<a/><b/>", "<x:a/>", "<a><![CDATA[x]]></a>", "<a>"}) {
+			XmlPullParser invalidParser{invalid.data(), invalid.size()};
+			auto event = invalidParser.next();
+			while (event != Event::EndDocument && event != Event::Error)
+				event = invalidParser.next();
+			BC_ASSERT_TRUE(event == Event::Error);
+		}
+	}
+};
+
+class StreamingPidfParseTest : public Test {
+public:
+	void operator()() override {
+		auto presence = StreamingPidf::parse(linphonePidf.data(), linphonePidf.size());
+		BC_HARD_ASSERT_TRUE(presence != nullptr);
+		BC_ASSERT_STRING_EQUAL(presence->getEntity().c_str(), "sip:alice@sip.example.org");
+		BC_HARD_ASSERT_TRUE(presence->getTuple().size() == 1);
+		const auto& tuple = presence->getTuple().front();
+		BC_ASSERT_STRING_EQUAL(tuple.getId().c_str(), "qmn5wj");
+		BC_ASSERT_TRUE(tuple.getStatus().getBasic() && *tuple.getStatus().getBasic() == Xsd::Pidf::Basic::open);
+		BC_ASSERT_TRUE(tuple.getContact() && tuple.getContact()->getPriority());
+		BC_HARD_ASSERT_TRUE(presence->getPerson().present());
+		BC_ASSERT_EQUAL(presence->getPerson()->getActivities().size(), 1, size_t, "%zu");
+		BC_ASSERT_EQUAL(presence->getPerson()->getActivities().front().getAway().size(), 1, size_t, "%zu");
+
+		// The object model is the same as the one of the XSD parser.
+		BC_ASSERT_STRING_EQUAL(serializeWithXsd(*presence).c_str(),
+		                       serializeWithXsd(*parseWithXsd(linphonePidf)).c_str());
+
+		// Unknown content is left to the XSD parser.
+		BC_ASSERT_TRUE(StreamingPidf::parse(extendedPidf.data(), extendedPidf.size()) == nullptr);
+		BC_ASSERT_TRUE(parseWithXsd(extendedPidf) != nullptr);
+		const string invalid = "<presence xmlns=\"urn:ietf:params:xml:ns:pidf\"><tuple/></presence>";
+		BC_ASSERT_TRUE(StreamingPidf::parse(invalid.data(), invalid.size()) == nullptr);
+	}
+};
+
+class StreamingPidfSerializeTest : public Test {
+public:
+	void operator()() override {
+		auto presence = parseWithXsd(linphonePidf);
+		string pidf{};
+		BC_HARD_ASSERT_TRUE(StreamingPidf::serialize(*presence, pidf));
+		// Reading the document back gives the same object model.
+		BC_ASSERT_STRING_EQUAL(serializeWithXsd(*parseWithXsd(pidf)).c_str(), serializeWithXsd(*presence).c_str());
+
+		// Unknown content is left to the XSD serializer.
+		pidf.clear();
+		BC_ASSERT_FALSE(StreamingPidf::serialize(*parseWithXsd(extendedPidf), pidf));
+		BC_ASSERT_TRUE(pidf.empty());
+	}
+};
+
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+/**
+ * Compare the time spent parsing and serializing the PIDF document of Linphone with the XSD bindings, and without.
+ */
+class StreamingPidfBenchmark : public Test {
+public:
+	void operator()() override {
+		constexpr int iterations = 2000;
+		auto xsdPresence = parseWithXsd(linphonePidf);
+		auto benchmark = [](const char* name, const function<bool()>& function) {
+			const auto start = steady_clock::now();
+			for (int i = 0; i < iterations; ++i) {
+				if (!function()) return false;
+			}
+			SLOGI << name << ": " << duration_cast<microseconds>(steady_clock::now() - start).count() / iterations
+			      << "us per document";
+			return true;
+		};
+
+		BC_ASSERT_TRUE(benchmark("XSD parser", [] { return parseWithXsd(linphonePidf) != nullptr; }));
+		BC_ASSERT_TRUE(benchmark("Streaming parser", [] {
+			return StreamingPidf::parse(linphonePidf.data(), linphonePidf.size()) != nullptr;
+		}));
+		BC_ASSERT_TRUE(
+		    benchmark("XSD serializer", [&xsdPresence] { return !serializeWithXsd(*xsdPresence).empty(); }));
+		BC_ASSERT_TRUE(benchmark("Streaming serializer", [&xsdPresence] {
+			string pidf{};
+			return StreamingPidf::serialize(*xsdPresence, pidf);
+		}));
+	}
+};
+#endif
+
+static test_t tests[] = {
+    TEST_NO_TAG("XML pull parser", run<XmlPullParserTest>),
+    TEST_NO_TAG("Streaming PIDF parser", run<StreamingPidfParseTest>),
+    TEST_NO_TAG("Streaming PIDF serializer", run<StreamingPidfSerializeTest>),
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+    TEST_NO_TAG("Streaming PIDF benchmark", run<StreamingPidfBenchmark>),
+#endif
+};
+
+test_suite_t streamingPidfSuite = {
+    "Streaming PIDF", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
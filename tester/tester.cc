@@ -86,14 +86,24 @@ void flexisip_tester_init(void (*ftester_printf)(int level, const char* fmt, va_
 	bc_tester_add_suite(&extended_contact_suite);
 	bc_tester_add_suite(&flexisip::tester::fork_call_suite);
 	bc_tester_add_suite(&fork_context_suite);
+	bc_tester_add_suite(&flexisip::tester::mediaFilterSuite);
 	bc_tester_add_suite(&module_pushnitification_suite);
+	bc_tester_add_suite(&flexisip::tester::msgSipSuite);
 #if ENABLE_UNIT_TESTS_PUSH_NOTIFICATION
 	bc_tester_add_suite(&push_notification_suite);
 #endif
 	bc_tester_add_suite(&register_suite);
+#if ENABLE_CONFERENCE
+	bc_tester_add_suite(&flexisip::tester::reginfoSuite);
+#endif
 	bc_tester_add_suite(&flexisip::tester::registarDbSuite);
 	bc_tester_add_suite(&router_suite);
+	bc_tester_add_suite(&flexisip::tester::rtpStatisticsSuite);
+	bc_tester_add_suite(&flexisip::tester::sdpModifierSuite);
 	bc_tester_add_suite(&flexisip::tester::threadPoolSuite);
+#if ENABLE_TRANSCODER
+	bc_tester_add_suite(&flexisip::tester::transcoderSuite);
+#endif
 	bc_tester_add_suite(&tls_connection_suite);
 	bc_tester_add_suite(&flexisip::tester::utilsSuite);
 #if ENABLE_B2BUA
@@ -103,6 +113,19 @@ void flexisip_tester_init(void (*ftester_printf)(int level, const char* fmt, va_
 	bc_tester_add_suite(&flexisip::tester::fork_context_mysql_suite);
 #endif
 	bc_tester_add_suite(&flexisip::tester::moduleInfoSuite);
+	bc_tester_add_suite(&flexisip::tester::moduleLatencyStatsSuite);
+	bc_tester_add_suite(&flexisip::tester::overloadControlSuite);
+	bc_tester_add_suite(&flexisip::tester::dosProtectionSuite);
+	bc_tester_add_suite(&flexisip::tester::nonceStoreSuite);
+	bc_tester_add_suite(&flexisip::tester::expiringCacheSuite);
+	bc_tester_add_suite(&flexisip::tester::authDbBatchSuite);
+#if ENABLE_PRESENCE
+	bc_tester_add_suite(&flexisip::tester::compactPresenceSuite);
+	bc_tester_add_suite(&flexisip::tester::presenceClusterSuite);
+	bc_tester_add_suite(&flexisip::tester::resourceListCacheSuite);
+	bc_tester_add_suite(&flexisip::tester::rlmiWriterSuite);
+	bc_tester_add_suite(&flexisip::tester::streamingPidfSuite);
+#endif
 	bc_tester_add_suite(&flexisip::tester::domain_registration_suite);
 #if ENABLE_CONFERENCE && 0 // Remove '&& 0' when the 'Registration Event' suite is fixed.
 	bc_tester_add_suite(&registration_event_suite);
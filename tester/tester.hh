@@ -71,12 +71,31 @@ extern test_suite_t agentSuite;
 #if ENABLE_B2BUA
 extern test_suite_t b2bua_suite;
 #endif
+extern test_suite_t compactPresenceSuite;
 extern test_suite_t domain_registration_suite;
 extern test_suite_t fork_call_suite;
 extern test_suite_t fork_context_mysql_suite;
+extern test_suite_t dosProtectionSuite;
+extern test_suite_t mediaFilterSuite;
 extern test_suite_t moduleInfoSuite;
+extern test_suite_t moduleLatencyStatsSuite;
+extern test_suite_t msgSipSuite;
+extern test_suite_t nonceStoreSuite;
+extern test_suite_t expiringCacheSuite;
+extern test_suite_t authDbBatchSuite;
+extern test_suite_t overloadControlSuite;
+extern test_suite_t presenceClusterSuite;
+extern test_suite_t reginfoSuite;
 extern test_suite_t registarDbSuite;
+extern test_suite_t resourceListCacheSuite;
+extern test_suite_t rlmiWriterSuite;
+extern test_suite_t rtpStatisticsSuite;
+extern test_suite_t sdpModifierSuite;
+extern test_suite_t streamingPidfSuite;
 extern test_suite_t threadPoolSuite;
+#if ENABLE_TRANSCODER
+extern test_suite_t transcoderSuite;
+#endif
 extern test_suite_t utilsSuite;
 
 } // namespace tester
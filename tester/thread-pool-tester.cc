@@ -16,10 +16,14 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "flexisip-config.h"
+#include "flexisip/logmanager.hh"
+
 #include "tester.hh"
 #include "utils/test-paterns/test.hh"
 #include "utils/thread/auto-thread-pool.hh"
 #include "utils/thread/basic-thread-pool.hh"
+#include "utils/thread/work-stealing-thread-pool.hh"
 
 using namespace std;
 
@@ -98,9 +102,9 @@ private:
 		mEndedCounter++;
 	};
 
-	std::atomic_uint mStartedCounter;
-	std::atomic_uint mRunningCounter;
-	std::atomic_uint mEndedCounter;
+	std::atomic_uint mStartedCounter{0};
+	std::atomic_uint mRunningCounter{0};
+	std::atomic_uint mEndedCounter{0};
 
 	std::atomic_bool mCanRun{false};
 	std::atomic_bool mCanStop{false};
@@ -109,9 +113,119 @@ private:
 	std::condition_variable mCondition{};
 };
 
+class WorkStealingThreadPoolPriorityTest : public Test {
+public:
+	void operator()() override {
+		using Priority = WorkStealingThreadPool::Priority;
+		WorkStealingThreadPool threadPool{1, 10};
+		mutex mtx{};
+		condition_variable condition{};
+		bool canRun = false;
+		vector<int> order{};
+
+		// Keep the only thread busy while the other tasks are queued.
+		BC_HARD_ASSERT_TRUE(threadPool.run([&]() {
+			unique_lock<mutex> lock(mtx);
+			condition.wait(lock, [&]() { return canRun; });
+		}));
+		BC_HARD_ASSERT_TRUE(waitFor([&]() { return threadPool.getStats().queuedTasks == 0; }, 100ms));
+		auto record = [&](int i) {
+			return [&, i]() {
+				lock_guard<mutex> lock(mtx);
+				order.push_back(i);
+			};
+		};
+		BC_HARD_ASSERT_TRUE(threadPool.run(record(1), Priority::Low));
+		BC_HARD_ASSERT_TRUE(threadPool.run(record(2), Priority::Normal));
+		BC_HARD_ASSERT_TRUE(threadPool.run(record(3), Priority::High));
+		BC_HARD_ASSERT_TRUE(threadPool.run(record(4), Priority::Normal));
+		BC_HARD_ASSERT_TRUE(threadPool.run(record(5), Priority::High));
+		BC_ASSERT_EQUAL(threadPool.getStats().queuedTasks, 5, size_t, "%zu");
+
+		{
+			lock_guard<mutex> lock(mtx);
+			canRun = true;
+		}
+		condition.notify_all();
+		threadPool.stop();
+		BC_ASSERT_TRUE(order == (vector<int>{3, 5, 2, 4, 1}));
+
+		const auto stats = threadPool.getStats();
+		BC_ASSERT_EQUAL(stats.executedTasks, 6, uint64_t, "%llu");
+		BC_ASSERT_EQUAL(stats.queuedTasks, 0, size_t, "%zu");
+		BC_ASSERT_TRUE(stats.maxWaitTime > 0us);
+		BC_ASSERT_TRUE(stats.totalRunTime > 0us);
+	}
+};
+
+class WorkStealingThreadPoolStealingTest : public Test {
+public:
+	void operator()() override {
+		WorkStealingThreadPool threadPool{4, 0};
+		atomic_uint counter{0};
+
+		// All the tasks submitted by a task go to the queue of its thread: the other threads have to steal them.
+		BC_HARD_ASSERT_TRUE(threadPool.run([&]() {
+			for (int i = 0; i < 1000; i++) {
+				threadPool.run([&]() {
+					this_thread::sleep_for(10us);
+					counter++;
+				});
+			}
+		}));
+		BC_ASSERT_TRUE(waitFor([&]() { return counter == 1000; }, 5s));
+		threadPool.stop();
+		BC_ASSERT_TRUE(threadPool.getStats().stolenTasks > 0);
+		BC_ASSERT_EQUAL(threadPool.getStats().rejectedTasks, 0, uint64_t, "%llu");
+	}
+};
+
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+/**
+ * Many threads submitting short tasks at the same time, as when the proxy is under load.
+ * The durations are logged to compare the implementations, only the completion of the tasks is checked.
+ */
+template <typename ThreadPoolType>
+class ThreadPoolBenchmark : public Test {
+public:
+	void operator()() override {
+		constexpr int submitterCount = 8;
+		constexpr int taskCount = 20000;
+		ThreadPoolType threadPool{8, 0};
+		atomic_uint counter{0};
+
+		const auto start = chrono::steady_clock::now();
+		vector<thread> submitters{};
+		for (int i = 0; i < submitterCount; i++) {
+			submitters.emplace_back([&]() {
+				for (int j = 0; j < taskCount; j++) {
+					threadPool.run([&]() { counter++; });
+				}
+			});
+		}
+		for (auto& submitter : submitters) {
+			submitter.join();
+		}
+		threadPool.stop();
+		const auto duration = chrono::steady_clock::now() - start;
+
+		BC_ASSERT_EQUAL(counter, submitterCount * taskCount, unsigned, "%u");
+		SLOGI << "ThreadPoolBenchmark: " << submitterCount * taskCount << " tasks run in "
+		      << chrono::duration_cast<chrono::milliseconds>(duration).count() << "ms";
+	}
+};
+#endif
+
 static test_t tests[] = {
     TEST_NO_TAG("BasicThreadPool testing", run<ThreadPoolTest<BasicThreadPool>>),
     TEST_NO_TAG("AutoThreadPool testing", run<ThreadPoolTest<AutoThreadPool>>),
+    TEST_NO_TAG("WorkStealingThreadPool testing", run<ThreadPoolTest<WorkStealingThreadPool>>),
+    TEST_NO_TAG("WorkStealingThreadPool priorities", run<WorkStealingThreadPoolPriorityTest>),
+    TEST_NO_TAG("WorkStealingThreadPool stealing", run<WorkStealingThreadPoolStealingTest>),
+#ifdef ENABLE_UNIT_TESTS_BENCHMARKS
+    TEST_NO_TAG("BasicThreadPool benchmark", run<ThreadPoolBenchmark<BasicThreadPool>>),
+    TEST_NO_TAG("WorkStealingThreadPool benchmark", run<ThreadPoolBenchmark<WorkStealingThreadPool>>),
+#endif
 };
 
 test_suite_t threadPoolSuite = {
@@ -0,0 +1,175 @@
+/*
+    Flexisip, a flexible SIP proxy server with media capabilities.
+    Copyright (C) 2010-2022 Belledonne Communications SARL, All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "module-transcode.hh"
+#include "sofia-wrapper/msg-sip.hh"
+#include "tester.hh"
+#include "utils/test-paterns/test.hh"
+
+using namespace std;
+using namespace sofiasip;
+
+namespace flexisip {
+namespace tester {
+
+namespace {
+
+// The tickers of a started manager, as seen by its load getter.
+pair<MSTicker*, MSTicker*> getTickers(TickerManager& manager) {
+	set<MSTicker*> tickers{};
+	manager.setLoadGetter([&tickers](MSTicker* ticker) {
+		tickers.insert(ticker);
+		return 0.0f;
+	});
+	manager.getLeastLoaded();
+	if (tickers.size() != 2) return {nullptr, nullptr};
+	return {*tickers.begin(), *tickers.rbegin()};
+}
+
+// A PCMU call, both sides running in the given ticker.
+shared_ptr<TranscodedCall> makeCall(MSFactory* factory, int index, MSTicker* ticker) {
+	const auto id = to_string(index);
+	MsgSip invite{0, "INVITE sip:bob@sip.example.org SIP/2.0\r\n"
+	                 "Via: SIP/2.0/UDP 192.168.1.10:5060;branch=z9hG4bK.call" + id + "\r\n"
+	                 "From: <sip:alice@sip.example.org>;tag=alice" + id + "\r\n"
+	                 "To: <sip:bob@sip.example.org>\r\n"
+	                 "Call-ID: call-" + id + "\r\n"
+	                 "CSeq: 20 INVITE\r\n"
+	                 "Content-Length: 0\r\n\r\n"};
+	auto call = make_shared<TranscodedCall>(factory, invite.getSip(), "127.0.0.1");
+	call->prepare(CallContextParams{0});
+	for (auto* side : {call->getFrontSide(), call->getBackSide()}) {
+		auto* pcmu = payload_type_clone(&payload_type_pcmu8000);
+		payload_type_set_number(pcmu, 0);
+		list<PayloadType*> payloads{pcmu};
+		side->assignPayloads(payloads);
+	}
+	call->join(ticker);
+	return call;
+}
+
+bool isRunningIn(const shared_ptr<TranscodedCall>& call, MSTicker* ticker) {
+	return call->getTicker() == ticker &&
+	       bctbx_list_find(ticker->execution_list, call->getFrontSide()->getRecvPoint().filter) != nullptr &&
+	       bctbx_list_find(ticker->execution_list, call->getBackSide()->getRecvPoint().filter) != nullptr;
+}
+
+} // namespace
+
+/*
+ * The calls go to the least loaded ticker, and each ticker thread runs on its own CPU when pinning is enabled.
+ */
+class TickerChoiceTest : public Test {
+public:
+	void operator()() override {
+		TickerManager manager{};
+		manager.configure(2, true);
+		const auto tickers = getTickers(manager);
+		BC_HARD_ASSERT_TRUE(tickers.first != nullptr);
+
+		map<MSTicker*, float> loads{{tickers.first, 80.0f}, {tickers.second, 10.0f}};
+		manager.setLoadGetter([&loads](MSTicker* ticker) { return loads[ticker]; });
+		BC_ASSERT_TRUE(manager.getLeastLoaded() == tickers.second);
+		BC_ASSERT_TRUE(manager.getMostLoaded() == tickers.first);
+		BC_ASSERT_TRUE(manager.chooseOne() == tickers.second);
+		loads[tickers.second] = 90.0f;
+		BC_ASSERT_TRUE(manager.chooseOne() == tickers.first);
+
+		set<int> cpus{};
+		for (auto* ticker : {tickers.first, tickers.second}) {
+			cpu_set_t cpuset;
+			CPU_ZERO(&cpuset);
+			BC_HARD_ASSERT_TRUE(pthread_getaffinity_np(ticker->thread, sizeof(cpuset), &cpuset) == 0);
+			BC_ASSERT_TRUE(CPU_COUNT(&cpuset) == 1);
+			for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+				if (CPU_ISSET(cpu, &cpuset)) cpus.insert(cpu);
+			}
+		}
+		BC_ASSERT_TRUE(cpus.size() == (ModuleToolbox::getCpuCount() > 1 ? 2 : 1));
+	}
+};
+
+/*
+ * A call of an overloaded ticker is moved to the least loaded one, with its running graphs.
+ */
+class TickerRebalanceTest : public Test {
+public:
+	void operator()() override {
+		unique_ptr<MSFactory, decltype(&ms_factory_destroy)> factory{ms_factory_new_with_voip(), ms_factory_destroy};
+		TickerManager manager{};
+		manager.configure(2, false);
+		const auto tickers = getTickers(manager);
+		BC_HARD_ASSERT_TRUE(tickers.first != nullptr);
+		auto* busiest = tickers.first;
+		auto* idlest = tickers.second;
+
+		list<shared_ptr<CallContextBase>> calls{};
+		for (int i = 0; i < 3; ++i) {
+			calls.push_back(makeCall(factory.get(), i, busiest));
+		}
+		map<MSTicker*, float> loads{{busiest, 90.0f}, {idlest, 10.0f}};
+		manager.setLoadGetter([&loads](MSTicker* ticker) { return loads[ticker]; });
+
+		// Disabled, or not loaded enough.
+		BC_ASSERT_TRUE(manager.rebalance(calls, 0) == nullptr);
+		BC_ASSERT_TRUE(manager.rebalance(calls, 95) == nullptr);
+
+		const auto moved = manager.rebalance(calls, 50);
+		BC_HARD_ASSERT_TRUE(moved != nullptr);
+		BC_ASSERT_TRUE(isRunningIn(moved, idlest));
+		BC_ASSERT_TRUE(bctbx_list_find(busiest->execution_list, moved->getFrontSide()->getRecvPoint().filter) ==
+		               nullptr);
+		int stillBusy = 0;
+		for (const auto& ctx : calls) {
+			auto call = dynamic_pointer_cast<TranscodedCall>(ctx);
+			if (call != moved && isRunningIn(call, busiest)) stillBusy++;
+		}
+		BC_ASSERT_TRUE(stillBusy == 2);
+
+		// Moving another call would only swap the imbalance.
+		loads[busiest] = 40.0f;
+		loads[idlest] = 30.0f;
+		BC_ASSERT_TRUE(manager.rebalance(calls, 35) == nullptr);
+
+		// Back to the first ticker, then a no-op to the same ticker.
+		moved->moveTo(busiest);
+		BC_ASSERT_TRUE(isRunningIn(moved, busiest));
+		moved->moveTo(busiest);
+		BC_ASSERT_TRUE(isRunningIn(moved, busiest));
+	}
+};
+
+static test_t tests[] = {
+    TEST_NO_TAG("Ticker choice", run<TickerChoiceTest>),
+    TEST_NO_TAG("Ticker rebalance", run<TickerRebalanceTest>),
+};
+
+test_suite_t transcoderSuite = {
+    "Transcoder", nullptr, nullptr, nullptr, nullptr, sizeof(tests) / sizeof(tests[0]), tests};
+
+} // namespace tester
+} // namespace flexisip
@@ -16,10 +16,14 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <map>
+
 #include <bctoolbox/tester.h>
 
 #include "tester.hh"
+#include "utils/consistent-hash-ring.hh"
 #include "utils/test-paterns/test.hh"
+#include "utils/timer-wheel.hh"
 #include "utils/uri-utils.hh"
 
 using namespace std;
@@ -59,8 +63,104 @@ public:
 	}
 };
 
+class TimerWheelTest : public Test {
+public:
+	void operator()() override {
+		TimerWheel wheel{4};
+		vector<int> fired{};
+		auto first = wheel.createTimer(2, [&fired] { fired.push_back(1); });
+		// Longer than a revolution of the wheel.
+		auto second = wheel.createTimer(6, [&fired] { fired.push_back(2); });
+		auto cancelled = wheel.createTimer(2, [&fired] { fired.push_back(3); });
+		TimerWheel::Timer rescheduled{};
+		auto third = wheel.createTimer(1, [&wheel, &fired, &rescheduled] {
+			fired.push_back(4);
+			rescheduled = wheel.createTimer(1, [&fired] { fired.push_back(5); });
+		});
+		BC_ASSERT_EQUAL(wheel.size(), 4, size_t, "%zu");
+		cancelled.cancel();
+		BC_ASSERT_EQUAL(wheel.size(), 3, size_t, "%zu");
+
+		wheel.tick();
+		BC_ASSERT_TRUE(fired == vector<int>({4}));
+		BC_ASSERT_FALSE(third.isActive());
+		BC_ASSERT_TRUE(rescheduled.isActive());
+		wheel.tick();
+		BC_ASSERT_TRUE(fired == vector<int>({4, 1, 5}) || fired == vector<int>({4, 5, 1}));
+		for (int i = 0; i < 3; i++) {
+			wheel.tick();
+		}
+		BC_ASSERT_EQUAL(fired.size(), 3, size_t, "%zu");
+		wheel.tick();
+		BC_ASSERT_EQUAL(fired.size(), 4, size_t, "%zu");
+		BC_ASSERT_EQUAL(fired.back(), 2, int, "%d");
+		BC_ASSERT_EQUAL(wheel.size(), 0, size_t, "%zu");
+
+		// Timers are cancelled on destruction, and may cancel each other while firing.
+		{
+			auto destroyed = wheel.createTimer(1, [&fired] { fired.push_back(6); });
+		}
+		TimerWheel::Timer a{}, b{};
+		a = wheel.createTimer(1, [&fired, &b] {
+			fired.push_back(7);
+			b.cancel();
+		});
+		b = wheel.createTimer(1, [&fired, &a] {
+			fired.push_back(8);
+			a.cancel();
+		});
+		wheel.tick();
+		BC_ASSERT_EQUAL(fired.size(), 5, size_t, "%zu");
+		BC_ASSERT_TRUE(fired.back() == 7 || fired.back() == 8);
+		BC_ASSERT_EQUAL(wheel.size(), 0, size_t, "%zu");
+	}
+};
+
+class ConsistentHashRingTest : public Test {
+public:
+	void operator()() override {
+		const vector<string> nodes{"sip:node1.example.org", "sip:node2.example.org", "sip:node3.example.org"};
+		ConsistentHashRing ring{nodes};
+		BC_ASSERT_STRING_EQUAL(ConsistentHashRing{}.getOwner("alice@example.org").c_str(), "");
+
+		// The owners don't depend on the order of the nodes, and the keys are spread over all of them.
+		ConsistentHashRing reversed{{nodes.rbegin(), nodes.rend()}};
+		map<string, int> counts{};
+		vector<string> keys{};
+		for (int i = 0; i < 3000; i++) {
+			keys.push_back("user" + to_string(i) + "@example.org");
+			const auto& owner = ring.getOwner(keys.back());
+			BC_ASSERT_TRUE(owner == reversed.getOwner(keys.back()));
+			counts[owner]++;
+		}
+		BC_HARD_ASSERT_TRUE(counts.size() == 3);
+		for (const auto& count : counts) {
+			BC_ASSERT_TRUE(count.second > 600 && count.second < 1400);
+		}
+
+		// Adding a node only moves keys to it.
+		auto grown = ring;
+		grown.addNode("sip:node4.example.org");
+		int moved = 0;
+		for (const auto& key : keys) {
+			const auto& owner = grown.getOwner(key);
+			if (owner == ring.getOwner(key)) continue;
+			BC_ASSERT_STRING_EQUAL(owner.c_str(), "sip:node4.example.org");
+			moved++;
+		}
+		BC_ASSERT_TRUE(moved > 400 && moved < 1200);
+
+		grown.removeNode("sip:node4.example.org");
+		for (const auto& key : keys) {
+			BC_ASSERT_TRUE(grown.getOwner(key) == ring.getOwner(key));
+		}
+	}
+};
+
 static test_t tests[] = {
     TEST_NO_TAG("UriUtils isIpv4Address and isIpv6Address method test", run<UriUtilsIsIpvXTest>),
+    TEST_NO_TAG("TimerWheel", run<TimerWheelTest>),
+    TEST_NO_TAG("ConsistentHashRing", run<ConsistentHashRingTest>),
 };
 
 test_suite_t utilsSuite = {